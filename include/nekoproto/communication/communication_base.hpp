@@ -19,12 +19,23 @@
 #include <ilias/net.hpp>
 #include <ilias/platform.hpp>
 #include <ilias/result.hpp>
+#include <ilias/sync/mutex.hpp>
+#include <ilias/sync/oneshot.hpp>
 #include <ilias/task.hpp>
 #include <ilias/task/task.hpp>
 #include <ilias/task/utils.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
 #include <set>
 #include <system_error>
+#include <utility>
 
+#include "nekoproto/communication/serializer_pool.hpp"
 #include "nekoproto/global/global.hpp"
 #include "nekoproto/proto/proto_base.hpp"
 #include "nekoproto/serialization/binary_serializer.hpp"
@@ -52,6 +63,10 @@ enum MessageType {
     SliceHeader,         // the slice header of the message.
     Cancel,              // cancel the message
     VersionVerification, // verification of protocol version
+    StreamHeader,        // opens a multiplexed stream
+    StreamSlice,         // the next slice of a multiplexed stream
+    StreamWindow,        // grants the sender of a multiplexed stream more bytes
+    StreamCancel,        // drops a multiplexed stream
 };
 
 /**
@@ -76,14 +91,50 @@ enum MessageType {
  * 5. VersionVerification:
  *      the length field is 0.
  *      the data field is the version of the protocol.
+ * 6. StreamHeader:
+ *      the length field is 8, followed by the total size (4 bytes) and the proto type (4 bytes).
+ *      the data field is the stream id.
+ * 7. StreamSlice:
+ *      the length field is the length of this slice, slices of one stream arrive in order.
+ *      the data field is the stream id.
+ * 8. StreamWindow:
+ *      the length field is the number of bytes granted, no payload follows.
+ *      the data field is the stream id.
+ * 9. StreamCancel:
+ *      the length field is 0.
+ *      the data field is the stream id.
  * @note the length field is the length of the message, not the length of the header
  *
  */
 class NEKO_PROTO_API MessageHeader {
 public:
-    MessageHeader(uint32_t length = 0, int32_t data = 0, uint16_t messageType = 0)
+    static constexpr std::size_t KSize = 10;
+    using Bytes                        = std::array<std::byte, KSize>;
+
+    constexpr MessageHeader(uint32_t length = 0, int32_t data = 0, uint16_t messageType = 0)
         : length(length), data(data), messageType(messageType) {}
-    static int size() { return 10; }
+    static constexpr int size() { return static_cast<int>(KSize); }
+    /**
+     * @brief write the header to @p output in wire order
+     *  same bytes as the BinarySerializer encoding of the raw fixed fields below,
+     * without building a serializer or a buffer.
+     */
+    constexpr void pack(std::byte* output) const NEKO_NOEXCEPT {
+        _packBigEndian(output, length);
+        _packBigEndian(output + 4, static_cast<uint32_t>(data));
+        _packBigEndian(output + 8, messageType);
+    }
+    constexpr Bytes pack() const NEKO_NOEXCEPT {
+        Bytes bytes{};
+        pack(bytes.data());
+        return bytes;
+    }
+    static constexpr MessageHeader unpack(const std::byte* input) NEKO_NOEXCEPT {
+        return MessageHeader(_unpackBigEndian<uint32_t>(input),
+                             static_cast<int32_t>(_unpackBigEndian<uint32_t>(input + 4)),
+                             _unpackBigEndian<uint16_t>(input + 8));
+    }
+
     uint32_t length = 0; // 4 : the length of the message, no't contain the header
     int32_t data    = 0; // 4 : the proto type of this message in Complete message or the slice index in Slice message
     uint16_t messageType = 0; // 2 : the type of this message
@@ -91,8 +142,26 @@ public:
     NEKO_SERIALIZER(make_tags<BinaryTag{.fixed_length = sizeof(uint32_t)}>(length),
                     make_tags<BinaryTag{.fixed_length = sizeof(int32_t)}>(data),
                     make_tags<BinaryTag{.fixed_length = sizeof(uint16_t)}>(messageType))
+
+private:
+    template <typename U>
+    static constexpr void _packBigEndian(std::byte* output, U value) NEKO_NOEXCEPT {
+        for (std::size_t idx = 0; idx < sizeof(U); ++idx) {
+            output[idx] = static_cast<std::byte>(value >> (8 * (sizeof(U) - 1 - idx)));
+        }
+    }
+    template <typename U>
+    static constexpr U _unpackBigEndian(const std::byte* input) NEKO_NOEXCEPT {
+        U value = 0;
+        for (std::size_t idx = 0; idx < sizeof(U); ++idx) {
+            value = static_cast<U>((value << 8) | static_cast<U>(input[idx]));
+        }
+        return value;
+    }
 };
 
+static_assert(MessageHeader::unpack(MessageHeader(0x01020304, -2, 0x090A).pack().data()).data == -2);
+
 struct ProtocolTable {
     uint32_t protocolFactoryVersion            = 0;
     std::map<uint32_t, std::string> protoTable = {};
@@ -130,7 +199,8 @@ private:
     NEKO_CHANNEL_ERROR(Timeout, 6, "the operator is timeout", -1)                                                      \
     NEKO_CHANNEL_ERROR(NoData, 7, "serializer maybe failed, return no data.", -1)                                      \
     NEKO_CHANNEL_ERROR(SerializationError, 10, "serialization failed, return error.", -1)                              \
-    NEKO_CHANNEL_ERROR(UnsupportOperator, 11, "unsupported operator", -1)
+    NEKO_CHANNEL_ERROR(UnsupportOperator, 11, "unsupported operator", -1)                                              \
+    NEKO_CHANNEL_ERROR(StreamWindowExceeded, 12, "receive more stream data than the window granted", -1)
 
 #define NEKO_CHANNEL_ERROR(name, code, message, _) name = code,
 enum class ErrorCode { NEKO_CHANNEL_ERROR_CODE_TABLE };
@@ -197,48 +267,55 @@ protected:
     ProtoClientBase(const ProtoClientBase&) = delete;
     ProtoClientBase(ProtoClientBase&&)      = default;
 
-    auto _serializeMessageData(const IProto& message, bool runInThread, bool reserveHeader) const
+    auto _serializeMessageData(const IProto& message, bool runInThread, bool reserveHeader)
         -> IoTask<std::vector<char>>;
-    auto _serializeHeader(const MessageHeader& header) const -> std::vector<char>;
-    auto _serializeVersionPacket() const -> IoTask<std::vector<char>>;
+    auto _recycleSendBuffer(std::vector<char>&& buffer) -> void;
+    auto _serializeVersionPacket() -> IoTask<std::vector<char>>;
     auto _syncProtocolTable(std::span<std::byte> payload, const MessageHeader& header) -> IoTask<void>;
     auto _finishMessage(IProto message, const MessageHeader& header, std::vector<std::byte>&& payload, StreamFlag flag)
         -> IoTask<IProto>;
     auto _createProto(uint32_t type) const -> IProto;
+    auto _setProtocolTable(ProtocolTable table) -> void;
 
 protected:
     ProtoFactory* mFactory       = nullptr;
     ProtocolTable mProtocolTable = {};
+    /// remote proto type -> local proto type, rebuilt whenever mProtocolTable changes.
+    std::vector<int> mRemoteTypes = {};
+    /// buffer of the last finished send, reused by the next one so a steady sender does not allocate.
+    std::vector<char> mSendBuffer = {};
+    /// keeps the SerializerInThread jobs of this connection in order on the serializer pool.
+    std::shared_ptr<SerializerPool::Strand> mSerializerStrand = std::make_shared<SerializerPool::Strand>();
+    static constexpr std::size_t KMaxRecycledSendBuffer = 1U << 20U;
 };
 
-inline auto ProtoClientBase::_serializeMessageData(const IProto& message, bool runInThread, bool reserveHeader) const
+inline auto ProtoClientBase::_serializeMessageData(const IProto& message, bool runInThread, bool reserveHeader)
     -> IoTask<std::vector<char>> {
-    std::vector<char> data;
-    if (reserveHeader) {
-        data.resize(MessageHeader::size());
-    }
-    bool ok = false;
+    // Take the recycled buffer rather than borrowing it, an overlapping send simply starts from an empty one.
+    std::vector<char> data     = std::exchange(mSendBuffer, {});
+    const std::size_t headroom = reserveHeader ? MessageHeader::KSize : 0;
     if (runInThread) {
-        ok = co_await blocking([&]() -> bool { return message.toData(data); });
+        auto strand          = mSerializerStrand;
+        const auto serialize = [&]() -> bool { return !message.toData(data, headroom).empty(); };
+        auto ret = co_await SerializerPool::instance().run(strand, SerializerPool::Stage::Serialize,
+                                                           strand->lastSerializedBytes, serialize);
+        if (!ret) {
+            co_return Err(ret.error());
+        }
+        strand->lastSerializedBytes = data.size();
     } else {
-        ok = message.toData(data);
-    }
-    if (!ok) {
-        data.clear();
+        message.toData(data, headroom);
     }
     co_return data;
 }
 
-inline auto ProtoClientBase::_serializeHeader(const MessageHeader& header) const -> std::vector<char> {
-    std::vector<char> headerData;
-    BinarySerializer::OutputSerializer serializer(headerData);
-    if (!serializer(make_tags<BinaryTag{.raw_fixed_data = true}>(header)) || !serializer.end()) {
-        headerData.clear();
+inline auto ProtoClientBase::_recycleSendBuffer(std::vector<char>&& buffer) -> void {
+    if (buffer.capacity() <= KMaxRecycledSendBuffer && buffer.capacity() > mSendBuffer.capacity()) {
+        mSendBuffer = std::move(buffer);
     }
-    return headerData;
 }
 
-inline auto ProtoClientBase::_serializeVersionPacket() const -> IoTask<std::vector<char>> {
+inline auto ProtoClientBase::_serializeVersionPacket() -> IoTask<std::vector<char>> {
     ProtocolTable protocolTable = {};
     if (mFactory != nullptr) {
         protocolTable.protocolFactoryVersion = mFactory->version();
@@ -259,12 +336,9 @@ inline auto ProtoClientBase::_serializeVersionPacket() const -> IoTask<std::vect
         co_return std::vector<char>{};
     }
 
-    auto headerData = _serializeHeader(MessageHeader(static_cast<uint32_t>(data.size() - MessageHeader::size()),
-                                                     proto.type(), MessageType::VersionVerification));
-    if (headerData.empty()) {
-        co_return std::vector<char>{};
-    }
-    memcpy(data.data(), headerData.data(), headerData.size());
+    MessageHeader(static_cast<uint32_t>(data.size() - MessageHeader::size()), proto.type(),
+                  MessageType::VersionVerification)
+        .pack(reinterpret_cast<std::byte*>(data.data()));
     co_return data;
 }
 
@@ -283,7 +357,7 @@ inline auto ProtoClientBase::_syncProtocolTable(std::span<std::byte> payload, co
         NEKO_LOG_WARN("Communication", "ProtoFactory version mismatch: {} != {}", protoTable->protocolFactoryVersion,
                       mFactory->version());
     }
-    mProtocolTable = *protoTable;
+    _setProtocolTable(std::move(*protoTable));
     NEKO_LOG_INFO("Communication", "sync message proto table, version: {}. size: {}",
                   mProtocolTable.protocolFactoryVersion, mProtocolTable.protoTable.size());
     for (const auto& [type, name] : mProtocolTable.protoTable) {
@@ -311,8 +385,12 @@ inline auto ProtoClientBase::_finishMessage(IProto message, const MessageHeader&
         return message.fromData(reinterpret_cast<char*>(payload.data()), payload.size());
     };
     if (static_cast<int>(flag & StreamFlag::SerializerInThread) != 0) {
-        auto ret = co_await blocking(parsePayload);
+        auto ret = co_await SerializerPool::instance().run(mSerializerStrand, SerializerPool::Stage::Parse,
+                                                           payload.size(), parsePayload);
         if (!ret) {
+            co_return Err(ret.error());
+        }
+        if (!*ret) {
             co_return Err(Error(ErrorCode::InvalidProtoData));
         }
     } else if (!parsePayload()) {
@@ -325,16 +403,20 @@ inline auto ProtoClientBase::_createProto(const uint32_t type) const -> IProto {
     if (mFactory == nullptr) {
         return {};
     }
-    if (type <= NEKO_RESERVED_PROTO_TYPE_SIZE || mProtocolTable.protoTable.empty()) {
-        return mFactory->create(type);
+    if (type <= NEKO_RESERVED_PROTO_TYPE_SIZE || mRemoteTypes.empty()) {
+        return mFactory->create(static_cast<int>(type));
     }
-    auto it = mProtocolTable.protoTable.find(type);
-    if (it != mProtocolTable.protoTable.end()) {
-        return mFactory->create(it->second.c_str());
+    if (type < mRemoteTypes.size()) {
+        return mFactory->create(mRemoteTypes[type]);
     }
     return {};
 }
 
+inline auto ProtoClientBase::_setProtocolTable(ProtocolTable table) -> void {
+    mProtocolTable = std::move(table);
+    mRemoteTypes   = ProtoFactory::translateProtoTypes(mProtocolTable.protoTable);
+}
+
 } // namespace detail
 
 template <CommunicationStream T = DynStream>
@@ -350,26 +432,109 @@ public:
     ~ProtoStreamClient() noexcept;
     auto setStreamClient(ClientType&& streamClient, bool reconnect = false) -> void;
     auto send(const IProto& message, StreamFlag flag = StreamFlag::None) -> IoTask<void>;
+    /**
+     * @brief Send @p message as a multiplexed stream.
+     *
+     * Concurrent streams on one connection interleave slice by slice. The
+     * stream with the highest @p priority that still has send window goes
+     * next, equal priorities take turns. Plain send calls wait for one slice
+     * at most, so small messages are not stuck behind a bulk transfer. The
+     * receiver grants window as its recv loop consumes slices, so a peer
+     * that stops reading stalls the stream instead of buffering it all.
+     * Grants are read by recv as well, so the sending side needs a recv
+     * loop running for streams larger than the window. recv never waits
+     * for the connection to send a grant: while another frame is being
+     * written the grant is queued and goes out before that writer's next
+     * frame. recv fails with ErrorCode::StreamWindowExceeded when a peer
+     * sends a slice larger than the window it was granted.
+     */
+    auto sendStream(const IProto& message, uint8_t priority = 0, StreamFlag flag = StreamFlag::None) -> IoTask<void>;
     auto recv(StreamFlag flag = StreamFlag::None) -> IoTask<IProto>;
     auto close() -> IoTask<void>;
     auto setProtoTable(uint32_t version, const std::map<uint32_t, std::string>& protoTable) -> void;
     auto getProtoTable() const -> const ProtocolTable&;
+    /**
+     * @brief Set the size of one slice sent with StreamFlag::SliceData, header included.
+     *
+     * 0 (the default) adapts the size to how much the stream accepts per write.
+     */
+    auto setSliceSize(uint32_t size) -> void;
+    auto sliceSize() const -> uint32_t;
 
 private:
     auto _sendRaw(std::span<std::byte> data) -> IoTask<void>;
     auto _recvRaw(std::span<std::byte> buf) -> IoTask<void>;
     auto _sendVersion() -> IoTask<void>;
     auto _recvVersion(const MessageHeader& header) -> IoTask<void>;
-    auto _sendSlice(std::span<std::byte> data, uint32_t offset) -> IoTask<void>;
+    auto _sendSlices(std::span<const char> data, uint32_t& offset) -> IoTask<void>;
     auto _sendCancel(uint32_t data = 0) -> IoTask<void>;
+    auto _sendLocked(std::span<std::byte> data) -> IoTask<void>;
+    auto _sendPieces(std::span<std::span<const std::byte>> pieces) -> IoTask<std::size_t>;
+    auto _queueControl(const MessageHeader::Bytes& frame) -> IoTask<void>;
+    auto _flushControl() -> IoTask<void>;
+
+    struct OutboundStream {
+        uint32_t id        = 0;
+        uint8_t priority   = 0;
+        std::vector<char> data;
+        std::size_t offset = 0;
+        std::size_t window = 0;
+        uint64_t lastTurn  = 0;
+        bool done          = false;
+        std::optional<ilias::oneshot::Sender<bool>> windowWaiter;
+    };
+    struct InboundStream {
+        IProto message;
+        int32_t type   = 0;
+        uint32_t total = 0;
+        std::vector<std::byte> buffer;
+        std::size_t window         = 0; // bytes the peer may still send, grants included
+        std::size_t unacknowledged = 0;
+    };
+    struct StreamMux {
+        ilias::Mutex writeMutex;
+        std::map<uint32_t, std::weak_ptr<OutboundStream>> outbound; // owned by the sendStream call
+        std::map<uint32_t, InboundStream> inbound;
+        std::deque<MessageHeader::Bytes> control; // window grants waiting for the next writer
+        uint32_t nextId     = 1;
+        uint64_t turns      = 0;
+        std::size_t writers = 0; // holding or waiting for writeMutex; each sends queued control frames
+        bool broken         = false;
+    };
+    /// Counts a writer from before it waits for writeMutex until after it lets go.
+    struct WriteScope {
+        StreamMux& mux;
+        explicit WriteScope(StreamMux& owner) : mux(owner) { ++mux.writers; }
+        WriteScope(const WriteScope&)                    = delete;
+        auto operator=(const WriteScope&) -> WriteScope& = delete;
+        ~WriteScope() { --mux.writers; }
+    };
+
+    auto _driveStream(OutboundStream& own) -> IoTask<void>;
+    auto _nextStream() -> std::shared_ptr<OutboundStream>;
+    auto _sendStreamSlice(OutboundStream& stream) -> IoTask<void>;
+    auto _recvStreamHeader() -> IoTask<void>;
+    auto _recvStreamSlice(std::optional<InboundStream>& completed) -> IoTask<void>;
 
 private:
     ClientType mStreamClient             = {};
+    detail::StreamReadBuffer mReadBuffer = detail::StreamReadBuffer{IoError::ConnectionReset};
     std::vector<std::byte> mBuffer       = {};
     MessageHeader mHeader                = {};
     IProto mMessage                      = {};
     uint32_t mSliceSizeCount             = 0;
-    static constexpr uint32_t gSliceSize = 1200;
+    uint32_t mSliceSize                  = KDefaultSliceSize;
+    bool mAdaptiveSliceSize              = true;
+    std::unique_ptr<StreamMux> mMux      = std::make_unique<StreamMux>();
+
+    static constexpr uint32_t KMinSliceSize      = 1200;
+    static constexpr uint32_t KDefaultSliceSize  = 16U * 1024U;
+    static constexpr uint32_t KMaxSliceSize      = 1024U * 1024U;
+    static constexpr uint32_t KMaxSliceBatchSize = 1024U * 1024U;
+    static constexpr uint32_t KSlicesPerWrite    = 8;
+    static constexpr uint32_t KStreamSliceSize   = 16U * 1024U;
+    static constexpr uint32_t KStreamWindow      = 256U * 1024U;
+    static constexpr uint32_t KMaxInboundStreams = 64;
 };
 
 template <CommunicationStream T>
@@ -378,8 +543,10 @@ inline ProtoStreamClient<T>::ProtoStreamClient(ProtoFactory& factory, T&& stream
 
 template <CommunicationStream T>
 inline ProtoStreamClient<T>::ProtoStreamClient(ProtoStreamClient&& other)
-    : Base(std::move(other)), mStreamClient(std::move(other.mStreamClient)), mBuffer(std::move(other.mBuffer)),
-      mHeader(std::move(other.mHeader)), mMessage(std::move(other.mMessage)), mSliceSizeCount(other.mSliceSizeCount) {}
+    : Base(std::move(other)), mStreamClient(std::move(other.mStreamClient)),
+      mReadBuffer(std::move(other.mReadBuffer)), mBuffer(std::move(other.mBuffer)), mHeader(std::move(other.mHeader)),
+      mMessage(std::move(other.mMessage)), mSliceSizeCount(other.mSliceSizeCount), mSliceSize(other.mSliceSize),
+      mAdaptiveSliceSize(other.mAdaptiveSliceSize), mMux(std::move(other.mMux)) {}
 
 template <CommunicationStream T>
 inline ProtoStreamClient<T>::~ProtoStreamClient() noexcept {}
@@ -387,11 +554,15 @@ inline ProtoStreamClient<T>::~ProtoStreamClient() noexcept {}
 template <CommunicationStream T>
 inline auto ProtoStreamClient<T>::setStreamClient(T&& streamClient, bool reconnect) -> void {
     mStreamClient = std::move(streamClient);
+    // Read-ahead bytes belong to the previous connection even when a message is resumed.
+    mReadBuffer.clear();
     if (!reconnect) {
         mHeader         = {};
         mMessage        = {};
         mSliceSizeCount = 0;
         mBuffer.clear();
+        mMux->inbound.clear();
+        mMux->control.clear();
     }
 }
 
@@ -428,47 +599,90 @@ inline auto ProtoStreamClient<T>::send(const IProto& message, StreamFlag flag) -
 
     if (isSlice) {
         uint32_t offset = 0;
-        auto headerData = Base::_serializeHeader(
-            MessageHeader(static_cast<uint32_t>(messageData.size()), message.type(), MessageType::SliceHeader));
-        if (headerData.empty()) {
-            co_return Err(ErrorCode::SerializationError);
-        }
-        auto ret =
-            co_await (_sendRaw({reinterpret_cast<std::byte*>(headerData.data()), headerData.size()}) | unstoppable());
+        auto headerData =
+            MessageHeader(static_cast<uint32_t>(messageData.size()), message.type(), MessageType::SliceHeader).pack();
+        auto ret = co_await (_sendLocked(headerData) | unstoppable());
         NEKO_LOG_INFO("Communication", "Sending slice header, protocol: {}, size: {}", message.type(),
                       messageData.size());
-        while (true) {
-            auto sliceSize =
-                std::min(static_cast<uint32_t>(messageData.size()) - offset, gSliceSize - MessageHeader::size());
-            NEKO_ASSERT(sliceSize > 0, "Communication", "Slice size is 0");
-            if (!ret) {
-                if (ret.error() == IoError::Canceled) {
-                    co_await (_sendCancel(message.type()) | unstoppable());
-                }
-                co_return Err(ret.error());
-            }
-            ret = co_await (_sendSlice({reinterpret_cast<std::byte*>(messageData.data() + offset), sliceSize}, offset) |
-                            unstoppable());
-            offset += sliceSize;
-            if (offset >= messageData.size()) {
-                break;
+        // Each batch of slices is written whole; a cancel is only acted on between batches.
+        while (ret && offset < messageData.size()) {
+            ret = co_await (_sendSlices(messageData, offset) | unstoppable());
+        }
+        Base::_recycleSendBuffer(std::move(messageData));
+        if (!ret) {
+            if (ret.error() == IoError::Canceled) {
+                co_await (_sendCancel(message.type()) | unstoppable());
             }
+            co_return Err(ret.error());
         }
         co_return {};
     }
 
-    auto headerData = Base::_serializeHeader(MessageHeader(
-        static_cast<uint32_t>(messageData.size() - MessageHeader::size()), message.type(), MessageType::Complete));
-    if (headerData.empty()) {
-        co_return Err(Error(ErrorCode::SerializationError));
-    }
-    NEKO_ASSERT(static_cast<int>(headerData.size()) == MessageHeader::size(), "Communication",
-                "Header size is not correct");
-    memcpy(messageData.data(), headerData.data(), headerData.size());
+    MessageHeader(static_cast<uint32_t>(messageData.size() - MessageHeader::size()), message.type(),
+                  MessageType::Complete)
+        .pack(reinterpret_cast<std::byte*>(messageData.data()));
     NEKO_LOG_INFO("Communication", "Send header: message type: Complete proto type: {} length: {}", message.type(),
                   messageData.size() - MessageHeader::size());
-    co_return co_await (_sendRaw({reinterpret_cast<std::byte*>(messageData.data()), messageData.size()}) |
-                        unstoppable());
+    auto ret = co_await (_sendLocked({reinterpret_cast<std::byte*>(messageData.data()), messageData.size()}) |
+                         unstoppable());
+    Base::_recycleSendBuffer(std::move(messageData));
+    co_return ret;
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::sendStream(const IProto& message, uint8_t priority, StreamFlag flag)
+    -> IoTask<void> {
+    if (!mStreamClient) {
+        NEKO_LOG_ERROR("Communication", "no stream client");
+        co_return Err(ErrorCode::UnsupportOperator);
+    }
+    if (static_cast<int>(flag & StreamFlag::VersionVerification) != 0) {
+        auto ret = co_await (_sendVersion() | unstoppable());
+        if (!ret) {
+            NEKO_LOG_WARN("Communication", "send to verification version failed!");
+            co_return Err(ret.error());
+        }
+    }
+
+    const bool isThread = static_cast<int>(flag & StreamFlag::SerializerInThread) != 0;
+    auto messageDataRet = co_await Base::_serializeMessageData(message, isThread, false);
+    if (!messageDataRet) {
+        co_return Err(messageDataRet.error());
+    }
+    auto stream  = std::make_shared<OutboundStream>();
+    stream->data = std::move(messageDataRet.value());
+    if (stream->data.empty()) {
+        co_return Err(ErrorCode::NoData);
+    }
+    if (stream->data.size() > std::numeric_limits<uint32_t>::max()) {
+        co_return Err(IoError::MessageTooLarge);
+    }
+    stream->id       = mMux->nextId++;
+    stream->priority = priority;
+    stream->window   = KStreamWindow;
+
+    std::array<std::byte, MessageHeader::KSize + 8> opening{};
+    MessageHeader(8, static_cast<int32_t>(stream->id), MessageType::StreamHeader).pack(opening.data());
+    // The payload reuses the header's big-endian layout: total size, then proto type.
+    const auto payload = MessageHeader(static_cast<uint32_t>(stream->data.size()), message.type()).pack();
+    std::copy_n(payload.begin(), 8, opening.begin() + MessageHeader::KSize);
+    NEKO_LOG_INFO("Communication", "Opening stream {}, protocol: {}, size: {}, priority: {}", stream->id,
+                  message.type(), stream->data.size(), priority);
+    auto ret = co_await (_sendLocked(opening) | unstoppable());
+    if (ret) {
+        mMux->outbound.emplace(stream->id, stream);
+        ret = co_await _driveStream(*stream);
+        mMux->outbound.erase(stream->id);
+    }
+    Base::_recycleSendBuffer(std::move(stream->data));
+    if (!ret) {
+        if (ret.error() == IoError::Canceled) {
+            auto cancel = MessageHeader(0, static_cast<int32_t>(stream->id), MessageType::StreamCancel).pack();
+            co_await (_sendLocked(cancel) | unstoppable());
+        }
+        co_return Err(ret.error());
+    }
+    co_return {};
 }
 
 template <CommunicationStream T>
@@ -487,20 +701,16 @@ inline auto ProtoStreamClient<T>::recv(StreamFlag flag) -> IoTask<IProto> {
                       "verification protofactory version, please set it in send function.");
     }
 
+    // A finished stream is kept apart from mBuffer, which may hold a half received legacy slice message.
+    std::optional<InboundStream> completed;
     bool isComplete = false;
     while (!isComplete) {
-        mHeader = MessageHeader();
-        std::vector<std::byte> messageHeader(MessageHeader::size());
+        MessageHeader::Bytes messageHeader{};
         auto ret = co_await (_recvRaw(messageHeader));
         if (!ret) {
             co_return Err(ret.error());
         }
-        BinarySerializer::InputSerializer serializer(reinterpret_cast<char*>(messageHeader.data()),
-                                                     messageHeader.size());
-        auto taggedHeader = make_tags<BinaryTag{.raw_fixed_data = true}>(mHeader);
-        if (!serializer(taggedHeader)) {
-            co_return Err(Error(ErrorCode::InvalidMessageHeader));
-        }
+        mHeader = MessageHeader::unpack(messageHeader.data());
 
         switch (mHeader.messageType) {
         case MessageType::Cancel:
@@ -518,6 +728,31 @@ inline auto ProtoStreamClient<T>::recv(StreamFlag flag) -> IoTask<IProto> {
             }
             break;
         }
+        case MessageType::StreamHeader:
+            if (auto ret2 = co_await _recvStreamHeader(); !ret2) {
+                co_return Err(ret2.error());
+            }
+            break;
+        case MessageType::StreamSlice:
+            if (auto ret2 = co_await _recvStreamSlice(completed); !ret2) {
+                co_return Err(ret2.error());
+            }
+            isComplete = completed.has_value();
+            break;
+        case MessageType::StreamWindow:
+            if (auto item = mMux->outbound.find(static_cast<uint32_t>(mHeader.data)); item != mMux->outbound.end()) {
+                if (auto stream = item->second.lock(); stream != nullptr) {
+                    stream->window += mHeader.length;
+                    if (auto waiter = std::exchange(stream->windowWaiter, std::nullopt); waiter.has_value()) {
+                        (void)waiter->send(true);
+                    }
+                }
+            }
+            break;
+        case MessageType::StreamCancel:
+            NEKO_LOG_INFO("Communication", "recv header: message type: StreamCancel, stream: {}", mHeader.data);
+            mMux->inbound.erase(static_cast<uint32_t>(mHeader.data));
+            break;
         case MessageType::Complete:
             NEKO_LOG_INFO("Communication", "recv header: message type: Complete proto type: {} lenght: {}",
                           mHeader.data, mHeader.length);
@@ -561,23 +796,18 @@ inline auto ProtoStreamClient<T>::recv(StreamFlag flag) -> IoTask<IProto> {
         }
     }
 
+    if (completed.has_value()) {
+        co_return co_await Base::_finishMessage(std::move(completed->message),
+                                                MessageHeader(completed->total, completed->type, MessageType::Complete),
+                                                std::move(completed->buffer), flag);
+    }
     co_return co_await Base::_finishMessage(std::move(mMessage), mHeader, std::move(mBuffer), flag);
 }
 
 template <CommunicationStream T>
 inline auto ProtoStreamClient<T>::_recvRaw(std::span<std::byte> buf) -> IoTask<void> {
-    int readsize = 0;
-    while (readsize < static_cast<int>(buf.size())) {
-        auto ret = co_await mStreamClient.read({buf.data() + readsize, buf.size() - readsize});
-        if (!ret) {
-            co_return Err(ret.error());
-        }
-        if (ret.value() == 0) {
-            co_return Err(IoError::ConnectionReset);
-        }
-        readsize += static_cast<uint32_t>(ret.value());
-    }
-    co_return {};
+    // Headers and small bodies are served from read-ahead, large bodies are read in place.
+    co_return co_await mReadBuffer.readExact(mStreamClient, buf);
 }
 
 template <CommunicationStream T>
@@ -590,7 +820,7 @@ inline auto ProtoStreamClient<T>::_sendVersion() -> IoTask<void> {
     if (data.empty()) {
         co_return Err(Error(ErrorCode::SerializationError));
     }
-    auto ret = co_await _sendRaw({reinterpret_cast<std::byte*>(data.data()), data.size()});
+    auto ret = co_await _sendLocked({reinterpret_cast<std::byte*>(data.data()), data.size()});
     if (!ret) {
         NEKO_LOG_WARN("Communication", "Failed to send version verification message");
         co_return Err(ret.error());
@@ -610,36 +840,252 @@ inline auto ProtoStreamClient<T>::_recvVersion(const MessageHeader& header) -> I
 }
 
 template <CommunicationStream T>
-inline auto ProtoStreamClient<T>::_sendSlice(std::span<std::byte> data, const uint32_t offset) -> IoTask<void> {
-    auto headerData =
-        Base::_serializeHeader(MessageHeader(static_cast<uint32_t>(data.size()), offset, MessageType::Slice));
-    if (headerData.empty()) {
-        co_return Err(Error(ErrorCode::SerializationError));
+inline auto ProtoStreamClient<T>::_sendSlices(std::span<const char> data, uint32_t& offset) -> IoTask<void> {
+    // Several slices leave together, each as its header followed by a view of the payload, nothing is copied.
+    WriteScope writing(*mMux);
+    auto guard = co_await mMux->writeMutex.lock();
+    if (auto ret = co_await _flushControl(); !ret) {
+        co_return Err(ret.error());
+    }
+    const uint32_t payloadSize = mSliceSize - static_cast<uint32_t>(MessageHeader::KSize);
+    const uint32_t sliceCount  = std::clamp<uint32_t>(KMaxSliceBatchSize / mSliceSize, 1U, KSlicesPerWrite);
+    std::array<MessageHeader::Bytes, KSlicesPerWrite> headers{};
+    std::array<std::span<const std::byte>, KSlicesPerWrite * 2> pieces{};
+    std::size_t count  = 0;
+    std::size_t sended = 0;
+    for (uint32_t idx = 0; idx < sliceCount && offset < data.size(); ++idx) {
+        const auto length = std::min(static_cast<uint32_t>(data.size()) - offset, payloadSize);
+        MessageHeader(length, offset, MessageType::Slice).pack(headers[idx].data());
+        pieces[count++] = headers[idx];
+        pieces[count++] = std::as_bytes(data.subspan(offset, length));
+        NEKO_LOG_INFO("Communication", "Sending slice, offset: {}, length: {}", offset, length);
+        sended += MessageHeader::KSize + length;
+        offset += length;
+    }
+
+    auto shortWrites = co_await _sendPieces(std::span{pieces}.first(count));
+    if (!shortWrites) {
+        NEKO_LOG_WARN("Communication", "Failed to send slice");
+        co_return Err(shortWrites.error());
+    }
+    // Grow while a full batch fits in one write, shrink once the stream only takes part of it, so a batch
+    // tracks the socket send buffer and a cancel never waits behind more than about one buffer of data.
+    if (mAdaptiveSliceSize) {
+        if (*shortWrites > 0) {
+            mSliceSize = std::max(mSliceSize / 2, KMinSliceSize);
+        } else if (sended >= static_cast<std::size_t>(sliceCount) * mSliceSize) {
+            mSliceSize = std::min(mSliceSize * 2, KMaxSliceSize);
+        }
     }
-    auto ret = co_await _sendRaw({reinterpret_cast<std::byte*>(headerData.data()), headerData.size()});
-    NEKO_LOG_INFO("Communication", "Sending slice, offset: {}, length: {}", offset, data.size());
+    co_return co_await _flushControl();
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_sendCancel(const uint32_t data) -> IoTask<void> {
+    auto headerData = MessageHeader(0, data, MessageType::Cancel).pack();
+    auto ret        = co_await _sendLocked(headerData);
     if (!ret) {
-        NEKO_LOG_WARN("Communication", "Failed to send message");
         co_return Err(ret.error());
     }
-    ret = co_await _sendRaw(data);
-    if (!ret) {
-        NEKO_LOG_WARN("Communication", "Failed to send slice");
+    co_return {};
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_sendLocked(std::span<std::byte> data) -> IoTask<void> {
+    // Every frame is written whole under the lock, so plain messages and stream slices can interleave.
+    WriteScope writing(*mMux);
+    auto guard = co_await mMux->writeMutex.lock();
+    if (auto ret = co_await _flushControl(); !ret) {
+        co_return Err(ret.error());
+    }
+    if (auto ret = co_await _sendRaw(data); !ret) {
         co_return Err(ret.error());
     }
+    co_return co_await _flushControl();
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_queueControl(const MessageHeader::Bytes& frame) -> IoTask<void> {
+    // Waiting for writeMutex here could deadlock: the writer may be blocked on a peer whose own recv is
+    // waiting for this very grant. Any writer holding or waiting for the lock sends the frame between its
+    // frames instead; with none, the lock is free and taken at once.
+    mMux->control.push_back(frame);
+    if (mMux->writers != 0U) {
+        co_return {};
+    }
+    co_return co_await _sendLocked({});
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_flushControl() -> IoTask<void> {
+    // Callers hold writeMutex.
+    while (!mMux->control.empty()) {
+        auto frame = mMux->control.front();
+        mMux->control.pop_front();
+        if (auto ret = co_await _sendRaw(frame); !ret) {
+            co_return Err(ret.error());
+        }
+    }
     co_return {};
 }
 
 template <CommunicationStream T>
-inline auto ProtoStreamClient<T>::_sendCancel(const uint32_t data) -> IoTask<void> {
-    auto headerData = Base::_serializeHeader(MessageHeader(0, data, MessageType::Cancel));
-    if (headerData.empty()) {
-        co_return Err(Error(ErrorCode::SerializationError));
+inline auto ProtoStreamClient<T>::_driveStream(OutboundStream& own) -> IoTask<void> {
+    // Every sender with an open stream takes turns at the lock and writes whichever slice is due, which is not
+    // necessarily its own. It only sleeps once nothing at all can move until the peer grants window.
+    while (!own.done) {
+        {
+            WriteScope writing(*mMux);
+            auto guard = co_await mMux->writeMutex.lock();
+            if (own.done) {
+                break;
+            }
+            if (mMux->broken) {
+                co_return Err(IoError::ConnectionReset);
+            }
+            // Grants queued by recv go out on both sides of the slice, so none waits behind it or is left behind.
+            auto ret  = co_await (_flushControl() | unstoppable());
+            auto next = ret ? _nextStream() : nullptr;
+            if (ret && next != nullptr) {
+                ret = co_await (_sendStreamSlice(*next) | unstoppable());
+                if (ret) {
+                    ret = co_await (_flushControl() | unstoppable());
+                }
+            }
+            if (!ret) {
+                mMux->broken = true;
+                for (auto& [id, weak] : mMux->outbound) {
+                    auto stream = weak.lock();
+                    if (stream == nullptr) {
+                        continue;
+                    }
+                    if (auto waiter = std::exchange(stream->windowWaiter, std::nullopt); waiter.has_value()) {
+                        (void)waiter->send(false);
+                    }
+                }
+                co_return Err(ret.error());
+            }
+            if (next != nullptr) {
+                continue;
+            }
+        }
+        auto channel = ilias::oneshot::channel<bool>();
+        own.windowWaiter.emplace(std::move(channel.sender));
+        auto granted = co_await std::move(channel.receiver);
+        if (!granted.has_value()) {
+            co_return Err(IoError::Canceled);
+        }
+        if (!*granted) {
+            co_return Err(IoError::ConnectionReset);
+        }
     }
-    auto ret = co_await _sendRaw({reinterpret_cast<std::byte*>(headerData.data()), headerData.size()});
-    if (!ret) {
+    co_return {};
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_nextStream() -> std::shared_ptr<OutboundStream> {
+    std::shared_ptr<OutboundStream> next;
+    for (auto item = mMux->outbound.begin(); item != mMux->outbound.end();) {
+        // A sendStream call that was torn down while waiting leaves an expired entry behind.
+        auto stream = item->second.lock();
+        if (stream == nullptr) {
+            item = mMux->outbound.erase(item);
+            continue;
+        }
+        ++item;
+        if (stream->done || stream->window == 0) {
+            continue;
+        }
+        if (next == nullptr || stream->priority > next->priority ||
+            (stream->priority == next->priority && stream->lastTurn < next->lastTurn)) {
+            next = std::move(stream);
+        }
+    }
+    return next;
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_sendStreamSlice(OutboundStream& stream) -> IoTask<void> {
+    const auto length =
+        std::min({stream.data.size() - stream.offset, stream.window, static_cast<std::size_t>(KStreamSliceSize)});
+    const auto header =
+        MessageHeader(static_cast<uint32_t>(length), static_cast<int32_t>(stream.id), MessageType::StreamSlice).pack();
+    std::array<std::span<const std::byte>, 2> pieces{
+        header, std::as_bytes(std::span<const char>{stream.data}.subspan(stream.offset, length))};
+    stream.lastTurn = ++mMux->turns;
+    if (auto ret = co_await _sendPieces(pieces); !ret) {
         co_return Err(ret.error());
     }
+    stream.offset += length;
+    stream.window -= length;
+    stream.done = stream.offset == stream.data.size();
+    co_return {};
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_recvStreamHeader() -> IoTask<void> {
+    if (mHeader.length != 8 || mMux->inbound.size() >= KMaxInboundStreams) {
+        co_return Err(Error(ErrorCode::InvalidMessageHeader));
+    }
+    // Decoded through a full header whose first eight bytes match the stream header payload.
+    MessageHeader::Bytes payload{};
+    if (auto ret = co_await _recvRaw({payload.data(), 8}); !ret) {
+        co_return Err(ret.error());
+    }
+    const auto opening = MessageHeader::unpack(payload.data());
+    if (opening.length == 0) {
+        co_return Err(Error(ErrorCode::InvalidMessageHeader));
+    }
+    NEKO_LOG_INFO("Communication", "recv header: message type: StreamHeader, stream: {}, proto type: {}, size: {}",
+                  mHeader.data, opening.data, opening.length);
+    InboundStream stream;
+    stream.message = Base::_createProto(opening.data);
+    if (stream.message == nullptr) {
+        co_return Err(Error(ErrorCode::InvalidProtoType));
+    }
+    stream.type    = opening.data;
+    stream.total   = opening.length;
+    stream.window  = KStreamWindow;
+    // Grow with the data rather than trusting the announced size, the window bounds how far it runs ahead.
+    stream.buffer.reserve(std::min(opening.length, KStreamWindow));
+    mMux->inbound.insert_or_assign(static_cast<uint32_t>(mHeader.data), std::move(stream));
+    co_return {};
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_recvStreamSlice(std::optional<InboundStream>& completed) -> IoTask<void> {
+    const auto id = static_cast<uint32_t>(mHeader.data);
+    auto item     = mMux->inbound.find(id);
+    if (item == mMux->inbound.end() || mHeader.length > item->second.total - item->second.buffer.size()) {
+        co_return Err(Error(ErrorCode::InvalidMessageHeader));
+    }
+    auto& stream = item->second;
+    if (mHeader.length > stream.window) {
+        NEKO_LOG_WARN("Communication", "stream {} sent {} bytes with only {} granted", id, mHeader.length,
+                      stream.window);
+        mMux->inbound.erase(item);
+        co_return Err(Error(ErrorCode::StreamWindowExceeded));
+    }
+    stream.window -= mHeader.length;
+    const auto offset = stream.buffer.size();
+    stream.buffer.resize(offset + mHeader.length);
+    if (auto ret = co_await _recvRaw({stream.buffer.data() + offset, mHeader.length}); !ret) {
+        co_return Err(ret.error());
+    }
+    if (stream.buffer.size() == stream.total) {
+        NEKO_LOG_INFO("Communication", "Received complete stream {}, size({})", id, stream.total);
+        completed.emplace(std::move(stream));
+        mMux->inbound.erase(item);
+        co_return {};
+    }
+    stream.unacknowledged += mHeader.length;
+    if (stream.unacknowledged >= KStreamWindow / 2) {
+        const auto granted = std::exchange(stream.unacknowledged, 0U);
+        stream.window += granted;
+        auto window =
+            MessageHeader(static_cast<uint32_t>(granted), static_cast<int32_t>(id), MessageType::StreamWindow).pack();
+        co_return co_await (_queueControl(window) | unstoppable());
+    }
     co_return {};
 }
 
@@ -655,7 +1101,7 @@ inline auto ProtoStreamClient<T>::close() -> IoTask<void> {
 template <CommunicationStream T>
 inline auto ProtoStreamClient<T>::setProtoTable(const uint32_t version,
                                                 const std::map<uint32_t, std::string>& protoTable) -> void {
-    this->mProtocolTable = ProtocolTable{version, protoTable};
+    this->_setProtocolTable(ProtocolTable{version, protoTable});
 }
 
 template <CommunicationStream T>
@@ -663,6 +1109,17 @@ inline auto ProtoStreamClient<T>::getProtoTable() const -> const ProtocolTable&
     return this->mProtocolTable;
 }
 
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::setSliceSize(const uint32_t size) -> void {
+    mAdaptiveSliceSize = size == 0;
+    mSliceSize         = mAdaptiveSliceSize ? KDefaultSliceSize : std::max<uint32_t>(size, MessageHeader::KSize + 1);
+}
+
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::sliceSize() const -> uint32_t {
+    return mSliceSize;
+}
+
 template <CommunicationStream T>
 inline auto ProtoStreamClient<T>::_sendRaw(std::span<std::byte> data) -> IoTask<void> {
     int sended = 0;
@@ -679,6 +1136,43 @@ inline auto ProtoStreamClient<T>::_sendRaw(std::span<std::byte> data) -> IoTask<
     co_return {};
 }
 
+/// Writes @p pieces in order, consuming them as it goes, and returns how many writes the stream took only in part.
+template <CommunicationStream T>
+inline auto ProtoStreamClient<T>::_sendPieces(std::span<std::span<const std::byte>> pieces) -> IoTask<std::size_t> {
+    std::size_t shortWrites = 0;
+    while (!pieces.empty()) {
+        std::size_t offered = pieces.front().size();
+        if constexpr (detail::VectoredWriteStream<T>) {
+            for (const auto& piece : pieces.subspan(1)) {
+                offered += piece.size();
+            }
+        }
+        auto ret = co_await [&] {
+            if constexpr (detail::VectoredWriteStream<T>) {
+                return mStreamClient.writeVectored(pieces);
+            } else {
+                return mStreamClient.write(pieces.front());
+            }
+        }();
+        if (!ret) {
+            co_return Err(ret.error());
+        }
+        if (ret.value() == 0 && offered != 0) {
+            co_return Err(IoError::ConnectionReset);
+        }
+        shortWrites += ret.value() < offered ? 1 : 0;
+        auto written = ret.value();
+        while (!pieces.empty() && written >= pieces.front().size()) {
+            written -= pieces.front().size();
+            pieces = pieces.subspan(1);
+        }
+        if (!pieces.empty()) {
+            pieces.front() = pieces.front().subspan(written);
+        }
+    }
+    co_return shortWrites;
+}
+
 template <typename T = ilias::UdpSocket>
 class ProtoDatagramClient : private detail::ProtoClientBase {
     using ClientType = T;
@@ -763,24 +1257,22 @@ inline auto ProtoDatagramClient<T>::send(const IProto& message, const IPEndpoint
         co_return Err(IoError::MessageTooLarge);
     }
 
-    auto headerData = Base::_serializeHeader(MessageHeader(
-        static_cast<uint32_t>(messageData.size() - MessageHeader::size()), message.type(), MessageType::Complete));
-    if (headerData.empty()) {
-        co_return Err(Error(ErrorCode::SerializationError));
-    }
-    NEKO_ASSERT(static_cast<int>(headerData.size()) == MessageHeader::size(), "Communication", "Header size error");
-    memcpy(messageData.data(), headerData.data(), headerData.size());
+    MessageHeader(static_cast<uint32_t>(messageData.size() - MessageHeader::size()), message.type(),
+                  MessageType::Complete)
+        .pack(reinterpret_cast<std::byte*>(messageData.data()));
     NEKO_LOG_INFO("Communication", "Send header: message type: Complete proto type: {} size: {}", message.type(),
                   messageData.size() - MessageHeader::size());
 
     auto ret = co_await (
         mDatagramClient.sendto({reinterpret_cast<std::byte*>(messageData.data()), messageData.size()}, endpoint) |
         unstoppable());
+    const auto messageSize = messageData.size();
+    Base::_recycleSendBuffer(std::move(messageData));
     if (!ret) {
         co_return Err(ret.error());
     }
-    if (ret.value() != messageData.size()) {
-        NEKO_LOG_ERROR("Communication", "Send data error, expect: {} -actual: {}", messageData.size(), ret.value());
+    if (ret.value() != messageSize) {
+        NEKO_LOG_ERROR("Communication", "Send data error, expect: {} -actual: {}", messageSize, ret.value());
         co_return Err(IoError::MessageTooLarge);
     }
     co_return {};
@@ -819,13 +1311,7 @@ inline auto ProtoDatagramClient<T>::recv(StreamFlag flag) -> IoTask<std::pair<IP
         }
         mBuffer.resize(recvSize);
 
-        MessageHeader header;
-        BinarySerializer::InputSerializer serializer(reinterpret_cast<char*>(mBuffer.data()), MessageHeader::size());
-        auto taggedHeader = make_tags<BinaryTag{.raw_fixed_data = true}>(header);
-        if (!serializer(taggedHeader)) {
-            NEKO_LOG_ERROR("Communication", "Recv message header error: deserialize error");
-            co_return Err(Error(ErrorCode::InvalidMessageHeader));
-        }
+        const auto header = MessageHeader::unpack(mBuffer.data());
 
         switch (header.messageType) {
         case MessageType::VersionVerification: {
@@ -896,7 +1382,7 @@ inline auto ProtoDatagramClient<T>::close() -> IoTask<void> {
 template <typename T>
 inline auto ProtoDatagramClient<T>::setProtoTable(const uint32_t version,
                                                   const std::map<uint32_t, std::string>& protoTable) -> void {
-    this->mProtocolTable = ProtocolTable{version, protoTable};
+    this->_setProtocolTable(ProtocolTable{version, protoTable});
 }
 
 template <typename T>
@@ -0,0 +1,221 @@
+/**
+ * @file serializer_pool.hpp
+ * @author llhsdmd (llhsdmd@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-02-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/runtime/executor.hpp>
+#include <ilias/task.hpp>
+
+#include "nekoproto/global/global.hpp"
+
+NEKO_BEGIN_NAMESPACE
+
+/**
+ * @brief Worker threads that run serialization jobs for StreamFlag::SerializerInThread.
+ *
+ * Jobs are queued per Strand. A strand's jobs run one at a time in
+ * submission order, while different strands run in parallel. A worker takes
+ * several queued jobs of one strand at once, up to Options::batch_bytes. When
+ * the strand is idle, small jobs run on the calling thread so small messages
+ * skip the thread hop. Once Options::max_queued_jobs are queued, further jobs
+ * wait for a free slot with their coroutine suspended, so a full pool slows
+ * its producers down without blocking their executor.
+ *
+ * The pool shares ownership of every strand with pending jobs. Stopping the
+ * awaiting task withdraws a job that has not started and resumes the task
+ * through its executor. A job already running is left to finish and resumes
+ * the task as usual, so cancellation never blocks a thread. Only a frame
+ * destroyed mid-await without a stop request still waits for its running job.
+ */
+class NEKO_PROTO_API SerializerPool {
+    struct Job;
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Stage : uint8_t {
+        Serialize = 0,
+        Parse     = 1,
+    };
+
+    struct Options {
+        std::size_t threads         = 0; // 0 uses one thread less than the hardware has, at least one
+        std::size_t max_queued_jobs = 1024U;
+        std::size_t inline_bytes    = 4U * 1024U;
+        std::size_t batch_bytes     = 64U * 1024U;
+    };
+
+    struct StageMetrics {
+        uint64_t jobs        = 0;
+        uint64_t inline_jobs = 0;
+        std::chrono::nanoseconds queue_time{};
+        std::chrono::nanoseconds max_queue_time{};
+        std::chrono::nanoseconds run_time{};
+    };
+
+    struct Metrics {
+        StageMetrics serialize;
+        StageMetrics parse;
+    };
+
+    /// Ordering domain, normally one per connection. Held through a shared_ptr.
+    class Strand {
+    public:
+        Strand() = default;
+        Strand(const Strand&)                    = delete;
+        auto operator=(const Strand&) -> Strand& = delete;
+
+        /// Output size of the last serialize job, used as the size hint of the next one.
+        std::size_t lastSerializedBytes = 0;
+
+    private:
+        friend class SerializerPool;
+        std::deque<std::shared_ptr<Job>> mJobs;
+        std::size_t mParked = 0; // jobs of this strand waiting for a queue slot
+        bool mScheduled     = false;
+    };
+
+private:
+    enum class JobState : uint8_t {
+        Created,
+        Parked,
+        Queued,
+        Running,
+        Finished,
+    };
+
+    struct Job {
+        bool (*invoke)(void* context)      = nullptr;
+        void* context                      = nullptr;
+        std::size_t bytes                  = 0;
+        Stage stage                        = Stage::Serialize;
+        ilias::runtime::Executor* executor = nullptr;
+        std::coroutine_handle<> handle;
+        Clock::time_point queued;
+        bool result = false;
+        std::shared_ptr<Strand> strand;
+        JobState state = JobState::Created;
+        // Set when a stop request withdrew the job before it ran.
+        bool canceled = false;
+        // Set by the awaiter when its coroutine goes away; read on the same executor before resuming.
+        bool abandoned = false;
+        // Keeps the job alive while its resumption is posted to the executor.
+        std::shared_ptr<Job> self;
+    };
+
+    class Awaiter {
+    public:
+        Awaiter(SerializerPool& pool, std::shared_ptr<Job> job) NEKO_NOEXCEPT : mPool(pool), mJob(std::move(job)) {}
+        Awaiter(const Awaiter&)                    = delete;
+        auto operator=(const Awaiter&) -> Awaiter& = delete;
+        ~Awaiter() { mPool._withdraw(*mJob); }
+
+        auto await_ready() const NEKO_NOEXCEPT -> bool { return false; }
+        auto await_suspend(std::coroutine_handle<> handle) -> bool {
+            mJob->handle   = handle;
+            mJob->executor = ilias::runtime::Executor::currentThread();
+            return mPool._submit(mJob);
+        }
+        auto await_resume() const NEKO_NOEXCEPT -> bool { return mJob->result; }
+
+    private:
+        SerializerPool& mPool;
+        std::shared_ptr<Job> mJob;
+    };
+
+public:
+    SerializerPool();
+    explicit SerializerPool(Options options);
+    SerializerPool(const SerializerPool&)                    = delete;
+    auto operator=(const SerializerPool&) -> SerializerPool& = delete;
+    ~SerializerPool();
+
+    /// Pool shared by every client that does not bring its own.
+    static auto instance() -> SerializerPool&;
+
+    /**
+     * @brief Run @p func on the pool and resume the awaiting coroutine on its own executor.
+     *
+     * @p bytes is the expected size of the message, it decides inline
+     * execution and batching. co_await yields the bool result of @p func,
+     * or IoError::Canceled when a stop request withdrew the job before it ran.
+     */
+    template <typename Func>
+    auto run(std::shared_ptr<Strand> strand, Stage stage, std::size_t bytes, Func&& func) -> ilias::IoTask<bool> {
+        using FuncType = std::remove_reference_t<Func>;
+        auto job       = std::make_shared<Job>();
+        job->invoke    = [](void* context) -> bool { return static_cast<bool>((*static_cast<FuncType*>(context))()); };
+        job->context   = const_cast<void*>(static_cast<const void*>(std::addressof(func)));
+        job->bytes     = bytes;
+        job->stage     = stage;
+        job->strand    = std::move(strand);
+        if (_tryRunInline(*job->strand, *job)) {
+            co_return job->result;
+        }
+        const auto token = co_await ilias::this_coro::stopToken();
+        std::stop_callback withdrawOnStop(token, [this, job]() { _cancel(job); });
+        const bool result = co_await Awaiter(*this, job);
+        if (job->canceled) {
+            co_return ilias::Err(ilias::IoError::Canceled);
+        }
+        co_return result;
+    }
+
+    auto options() const NEKO_NOEXCEPT -> const Options& { return mOptions; }
+    auto metrics() const -> Metrics;
+
+private:
+    struct StageCounters {
+        std::atomic<uint64_t> jobs{0};
+        std::atomic<uint64_t> inlineJobs{0};
+        std::atomic<int64_t> queueNs{0};
+        std::atomic<int64_t> maxQueueNs{0};
+        std::atomic<int64_t> runNs{0};
+    };
+
+    auto _tryRunInline(Strand& strand, Job& job) -> bool;
+    auto _submit(const std::shared_ptr<Job>& job) -> bool;
+    auto _enqueueLocked(const std::shared_ptr<Job>& job) -> bool;
+    auto _cancel(const std::shared_ptr<Job>& job) -> void;
+    auto _withdraw(Job& job) -> void;
+    auto _resume(std::unique_lock<std::mutex>& lock, const std::shared_ptr<Job>& job) -> void;
+    auto _workerLoop() -> void;
+    auto _runJob(Job& job, bool inlined) -> void;
+
+    Options mOptions;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::condition_variable mFinished;
+    std::deque<std::shared_ptr<Strand>> mReady;
+    std::deque<std::shared_ptr<Job>> mParked;
+    std::size_t mQueuedJobs = 0;
+    bool mStopping          = false;
+    std::array<StageCounters, 2> mCounters;
+    std::vector<std::thread> mThreads;
+};
+
+NEKO_END_NAMESPACE
@@ -55,6 +55,7 @@ struct JsonRpcBackend {
         std::size_t max_active_requests_global = 4096U;
         std::size_t max_queued_requests_global = 4096U;
         std::optional<std::chrono::nanoseconds> request_timeout;
+        detail::StreamWriteCoalescing write_coalescing;
     };
 
     struct ClientContext {
@@ -421,8 +422,10 @@ public:
 
     template <ilias::Stream StreamT>
     static auto makeEndpoint(StreamT stream, const Options& options) {
-        return detail::LengthPrefixedStreamMessageEndpoint<StreamT>{
-            std::move(stream), JsonRpcError::InvalidRequest, options.max_message_bytes};
+        detail::LengthPrefixedStreamMessageEndpoint<StreamT> endpoint{std::move(stream), JsonRpcError::InvalidRequest,
+                                                                     options.max_message_bytes};
+        endpoint.setWriteCoalescing(options.write_coalescing);
+        return endpoint;
     }
 
     template <MessageEndpoint EndpointT>
@@ -27,6 +27,8 @@
 #include "ilias/task/utils.hpp"
 #include "nekoproto/global/global.hpp"
 #include "nekoproto/rpc/endpoint.hpp"
+#include "nekoproto/transport/fragmented_datagram_endpoint.hpp"
+#include "nekoproto/transport/unix_memfd_endpoint.hpp"
 
 NEKO_BEGIN_NAMESPACE
 
@@ -40,6 +42,7 @@ using ilias::Err;
 
 using IliasLengthPrefixedMessageEndpoint = LengthPrefixedStreamMessageEndpoint<IliasDynStream>;
 using IliasChunkedDatagramMessageEndpoint = ChunkedDatagramMessageEndpoint<IliasUdpSocket, IPEndpoint>;
+using IliasFragmentedDatagramMessageEndpoint = FragmentedDatagramMessageEndpoint<IliasUdpSocket, IPEndpoint>;
 
 NEKO_PROTO_API
 auto make_tcp_stream_client(IPEndpoint ipendpoint) -> IoTask<IliasLengthPrefixedMessageEndpoint>;
@@ -62,6 +65,22 @@ NEKO_PROTO_API
 auto make_udp_stream_client(const char* url) -> IoTask<IliasChunkedDatagramMessageEndpoint>;
 NEKO_PROTO_API
 auto make_udp_stream_client(const std::string& url) -> IoTask<IliasChunkedDatagramMessageEndpoint>;
+// Same addresses as make_udp_stream_client, for messages larger than one datagram.
+// Both peers must use the fragmented endpoint with the same max_datagram_bytes.
+NEKO_PROTO_API
+auto make_fragmented_udp_stream_client(IPEndpoint bindIpendpoint, IPEndpoint remoteIpendpoint,
+                                       DatagramFragmentOptions options = {})
+    -> IoTask<IliasFragmentedDatagramMessageEndpoint>;
+NEKO_PROTO_API
+auto make_fragmented_udp_stream_client(std::string_view url, DatagramFragmentOptions options = {})
+    -> IoTask<IliasFragmentedDatagramMessageEndpoint>;
+#if defined(__linux__)
+// Same-host peers; messages of at least options.memfd_threshold bytes are passed as sealed memfds.
+// like unix:///run/app.sock
+// unix://@app for an abstract socket
+NEKO_PROTO_API
+auto make_unix_stream_client(std::string_view url, UnixMemfdOptions options = {}) -> IoTask<UnixMemfdMessageEndpoint>;
+#endif
 } // namespace detail
 
 NEKO_END_NAMESPACE
@@ -0,0 +1,278 @@
+/**
+ * @file field_table.hpp
+ * @author llhsdmd (llhsdmd@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-02-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "nekoproto/global/global.hpp"
+#include "nekoproto/serialization/reflection.hpp"
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+/// Seeded 32-bit FNV-1a, the seed is picked per type so the field names land in distinct slots.
+/// The murmur finalizer spreads the last bytes over the high bits, which select the slot.
+constexpr uint32_t field_name_hash(NEKO_STRING_VIEW name, uint32_t seed) NEKO_NOEXCEPT {
+    uint32_t hash = 2166136261U ^ seed;
+    for (const char item : name) {
+        hash ^= static_cast<uint8_t>(item);
+        hash *= 16777619U;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/// Slot of a name whose hash is @p hash once its bucket's @p displacement is applied.
+constexpr uint32_t field_slot(uint32_t hash, uint32_t displacement, uint32_t mask) NEKO_NOEXCEPT {
+    return (std::rotr(hash, 16) ^ displacement) & mask;
+}
+
+/**
+ * @brief Type-erased access to one reflected member.
+ *
+ * `address` maps a pointer to the owning message onto a pointer to the member,
+ * so reading or writing a field costs one indirect call and no name handling.
+ */
+struct FieldAccessor {
+    NEKO_STRING_VIEW name;
+    const std::type_info& (*typeInfo)() NEKO_NOEXCEPT;
+    void* (*address)(void* object) NEKO_NOEXCEPT;
+    bool writable;
+};
+
+/**
+ * @brief Name index over the reflected members of one message type.
+ *
+ * A hash-and-displace table built at compile time: the low hash bits pick a
+ * bucket, whose displacement is xor-ed into the high bits to pick the slot.
+ * Displacements are chosen so every name lands in its own slot, keeping the
+ * table linear in the field count while a lookup stays one hash, two reads
+ * and one name compare.
+ */
+class FieldTable {
+public:
+    constexpr FieldTable(const FieldAccessor* fields, std::size_t size, const uint32_t* displacements,
+                         uint32_t bucketMask, const int16_t* slots, uint32_t mask, uint32_t seed) NEKO_NOEXCEPT
+        : mFields(fields),
+          mSize(size),
+          mDisplacements(displacements),
+          mBucketMask(bucketMask),
+          mSlots(slots),
+          mMask(mask),
+          mSeed(seed) {}
+
+    const FieldAccessor* find(NEKO_STRING_VIEW name) const NEKO_NOEXCEPT {
+        if (mSize == 0) {
+            return nullptr;
+        }
+        const auto hash  = field_name_hash(name, mSeed);
+        const auto index = mSlots[field_slot(hash, mDisplacements[hash & mBucketMask], mMask)];
+        if (index < 0 || mFields[index].name != name) {
+            return nullptr;
+        }
+        return &mFields[index];
+    }
+    std::size_t size() const NEKO_NOEXCEPT { return mSize; }
+    const FieldAccessor& operator[](std::size_t index) const NEKO_NOEXCEPT { return mFields[index]; }
+
+private:
+    const FieldAccessor* mFields;
+    std::size_t mSize;
+    const uint32_t* mDisplacements;
+    uint32_t mBucketMask;
+    const int16_t* mSlots;
+    uint32_t mMask;
+    uint32_t mSeed;
+};
+
+template <typename T, std::size_t I>
+using field_member_ref_t = decltype(Reflect<T>::template value<I>(std::declval<T&>()));
+
+template <typename T, std::size_t I>
+void* field_address(void* object) NEKO_NOEXCEPT {
+    if constexpr (std::is_lvalue_reference_v<field_member_ref_t<T, I>>) {
+        auto& member = Reflect<T>::template value<I>(*static_cast<T*>(object));
+        return const_cast<void*>(static_cast<const void*>(std::addressof(member)));
+    } else {
+        return nullptr;
+    }
+}
+
+template <typename T, std::size_t I>
+const std::type_info& field_type_info() NEKO_NOEXCEPT {
+    return typeid(std::remove_cvref_t<field_member_ref_t<T, I>>);
+}
+
+template <typename T, std::size_t... Is>
+constexpr auto make_field_accessors(std::index_sequence<Is...> /*unused*/) {
+    constexpr auto names = Reflect<T>::names();
+    return std::array<FieldAccessor, sizeof...(Is)>{
+        FieldAccessor{names[Is], &field_type_info<T, Is>, &field_address<T, Is>,
+                      std::is_lvalue_reference_v<field_member_ref_t<T, Is>> &&
+                          !std::is_const_v<std::remove_reference_t<field_member_ref_t<T, Is>>>}...};
+}
+
+template <typename T>
+inline constexpr auto field_accessors_v =
+    make_field_accessors<T>(std::make_index_sequence<Reflect<T>::names().size()>{});
+
+/// Hash seeds tried before a field layout gives up; each seed tries every displacement of every bucket.
+inline constexpr uint32_t KMaxFieldSeeds = 64;
+
+template <std::size_t BucketCount, std::size_t SlotCount>
+struct FieldLayout {
+    bool complete = false;
+    uint32_t seed = 0;
+    std::array<uint32_t, BucketCount> displacements{};
+    std::array<int16_t, SlotCount> slots{};
+};
+
+/// Buckets for @p count names, about two names per bucket.
+constexpr std::size_t field_bucket_count(std::size_t count) NEKO_NOEXCEPT {
+    return std::bit_ceil(std::max<std::size_t>(count / 2, 1));
+}
+
+/// Slots for @p count names, between 2n and 4n so a free displacement is quick to find.
+constexpr std::size_t field_slot_count(std::size_t count) NEKO_NOEXCEPT {
+    return std::bit_ceil(std::max<std::size_t>(count * 2, 1));
+}
+
+/**
+ * @brief Searches a seed and per-bucket displacements placing every name of @p T in its own slot.
+ *
+ * Buckets are placed largest first, each taking the first displacement whose
+ * slots are all free. Names of a bucket that share a slot under every
+ * displacement, or a bucket that finds no free displacement, move on to the
+ * next seed; `complete` stays false once KMaxFieldSeeds seeds are exhausted.
+ */
+template <typename T>
+constexpr auto make_field_layout() {
+    constexpr auto& fields            = field_accessors_v<T>;
+    constexpr std::size_t count       = fields.size();
+    constexpr std::size_t bucketCount = field_bucket_count(count);
+    constexpr std::size_t slotCount   = field_slot_count(count);
+    static_assert(count < INT16_MAX, "reflected message has too many fields for the field table");
+    constexpr auto bucketMask = static_cast<uint32_t>(bucketCount - 1);
+    constexpr auto slotMask   = static_cast<uint32_t>(slotCount - 1);
+
+    FieldLayout<bucketCount, slotCount> layout;
+    std::array<uint32_t, count> hashes{};
+    std::array<std::size_t, count> order{};
+    for (; layout.seed < KMaxFieldSeeds; ++layout.seed) {
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            hashes[idx] = field_name_hash(fields[idx].name, layout.seed);
+            order[idx]  = idx;
+        }
+        std::array<std::size_t, bucketCount> sizes{};
+        for (const auto hash : hashes) {
+            ++sizes[hash & bucketMask];
+        }
+        std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+            const auto lhsBucket = hashes[lhs] & bucketMask;
+            const auto rhsBucket = hashes[rhs] & bucketMask;
+            return sizes[lhsBucket] != sizes[rhsBucket] ? sizes[lhsBucket] > sizes[rhsBucket] : lhsBucket < rhsBucket;
+        });
+
+        layout.slots.fill(-1);
+        layout.displacements.fill(0);
+        bool placed = true;
+        for (std::size_t begin = 0; placed && begin < count;) {
+            const auto bucket = hashes[order[begin]] & bucketMask;
+            const auto end    = begin + sizes[bucket];
+            placed            = false;
+            for (uint32_t displacement = 0; !placed && displacement < slotCount; ++displacement) {
+                placed = true;
+                for (std::size_t idx = begin; placed && idx < end; ++idx) {
+                    const auto slot = field_slot(hashes[order[idx]], displacement, slotMask);
+                    for (std::size_t prev = begin; placed && prev < idx; ++prev) {
+                        placed = field_slot(hashes[order[prev]], displacement, slotMask) != slot;
+                    }
+                    placed = placed && layout.slots[slot] == -1;
+                }
+                if (placed) {
+                    layout.displacements[bucket] = displacement;
+                    for (std::size_t idx = begin; idx < end; ++idx) {
+                        layout.slots[field_slot(hashes[order[idx]], displacement, slotMask)] =
+                            static_cast<int16_t>(order[idx]);
+                    }
+                }
+            }
+            begin = end;
+        }
+        if (placed) {
+            layout.complete = true;
+            return layout;
+        }
+    }
+    return layout;
+}
+
+template <typename T>
+constexpr auto make_checked_field_layout() {
+    constexpr auto layout = make_field_layout<T>();
+    static_assert(layout.complete, "no collision free field layout within KMaxFieldSeeds seeds, rename a field or "
+                                   "raise KMaxFieldSeeds");
+    return layout;
+}
+
+template <typename T>
+inline constexpr auto field_layout_v = make_checked_field_layout<T>();
+
+/// Field table of a reflected message type, built entirely at compile time.
+template <typename T>
+inline constexpr FieldTable field_table_v{field_accessors_v<T>.data(),
+                                          field_accessors_v<T>.size(),
+                                          field_layout_v<T>.displacements.data(),
+                                          static_cast<uint32_t>(field_layout_v<T>.displacements.size() - 1),
+                                          field_layout_v<T>.slots.data(),
+                                          static_cast<uint32_t>(field_layout_v<T>.slots.size() - 1),
+                                          field_layout_v<T>.seed};
+} // namespace detail
+
+/**
+ * @brief A member of a message resolved once by name.
+ *
+ * Obtain it from IProto::fieldHandle and pass it to IProto::field to reach the
+ * member directly. A handle only works with messages of the type it was
+ * resolved against; for any other message IProto::field returns nullptr.
+ */
+template <typename T>
+class FieldHandle {
+public:
+    FieldHandle() = default;
+
+    bool valid() const NEKO_NOEXCEPT { return mAccessor != nullptr; }
+    explicit operator bool() const NEKO_NOEXCEPT { return valid(); }
+    NEKO_STRING_VIEW name() const NEKO_NOEXCEPT { return mAccessor != nullptr ? mAccessor->name : NEKO_STRING_VIEW{}; }
+    bool writable() const NEKO_NOEXCEPT { return mAccessor != nullptr && mAccessor->writable; }
+
+private:
+    friend class IProto;
+    FieldHandle(const detail::FieldTable* table, const detail::FieldAccessor* accessor) NEKO_NOEXCEPT
+        : mTable(table),
+          mAccessor(accessor) {}
+
+    const detail::FieldTable* mTable       = nullptr;
+    const detail::FieldAccessor* mAccessor = nullptr;
+};
+
+NEKO_END_NAMESPACE
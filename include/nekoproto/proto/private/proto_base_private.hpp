@@ -9,14 +9,22 @@
  *
  */
 #pragma once
+#include <atomic>
 #include <cstring>
 #include <functional>
 #include <map>
+#include <optional>
 #include <vector>
 
+#include "field_table.hpp"
 #include "nekoproto/global/global.hpp"
 #include "reflection_serializer.hpp"
 
+/// Recycled instances each thread keeps per proto type, 0 disables pooling.
+#ifndef NEKO_PROTO_POOL_CAPACITY
+#define NEKO_PROTO_POOL_CAPACITY 64
+#endif
+
 NEKO_BEGIN_NAMESPACE
 class NEKO_PROTO_API ProtoFactory;
 namespace detail {
@@ -24,6 +32,16 @@ class NEKO_PROTO_API AbstractProto;
 NEKO_PROTO_API
 auto static_init_funcs(const NEKO_STRING_VIEW&, std::function<void(ProtoFactory*)>)
     -> std::map<NEKO_STRING_VIEW, std::function<void(ProtoFactory*)>>&;
+
+/// 32-bit FNV-1a of a proto name, usable at compile time for declared types.
+constexpr uint32_t proto_name_hash(NEKO_STRING_VIEW name) NEKO_NOEXCEPT {
+    uint32_t hash = 2166136261U;
+    for (const char item : name) {
+        hash ^= static_cast<uint8_t>(item);
+        hash *= 16777619U;
+    }
+    return hash;
+}
 } // namespace detail
 
 namespace detail {
@@ -37,7 +55,97 @@ public:
     virtual NEKO_STRING_VIEW protoName() const NEKO_NOEXCEPT                = 0;
     virtual AbstractProto* clone() const                                    = 0;
     virtual detail::ReflectionObject* getReflectionObject() NEKO_NOEXCEPT   = 0;
+    virtual const FieldTable* fieldTable() const NEKO_NOEXCEPT              = 0;
     virtual void* data() NEKO_NOEXCEPT                                      = 0;
+    /// Hands the object back to its pool if it came from one, otherwise deletes it.
+    virtual void recycle() NEKO_NOEXCEPT { delete this; }
+};
+
+struct ProtoDeleter {
+    void operator()(AbstractProto* proto) const NEKO_NOEXCEPT { proto->recycle(); }
+};
+
+/**
+ * @brief Per-type free list of proto instances.
+ *
+ * Every thread keeps its own list, so drawing and returning instances takes
+ * no lock and never touches the allocator once the list is warm. An
+ * instance returned on another thread joins that thread's list.
+ */
+template <typename ProtoBaseT>
+class ProtoPool {
+public:
+    ProtoPool() = default;
+    ProtoPool(const ProtoPool&)            = delete;
+    ProtoPool& operator=(const ProtoPool&) = delete;
+    ~ProtoPool() {
+        _exited() = true;
+        for (auto* proto : mFree) {
+            delete proto;
+        }
+    }
+
+    /// Takes a recycled instance or allocates a new one; either way it returns to the pool when released.
+    static ProtoBaseT* acquire() {
+        ProtoBaseT* proto = nullptr;
+        if (!_exited() && !_local().mFree.empty()) {
+            auto& free = _local().mFree;
+            proto      = free.back();
+            free.pop_back();
+        } else {
+            proto = new ProtoBaseT();
+        }
+        proto->mPooled = true;
+        return proto;
+    }
+
+    /// Resets @p proto and keeps it for reuse, false when the pool is full and the caller must delete it.
+    static bool release(ProtoBaseT* proto) NEKO_NOEXCEPT {
+        // Messages released while the thread is shutting down outlive its pool.
+        if (_exited()) {
+            return false;
+        }
+        auto& free = _local().mFree;
+        if (free.size() >= gCapacity.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        try {
+            proto->_resetForReuse();
+            free.push_back(proto);
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+    static void setCapacity(std::size_t capacity) NEKO_NOEXCEPT {
+        gCapacity.store(capacity, std::memory_order_relaxed);
+        if (_exited()) {
+            return;
+        }
+        auto& free = _local().mFree;
+        while (free.size() > capacity) {
+            delete free.back();
+            free.pop_back();
+        }
+    }
+    static std::size_t capacity() NEKO_NOEXCEPT { return gCapacity.load(std::memory_order_relaxed); }
+    /// Idle instances held by the calling thread.
+    static std::size_t size() NEKO_NOEXCEPT { return _exited() ? 0 : _local().mFree.size(); }
+
+private:
+    static ProtoPool& _local() NEKO_NOEXCEPT {
+        thread_local ProtoPool kPool;
+        return kPool;
+    }
+    static bool& _exited() NEKO_NOEXCEPT {
+        thread_local bool kExited = false;
+        return kExited;
+    }
+
+private:
+    std::vector<ProtoBaseT*> mFree;
+    static inline std::atomic<std::size_t> gCapacity{NEKO_PROTO_POOL_CAPACITY};
 };
 
 template <typename ProtoT, typename SerializerT>
@@ -75,15 +183,24 @@ public:
     static bool Serialize(const ProtoT& proto, std::vector<char>& buffer);      // NOLINT(readability-identifier-naming)
     static bool Deserialize(const char* data, std::size_t size, ProtoT& proto); // NOLINT(readability-identifier-naming)
     ReflectionObject* getReflectionObject() NEKO_NOEXCEPT override;
+    const FieldTable* fieldTable() const NEKO_NOEXCEPT override { return &field_table_v<ProtoT>; }
     virtual void* data() NEKO_NOEXCEPT override;
+    void recycle() NEKO_NOEXCEPT override;
 
 protected:
     ProtoBase(const ProtoBase& other)            = delete;
     ProtoBase& operator=(const ProtoBase& other) = delete;
 
+private:
+    friend class ProtoPool<ProtoBase>;
+    void _resetForReuse();
+
 private:
     std::unique_ptr<ReflectionSerializer> mReflectionSerializer = {};
-    std::unique_ptr<ProtoT, void (*)(ProtoT*)> mData            = {};
+    /// Owned messages live inline so one allocation covers the wrapper and the message.
+    std::optional<ProtoT> mStorage = {};
+    ProtoT* mData                  = nullptr;
+    bool mPooled                   = false;
     static NEKO_STRING_VIEW gProtoName;
 };
 class proto_method_access {
@@ -115,7 +232,7 @@ NEKO_MAKE_HAS_STATIC_METHOD_TEST1(specify_type, specify_type)
 
 template <typename ProtoT, typename SerializerT>
 inline void* ProtoBase<ProtoT, SerializerT>::data() NEKO_NOEXCEPT {
-    return mData.get();
+    return mData;
 }
 template <typename ProtoT, typename SerializerT>
 inline AbstractProto* ProtoBase<ProtoT, SerializerT>::clone() const {
@@ -123,36 +240,66 @@ inline AbstractProto* ProtoBase<ProtoT, SerializerT>::clone() const {
 }
 
 template <typename ProtoT, typename SerializerT>
-inline ProtoBase<ProtoT, SerializerT>::ProtoBase() : mData(new ProtoT(), [](ProtoT* ptr) { delete ptr; }) {}
+inline void ProtoBase<ProtoT, SerializerT>::recycle() NEKO_NOEXCEPT {
+    if (mPooled && ProtoPool<ProtoBase>::release(this)) {
+        return;
+    }
+    delete this;
+}
+
+template <typename ProtoT, typename SerializerT>
+inline void ProtoBase<ProtoT, SerializerT>::_resetForReuse() {
+    // The message keeps its address, so a cached reflection object stays valid.
+    if constexpr (std::is_move_assignable_v<ProtoT>) {
+        *mData = ProtoT();
+    } else {
+        mStorage.emplace();
+        mReflectionSerializer.reset();
+    }
+}
+
+template <typename ProtoT, typename SerializerT>
+inline ProtoBase<ProtoT, SerializerT>::ProtoBase() : mStorage(std::in_place), mData(&*mStorage) {}
 
 template <typename ProtoT, typename SerializerT>
 inline ProtoBase<ProtoT, SerializerT>::ProtoBase(const ProtoT& proto)
-    : mData(new ProtoT(proto), [](ProtoT* ptr) { delete ptr; }) {}
+    : mStorage(std::in_place, proto), mData(&*mStorage) {}
 
 template <typename ProtoT, typename SerializerT>
 inline ProtoBase<ProtoT, SerializerT>::ProtoBase(ProtoT&& proto)
-    : mData(new ProtoT(std::move(proto)), [](ProtoT* ptr) { delete ptr; }) {}
+    : mStorage(std::in_place, std::move(proto)), mData(&*mStorage) {}
 
 template <typename ProtoT, typename SerializerT>
-inline ProtoBase<ProtoT, SerializerT>::ProtoBase(ProtoT* proto) : mData(proto, [](ProtoT*) {}) {}
+inline ProtoBase<ProtoT, SerializerT>::ProtoBase(ProtoT* proto) : mData(proto) {}
 
 template <typename T, typename SerializerT>
 ProtoBase<T, SerializerT>::ProtoBase(ProtoBase<T, SerializerT>&& other) {
-    mReflectionSerializer = std::move(other.mReflectionSerializer);
-    mData                 = std::move(other.mData);
-    other.mData           = nullptr;
+    *this = std::move(other);
 }
 
 template <typename ProtoT, typename SerializerT>
 inline ProtoBase<ProtoT, SerializerT>::~ProtoBase() {
-    mData.reset();
+    mReflectionSerializer.reset();
 }
 
 template <typename T, typename SerializerT>
 ProtoBase<T, SerializerT>& ProtoBase<T, SerializerT>::operator=(ProtoBase<T, SerializerT>&& other) NEKO_NOEXCEPT {
-    mReflectionSerializer = std::move(other.mReflectionSerializer);
-    mData                 = std::move(other.mData);
-    other.mData           = nullptr;
+    if (this == &other) {
+        return *this;
+    }
+    if (other.mStorage.has_value()) {
+        // The message moves to a new address, so the other side's reflection object would dangle.
+        mReflectionSerializer.reset();
+        mStorage.emplace(std::move(*other.mStorage));
+        mData = &*mStorage;
+        other.mReflectionSerializer.reset();
+    } else {
+        mReflectionSerializer = std::move(other.mReflectionSerializer);
+        mStorage.reset();
+        mData = other.mData;
+    }
+    other.mStorage.reset();
+    other.mData = nullptr;
     return *this;
 }
 
@@ -226,19 +373,19 @@ bool ProtoBase<ProtoT, SerializerT>::Deserialize(const char* data, std::size_t s
 template <typename T, typename SerializerT>
 bool ProtoBase<T, SerializerT>::toData(std::vector<char>& buffer) const NEKO_NOEXCEPT {
     NEKO_ASSERT(mData != nullptr, "ReflectionSerializer", "mData is nullptr");
-    return Serialize(*mData.get(), buffer);
+    return Serialize(*mData, buffer);
 }
 
 template <typename T, typename SerializerT>
 std::vector<char> ProtoBase<T, SerializerT>::toData() const NEKO_NOEXCEPT {
     NEKO_ASSERT(mData != nullptr, "ReflectionSerializer", "mData is nullptr");
-    return Serialize(*mData.get());
+    return Serialize(*mData);
 }
 
 template <typename T, typename SerializerT>
 bool ProtoBase<T, SerializerT>::fromData(const char* data, std::size_t size) NEKO_NOEXCEPT {
     NEKO_ASSERT(mData != nullptr, "ReflectionSerializer", "mData is nullptr");
-    return Deserialize(data, size, *mData.get());
+    return Deserialize(data, size, *mData);
 }
 } // namespace detail
 
@@ -71,6 +71,7 @@
 #include <cstring>
 #include <functional>
 #include <map>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
@@ -101,6 +102,14 @@ public:
      */
     inline std::vector<char> toData() const NEKO_NOEXCEPT;
     inline bool toData(std::vector<char>& buffer) const NEKO_NOEXCEPT;
+    /**
+     * @brief serializer self after @p headroom reserved bytes
+     *  @p buffer is reused as is: it is resized to @p headroom and the message is
+     * appended, so a caller can keep one buffer across messages and fill the
+     * headroom (e.g. a frame header) in place afterwards.
+     * @return std::span<char> the payload inside @p buffer, empty on failure
+     */
+    inline std::span<char> toData(std::vector<char>& buffer, std::size_t headroom) const NEKO_NOEXCEPT;
     /**
      * @brief deserializer self
      * The input data must be serialized using the same serializer as the current one
@@ -143,6 +152,25 @@ public:
     T getField(const NEKO_STRING_VIEW& name, const T& defaultValue) NEKO_NOEXCEPT;
     template <typename T>
     bool setField(const NEKO_STRING_VIEW& name, const T& value) NEKO_NOEXCEPT;
+    /**
+     * @brief resolve a field once for repeated access
+     *  the lookup goes through a per-type table generated at compile time from the
+     * reflection meta, so it costs one hash and one name compare.
+     * @tparam T the field type, must be the same as the member type
+     * @param name the field name in nameValuePair in serializer
+     * @return FieldHandle<T> invalid if the field does not exist or has another type
+     */
+    template <typename T>
+    FieldHandle<T> fieldHandle(const NEKO_STRING_VIEW& name) const NEKO_NOEXCEPT;
+    /**
+     * @brief access a field through a handle, without any name lookup
+     * @return T* nullptr if the handle is invalid, was resolved against another
+     * proto type, or the field is not writable
+     */
+    template <typename T>
+    T* field(const FieldHandle<T>& handle) NEKO_NOEXCEPT;
+    template <typename T>
+    const T* field(const FieldHandle<T>& handle) const NEKO_NOEXCEPT;
     template <typename T>
     T* cast() NEKO_NOEXCEPT;
     template <typename T>
@@ -156,7 +184,7 @@ public:
     IProto& operator=(IProto&& proto);
 
 private:
-    std::unique_ptr<detail::AbstractProto> mImp;
+    std::unique_ptr<detail::AbstractProto, detail::ProtoDeleter> mImp;
 };
 
 class NEKO_PROTO_API ProtoFactory {
@@ -174,16 +202,37 @@ public:
     static int specifyProtoType(int type) NEKO_NOEXCEPT;
     template <typename T>
     static NEKO_STRING_VIEW protoName() NEKO_NOEXCEPT;
+    /**
+     * @brief stable hash of the proto name, see detail::proto_name_hash
+     */
+    template <typename T>
+    static constexpr uint32_t protoHash() NEKO_NOEXCEPT;
+    /**
+     * @brief type of a declared proto by name, -1 if it is not declared
+     *  resolved through the name hash, the ordered map is only consulted when two
+     * declared names share a hash
+     */
+    static int protoType(const NEKO_STRING_VIEW& name) NEKO_NOEXCEPT;
+    /**
+     * @brief map the type ids of a peer's proto table onto local ones
+     *  the result is indexed by the remote type and holds the local type, or -1
+     * for names this side does not know. Build it once when the table arrives so
+     * every later message only needs an array index.
+     * @param remoteTable remote type -> proto name
+     * @return std::vector<int>
+     */
+    static std::vector<int> translateProtoTypes(const std::map<uint32_t, std::string>& remoteTable) NEKO_NOEXCEPT;
     /**
      * @brief create a proto object by type
-     *  this object is a pointer, you need to delete it by yourself
+     *  registered types are drawn from a per-thread pool (detail::ProtoPool) and
+     * go back to it, reset to a default value, when the IProto is destroyed
      * @param type
      * @return IProto
      */
     IProto create(int type) const NEKO_NOEXCEPT;
     /**
      * @brief create a proto object by name
-     *  this object is a pointer, you need to delete it by yourself
+     *  pooled like create(int)
      * @param name
      * @return IProto
      */
@@ -198,7 +247,9 @@ private:
     static IProto _creater() NEKO_NOEXCEPT;
     void _setVersion(int major, int minor, int patch) NEKO_NOEXCEPT;
     static int _protoType(const NEKO_STRING_VIEW& name, bool isDeclared = false, int specifyType = -1) NEKO_NOEXCEPT;
+    static int _findProtoType(const NEKO_STRING_VIEW& name) NEKO_NOEXCEPT;
     static std::map<NEKO_STRING_VIEW, int>& _staticProtoTypeMap();
+    static std::unordered_map<uint32_t, std::pair<NEKO_STRING_VIEW, int>>& _staticProtoHashMap();
 
 private:
     std::vector<std::function<IProto()>> mCreaterList;
@@ -233,9 +284,14 @@ NEKO_STRING_VIEW ProtoFactory::protoName() NEKO_NOEXCEPT {
     return name;
 }
 
+template <typename T>
+constexpr uint32_t ProtoFactory::protoHash() NEKO_NOEXCEPT {
+    return detail::proto_name_hash(detail::class_nameof<T>);
+}
+
 template <typename T>
 IProto ProtoFactory::_creater() NEKO_NOEXCEPT {
-    return IProto{new T()};
+    return IProto{detail::ProtoPool<T>::acquire()};
 }
 
 inline IProto::IProto(detail::AbstractProto* proto) : mImp(proto) {}
@@ -256,6 +312,15 @@ inline bool IProto::toData(std::vector<char>& buffer) const NEKO_NOEXCEPT {
     return false;
 }
 
+inline std::span<char> IProto::toData(std::vector<char>& buffer, std::size_t headroom) const NEKO_NOEXCEPT {
+    buffer.resize(headroom);
+    if (!mImp || !mImp->toData(buffer)) {
+        buffer.clear();
+        return {};
+    }
+    return {buffer.data() + headroom, buffer.size() - headroom};
+}
+
 inline bool IProto::fromData(const char* data, std::size_t size) NEKO_NOEXCEPT {
     if (mImp) {
         return mImp->fromData(data, size);
@@ -287,27 +352,71 @@ inline IProto IProto::clone() const {
 template <typename T>
 bool IProto::getField(const NEKO_STRING_VIEW& name, T* result) NEKO_NOEXCEPT {
     NEKO_ASSERT(mImp != nullptr, "ReflectionSerializer", " protoobject is nullptr");
-    auto* reflectionObject = mImp->getReflectionObject();
-    if (reflectionObject == nullptr) {
+    const auto* value = std::as_const(*this).field(fieldHandle<T>(name));
+    if (value == nullptr) {
         return false;
     }
-    return reflectionObject->getField(name, result);
+    if (result != nullptr) {
+        *result = *value;
+    }
+    return true;
 }
 
 template <typename T>
 T IProto::getField(const NEKO_STRING_VIEW& name, const T& defaultValue) NEKO_NOEXCEPT {
     NEKO_ASSERT(mImp != nullptr, "ReflectionSerializer", "proto object is nullptr");
-    auto* reflectionObject = mImp->getReflectionObject();
-    NEKO_ASSERT(reflectionObject != nullptr, "ReflectionSerializer", "reflectionObject is nullptr");
-    return reflectionObject->getField(name, defaultValue);
+    const auto* value = std::as_const(*this).field(fieldHandle<T>(name));
+    return value != nullptr ? *value : defaultValue;
 }
 
 template <typename T>
 bool IProto::setField(const NEKO_STRING_VIEW& name, const T& value) NEKO_NOEXCEPT {
     NEKO_ASSERT(mImp != nullptr, "ReflectionSerializer", "proto object is nullptr");
-    auto* reflectionObject = mImp->getReflectionObject();
-    NEKO_ASSERT(reflectionObject != nullptr, "ReflectionSerializer", "reflectionObject is nullptr");
-    return reflectionObject->setField(name, value);
+    const auto handle = fieldHandle<T>(name);
+    auto* field       = this->field(handle);
+    if (field == nullptr) {
+        if (handle) {
+            NEKO_LOG_ERROR("ReflectionSerializer", "field {} is not writable.", name);
+        }
+        return false;
+    }
+    *field = value;
+    return true;
+}
+
+template <typename T>
+FieldHandle<T> IProto::fieldHandle(const NEKO_STRING_VIEW& name) const NEKO_NOEXCEPT {
+    if (mImp == nullptr) {
+        return {};
+    }
+    const auto* table    = mImp->fieldTable();
+    const auto* accessor = table->find(name);
+    if (accessor == nullptr) {
+        NEKO_LOG_ERROR("ReflectionSerializer", "field {} not found.", name);
+        return {};
+    }
+    if (typeid(T) != accessor->typeInfo()) {
+        NEKO_LOG_ERROR("ReflectionSerializer", "field {} type mismatch, expected {} but got {}.", name,
+                       typeid(T).name(), accessor->typeInfo().name());
+        return {};
+    }
+    return FieldHandle<T>{table, accessor};
+}
+
+template <typename T>
+T* IProto::field(const FieldHandle<T>& handle) NEKO_NOEXCEPT {
+    if (!handle.writable()) {
+        return nullptr;
+    }
+    return const_cast<T*>(std::as_const(*this).field(handle));
+}
+
+template <typename T>
+const T* IProto::field(const FieldHandle<T>& handle) const NEKO_NOEXCEPT {
+    if (mImp == nullptr || !handle || mImp->fieldTable() != handle.mTable) {
+        return nullptr;
+    }
+    return static_cast<const T*>(handle.mAccessor->address(mImp->data()));
 }
 
 inline bool IProto::operator==(std::nullptr_t) const { return mImp == nullptr; }
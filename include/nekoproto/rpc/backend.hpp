@@ -80,6 +80,9 @@ struct NekoRpcBackend {
         std::size_t max_queued_requests_global = 4096U;
         std::optional<std::chrono::nanoseconds> request_timeout;
         std::shared_ptr<CompressionStats> compression_stats;
+        // Server receive buffers kept per size class and connection; 0 disables pooling.
+        std::size_t recv_buffers_per_class = 16U;
+        std::size_t max_pooled_recv_buffer_bytes = 1024U * 1024U;
     };
 
     struct EncodedRequest {
@@ -96,6 +99,16 @@ struct NekoRpcBackend {
 
     using ResponseValues = std::vector<ResponseValue>;
 
+    // One response frame ready for IMessageEndpoint::sendVectored. The method
+    // and payload segments point into the ResponseValues it was encoded from.
+    struct ResponseSegments {
+        typename Codec::EncodedFrame frame;
+        Message compressed_payload;
+
+        auto segments() const noexcept { return frame.segments(); }
+        auto size() const noexcept -> std::size_t { return frame.size(); }
+    };
+
     struct DecodeResult {
         bool ok    = false;
         bool batch = false;
@@ -215,12 +228,6 @@ public:
             _appendFrameError(result.responses, parts, decompressed.error());
             return result;
         }
-        std::optional<Message> payload_storage;
-        std::span<const std::byte> payload_view = parts.payload;
-        if (decompressed.value()) {
-            payload_storage = std::move(*decompressed.value());
-            payload_view    = rpc::NekoRpcExtensionCodec::asBytes(*payload_storage);
-        }
 
         if (parts.header.kind == Kind::Cancel || parts.header.kind == Kind::Hello) {
             result.ok = true;
@@ -241,35 +248,30 @@ public:
 
         // Method-id resolution belongs here because it depends on backend-owned
         // session state and extension TLVs, not on endpoint transport behavior.
-        auto method_name = rpc::NekoRpcIncomingMethodName<NekoRpcBackend>(context, session, parts);
-        if (!method_name) {
+        DecodedRequest request;
+        if (auto named = rpc::NekoRpcIncomingMethodName<NekoRpcBackend>(context, session, parts, request); !named) {
             result.ok = true;
-            _appendFrameError(result.responses, parts, method_name.error(),
-                              _methodIdErrorResponseExtensions(context, session, method_name.error()));
+            _appendFrameError(result.responses, parts, named.error(),
+                              _methodIdErrorResponseExtensions(context, session, named.error()));
             return result;
         }
-        if (method_name.value().empty()) {
+        if (methodName(request).empty()) {
             return result;
         }
 
-        auto header  = parts.header;
-        header.flags = static_cast<std::uint8_t>(header.flags & ~Flag::Compressed);
-        header.flags = static_cast<std::uint8_t>(header.flags & ~Flag::MethodId);
-
-        DecodedRequest request;
-        request.header = header;
-        request.method = std::move(method_name.value());
-        if (payload_storage) {
-            request.payload = std::move(*payload_storage);
-        } else {
-            request.payload.assign(payload_view.begin(), payload_view.end());
-        }
+        // Method and payload stay views into message, which the caller keeps
+        // alive for the whole request; only a decompressed payload is owned.
+        request.header        = parts.header;
+        request.header.flags  = static_cast<std::uint8_t>(request.header.flags & ~Flag::Compressed);
+        request.header.flags  = static_cast<std::uint8_t>(request.header.flags & ~Flag::MethodId);
+        request.payload       = parts.payload;
+        request.owned_payload = std::move(decompressed.value());
 
         result.ok = true;
         result.requests.emplace_back(std::move(request));
         NEKO_LOG_TRACE("rpc", "rpc backend incoming request decoded: method={} id={} payload={}",
-                       result.requests.back().method, result.requests.back().header.id,
-                       result.requests.back().payload.size());
+                       methodName(result.requests.back()), result.requests.back().header.id,
+                       Codec::payload(result.requests.back()).size());
         return result;
     }
 
@@ -286,7 +288,7 @@ public:
         static_assert(BackendSerializable<NekoRpcBackend, Params>,
                       "NekoRpcBackend: method parameters are not serializable by this Serializer");
         Params params;
-        if (!_decodePayload(request.payload, params)) {
+        if (!_decodePayload(Codec::payload(request), params)) {
             return ilias::Err(RpcError::InvalidParams);
         }
         return params;
@@ -348,19 +350,31 @@ public:
 
     static Message encodeResponses(ServerContext& context, PeerSession& session, const ResponseValues& responses,
                                    bool batch) {
-        WireResponseValues frames;
-        frames.reserve(responses.size());
+        auto segments = encodeResponseSegments(context, session, responses, batch);
+        if (!segments) {
+            return {};
+        }
+        return segments->frame.flatten();
+    }
+
+    // Like Codec::encodeResponses, a message carries the first response that
+    // encodes. The dispatcher sends the segments as they are, so payloads are
+    // not copied again after serialization.
+    static auto encodeResponseSegments(ServerContext& context, PeerSession& session, const ResponseValues& responses,
+                                       bool /*batch*/) -> std::optional<ResponseSegments> {
         for (const auto& response : responses) {
-            if (auto encoded = _encodeResponseFrame(context.options, session, response)) {
-                frames.emplace_back(std::move(encoded.value()));
-            } else {
-                auto fallback = _encodeResponseFrame(response);
-                if (_validFrameSize(fallback, context.options.frame_limits)) {
-                    frames.emplace_back(std::move(fallback));
-                }
+            ResponseSegments out;
+            if (auto encoded = _encodeResponseSegments(context.options, session, response, out.compressed_payload)) {
+                out.frame = std::move(encoded.value());
+                return out;
+            }
+            if (auto fallback = Codec::encodeFrameSegments(_responseParts(response));
+                fallback && _validFrameSegments(fallback.value(), context.options.frame_limits)) {
+                out.frame = std::move(fallback.value());
+                return out;
             }
         }
-        return Codec::encodeResponses(frames, batch);
+        return std::nullopt;
     }
 
     template <typename Method, typename... Args>
@@ -566,8 +580,8 @@ public:
         }
 
         std::vector<std::byte> response;
-        ILIAS_CO_TRY(auto received, co_await endpoint.recv(response));
-        if (received == 0U || !handleClientControl(context, session, response)) {
+        ILIAS_CO_TRY(auto received, co_await endpoint.recvHeld(response));
+        if (received.bytes.empty() || !handleClientControl(context, session, received.bytes)) {
             co_return ilias::Err(RpcError::InvalidRequest);
         }
 
@@ -677,6 +691,12 @@ private:
         return {};
     }
 
+    static auto _validFrameSegments(const typename Codec::EncodedFrame& frame, const rpc::NekoRpcFrameLimits& limits)
+        -> bool {
+        auto body_size = Codec::headerBodySize(frame.header, CodecId, limits);
+        return body_size && body_size.value() == frame.size() - frame.header.size();
+    }
+
     static auto _validFrameSize(std::span<const std::byte> frame, const rpc::NekoRpcFrameLimits& limits) -> bool {
         return static_cast<bool>(_validateFrameSize(frame, limits));
     }
@@ -841,25 +861,24 @@ private:
         return _makeResponse(id, std::move(payload.value()), Flag::Error, std::move(extensions));
     }
 
-    static auto _encodeResponseFrame(const ResponseValue& response) -> Message {
-        return Codec::encodeFrame({
+    static auto _responseParts(const ResponseValue& response) -> FrameParts {
+        return {
             .header     = response.header,
             .method     = rpc::NekoRpcExtensionCodec::asBytes(response.method),
             .extensions = _extensionViews(response.extensions),
             .payload    = rpc::NekoRpcExtensionCodec::asBytes(response.payload),
-        });
+        };
     }
 
-    static auto _encodeResponseFrame(const Options& options, PeerSession& session, const ResponseValue& response)
-        -> ilias::Result<Message, std::error_code> {
-        return rpc::neko_rpc_encode_outgoing_frame<NekoRpcBackend>(
-            options, session,
-            {
-                .header     = response.header,
-                .method     = rpc::NekoRpcExtensionCodec::asBytes(response.method),
-                .extensions = _extensionViews(response.extensions),
-                .payload    = rpc::NekoRpcExtensionCodec::asBytes(response.payload),
-            });
+    static auto _encodeResponseFrame(const ResponseValue& response) -> Message {
+        return Codec::encodeFrame(_responseParts(response));
+    }
+
+    static auto _encodeResponseSegments(const Options& options, PeerSession& session, const ResponseValue& response,
+                                        Message& compressed_payload)
+        -> ilias::Result<typename Codec::EncodedFrame, std::error_code> {
+        return rpc::neko_rpc_encode_outgoing_segments<NekoRpcBackend>(options, session, _responseParts(response),
+                                                                      compressed_payload);
     }
 
     static auto _decodeFrame(std::span<const std::byte> data) -> ilias::Result<DecodedRequest, std::error_code> {
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "nekoproto/global/global.hpp"
+#include "nekoproto/rpc/options.hpp"
+
+NEKO_BEGIN_NAMESPACE
+namespace detail {
+
+// Counters shared by every connection pool of one server.
+struct RpcRecvBufferPoolStats {
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::size_t> pooled_bytes{0};
+    std::atomic<std::size_t> leased_bytes{0};
+    std::atomic<std::size_t> pooled_bytes_high_water{0};
+    std::atomic<std::size_t> leased_bytes_high_water{0};
+
+    auto snapshot() const noexcept -> RpcBufferPoolMetrics {
+        return {.hits = hits.load(std::memory_order_relaxed),
+                .misses = misses.load(std::memory_order_relaxed),
+                .dropped = dropped.load(std::memory_order_relaxed),
+                .pooled_bytes = pooled_bytes.load(std::memory_order_relaxed),
+                .leased_bytes = leased_bytes.load(std::memory_order_relaxed),
+                .pooled_bytes_high_water = pooled_bytes_high_water.load(std::memory_order_relaxed),
+                .leased_bytes_high_water = leased_bytes_high_water.load(std::memory_order_relaxed)};
+    }
+
+    static auto add(std::atomic<std::size_t>& gauge, std::atomic<std::size_t>& highWater, std::size_t bytes) -> void {
+        const auto now = gauge.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto seen = highWater.load(std::memory_order_relaxed);
+        while (now > seen && !highWater.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// Receive buffers of one connection, kept in power-of-two size classes from
+// KMinBufferBytes up to the configured maximum. The server draws a buffer
+// sized for the previous frame before each recv, so the endpoint fills it
+// without allocating, and the buffer comes back when the request that owns it
+// has sent its response. Buffers beyond the per-class count or the maximum
+// size are freed instead of kept.
+class RpcRecvBufferPool : public std::enable_shared_from_this<RpcRecvBufferPool> {
+public:
+    static constexpr std::size_t KMinBufferBytes = 256U;
+    static constexpr std::size_t KMaxClasses = 24U; // 256 B .. 2 GiB
+
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(const Lease&) = delete;
+        auto operator=(const Lease&) -> Lease& = delete;
+        Lease(Lease&& other) noexcept
+            : mPool(std::move(other.mPool)), mBuffer(std::move(other.mBuffer)),
+              mLeasedBytes(std::exchange(other.mLeasedBytes, 0)) {}
+        auto operator=(Lease&& other) noexcept -> Lease& {
+            if (this != &other) {
+                _release();
+                mPool = std::move(other.mPool);
+                mBuffer = std::move(other.mBuffer);
+                mLeasedBytes = std::exchange(other.mLeasedBytes, 0);
+            }
+            return *this;
+        }
+        ~Lease() { _release(); }
+
+        auto buffer() noexcept -> std::vector<std::byte>& { return mBuffer; }
+
+    private:
+        friend class RpcRecvBufferPool;
+
+        Lease(std::shared_ptr<RpcRecvBufferPool> pool, std::vector<std::byte> buffer)
+            : mPool(std::move(pool)), mBuffer(std::move(buffer)), mLeasedBytes(mBuffer.capacity()) {}
+
+        auto _release() -> void {
+            if (auto pool = std::exchange(mPool, nullptr); pool != nullptr) {
+                pool->_release(std::move(mBuffer), mLeasedBytes);
+            }
+        }
+
+        std::shared_ptr<RpcRecvBufferPool> mPool;
+        std::vector<std::byte> mBuffer;
+        std::size_t mLeasedBytes = 0;
+    };
+
+    RpcRecvBufferPool(std::shared_ptr<RpcRecvBufferPoolStats> stats, std::size_t buffersPerClass,
+                      std::size_t maxBufferBytes)
+        : mStats(std::move(stats)), mBuffersPerClass(buffersPerClass),
+          mClassCount(std::min(_classOf(std::max(maxBufferBytes, KMinBufferBytes)) + 1U, KMaxClasses)) {}
+
+    ~RpcRecvBufferPool() {
+        std::size_t bytes = 0;
+        for (const auto& buffers : mClasses) {
+            for (const auto& buffer : buffers) {
+                bytes += buffer.capacity();
+            }
+        }
+        mStats->pooled_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // A buffer with room for at least expectedBytes when one is pooled, else a
+    // fresh one reserved to the size class of expectedBytes.
+    auto acquire(std::size_t expectedBytes) -> Lease {
+        const auto wanted = _ceilClassOf(std::max(expectedBytes, KMinBufferBytes));
+        std::vector<std::byte> buffer;
+        bool hit = false;
+        if (wanted < mClassCount) {
+            std::scoped_lock lock(mMutex);
+            // One class up is still a fair fit; beyond that a small frame would pin a large buffer.
+            for (auto cls = wanted; cls < std::min(wanted + 2U, mClassCount) && !hit; ++cls) {
+                if (!mClasses[cls].empty()) {
+                    buffer = std::move(mClasses[cls].back());
+                    mClasses[cls].pop_back();
+                    hit = true;
+                }
+            }
+        }
+        if (hit) {
+            mStats->hits.fetch_add(1U, std::memory_order_relaxed);
+            mStats->pooled_bytes.fetch_sub(buffer.capacity(), std::memory_order_relaxed);
+        } else {
+            mStats->misses.fetch_add(1U, std::memory_order_relaxed);
+            buffer.reserve(KMinBufferBytes << std::min(wanted, KMaxClasses - 1U));
+        }
+        RpcRecvBufferPoolStats::add(mStats->leased_bytes, mStats->leased_bytes_high_water, buffer.capacity());
+        return Lease(shared_from_this(), std::move(buffer));
+    }
+
+private:
+    static auto _classOf(std::size_t capacity) noexcept -> std::size_t {
+        return static_cast<std::size_t>(std::bit_width(capacity / KMinBufferBytes)) - 1U;
+    }
+    static auto _ceilClassOf(std::size_t bytes) noexcept -> std::size_t {
+        return _classOf(std::bit_ceil(bytes));
+    }
+
+    auto _release(std::vector<std::byte> buffer, std::size_t leasedBytes) -> void {
+        mStats->leased_bytes.fetch_sub(leasedBytes, std::memory_order_relaxed);
+        const auto capacity = buffer.capacity();
+        if (capacity >= KMinBufferBytes) {
+            const auto cls = _classOf(capacity);
+            std::scoped_lock lock(mMutex);
+            if (cls < mClassCount && mClasses[cls].size() < mBuffersPerClass) {
+                buffer.clear();
+                mClasses[cls].push_back(std::move(buffer));
+                RpcRecvBufferPoolStats::add(mStats->pooled_bytes, mStats->pooled_bytes_high_water, capacity);
+                return;
+            }
+        }
+        if (capacity != 0U) {
+            mStats->dropped.fetch_add(1U, std::memory_order_relaxed);
+        }
+    }
+
+    std::shared_ptr<RpcRecvBufferPoolStats> mStats;
+    std::size_t mBuffersPerClass;
+    std::size_t mClassCount;
+    std::mutex mMutex;
+    std::array<std::vector<std::vector<std::byte>>, KMaxClasses> mClasses;
+};
+
+} // namespace detail
+NEKO_END_NAMESPACE
@@ -22,6 +22,7 @@
 #include "nekoproto/rpc/builtin.hpp"
 #include "nekoproto/rpc/concepts.hpp"
 #include "nekoproto/rpc/endpoint.hpp"
+#include "nekoproto/rpc/local.hpp"
 #include "nekoproto/rpc/options.hpp"
 #include "nekoproto/rpc/registry.hpp"
 
@@ -57,15 +58,18 @@ public:
     auto close() -> void {
         std::shared_ptr<detail::IMessageEndpoint> endpoint;
         std::shared_ptr<ilias::TaskScope> receiverScope;
+        RpcLocalEndpoint<Backend> local;
         {
             std::scoped_lock lock(mStateMutex);
             endpoint         = std::exchange(mEndpoint, nullptr);
             receiverScope    = std::exchange(mReceiverScope, nullptr);
+            local            = std::exchange(mLocal, {});
             mReceiverStarted = false;
         }
         if (endpoint != nullptr) {
             endpoint->close();
         }
+        local.close();
         _failAllPending(Backend::clientNotInitError());
         if (receiverScope != nullptr) {
             receiverScope->stop();
@@ -124,7 +128,7 @@ public:
 
     auto isConnected() const -> bool {
         std::scoped_lock lock(mStateMutex);
-        return mEndpoint != nullptr;
+        return mEndpoint != nullptr || mLocal.isOpen();
     }
 
     auto metrics() const -> RpcMetricsSnapshot {
@@ -188,6 +192,13 @@ public:
         mResetPeerSession = true;
     }
 
+    // Connects to a server in the same process, see RpcServer::connectLocal().
+    auto setEndpoint(RpcLocalEndpoint<Backend> endpoint) -> void {
+        close();
+        std::scoped_lock lock(mStateMutex);
+        mLocal = std::move(endpoint);
+    }
+
     template <typename StreamT>
         requires detail::RpcStreamBackend<Backend, StreamT>
     auto setEndpoint(StreamT stream) -> void {
@@ -387,6 +398,29 @@ private:
 
     template <typename T, typename... Args>
     auto _callRemote(T& metadata, Args... args) -> ilias::IoTask<typename std::decay_t<T>::RawReturnType> {
+        RpcLocalEndpoint<Backend> local;
+        {
+            std::scoped_lock lock(mStateMutex);
+            local = mLocal;
+        }
+        if (local.isOpen()) {
+            using RetT   = typename std::decay_t<T>::RawReturnType;
+            using Params = detail::RpcLocalParamsType<typename std::decay_t<T>::RawParamsType>;
+            if (local.accepts(metadata.name(), typeid(RetT(Params)))) {
+                co_return co_await local.template call<RetT>(metadata.name(), Params(std::forward<Args>(args)...),
+                                                             metadata.isNotification());
+            }
+            // The handler declares other types than this call: encode it so
+            // the codec converts the values exactly as it would on the wire.
+            auto session = Backend::makeClientPeerSession(mBackendContext);
+            ILIAS_CO_TRY(auto request, Backend::template encodeRequest<T>(mBackendContext, session, metadata,
+                                                                          metadata.isNotification(), args...));
+            ILIAS_CO_TRY(auto response,
+                         co_await local.call(std::move(request.message), request.id, metadata.isNotification()));
+            co_return Backend::template decodeResponse<T>(
+                mBackendContext, session,
+                {reinterpret_cast<const std::byte*>(response.data()), response.size()}, request.id);
+        }
         if constexpr (!requires(std::span<const std::byte> message) {
                           { Backend::responseId(message) } -> std::same_as<std::optional<typename Backend::Id>>;
                       }) {
@@ -470,8 +504,8 @@ private:
 
             ilias::Result<typename std::decay_t<T>::RawReturnType, std::error_code> decoded;
             {
-                decoded =
-                    Backend::template decodeResponse<T>(mBackendContext, mPeerSession, wireResult.value(), request.id);
+                const auto response = wireResult.value().held.bytes;
+                decoded = Backend::template decodeResponse<T>(mBackendContext, mPeerSession, response, request.id);
             }
             if (decoded) {
                 NEKO_LOG_TRACE("rpc", "rpc client call end: method={}", metadata.name());
@@ -537,9 +571,9 @@ private:
                 co_return ilias::Err(Backend::notificationOk());
             }
             std::vector<std::byte> buffer;
-            ILIAS_CO_TRY(auto received, co_await endpoint->recv(buffer));
-            (void)received;
-            auto decoded = Backend::template decodeResponse<T>(mBackendContext, mPeerSession, buffer, request.id);
+            ILIAS_CO_TRY(auto received, co_await endpoint->recvHeld(buffer));
+            auto decoded =
+                Backend::template decodeResponse<T>(mBackendContext, mPeerSession, received.bytes, request.id);
             if (decoded) {
                 if constexpr (std::is_void_v<typename std::decay_t<T>::RawReturnType>) {
                     co_return {};
@@ -592,25 +626,27 @@ private:
 
     auto _receiveLoop(std::shared_ptr<detail::IMessageEndpoint> endpoint) -> ilias::Task<void> {
         while (true) {
+            // A held message (e.g. a mapped memfd) is handed to the caller in place, together with its holder.
             std::vector<std::byte> buffer;
-            auto received = co_await endpoint->recv(buffer);
-            if (!received || received.value() == 0U) {
+            auto received = co_await endpoint->recvHeld(buffer);
+            if (!received || received.value().bytes.empty()) {
                 const auto error = received ? make_error_code(ilias::IoError::UnexpectedEOF) : received.error();
                 _disconnect(endpoint, error);
                 co_return;
             }
-            if constexpr (requires { Backend::validateMessage(mBackendContext, buffer); }) {
-                auto validated = Backend::validateMessage(mBackendContext, buffer);
+            const auto message = received.value().bytes;
+            if constexpr (requires { Backend::validateMessage(mBackendContext, message); }) {
+                auto validated = Backend::validateMessage(mBackendContext, message);
                 if (!validated) {
                     endpoint->close();
                     _disconnect(endpoint, validated.error());
                     co_return;
                 }
             }
-            if (Backend::handleClientControl(mBackendContext, mPeerSession, buffer)) {
+            if (Backend::handleClientControl(mBackendContext, mPeerSession, message)) {
                 continue;
             }
-            auto id = Backend::responseId(buffer);
+            auto id = Backend::responseId(message);
             if (!id.has_value()) {
                 NEKO_LOG_WARN("rpc", "rpc client ignored a frame without a response id");
                 continue;
@@ -624,7 +660,8 @@ private:
                 }
             }
             if (sender.has_value()) {
-                (void)sender->send(PendingResult(std::move(buffer)));
+                // Moving the vector keeps its storage, so a view into it stays valid.
+                (void)sender->send(PendingResult(ReceivedFrame{std::move(buffer), std::move(received.value())}));
             } else {
                 NEKO_LOG_WARN("rpc", "rpc client received a response for an unknown request id");
             }
@@ -714,7 +751,12 @@ private:
     }
 
 private:
-    using PendingResult = ilias::Result<std::vector<std::byte>, std::error_code>;
+    /// A response and what keeps it alive: @c held views either @c buffer or storage owned by its holder.
+    struct ReceivedFrame {
+        std::vector<std::byte> buffer;
+        detail::HeldMessage held;
+    };
+    using PendingResult = ilias::Result<ReceivedFrame, std::error_code>;
     using PendingSender = ilias::oneshot::Sender<PendingResult>;
 
     struct PendingEraseGuard {
@@ -731,6 +773,7 @@ private:
 
     std::shared_ptr<detail::IMessageEndpoint> mEndpoint;
     std::shared_ptr<ilias::TaskScope> mReceiverScope;
+    RpcLocalEndpoint<Backend> mLocal;
     typename Backend::ClientContext mBackendContext;
     typename Backend::PeerSession mPeerSession;
     std::map<typename Backend::Id, PendingSender> mPending;
@@ -5,6 +5,7 @@
 #include <atomic>
 #include <chrono>
 #include <compare>
+#include <functional>
 #include <ilias/io/system_error.hpp>
 #include <ilias/platform.hpp>
 #include <ilias/sync/mutex.hpp>
@@ -20,6 +21,9 @@
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -158,6 +162,23 @@ private:
     std::atomic<std::uint64_t> mRejected{0};
 };
 
+// Argument tuple handed over by RpcLocalEndpoint. Parameters are decayed the
+// same way backends decode them, so a client and a server that declare the
+// same method agree on this type.
+template <typename Tuple>
+struct RpcLocalParams;
+
+template <typename... Args>
+struct RpcLocalParams<std::tuple<Args...>> {
+    using type = std::tuple<std::decay_t<Args>...>;
+};
+
+template <typename Tuple>
+using RpcLocalParamsType = typename RpcLocalParams<Tuple>::type;
+
+template <typename Method>
+using RpcLocalSignature = typename Method::RawReturnType(RpcLocalParamsType<typename Method::RawParamsType>);
+
 template <RpcBackend Backend>
 class RpcMethodWrapperBase {
 public:
@@ -168,6 +189,10 @@ public:
     virtual auto call(const typename Backend::DecodedRequest& request,
                       typename Backend::ResponseValues& responses, const RpcRequestContext* context)
         -> ilias::Task<void> = 0;
+    // In-process call: params points to RpcLocalParamsType of the method and
+    // result to its ilias::Result, both checked against localSignature().
+    virtual auto callLocal(void* params, void* result, const RpcRequestContext* context) -> ilias::Task<void> = 0;
+    virtual auto localSignature() const noexcept -> const std::type_info& = 0;
     virtual auto usesContext() const noexcept -> bool = 0;
     virtual auto name() noexcept -> std::string_view                                             = 0;
     virtual auto signature() noexcept -> std::string_view                                        = 0;
@@ -206,6 +231,10 @@ public:
     auto call(const typename Backend::DecodedRequest& request, typename Backend::ResponseValues& responses,
               const RpcRequestContext* context)
         -> ilias::Task<void> override;
+    auto callLocal(void* params, void* result, const RpcRequestContext* context) -> ilias::Task<void> override;
+    auto localSignature() const noexcept -> const std::type_info& override {
+        return typeid(RpcLocalSignature<MethodType>);
+    }
     auto usesContext() const noexcept -> bool override { return false; }
     auto name() noexcept -> std::string_view override { return mMethodData->name(); }
     auto signature() noexcept -> std::string_view override { return mMethodData->signature; }
@@ -228,6 +257,10 @@ public:
 
     auto call(const typename Backend::DecodedRequest& request, typename Backend::ResponseValues& responses,
               const RpcRequestContext* context) -> ilias::Task<void> override;
+    auto callLocal(void* params, void* result, const RpcRequestContext* context) -> ilias::Task<void> override;
+    auto localSignature() const noexcept -> const std::type_info& override {
+        return typeid(RpcLocalSignature<typename RpcMethodTypeHelper<T>::MethodType>);
+    }
     auto usesContext() const noexcept -> bool override { return true; }
     auto name() noexcept -> std::string_view override { return mMethodData->name(); }
     auto signature() noexcept -> std::string_view override { return mMethodData->signature; }
@@ -412,7 +445,7 @@ public:
     }
 
     auto methodDatas(std::string_view name) -> MethodData {
-        if (auto item = mHandlers.find(std::string(name)); item != mHandlers.end()) {
+        if (auto item = mHandlers.find(name); item != mHandlers.end()) {
             return {.name           = item->second->name(),
                     .signature      = item->second->signature(),
                     .description    = item->second->description(),
@@ -449,7 +482,7 @@ public:
         ilias::TaskGroup<void> requestTasks;
         for (std::size_t index = 0; index < decoded.requests.size(); ++index) {
             const auto& request = decoded.requests[index];
-            const auto method_name = std::string(Backend::methodName(request));
+            const auto method_name = Backend::methodName(request);
             const auto handler = mHandlers.find(method_name);
             if (handler == mHandlers.end()) {
                 NEKO_LOG_WARN("rpc", "method {} not found!", method_name);
@@ -477,10 +510,10 @@ public:
                 }
                 const auto effectiveTimeout = _effectiveRequestTimeout(std::addressof(session));
                 const auto deadline = _deadlineFromNow(effectiveTimeout);
-                auto handle = requestTasks.spawn(_executeRequest(*handler->second, request, responseSlots[index],
-                                                                 std::move(*admission), activeKey,
-                                                                 std::addressof(session), peer, effectiveTimeout,
-                                                                 deadline));
+                auto handle = requestTasks.spawn(
+                    _executeRequest(WireInvocation{*handler->second, request, responseSlots[index]},
+                                    std::move(*admission), activeKey, std::addressof(session), peer,
+                                    effectiveTimeout, deadline));
                 if (activeKey.has_value()) {
                     {
                         std::scoped_lock lock(mActiveMutex);
@@ -513,6 +546,16 @@ public:
             responses.insert(responses.end(), std::make_move_iterator(slot.begin()), std::make_move_iterator(slot.end()));
         }
 
+        // Backends that hand a response out as segments let the endpoint write
+        // it straight from the response values instead of one flat copy.
+        if constexpr (requires { Backend::encodeResponseSegments(context, session, responses, decoded.batch); }) {
+            if (endpoint != nullptr) {
+                co_await _sendResponseSegments(context, session, responses, decoded.batch, endpoint,
+                                               endpointSendMutex);
+                co_return buffer;
+            }
+        }
+
         buffer = Backend::encodeResponses(context, session, responses, decoded.batch);
         if (!buffer.empty()) {
             if constexpr (requires { Backend::validateMessage(context, buffer); }) {
@@ -552,6 +595,64 @@ public:
         co_return buffer;
     }
 
+    // Whether an in-process call declared as @p signature can be handed to the
+    // handler of @p method without encoding. Unknown methods answer true so the
+    // typed call reports MethodNotFound.
+    auto acceptsLocal(std::string_view method, const std::type_info& signature) const -> bool {
+        const auto handler = mHandlers.find(method);
+        return handler == mHandlers.end() || handler->second->localSignature() == signature;
+    }
+
+    // Runs one in-process call through the same admission, timeout and
+    // cancellation bookkeeping as processMessage, with the arguments moved
+    // straight into the handler and its return value moved back out.
+    template <typename RetT, typename Params>
+    auto callLocal(std::string_view method, Params params, const void* session, Id id, bool expectsResponse,
+                   bool rejectOnly = false, const RpcPeerInfo* peer = nullptr) -> ilias::IoTask<RetT> {
+        const auto handler = mHandlers.find(method);
+        if (handler == mHandlers.end()) {
+            NEKO_LOG_WARN("rpc", "method {} not found!", method);
+            co_return ilias::Err(RpcError::MethodNotFound);
+        }
+        if (handler->second->localSignature() != typeid(RetT(Params))) {
+            NEKO_LOG_WARN("rpc", "local call signature mismatch: method={}", method);
+            co_return ilias::Err(RpcError::InvalidParams);
+        }
+        if (rejectOnly) {
+            mExecution.reject();
+            co_return ilias::Err(RpcError::Overloaded);
+        }
+        auto admission = mExecution.tryAdmit();
+        if (!admission.has_value()) {
+            co_return ilias::Err(RpcError::Overloaded);
+        }
+
+        std::optional<ActiveKey> activeKey;
+        if (expectsResponse) {
+            activeKey = ActiveKey{.session = session, .id = id};
+            std::scoped_lock lock(mActiveMutex);
+            mRequestStates.insert_or_assign(*activeKey, RequestState::Queued);
+        }
+        const auto effectiveTimeout = _effectiveRequestTimeout(session);
+        const auto deadline = _deadlineFromNow(effectiveTimeout);
+        ilias::Result<RetT, std::error_code> result = ilias::Err(ilias::IoError::Canceled);
+        ilias::TaskGroup<void> requestTasks;
+        auto handle = requestTasks.spawn(
+            _executeRequest(LocalInvocation<RetT, Params>{*handler->second, method, id, params, result},
+                            std::move(*admission), activeKey, session, peer, effectiveTimeout, deadline));
+        if (activeKey.has_value()) {
+            std::scoped_lock lock(mActiveMutex);
+            mCancelHandles.insert_or_assign(*activeKey, std::move(handle));
+        }
+        co_await requestTasks.waitAll();
+        if (activeKey.has_value()) {
+            std::scoped_lock lock(mActiveMutex);
+            mCancelHandles.erase(*activeKey);
+            mRequestStates.erase(*activeKey);
+        }
+        co_return std::move(result);
+    }
+
     void cancel(const void* session, const Id& id) {
         std::scoped_lock lock(mActiveMutex);
         if (auto it = mCancelHandles.find(ActiveKey{.session = session, .id = id}); it != mCancelHandles.end()) {
@@ -610,8 +711,69 @@ public:
     }
 
 private:
-    auto _executeRequest(RpcMethodWrapperBase<Backend>& handler, const typename Backend::DecodedRequest& request,
-                         typename Backend::ResponseValues& responses, RpcExecutionLimiter::Admission admission,
+    // One admitted call as seen by the limiter and timeout code: either a
+    // decoded wire request or a typed in-process call.
+    struct WireInvocation {
+        RpcMethodWrapperBase<Backend>& handler;
+        const typename Backend::DecodedRequest& request;
+        typename Backend::ResponseValues& responses;
+
+        auto method() const -> std::string_view { return Backend::methodName(request); }
+        auto id() const -> const Id& { return Backend::id(request); }
+        auto fail(std::error_code error) -> void { Backend::appendError(responses, request, error); }
+        auto run(const RpcRequestContext* context) -> ilias::Task<void> {
+            return handler.call(request, responses, context);
+        }
+    };
+
+    template <typename RetT, typename Params>
+    struct LocalInvocation {
+        RpcMethodWrapperBase<Backend>& handler;
+        std::string_view name;
+        const Id& requestId;
+        Params& params;
+        ilias::Result<RetT, std::error_code>& result;
+
+        auto method() const -> std::string_view { return name; }
+        auto id() const -> const Id& { return requestId; }
+        auto fail(std::error_code error) -> void { result = ilias::Err(error); }
+        auto run(const RpcRequestContext* context) -> ilias::Task<void> {
+            return handler.callLocal(std::addressof(params), std::addressof(result), context);
+        }
+    };
+
+    auto _sendResponseSegments(typename Backend::ServerContext& context, typename Backend::PeerSession& session,
+                               const typename Backend::ResponseValues& responses, bool batch,
+                               IMessageEndpoint* endpoint, ilias::Mutex* endpointSendMutex) -> ilias::Task<void> {
+        if (responses.empty()) {
+            co_return;
+        }
+        const auto frame = Backend::encodeResponseSegments(context, session, responses, batch);
+        if (!frame) {
+            NEKO_LOG_ERROR("rpc", "rpc response could not be encoded within configured message limits");
+            endpoint->close();
+            co_return;
+        }
+        NEKO_LOG_TRACE("rpc", "rpc dispatcher response encoded: responses={} bytes={}", responses.size(),
+                       frame->size());
+
+        const auto segments     = frame->segments();
+        const auto sendResponse = [endpoint, &frame](const auto& ret) {
+            if (!ret || ret.value() != frame->size()) {
+                NEKO_LOG_ERROR("rpc", "send rpc response failed: {}", ret ? "short write" : ret.error().message());
+                endpoint->close();
+            }
+        };
+        if (endpointSendMutex != nullptr) {
+            auto guard = co_await endpointSendMutex->lock();
+            sendResponse(co_await endpoint->sendVectored(segments));
+        } else {
+            sendResponse(co_await endpoint->sendVectored(segments));
+        }
+    }
+
+    template <typename Invocation>
+    auto _executeRequest(Invocation invocation, RpcExecutionLimiter::Admission admission,
                          std::optional<ActiveKey> activeKey, const void* session, const RpcPeerInfo* peer,
                          std::optional<std::chrono::nanoseconds> effectiveTimeout,
                          std::optional<RpcRequestContext::Clock::time_point> deadline)
@@ -619,33 +781,30 @@ private:
         if (effectiveTimeout.has_value()) {
             if (effectiveTimeout->count() <= 0) {
                 mExecution.markTimedOut();
-                Backend::appendError(responses, request, RpcError::DeadlineExceeded);
+                invocation.fail(RpcError::DeadlineExceeded);
                 co_return;
             }
             const auto remaining = *deadline - RpcRequestContext::Clock::now();
             if (remaining <= RpcRequestContext::Clock::duration::zero()) {
                 mExecution.markTimedOut();
-                Backend::appendError(responses, request, RpcError::DeadlineExceeded);
+                invocation.fail(RpcError::DeadlineExceeded);
                 co_return;
             }
             auto completed = co_await ilias::timeout(
-                _runAdmittedRequest(handler, request, responses, std::move(admission), std::move(activeKey),
-                                    deadline, session, peer),
+                _runAdmittedRequest(invocation, std::move(admission), std::move(activeKey), deadline, session, peer),
                 remaining);
             if (!completed) {
                 mExecution.markTimedOut();
-                Backend::appendError(responses, request, RpcError::DeadlineExceeded);
+                invocation.fail(RpcError::DeadlineExceeded);
             }
             co_return;
         }
 
-        co_await _runAdmittedRequest(handler, request, responses, std::move(admission), std::move(activeKey),
-                                    deadline, session, peer);
+        co_await _runAdmittedRequest(invocation, std::move(admission), std::move(activeKey), deadline, session, peer);
     }
 
-    auto _runAdmittedRequest(RpcMethodWrapperBase<Backend>& handler,
-                             const typename Backend::DecodedRequest& request,
-                             typename Backend::ResponseValues& responses, RpcExecutionLimiter::Admission admission,
+    template <typename Invocation>
+    auto _runAdmittedRequest(Invocation invocation, RpcExecutionLimiter::Admission admission,
                              std::optional<ActiveKey> activeKey,
                              std::optional<RpcRequestContext::Clock::time_point> deadline, const void* session,
                              const RpcPeerInfo* peer)
@@ -659,12 +818,12 @@ private:
             }
         }
         std::optional<RpcRequestContext> context;
-        if (handler.usesContext()) {
-            context.emplace(RpcRequestContextAccess::make(Backend::methodName(request),
-                                                          _stringifyId(Backend::id(request)), deadline, peer, session));
+        if (invocation.handler.usesContext()) {
+            context.emplace(RpcRequestContextAccess::make(invocation.method(), _stringifyId(invocation.id()),
+                                                          deadline, peer, session));
             RpcRequestContextAccess::setCancellationToken(*context, co_await ilias::this_coro::stopToken());
         }
-        co_await handler.call(request, responses, context.has_value() ? std::addressof(*context) : nullptr);
+        co_await invocation.run(context.has_value() ? std::addressof(*context) : nullptr);
     }
 
     auto _effectiveRequestTimeout(const void* session) const -> std::optional<std::chrono::nanoseconds> {
@@ -758,6 +917,38 @@ private:
         NEKO_LOG_TRACE("rpc", "rpc dispatcher context invoke end: method={}", metadata.name());
     }
 
+    template <typename T>
+    auto _handleLocal(T& metadata, RpcLocalParamsType<typename T::RawParamsType>& params,
+                      ilias::Result<typename T::RawReturnType, std::error_code>& result) -> ilias::Task<void> {
+        NEKO_LOG_TRACE("rpc", "rpc dispatcher local invoke begin: method={}", metadata.name());
+        try {
+            result = co_await std::apply(metadata, std::move(params));
+        } catch (...) {
+            NEKO_LOG_ERROR("rpc", "rpc handler threw an exception: method={}", metadata.name());
+            result = ilias::Err(RpcError::InternalError);
+        }
+        NEKO_LOG_TRACE("rpc", "rpc dispatcher local invoke end: method={}", metadata.name());
+    }
+
+    template <typename T, typename Function>
+    auto _handleLocalWithContext(T& metadata, Function& function, const RpcRequestContext& context,
+                                 RpcLocalParamsType<typename T::RawParamsType>& params,
+                                 ilias::Result<typename T::RawReturnType, std::error_code>& result)
+        -> ilias::Task<void> {
+        NEKO_LOG_TRACE("rpc", "rpc dispatcher local context invoke begin: method={}", metadata.name());
+        try {
+            result = co_await std::apply(
+                [&](auto&&... args) {
+                    return function(context, std::forward<decltype(args)>(args)...);
+                },
+                std::move(params));
+        } catch (...) {
+            NEKO_LOG_ERROR("rpc", "rpc context handler threw an exception: method={}", metadata.name());
+            result = ilias::Err(RpcError::InternalError);
+        }
+        NEKO_LOG_TRACE("rpc", "rpc dispatcher local context invoke end: method={}", metadata.name());
+    }
+
     template <typename Value>
     static auto _stringifyId(const Value& value) -> std::string {
         using Type = std::remove_cvref_t<Value>;
@@ -779,7 +970,7 @@ private:
     std::map<ActiveKey, RequestState> mRequestStates;
     std::map<const void*, std::chrono::nanoseconds> mConnectionTimeouts;
     mutable std::mutex mActiveMutex;
-    std::map<std::string, std::unique_ptr<RpcMethodWrapperBase<Backend>>> mHandlers;
+    std::map<std::string, std::unique_ptr<RpcMethodWrapperBase<Backend>>, std::less<>> mHandlers;
     RpcExecutionLimiter mExecution;
     std::optional<std::chrono::nanoseconds> mRequestTimeout;
 
@@ -796,6 +987,14 @@ auto RpcMethodWrapperImpl<Backend, T>::call(const typename Backend::DecodedReque
     return mSelf->_handle(request, responses, *mMethodData);
 }
 
+template <RpcBackend Backend, typename T>
+auto RpcMethodWrapperImpl<Backend, T>::callLocal(void* params, void* result, const RpcRequestContext* /*context*/)
+    -> ilias::Task<void> {
+    using Params = RpcLocalParamsType<typename MethodType::RawParamsType>;
+    using Result = ilias::Result<typename MethodType::RawReturnType, std::error_code>;
+    return mSelf->_handleLocal(*mMethodData, *static_cast<Params*>(params), *static_cast<Result*>(result));
+}
+
 template <RpcBackend Backend, typename T, typename ContextFunction>
 auto RpcContextMethodWrapperImpl<Backend, T, ContextFunction>::call(
     const typename Backend::DecodedRequest& request, typename Backend::ResponseValues& responses,
@@ -806,6 +1005,20 @@ auto RpcContextMethodWrapperImpl<Backend, T, ContextFunction>::call(
     co_await mSelf->_handleWithContext(request, responses, *mMethodData, mFunction, *context);
 }
 
+template <RpcBackend Backend, typename T, typename ContextFunction>
+auto RpcContextMethodWrapperImpl<Backend, T, ContextFunction>::callLocal(void* params, void* result,
+                                                                         const RpcRequestContext* context)
+    -> ilias::Task<void> {
+    using MethodType = typename RpcMethodTypeHelper<T>::MethodType;
+    using Params     = RpcLocalParamsType<typename MethodType::RawParamsType>;
+    using Result     = ilias::Result<typename MethodType::RawReturnType, std::error_code>;
+    if (context == nullptr) {
+        co_return;
+    }
+    co_await mSelf->_handleLocalWithContext(*mMethodData, mFunction, *context, *static_cast<Params*>(params),
+                                            *static_cast<Result*>(result));
+}
+
 } // namespace detail
 
 NEKO_END_NAMESPACE
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ilias/io/system_error.hpp>
+#include <ilias/sync/oneshot.hpp>
+#include <ilias/task/scope.hpp>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <typeinfo>
+#include <utility>
+
+#include "nekoproto/global/log.hpp"
+#include "nekoproto/rpc/concepts.hpp"
+#include "nekoproto/rpc/dispatcher.hpp"
+#include "nekoproto/rpc/options.hpp"
+
+NEKO_BEGIN_NAMESPACE
+namespace detail {
+
+// Server half of an in-process connection. The server keeps every link it
+// handed out and closes it before the dispatcher goes away; the calls run in
+// the link's own task scope so server close/shutdown can wait for them.
+template <RpcBackend Backend>
+struct RpcLocalLink {
+    RpcDispatcher<Backend>* dispatcher = nullptr;
+    typename Backend::ServerContext* context = nullptr;
+    typename Backend::PeerSession session;
+    // Encoded calls run under their own session so their request ids never
+    // collide with the ids handed out for typed calls.
+    typename Backend::PeerSession wireSession;
+    RpcPeerInfo peer;
+    std::size_t maxInflight = 1024U;
+    std::unique_ptr<ilias::TaskScope> requests = std::make_unique<ilias::TaskScope>();
+    std::mutex mutex;
+    std::size_t inflight = 0;
+    bool closed = false;
+    std::atomic<std::uint64_t> nextId{1};
+
+    auto isOpen() -> bool {
+        std::scoped_lock lock(mutex);
+        return !closed;
+    }
+
+    // Refuse new calls but let the running ones finish.
+    auto stopAccepting() -> void {
+        std::scoped_lock lock(mutex);
+        closed = true;
+    }
+
+    // Whichever side closes first cancels the running calls; after that the
+    // server may already be gone, so the dispatcher is not touched again.
+    // Stopping a handler may finish its task inline and the task takes the
+    // mutex on exit, hence the dispatcher is called without holding it.
+    auto close() -> void {
+        {
+            std::scoped_lock lock(mutex);
+            if (std::exchange(closed, true)) {
+                return;
+            }
+        }
+        dispatcher->cancelSession(std::addressof(session));
+        dispatcher->cancelSession(std::addressof(wireSession));
+        requests->stop();
+    }
+
+    auto cancel(const typename Backend::PeerSession& target, const typename Backend::Id& id) -> void {
+        if (isOpen()) {
+            dispatcher->cancel(std::addressof(target), id);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief In-process connection between an RpcClient and an RpcServer that share a Backend.
+ *
+ * Obtained from RpcServer::connectLocal() and passed to RpcClient::setEndpoint().
+ * A call skips the codec and the stream: the argument tuple is moved into a
+ * task on the server, which runs the handler through the dispatcher's
+ * admission limits, request timeout and cancel bookkeeping, and the return
+ * value is moved back through a oneshot channel. Client and server must run
+ * on the same executor. The typed path needs both sides to declare the same
+ * decayed signature; when they differ (say `int` against `std::int64_t`) the
+ * client encodes the request with the backend instead and the server runs it
+ * through processMessage, so the codec converts the values as it would on the
+ * wire.
+ */
+template <RpcBackend Backend>
+class RpcLocalEndpoint {
+public:
+    RpcLocalEndpoint() = default;
+    explicit RpcLocalEndpoint(std::shared_ptr<detail::RpcLocalLink<Backend>> link) : mLink(std::move(link)) {}
+
+    auto isOpen() const -> bool { return mLink != nullptr && mLink->isOpen(); }
+
+    auto close() -> void {
+        if (auto link = std::exchange(mLink, nullptr); link != nullptr) {
+            link->close();
+        }
+    }
+
+    // Whether a call declared as @p signature can take the typed path. An
+    // unknown method or a closed link stays on it to report the error there.
+    auto accepts(std::string_view method, const std::type_info& signature) const -> bool {
+        auto link = mLink;
+        if (link == nullptr) {
+            return true;
+        }
+        std::scoped_lock lock(link->mutex);
+        return link->closed || link->dispatcher->acceptsLocal(method, signature);
+    }
+
+    template <typename RetT, typename Params>
+    auto call(std::string_view method, Params params, bool notification) -> ilias::IoTask<RetT> {
+        return _submit<RetT>(
+            false, std::nullopt, notification,
+            [method = std::string(method), params = std::move(params), notification](
+                detail::RpcLocalLink<Backend>& link, const typename Backend::Id& id, bool overloaded) mutable {
+                return link.dispatcher->template callLocal<RetT>(method, std::move(params),
+                                                                 std::addressof(link.session), id, !notification,
+                                                                 overloaded, std::addressof(link.peer));
+            });
+    }
+
+    // Runs a request the client encoded with the backend and hands back the
+    // encoded response; @p id is the id the request carries.
+    auto call(typename Backend::Message request, const typename Backend::Id& id, bool notification)
+        -> ilias::IoTask<typename Backend::Message> {
+        return _submit<typename Backend::Message>(
+            true, id, notification,
+            [request = std::move(request)](detail::RpcLocalLink<Backend>& link, const typename Backend::Id& /*id*/,
+                                           bool overloaded) -> ilias::IoTask<typename Backend::Message> {
+                co_return co_await link.dispatcher->processMessage(
+                    {reinterpret_cast<const std::byte*>(request.data()), request.size()}, *link.context,
+                    link.wireSession, nullptr, nullptr, overloaded, std::addressof(link.peer));
+            });
+    }
+
+private:
+    // Shared by both call paths: inflight accounting, running @p invoke in
+    // the link's task scope and cancelling it when the caller goes away. A
+    // typed call draws its id from the link; an encoded call brings its own.
+    template <typename RetT, typename Invoke>
+    auto _submit(bool wire, std::optional<typename Backend::Id> requestId, bool notification, Invoke invoke)
+        -> ilias::IoTask<RetT> {
+        using Result = ilias::Result<RetT, std::error_code>;
+        auto link    = mLink;
+        if (link == nullptr) {
+            co_return ilias::Err(Backend::clientNotInitError());
+        }
+        bool overloaded = false;
+        {
+            std::scoped_lock lock(link->mutex);
+            if (link->closed) {
+                co_return ilias::Err(Backend::clientNotInitError());
+            }
+            overloaded = link->inflight >= link->maxInflight;
+            ++link->inflight;
+        }
+        const typename Backend::Id id =
+            requestId.has_value() ? std::move(*requestId)
+                                  : typename Backend::Id(link->nextId.fetch_add(1U, std::memory_order_relaxed));
+        auto channel = ilias::oneshot::channel<Result>();
+        link->requests->spawn([link, id, invoke = std::move(invoke), notification, overloaded,
+                               sender = std::move(channel.sender)]() mutable -> ilias::Task<void> {
+            struct InflightGuard {
+                detail::RpcLocalLink<Backend>& link;
+                ~InflightGuard() {
+                    std::scoped_lock lock(link.mutex);
+                    --link.inflight;
+                }
+            } inflightGuard{*link};
+            auto result = co_await invoke(*link, id, overloaded);
+            if (!notification) {
+                (void)sender.send(std::move(result));
+            }
+        });
+        if (notification) {
+            NEKO_LOG_TRACE("rpc", "rpc local notification queued");
+            co_return ilias::Err(Backend::notificationOk());
+        }
+
+        // Dropping the caller (client timeout or cancellation) stops the
+        // server task the same way a wire cancel frame would.
+        struct AbandonGuard {
+            detail::RpcLocalLink<Backend>& link;
+            const typename Backend::PeerSession& session;
+            const typename Backend::Id& id;
+            bool active = true;
+            ~AbandonGuard() {
+                if (active) {
+                    link.cancel(session, id);
+                }
+            }
+        } abandonGuard{*link, wire ? link->wireSession : link->session, id};
+        auto delivered      = co_await std::move(channel.receiver);
+        abandonGuard.active = false;
+        if (!delivered.has_value()) {
+            co_return ilias::Err(ilias::IoError::Canceled);
+        }
+        co_return std::move(*delivered);
+    }
+
+    std::shared_ptr<detail::RpcLocalLink<Backend>> mLink;
+};
+
+NEKO_END_NAMESPACE
@@ -113,4 +113,19 @@ struct RpcMetricsSnapshot {
     std::uint64_t rejected = 0;
 };
 
+// Receive buffer pool of a server, summed over its connections. hits/misses
+// count buffers drawn from or missing in a pool, dropped counts buffers freed
+// on return because their size class was full or too large. The *_bytes
+// fields are gauges of buffer capacity sitting in the pools and lent out to
+// in-flight messages, with their high-water marks.
+struct RpcBufferPoolMetrics {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t dropped = 0;
+    std::size_t pooled_bytes = 0;
+    std::size_t leased_bytes = 0;
+    std::size_t pooled_bytes_high_water = 0;
+    std::size_t leased_bytes_high_water = 0;
+};
+
 NEKO_END_NAMESPACE
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <map>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -73,6 +76,116 @@ struct NekoRpcFrameLimits {
     std::size_t max_extension_bytes = 64U * 1024U;
 };
 
+// Extension TLVs of one frame, kept sorted by type so they always encode in
+// type order. The first KInlineCapacity entries live inline, which covers
+// every frame this backend sends; a peer sending more moves the list to the
+// heap.
+class NekoRpcExtensionList {
+public:
+    using key_type       = NekoRpcExtensionType;
+    using mapped_type    = std::span<const std::byte>;
+    using value_type     = std::pair<key_type, mapped_type>;
+    using iterator       = value_type*;
+    using const_iterator = const value_type*;
+
+    static constexpr std::size_t KInlineCapacity = 8U;
+
+    NekoRpcExtensionList() = default;
+    NekoRpcExtensionList(const NekoRpcExtensionList&) = default;
+    auto operator=(const NekoRpcExtensionList&) -> NekoRpcExtensionList& = default;
+    NekoRpcExtensionList(NekoRpcExtensionList&& other) noexcept
+        : mInline(other.mInline), mSpill(std::move(other.mSpill)), mSize(std::exchange(other.mSize, 0U)) {}
+    auto operator=(NekoRpcExtensionList&& other) noexcept -> NekoRpcExtensionList& {
+        if (this != &other) {
+            mInline = other.mInline;
+            mSpill  = std::move(other.mSpill);
+            mSize   = std::exchange(other.mSize, 0U);
+        }
+        return *this;
+    }
+
+    auto begin() noexcept -> iterator { return _data(); }
+    auto end() noexcept -> iterator { return _data() + mSize; }
+    auto begin() const noexcept -> const_iterator { return _data(); }
+    auto end() const noexcept -> const_iterator { return _data() + mSize; }
+    auto size() const noexcept -> std::size_t { return mSize; }
+    auto empty() const noexcept -> bool { return mSize == 0U; }
+
+    auto clear() noexcept -> void {
+        mSpill.clear();
+        mSize = 0;
+    }
+
+    auto find(key_type type) noexcept -> iterator {
+        const auto item = _lowerBound(type);
+        return item != end() && item->first == type ? item : end();
+    }
+    auto find(key_type type) const noexcept -> const_iterator {
+        return const_cast<NekoRpcExtensionList*>(this)->find(type);
+    }
+    auto contains(key_type type) const noexcept -> bool { return find(type) != end(); }
+
+    // Inserts unless type is already present, like std::map::emplace.
+    auto emplace(key_type type, mapped_type value) -> std::pair<iterator, bool> {
+        auto item = _lowerBound(type);
+        if (item != end() && item->first == type) {
+            return {item, false};
+        }
+        const auto index = static_cast<std::size_t>(item - begin());
+        if (mSize < KInlineCapacity) {
+            std::move_backward(mInline.begin() + index, mInline.begin() + mSize, mInline.begin() + mSize + 1U);
+            mInline[index] = {type, value};
+        } else {
+            if (mSize == KInlineCapacity) {
+                mSpill.assign(mInline.begin(), mInline.end());
+            }
+            mSpill.insert(mSpill.begin() + static_cast<std::ptrdiff_t>(index), value_type{type, value});
+        }
+        ++mSize;
+        return {begin() + index, true};
+    }
+
+    auto operator[](key_type type) -> mapped_type& { return emplace(type, {}).first->second; }
+
+    // Appends in arrival order; sortAndFindDuplicate() must run before any
+    // lookup. A decoded frame can carry thousands of TLVs, and sorting them
+    // once avoids an O(n^2) series of shifting inserts.
+    auto append(key_type type, mapped_type value) -> void {
+        if (mSize < KInlineCapacity) {
+            mInline[mSize] = {type, value};
+        } else {
+            if (mSize == KInlineCapacity) {
+                mSpill.assign(mInline.begin(), mInline.end());
+            }
+            mSpill.emplace_back(type, value);
+        }
+        ++mSize;
+    }
+
+    // Restores type order after append(). Returns the first entry whose type
+    // repeats, or end() when every type is distinct.
+    auto sortAndFindDuplicate() -> iterator {
+        const auto byType = [](const value_type& lhs, const value_type& rhs) { return lhs.first < rhs.first; };
+        std::sort(begin(), end(), byType);
+        return std::adjacent_find(begin(), end(),
+                                  [](const value_type& lhs, const value_type& rhs) { return lhs.first == rhs.first; });
+    }
+
+private:
+    auto _data() noexcept -> value_type* { return mSize > KInlineCapacity ? mSpill.data() : mInline.data(); }
+    auto _data() const noexcept -> const value_type* {
+        return mSize > KInlineCapacity ? mSpill.data() : mInline.data();
+    }
+    auto _lowerBound(key_type type) noexcept -> iterator {
+        return std::lower_bound(begin(), end(), type,
+                                [](const value_type& item, key_type key) { return item.first < key; });
+    }
+
+    std::array<value_type, KInlineCapacity> mInline{};
+    std::vector<value_type> mSpill;
+    std::size_t mSize = 0;
+};
+
 class NEKO_PROTO_API NekoRpcFrameCodec {
 public:
     using IdType             = std::uint64_t;
@@ -80,11 +193,13 @@ public:
     using ResponseValuesType = std::vector<MessageType>;
     using ExtensionType      = NekoRpcExtensionType;
     using ExtensionValueType = std::span<const std::byte>;
-    using ExtensionMapType   = std::map<ExtensionType, ExtensionValueType>;
+    using ExtensionMapType   = NekoRpcExtensionList;
 
     static constexpr std::uint16_t Magic  = 0x4E52U;
     static constexpr std::uint8_t Version = 1U;
     static constexpr std::size_t MaxExtensionBytes = std::numeric_limits<std::uint16_t>::max();
+    // Wire size of Header; every field sits at a fixed big-endian offset.
+    static constexpr std::size_t HeaderBytes = 24U;
 
     struct Header {
         // Protocol sentinel, encoded on the wire as "NR".
@@ -107,10 +222,16 @@ public:
         std::uint32_t payload_size = 0;
     };
 
+    // Method and payload borrow the received frame; the server request task
+    // owns that buffer until processMessage returns. Bytes that are not in the
+    // frame, a name resolved from a method id or a decompressed payload, are
+    // held in the owned_* members instead. Read through methodName/payload.
     struct DecodedRequest {
         Header header;
-        std::string method;
-        MessageType payload;
+        std::string_view method;
+        std::span<const std::byte> payload;
+        std::optional<std::string> owned_method;
+        std::optional<MessageType> owned_payload;
     };
 
     struct DecodeResult {
@@ -131,6 +252,9 @@ public:
         std::span<const std::byte> payload;
     };
 
+    // Frame split into the pieces it is written from; defined after the class.
+    struct EncodedFrame;
+
 private:
     template <typename T>
     static consteval auto wire_field_size() -> std::size_t {
@@ -154,16 +278,67 @@ private:
         return wire_tuple_size<FieldsType>(std::make_index_sequence<std::tuple_size_v<FieldsType>>{});
     }
 
+    template <typename T>
+    static constexpr auto load_be(const std::byte* data) noexcept -> T {
+        T value = 0;
+        for (std::size_t ix = 0; ix < sizeof(T); ++ix) {
+            value = static_cast<T>((value << 8U) | std::to_integer<T>(data[ix]));
+        }
+        return value;
+    }
+
+    template <typename T>
+    static constexpr auto store_be(std::byte* data, T value) noexcept -> void {
+        for (std::size_t ix = 0; ix < sizeof(T); ++ix) {
+            data[ix] = static_cast<std::byte>(value >> ((sizeof(T) - 1U - ix) * 8U));
+        }
+    }
+
 public:
     static auto headerSize() noexcept -> std::size_t;
 
+    // Fixed-offset header encoding: magic@0 version@2 kind@3 flags@4 codec@5
+    // extension_size@6 id@8 method_size@16 payload_size@20. Both directions
+    // are straight-line loads and stores without per-field dispatch.
+    static constexpr auto packHeader(const Header& header) noexcept -> std::array<std::byte, HeaderBytes> {
+        std::array<std::byte, HeaderBytes> out{};
+        store_be(out.data(), header.magic);
+        store_be(out.data() + 2, header.version);
+        store_be(out.data() + 3, static_cast<std::uint8_t>(header.kind));
+        store_be(out.data() + 4, header.flags);
+        store_be(out.data() + 5, header.codec);
+        store_be(out.data() + 6, header.extension_size);
+        store_be(out.data() + 8, header.id);
+        store_be(out.data() + 16, header.method_size);
+        store_be(out.data() + 20, header.payload_size);
+        return out;
+    }
+
+    static constexpr auto unpackHeader(std::span<const std::byte, HeaderBytes> data) noexcept -> Header {
+        return {
+            .magic          = load_be<std::uint16_t>(data.data()),
+            .version        = load_be<std::uint8_t>(data.data() + 2),
+            .kind           = static_cast<NekoRpcKind>(load_be<std::uint8_t>(data.data() + 3)),
+            .flags          = load_be<std::uint8_t>(data.data() + 4),
+            .codec          = load_be<std::uint8_t>(data.data() + 5),
+            .extension_size = load_be<std::uint16_t>(data.data() + 6),
+            .id             = load_be<IdType>(data.data() + 8),
+            .method_size    = load_be<std::uint32_t>(data.data() + 16),
+            .payload_size   = load_be<std::uint32_t>(data.data() + 20),
+        };
+    }
+
     static auto methodName(const DecodedRequest& request) noexcept -> std::string_view;
+    static auto payload(const DecodedRequest& request) noexcept -> std::span<const std::byte>;
     static auto id(const DecodedRequest& request) noexcept -> const IdType&;
     static auto expectsResponse(const DecodedRequest& request) noexcept -> bool;
     static auto encodeResponses(const ResponseValuesType& responses, bool batch) -> MessageType;
 
     static auto encodeFrame(FrameParts frame) -> MessageType;
+    // Same frame as encodeFrame, without copying method and payload into it.
+    static auto encodeFrameSegments(FrameParts frame) -> ilias::Result<EncodedFrame, std::error_code>;
     static auto encodeHello(ExtensionMapType extensions, std::uint8_t codec) -> MessageType;
+    // The decoded request borrows data, so data must outlive it.
     static auto decodeFrame(std::span<const std::byte> data) -> ilias::Result<DecodedRequest, std::error_code>;
 
     static auto knownKind(NekoRpcKind kind) -> bool;
@@ -175,6 +350,31 @@ public:
     static auto parseFrame(std::span<const std::byte> data, std::uint8_t codec, FrameParts& parts) -> bool;
 };
 
+// The header and the extension TLVs are encoded into the frame itself, the
+// method and payload spans still point at the FrameParts storage, which has to
+// outlive the frame. segments() is what a vectored send writes.
+struct NekoRpcFrameCodec::EncodedFrame {
+    std::array<std::byte, NekoRpcFrameCodec::HeaderBytes> header{};
+    std::span<const std::byte> method;
+    MessageType extensions;
+    std::span<const std::byte> payload;
+
+    auto segments() const noexcept -> std::array<std::span<const std::byte>, 4> {
+        return {std::span<const std::byte>(header), method, std::span<const std::byte>(extensions), payload};
+    }
+    auto size() const noexcept -> std::size_t {
+        return header.size() + method.size() + extensions.size() + payload.size();
+    }
+    auto flatten() const -> MessageType {
+        MessageType out;
+        out.reserve(size());
+        for (const auto& segment : segments()) {
+            out.insert(out.end(), segment.begin(), segment.end());
+        }
+        return out;
+    }
+};
+
 class NEKO_PROTO_API NekoRpcExtensionCodec {
 public:
     using MessageType      = NekoRpcFrameCodec::MessageType;
@@ -39,11 +39,15 @@ auto neko_rpc_add_compression_stat(const typename Backend::Options& options, Cou
     }
 }
 
+// Encodes frame as segments for a vectored send. Method and payload are not
+// copied; a compressed payload is moved into compressed_payload, which the
+// returned segments point into, so keep it alive as long as the frame.
 template <typename Backend>
-auto neko_rpc_encode_outgoing_frame(const typename Backend::Options& options,
-                                    typename Backend::PeerSession& session,
-                                    typename Backend::Codec::FrameParts frame)
-    -> ilias::Result<typename Backend::Message, std::error_code> {
+auto neko_rpc_encode_outgoing_segments(const typename Backend::Options& options,
+                                       typename Backend::PeerSession& session,
+                                       typename Backend::Codec::FrameParts frame,
+                                       typename Backend::Message& compressed_payload)
+    -> ilias::Result<typename Backend::Codec::EncodedFrame, std::error_code> {
     using Codec            = typename Backend::Codec;
     using CompressionCodec = typename Backend::CompressionCodec;
     using CompressionStats = typename Backend::CompressionStats;
@@ -51,16 +55,10 @@ auto neko_rpc_encode_outgoing_frame(const typename Backend::Options& options,
     using Flag             = typename Backend::Flag;
 
     const auto encode_checked = [&options](typename Backend::Codec::FrameParts value)
-        -> ilias::Result<typename Backend::Message, std::error_code> {
-        auto encoded = Codec::encodeFrame(value);
-        const auto header_size = Codec::headerSize();
-        if (encoded.size() < header_size) {
-            return ilias::Err(RpcError::InvalidRequest);
-        }
-        ILIAS_TRY(auto body_size,
-                  Codec::headerBodySize(std::span<const std::byte>(encoded).first(header_size),
-                                        value.header.codec, options.frame_limits));
-        if (body_size != encoded.size() - header_size) {
+        -> ilias::Result<typename Backend::Codec::EncodedFrame, std::error_code> {
+        ILIAS_TRY(auto encoded, Codec::encodeFrameSegments(value));
+        ILIAS_TRY(auto body_size, Codec::headerBodySize(encoded.header, value.header.codec, options.frame_limits));
+        if (body_size != encoded.size() - encoded.header.size()) {
             return ilias::Err(RpcError::InvalidRequest);
         }
         return encoded;
@@ -106,13 +104,27 @@ auto neko_rpc_encode_outgoing_frame(const typename Backend::Options& options,
                                        compressed.value().size());
 
     const auto original_size = frame.payload.size();
-    frame.header.flags = static_cast<std::uint8_t>(frame.header.flags | Flag::Compressed);
-    frame.payload      = NekoRpcExtensionCodec::asBytes(compressed.value());
+    compressed_payload       = std::move(compressed.value());
+    frame.header.flags       = static_cast<std::uint8_t>(frame.header.flags | Flag::Compressed);
+    frame.payload            = NekoRpcExtensionCodec::asBytes(compressed_payload);
     NEKO_LOG_TRACE("rpc", "rpc backend compression end: input={} output={} algorithm={}", original_size,
-                   compressed.value().size(), neko_rpc_compression_algorithm_name(session.compression_algorithm));
+                   compressed_payload.size(), neko_rpc_compression_algorithm_name(session.compression_algorithm));
     return encode_checked(frame);
 }
 
+// Flat form of neko_rpc_encode_outgoing_segments for callers that keep the
+// frame as one message, such as client requests.
+template <typename Backend>
+auto neko_rpc_encode_outgoing_frame(const typename Backend::Options& options,
+                                    typename Backend::PeerSession& session,
+                                    typename Backend::Codec::FrameParts frame)
+    -> ilias::Result<typename Backend::Message, std::error_code> {
+    typename Backend::Message compressed_payload;
+    ILIAS_TRY(auto encoded,
+              neko_rpc_encode_outgoing_segments<Backend>(options, session, std::move(frame), compressed_payload));
+    return encoded.flatten();
+}
+
 template <typename Backend>
 auto neko_rpc_decompress_incoming_payload(const typename Backend::Options& options,
                                           typename Backend::PeerSession& session,
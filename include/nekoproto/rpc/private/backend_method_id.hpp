@@ -101,15 +101,20 @@ inline auto NekoRpcSyncMethodTable(NekoRpcMethodIdTable& table,
     }
 }
 
+// Sets the method of request from an incoming frame. A plain name stays a view
+// into the frame; a method id resolves to a copy of the table entry name,
+// because the table may be refreshed while the request is still running.
 template <typename Backend>
 auto NekoRpcIncomingMethodName(typename Backend::ServerContext& context,
                               typename Backend::PeerSession& session,
-                              const typename Backend::Codec::FrameParts& parts)
-    -> ilias::Result<std::string, std::error_code> {
+                              const typename Backend::Codec::FrameParts& parts,
+                              typename Backend::DecodedRequest& request)
+    -> ilias::Result<void, std::error_code> {
     using Flag = typename Backend::Flag;
 
     if ((parts.header.flags & Flag::MethodId) == 0U) {
-        return std::string{reinterpret_cast<const char*>(parts.method.data()), parts.method.size()};
+        request.method = {reinterpret_cast<const char*>(parts.method.data()), parts.method.size()};
+        return {};
     }
 
     if (!session.method_id_enabled || parts.method.size() != sizeof(std::uint64_t)) {
@@ -156,7 +161,8 @@ auto NekoRpcIncomingMethodName(typename Backend::ServerContext& context,
         return ilias::Err(RpcError::MethodSignatureMismatch);
     }
 
-    return resolved.entry->name;
+    request.owned_method = resolved.entry->name;
+    return {};
 }
 
 } // namespace rpc
@@ -39,6 +39,36 @@ public:
         co_return buffer.size();
     }
 
+    // Writes a frame handed over as segments, header first, without joining
+    // them. Segments below detail::KGatherPieceBytes are still gathered into
+    // one write; larger payloads go out from the caller's memory.
+    auto sendVectored(std::span<const std::span<const std::byte>> pieces) -> ilias::IoTask<std::size_t> {
+        const auto header_size = Codec::headerSize();
+        if (pieces.empty() || pieces.front().size() < header_size) {
+            const auto frame = detail::join_message_pieces(pieces);
+            co_return co_await send(std::span<const std::byte>{frame});
+        }
+        std::size_t frame_size = 0;
+        for (const auto& piece : pieces) {
+            frame_size += piece.size();
+        }
+        if (frame_size > mLimits.max_frame_bytes) {
+            co_return ilias::Err(ilias::IoError::MessageTooLarge);
+        }
+        ILIAS_CO_TRY(auto body_size, Codec::headerBodySize(pieces.front().first(header_size), CodecId, mLimits));
+        if (body_size != frame_size - header_size) {
+            co_return ilias::Err(RpcError::InvalidRequest);
+        }
+
+        auto guard = co_await mWriteMutex->lock();
+        ILIAS_CO_TRY(auto ret, co_await detail::write_stream_pieces(mStream, pieces, mGatherBuffer));
+        if (ret != frame_size) {
+            co_return ilias::Err(ilias::IoError::WriteZero);
+        }
+        ILIAS_CO_TRYV(co_await detail::flush_stream(mStream));
+        co_return frame_size;
+    }
+
     auto close() -> void { detail::close_stream(mStream); }
     auto shutdown() -> ilias::IoTask<void> { co_return co_await detail::shutdown_stream(mStream); }
     auto flush() -> ilias::IoTask<void> { co_return co_await detail::flush_stream(mStream); }
@@ -99,6 +129,7 @@ private:
     StreamT mStream;
     NekoRpcFrameLimits mLimits;
     std::unique_ptr<ilias::Mutex> mWriteMutex = std::make_unique<ilias::Mutex>();
+    std::vector<std::byte> mGatherBuffer;
 };
 
 } // namespace rpc
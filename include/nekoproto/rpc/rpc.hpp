@@ -7,6 +7,7 @@
 #include "nekoproto/rpc/dispatcher.hpp"
 #include "nekoproto/rpc/endpoint.hpp"
 #include "nekoproto/rpc/error.hpp"
+#include "nekoproto/rpc/local.hpp"
 #include "nekoproto/rpc/method.hpp"
 #include "nekoproto/rpc/options.hpp"
 #include "nekoproto/rpc/registry.hpp"
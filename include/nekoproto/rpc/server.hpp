@@ -19,10 +19,12 @@
 #include <vector>
 
 #include "nekoproto/global/log.hpp"
+#include "nekoproto/rpc/buffer_pool.hpp"
 #include "nekoproto/rpc/builtin.hpp"
 #include "nekoproto/rpc/concepts.hpp"
 #include "nekoproto/rpc/dispatcher.hpp"
 #include "nekoproto/rpc/endpoint.hpp"
+#include "nekoproto/rpc/local.hpp"
 #include "nekoproto/rpc/registry.hpp"
 
 NEKO_BEGIN_NAMESPACE
@@ -40,6 +42,7 @@ private:
         RpcPeerInfo peer;
         std::unique_ptr<ilias::TaskScope> requests = std::make_unique<ilias::TaskScope>();
         ilias::Mutex sendMutex;
+        std::shared_ptr<detail::RpcRecvBufferPool> recvBuffers;
     };
 
     RpcBuiltinMethods mRpc;
@@ -66,11 +69,18 @@ public:
 
     auto close() -> void {
         auto endpoints = _beginClose();
+        auto links     = _takeLocalLinks();
         // Cancel endpoint and request tasks before destroying their streams.
         // Closing a stream concurrently with a just-started read can race in
         // some endpoint implementations; framed reads are cancellation-aware.
+        for (auto& link : links) {
+            link->close();
+        }
         mScope.stop();
         wait().wait();
+        for (auto& link : links) {
+            link->requests->waitAll().wait();
+        }
         for (auto& slot : endpoints) {
             slot->endpoint->close();
         }
@@ -89,6 +99,13 @@ public:
 
     auto shutdown() -> ilias::Task<void> {
         auto endpoints = _beginClose();
+        auto links     = _takeLocalLinks();
+        for (auto& link : links) {
+            link->stopAccepting();
+        }
+        for (auto& link : links) {
+            co_await link->requests->waitAll();
+        }
         for (auto& slot : endpoints) {
             auto guard = co_await slot->sendMutex.lock();
             if (auto ret = co_await slot->endpoint->flush(); !ret) {
@@ -115,11 +132,34 @@ public:
     auto cancelAll() -> void { mDispatcher.cancelAll(); }
     auto getCurrentIds() const -> std::vector<typename Backend::Id> { return mDispatcher.getCurrentIds(); }
     auto metrics() const noexcept -> RpcMetricsSnapshot { return mDispatcher.metrics(); }
+    auto bufferPoolMetrics() const noexcept -> RpcBufferPoolMetrics { return mRecvBufferStats->snapshot(); }
+
+    // In-process connection for a client living in the same process:
+    //   client.setEndpoint(server.connectLocal());
+    // Calls skip the codec but keep the per-connection and global limits,
+    // request timeout and cancellation of an addEndpoint() connection.
+    auto connectLocal(RpcPeerInfo peer = {}) -> RpcLocalEndpoint<Backend> {
+        auto link         = std::make_shared<detail::RpcLocalLink<Backend>>();
+        link->dispatcher  = std::addressof(mDispatcher);
+        link->context     = std::addressof(mBackendContext);
+        link->session     = Backend::makeServerPeerSession(mBackendContext);
+        link->wireSession = Backend::makeServerPeerSession(mBackendContext);
+        link->peer        = std::move(peer);
+        link->maxInflight = _maxInflightRequests();
+        std::scoped_lock lock(mEndpointMutex);
+        if (mClosing) {
+            link->closed = true;
+        } else {
+            mLocalLinks.emplace_back(link);
+        }
+        return RpcLocalEndpoint<Backend>(std::move(link));
+    }
 
     template <MessageEndpoint EndpointT>
     auto addEndpoint(EndpointT endpoint, RpcPeerInfo peer = {}) -> void {
         auto slot = std::make_shared<EndpointSlot>();
         slot->peer = std::move(peer);
+        slot->recvBuffers = _makeRecvBufferPool();
         if constexpr (detail::is_message_endpoint<EndpointT>::value) {
             slot->endpoint = std::make_unique<EndpointT>(std::move(endpoint));
         } else {
@@ -240,6 +280,18 @@ private:
         mDispatcher.configureExecution(maxActive, maxQueued, requestTimeout);
     }
 
+    auto _makeRecvBufferPool() const -> std::shared_ptr<detail::RpcRecvBufferPool> {
+        std::size_t buffersPerClass = 16U;
+        std::size_t maxBufferBytes = 1024U * 1024U;
+        if constexpr (requires { mBackendContext.options.recv_buffers_per_class; }) {
+            buffersPerClass = mBackendContext.options.recv_buffers_per_class;
+        }
+        if constexpr (requires { mBackendContext.options.max_pooled_recv_buffer_bytes; }) {
+            maxBufferBytes = mBackendContext.options.max_pooled_recv_buffer_bytes;
+        }
+        return std::make_shared<detail::RpcRecvBufferPool>(mRecvBufferStats, buffersPerClass, maxBufferBytes);
+    }
+
     auto _maxInflightRequests() const noexcept -> std::size_t {
         if constexpr (requires { mBackendContext.options.max_inflight_requests_per_connection; }) {
             return mBackendContext.options.max_inflight_requests_per_connection;
@@ -318,19 +370,26 @@ private:
     }
 
     auto _handleClient(std::shared_ptr<EndpointSlot> slot) -> ilias::Task<void> {
+        std::size_t lastFrameBytes = 0;
         while (slot->endpoint != nullptr) {
-            std::vector<std::byte> buffer;
-            if (auto ret = co_await slot->endpoint->recv(buffer); !ret) {
-                NEKO_LOG_INFO("rpc", "rpc server endpoint loop stop: recv={}", ret.error().message());
+            // Sized for the previous frame; goes back to the pool when this iteration or the spawned request ends.
+            auto lease = slot->recvBuffers->acquire(lastFrameBytes);
+            auto& buffer = lease.buffer();
+            // A held message (e.g. a mapped memfd) is viewed in place; its holder rides along with the lease.
+            auto received = co_await slot->endpoint->recvHeld(buffer);
+            if (!received) {
+                NEKO_LOG_INFO("rpc", "rpc server endpoint loop stop: recv={}", received.error().message());
                 break;
             }
-            if (buffer.empty()) {
+            const auto message = received.value().bytes;
+            lastFrameBytes     = buffer.size();
+            if (message.empty()) {
                 NEKO_LOG_INFO("rpc", "rpc server endpoint loop stop: reason=empty_frame");
                 break;
             }
 
-            if constexpr (requires { Backend::validateMessage(mBackendContext, buffer); }) {
-                auto validated = Backend::validateMessage(mBackendContext, buffer);
+            if constexpr (requires { Backend::validateMessage(mBackendContext, message); }) {
+                auto validated = Backend::validateMessage(mBackendContext, message);
                 if (!validated) {
                     NEKO_LOG_WARN("rpc", "rpc server rejected oversized or malformed frame: {}",
                                   validated.error().message());
@@ -339,8 +398,8 @@ private:
                 }
             }
 
-            if constexpr (requires { Backend::cancelId(buffer); }) {
-                if (auto cancel_id = Backend::cancelId(buffer); cancel_id.has_value()) {
+            if constexpr (requires { Backend::cancelId(message); }) {
+                if (auto cancel_id = Backend::cancelId(message); cancel_id.has_value()) {
                     mDispatcher.cancel(std::addressof(slot->session), *cancel_id);
                     continue;
                 }
@@ -349,27 +408,30 @@ private:
             // Control frames update backend session state and must not enter
             // the dispatcher as user-call requests.
             auto control =
-                co_await Backend::handleServerControl(mBackendContext, slot->session, *slot->endpoint, buffer);
+                co_await Backend::handleServerControl(mBackendContext, slot->session, *slot->endpoint, message);
             if (!control) {
                 NEKO_LOG_ERROR("rpc", "handle rpc control frame failed: {}", control.error().message());
                 break;
             }
             if (control.value()) {
                 NEKO_LOG_INFO("rpc", "rpc server handled control frame");
-                NEKO_LOG_TRACE("rpc", "rpc server control frame bytes={}", buffer.size());
+                NEKO_LOG_TRACE("rpc", "rpc server control frame bytes={}", message.size());
                 continue;
             }
 
             if (slot->requests->size() >= _maxInflightRequests()) {
                 NEKO_LOG_WARN("rpc", "rpc server connection exceeded in-flight request limit");
-                (void)co_await mDispatcher.processMessage(buffer, mBackendContext, slot->session,
+                (void)co_await mDispatcher.processMessage(message, mBackendContext, slot->session,
                                                           slot->endpoint.get(), &slot->sendMutex, true,
                                                           std::addressof(slot->peer));
                 continue;
             }
-            slot->requests->spawn([this, slot, message = std::move(buffer)]() mutable -> ilias::Task<void> {
-                (void)co_await mDispatcher.processMessage(message, mBackendContext, slot->session, slot->endpoint.get(),
-                                                          &slot->sendMutex, false, std::addressof(slot->peer));
+            // Moving the lease keeps the vector's storage, so message stays valid in the request.
+            slot->requests->spawn([this, slot, message, lease = std::move(lease),
+                                   holder = std::move(received.value().holder)]() mutable -> ilias::Task<void> {
+                (void)co_await mDispatcher.processMessage(message, mBackendContext, slot->session,
+                                                          slot->endpoint.get(), &slot->sendMutex, false,
+                                                          std::addressof(slot->peer));
             });
         }
         // Don't do anything clean up here; once the coroutine is canceled, the following code won't run. You can only
@@ -522,6 +584,11 @@ private:
         return endpoints;
     }
 
+    auto _takeLocalLinks() -> std::list<std::shared_ptr<detail::RpcLocalLink<Backend>>> {
+        std::scoped_lock lock(mEndpointMutex);
+        return std::exchange(mLocalLinks, {});
+    }
+
     auto _eraseEndpoint(const std::shared_ptr<EndpointSlot>& slot) -> void {
         std::scoped_lock lock(mEndpointMutex);
         mEndpoints.remove(slot);
@@ -530,8 +597,11 @@ private:
     Dispatcher mDispatcher;
     typename Backend::ServerContext mBackendContext;
     std::list<std::shared_ptr<EndpointSlot>> mEndpoints;
+    std::list<std::shared_ptr<detail::RpcLocalLink<Backend>>> mLocalLinks;
     mutable std::mutex mEndpointMutex;
     bool mClosing = false;
+    std::shared_ptr<detail::RpcRecvBufferPoolStats> mRecvBufferStats =
+        std::make_shared<detail::RpcRecvBufferPoolStats>();
     ilias::TaskGroup<void> mScope;
 };
 
@@ -4,6 +4,7 @@
 #include "nekoproto/serialization/binary/binary_writer.hpp"
 #include "nekoproto/serialization/binary/endian.hpp"
 #include "nekoproto/serialization/error.hpp"
+#include "nekoproto/serialization/parsing/value_kind.hpp"
 
 #include <bit>
 #include <cstddef>
@@ -248,6 +249,41 @@ public:
         return true;
     }
 
+    static sa::Result<parsing::ValueKind> valueKind(const InputValueType& input) {
+        if (auto error = _validate(input); error) return *error;
+        if (input.node->raw) return _typeError<parsing::ValueKind>("framed value");
+        switch (input.node->tag) {
+        case ValueTag::Null:
+            return parsing::ValueKind::Null;
+        case ValueTag::False:
+        case ValueTag::True:
+            return parsing::ValueKind::Bool;
+        case ValueTag::SignedInteger:
+        case ValueTag::FixedSigned8:
+        case ValueTag::FixedSigned16:
+        case ValueTag::FixedSigned32:
+        case ValueTag::FixedSigned64:
+            return parsing::ValueKind::Signed;
+        case ValueTag::UnsignedInteger:
+        case ValueTag::FixedUnsigned8:
+        case ValueTag::FixedUnsigned16:
+        case ValueTag::FixedUnsigned32:
+        case ValueTag::FixedUnsigned64:
+            return parsing::ValueKind::Unsigned;
+        case ValueTag::Float32:
+        case ValueTag::Float64:
+            return parsing::ValueKind::Float;
+        case ValueTag::String:
+            return parsing::ValueKind::String;
+        case ValueTag::Array:
+            return parsing::ValueKind::Array;
+        case ValueTag::NamedObject:
+        case ValueTag::IdObject:
+            return parsing::ValueKind::Object;
+        }
+        return _typeError<parsing::ValueKind>("known value tag");
+    }
+
     template <typename T>
     static sa::Result<T> toBasicType(const InputValueType& input) {
         if (auto error = _validate(input); error) return *error;
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "nekoproto/global/global.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+NEKO_BEGIN_NAMESPACE
+namespace json {
+
+/// Number of bytes `escape_to` writes for `value`, without the surrounding quotes.
+constexpr std::size_t escaped_size(std::string_view value) noexcept {
+    std::size_t size = 0;
+    for (const char item : value) {
+        const auto ch = static_cast<unsigned char>(item);
+        switch (ch) {
+        case '"':
+        case '\\':
+        case '\b':
+        case '\f':
+        case '\n':
+        case '\r':
+        case '\t':
+            size += 2;
+            break;
+        default:
+            size += ch < 0x20U ? 6 : 1;
+            break;
+        }
+    }
+    return size;
+}
+
+/// Writes the JSON string escape of `value` to `output` and returns the end of the written range.
+constexpr char* escape_to(std::string_view value, char* output) noexcept {
+    constexpr char KHex[] = "0123456789abcdef";
+    for (const char item : value) {
+        const auto ch = static_cast<unsigned char>(item);
+        switch (ch) {
+        case '"':
+            *output++ = '\\';
+            *output++ = '"';
+            break;
+        case '\\':
+            *output++ = '\\';
+            *output++ = '\\';
+            break;
+        case '\b':
+            *output++ = '\\';
+            *output++ = 'b';
+            break;
+        case '\f':
+            *output++ = '\\';
+            *output++ = 'f';
+            break;
+        case '\n':
+            *output++ = '\\';
+            *output++ = 'n';
+            break;
+        case '\r':
+            *output++ = '\\';
+            *output++ = 'r';
+            break;
+        case '\t':
+            *output++ = '\\';
+            *output++ = 't';
+            break;
+        default:
+            if (ch < 0x20U) {
+                *output++ = '\\';
+                *output++ = 'u';
+                *output++ = '0';
+                *output++ = '0';
+                *output++ = KHex[(ch >> 4U) & 0x0FU];
+                *output++ = KHex[ch & 0x0FU];
+            } else {
+                *output++ = item;
+            }
+            break;
+        }
+    }
+    return output;
+}
+
+/**
+ * @brief Object member name handed to the JSON writers.
+ *
+ * Reflected fields arrive with `fragment` set to the complete, already escaped
+ * `"name":` text taken from a per-type table built at compile time, and with a
+ * `name` of static storage duration. Map keys and other runtime names leave
+ * `fragment` empty and are escaped by the writer as before.
+ */
+struct Key {
+    constexpr Key(std::string_view name) noexcept : name(name) {} // NOLINT(google-explicit-constructor)
+    constexpr Key(std::string_view name, std::string_view fragment) noexcept : name(name), fragment(fragment) {}
+
+    static constexpr std::size_t fragmentSize(std::string_view name) noexcept { return escaped_size(name) + 3; }
+
+    static constexpr char* encodeFragment(std::string_view name, char* output) noexcept {
+        *output++ = '"';
+        output    = escape_to(name, output);
+        *output++ = '"';
+        *output++ = ':';
+        return output;
+    }
+
+    std::string_view name;
+    std::string_view fragment;
+};
+
+} // namespace json
+NEKO_END_NAMESPACE
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "nekoproto/global/global.hpp"
+#include "nekoproto/serialization/error.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <string_view>
+#include <vector>
+
+NEKO_BEGIN_NAMESPACE
+namespace json {
+
+inline bool is_blank_record(std::string_view text) noexcept {
+    return std::all_of(text.begin(), text.end(),
+                       [](char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; });
+}
+
+/// Length of the longest line in @p text, counting its newline.
+inline std::size_t longest_record(std::string_view text) noexcept {
+    std::size_t longest = 0;
+    while (!text.empty()) {
+        const auto end    = text.find('\n');
+        const auto length = end == std::string_view::npos ? text.size() : end + 1;
+        longest           = std::max(longest, length);
+        text.remove_prefix(length);
+    }
+    return longest;
+}
+
+/**
+ * @brief Bounded window over newline-delimited JSON (JSON Lines) input.
+ *
+ * `next()` hands out runs of complete records that always end on a record
+ * boundary. Input is pulled in chunks, so memory stays proportional to the
+ * chunk size plus the longest record rather than to the whole input. Every
+ * batch is followed by at least `padding` readable bytes, which lets SIMD
+ * parsers scan past the end. A caller buffer that needs no padding is handed
+ * out in one piece without copying.
+ */
+class RecordWindow {
+public:
+    static constexpr std::size_t KDefaultChunkSize = std::size_t{1} << 20U;
+
+    RecordWindow(const char* data, std::size_t size, std::size_t padding = 0,
+                 std::size_t chunkSize = KDefaultChunkSize) noexcept
+        : mData(data), mSize(size), mPadding(padding), mChunkSize(std::max<std::size_t>(chunkSize, 1)) {}
+
+    explicit RecordWindow(std::istream& stream, std::size_t padding = 0,
+                          std::size_t chunkSize = KDefaultChunkSize) noexcept
+        : mStream(&stream), mPadding(padding), mChunkSize(std::max<std::size_t>(chunkSize, 1)) {}
+
+    RecordWindow(const RecordWindow&)            = delete;
+    RecordWindow& operator=(const RecordWindow&) = delete;
+
+    /**
+     * @brief Returns the next run of complete records.
+     *
+     * An empty view means the input is exhausted. The view stays valid until
+     * the next call.
+     */
+    sa::Result<std::string_view> next() {
+        if (mStream == nullptr && mPadding == 0) {
+            mOffset = mCursor;
+            if (mCursor >= mSize) {
+                return std::string_view{};
+            }
+            const std::string_view batch{mData + mCursor, mSize - mCursor};
+            mCursor = mSize;
+            return batch;
+        }
+
+        if (mConsumed != 0) {
+            std::memmove(mBuffer.data(), mBuffer.data() + mConsumed, mFilled - mConsumed);
+            mFilled -= mConsumed;
+            mBase += mConsumed;
+            mConsumed = 0;
+        }
+        mOffset = mBase;
+
+        std::size_t searched = 0;
+        for (;;) {
+            const std::string_view filled{mBuffer.data(), mFilled};
+            const auto newline = filled.substr(searched).rfind('\n');
+            if (newline != std::string_view::npos) {
+                mConsumed = searched + newline + 1;
+                return filled.substr(0, mConsumed);
+            }
+            if (mSourceDone) {
+                mConsumed = mFilled;
+                return filled;
+            }
+            searched = mFilled;
+            if (mBuffer.size() < mFilled + mChunkSize + mPadding) {
+                mBuffer.resize(mFilled + mChunkSize + mPadding);
+            }
+            auto read = _read(mBuffer.data() + mFilled, mChunkSize);
+            if (!read) {
+                return sa::Err(std::move(read.error()));
+            }
+            mFilled += read.value();
+            mSourceDone = read.value() == 0;
+        }
+    }
+
+    /// Input offset of the batch returned by the last `next()` call.
+    std::size_t offset() const noexcept { return mOffset; }
+
+private:
+    sa::Result<std::size_t> _read(char* output, std::size_t size) {
+        if (mStream == nullptr) {
+            const auto count = std::min(size, mSize - mCursor);
+            if (count != 0) {
+                std::memcpy(output, mData + mCursor, count);
+            }
+            mCursor += count;
+            return count;
+        }
+        mStream->read(output, static_cast<std::streamsize>(size));
+        if (mStream->bad()) {
+            return sa::Err(sa::ErrorCode::ParseError, "Failed to read JSON Lines input stream");
+        }
+        return static_cast<std::size_t>(mStream->gcount());
+    }
+
+private:
+    const char* mData     = nullptr;
+    std::size_t mSize     = 0;
+    std::size_t mCursor   = 0;
+    std::istream* mStream = nullptr;
+    std::size_t mPadding  = 0;
+    std::size_t mChunkSize;
+    std::vector<char> mBuffer;
+    std::size_t mFilled   = 0;
+    std::size_t mConsumed = 0;
+    std::size_t mBase     = 0;
+    std::size_t mOffset   = 0;
+    bool mSourceDone      = false;
+};
+
+} // namespace json
+NEKO_END_NAMESPACE
@@ -23,6 +23,7 @@
 #endif
 
 #include "nekoproto/serialization/error.hpp"
+#include "nekoproto/serialization/parsing/value_kind.hpp"
 
 NEKO_BEGIN_NAMESPACE
 namespace rapid {
@@ -91,6 +92,31 @@ struct Reader {
 
     static bool isEmpty(const InputValueType& value) noexcept { return value == nullptr || value->IsNull(); }
 
+    static sa::Result<parsing::ValueKind> valueKind(const InputValueType& value) noexcept {
+        if (value == nullptr || value->IsNull()) {
+            return parsing::ValueKind::Null;
+        }
+        if (value->IsBool()) {
+            return parsing::ValueKind::Bool;
+        }
+        if (value->IsInt64()) {
+            return parsing::ValueKind::Signed;
+        }
+        if (value->IsUint64()) {
+            return parsing::ValueKind::Unsigned;
+        }
+        if (value->IsNumber()) {
+            return parsing::ValueKind::Float;
+        }
+        if (value->IsString()) {
+            return parsing::ValueKind::String;
+        }
+        if (value->IsArray()) {
+            return parsing::ValueKind::Array;
+        }
+        return parsing::ValueKind::Object;
+    }
+
     static sa::Result<std::string> toRawString(InputValueType value) noexcept {
         if (value == nullptr) {
             return sa::error(sa::ErrorCode::InvalidType, "value is null");
@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <cstring>
+#include <istream>
 #include <memory>
 #include <ostream>
 #include <rapidjson/document.h>
@@ -25,6 +26,7 @@
 #include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/rapidjson.h>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -40,6 +42,7 @@
 #endif
 #endif
 
+#include "nekoproto/serialization/json/json_lines.hpp"
 #include "nekoproto/serialization/json/rapid_json_reader.hpp"
 #include "nekoproto/serialization/json/rapid_json_writer.hpp"
 #include "nekoproto/serialization/parsing/parsers.hpp"
@@ -344,9 +347,32 @@ struct RapidJsonBackend {
         sa::Result<void> result;
     };
 
+    /**
+     * @brief JSON Lines input state.
+     *
+     * Records are split on newlines inside a bounded window and parsed one at
+     * a time into a reused document, so memory follows the longest record
+     * instead of the input size. Buffers are read in place without copying.
+     */
+    template <typename SourceT>
+    class RecordInputState {
+    public:
+        RecordInputState(const char* buffer, std::size_t size) noexcept : window(buffer, size) {}
+
+        explicit RecordInputState(std::istream& inputStream,
+                                  std::size_t chunkSize = json::RecordWindow::KDefaultChunkSize) noexcept
+            : window(inputStream, 0, chunkSize) {}
+
+        json::RecordWindow window;
+        std::string_view batch;
+        std::size_t cursor = 0;
+        detail::JsonDocument document;
+        bool failed = false;
+    };
+
     template <typename BufferT, typename T>
     static sa::Result<void> write(OutputState<BufferT>& state, const T& value) {
-        state.writer.doc()->SetNull();
+        state.writer.reset();
         auto result   = parser_write<rapid::Writer>(state.writer, value, parsing::Parent<rapid::Writer>::Root{});
         state.hasRoot = static_cast<bool>(result);
         state.flushed = false;
@@ -380,6 +406,14 @@ struct RapidJsonBackend {
         return state.hasRoot && static_cast<bool>(result);
     }
 
+    template <typename BufferT>
+    static sa::Result<void> endRecord(OutputState<BufferT>& state) {
+        static_assert(!OutputState<BufferT>::OutputTraits::pretty, "JSON Lines records must be written compactly");
+        state.stream.Put('\n');
+        state.stream.Flush();
+        return sa::success();
+    }
+
     template <typename BufferT>
     static sa::Result<void> inputResult(const InputState<BufferT>& state) {
         return state.result;
@@ -389,6 +423,55 @@ struct RapidJsonBackend {
     static sa::Result<void> read(InputState<BufferT>& state, T& value) {
         return parser_read<rapid::Reader>(&state.document, value);
     }
+
+    template <typename SourceT, typename T>
+    static sa::Result<bool> readRecord(RecordInputState<SourceT>& state, T& value) {
+        if (state.failed) {
+            return sa::Err(sa::ErrorCode::ParseError, "JSON Lines input already failed");
+        }
+        for (;;) {
+            if (state.cursor >= state.batch.size()) {
+                auto batch = state.window.next();
+                if (!batch) {
+                    state.failed = true;
+                    return sa::Err(std::move(batch.error()));
+                }
+                if (batch->empty()) {
+                    return false;
+                }
+                state.batch  = *batch;
+                state.cursor = 0;
+            }
+            const auto begin   = state.cursor;
+            const auto newline = state.batch.find('\n', begin);
+            const auto end     = newline == std::string_view::npos ? state.batch.size() : newline;
+            state.cursor       = newline == std::string_view::npos ? state.batch.size() : newline + 1;
+            const auto line    = state.batch.substr(begin, end - begin);
+            if (json::is_blank_record(line)) {
+                continue;
+            }
+            state.document.SetNull();
+            state.document.GetAllocator().Clear();
+            state.document.Parse(line.data(), line.size());
+            if (state.document.HasParseError()) {
+                state.failed = true;
+                return sa::Err(sa::ErrorCode::ParseError,
+                               "RapidJSON parse error at offset " +
+                                   std::to_string(state.window.offset() + begin + state.document.GetErrorOffset()) +
+                                   ": " + rapidjson::GetParseError_En(state.document.GetParseError()));
+            }
+            auto result = parser_read<rapid::Reader>(&state.document, value);
+            if (!result) {
+                return sa::Err(std::move(result.error()));
+            }
+            return true;
+        }
+    }
+
+    template <typename SourceT>
+    static bool recordStreamFailed(const RecordInputState<SourceT>& state) noexcept {
+        return state.failed;
+    }
 };
 
 template <typename BufferT = RapidJsonBackend::DefaultOutputBuffer>
@@ -416,15 +499,39 @@ RapidJsonInputSerializer(const detail::RapidJsonValue&) -> RapidJsonInputSeriali
 template <typename BufferT>
 RapidJsonInputSerializer(BufferT&) -> RapidJsonInputSerializer<BufferT>;
 
+/**
+ * @brief JSON Lines (NDJSON) writer: one compact document per line.
+ */
+template <typename BufferT = RapidJsonBackend::DefaultOutputBuffer>
+class RapidJsonLinesOutputSerializer : public detail::RecordOutputSerializerAdapter<RapidJsonBackend, BufferT> {
+public:
+    using Base = detail::RecordOutputSerializerAdapter<RapidJsonBackend, BufferT>;
+    using Base::Base;
+};
+
+template <typename BufferT>
+RapidJsonLinesOutputSerializer(BufferT&) -> RapidJsonLinesOutputSerializer<BufferT>;
+
+/**
+ * @brief Lazy JSON Lines (NDJSON) reader over a buffer or an input stream.
+ */
+class RapidJsonLinesInputSerializer : public detail::RecordInputSerializerAdapter<RapidJsonBackend, void> {
+public:
+    using Base = detail::RecordInputSerializerAdapter<RapidJsonBackend, void>;
+    using Base::Base;
+};
+
 // #####################################################
 // default JsonSerializer type definition
 struct RapidJsonSerializer {
-    using OutputSerializer     = RapidJsonOutputSerializer<>;
-    using ByteOutputSerializer = RapidJsonByteOutputSerializer;
-    using InputSerializer      = RapidJsonInputSerializer<>;
-    using JsonValue            = detail::RapidJsonValue;
-    using Reader               = rapid::Reader;
-    using Writer               = rapid::Writer;
+    using OutputSerializer      = RapidJsonOutputSerializer<>;
+    using ByteOutputSerializer  = RapidJsonByteOutputSerializer;
+    using InputSerializer       = RapidJsonInputSerializer<>;
+    using LinesOutputSerializer = RapidJsonLinesOutputSerializer<>;
+    using LinesInputSerializer  = RapidJsonLinesInputSerializer;
+    using JsonValue             = detail::RapidJsonValue;
+    using Reader                = rapid::Reader;
+    using Writer                = rapid::Writer;
 };
 
 NEKO_END_NAMESPACE
@@ -20,12 +20,14 @@
 #endif
 
 #include "nekoproto/serialization/error.hpp"
+#include "nekoproto/serialization/json/json_key.hpp"
 
 NEKO_BEGIN_NAMESPACE
 namespace rapid {
 class Writer {
 public:
-    using RawValueType = rapidjson::Document;
+    using RawValueType  = rapidjson::Document;
+    using OutputKeyType = json::Key;
 
     struct OutputArrayType {
         rapidjson::Value* value;
@@ -49,6 +51,12 @@ public:
 
     rapidjson::Document* doc() { return &mDoc; }
 
+    /// Drops the current tree and the pool memory behind it so one writer can serve many documents.
+    void reset() noexcept {
+        mDoc.SetNull();
+        mDoc.GetAllocator().Clear();
+    }
+
     OutputArrayType arrayAsRoot(const std::size_t size) noexcept {
         mDoc.SetArray();
         if (size != static_cast<std::size_t>(-1)) {
@@ -88,9 +96,8 @@ public:
         auto& inserted = (*parent->value)[parent->value->Size() - 1];
         return {&inserted};
     }
-    OutputArrayType addArrayToObject(std::string_view name, const std::size_t size, OutputObjectType* parent) {
-        rapidjson::Value key;
-        key.SetString(name.data(), static_cast<rapidjson::SizeType>(name.size()), mDoc.GetAllocator());
+    OutputArrayType addArrayToObject(const json::Key& name, const std::size_t size, OutputObjectType* parent) {
+        auto key = _key(name);
 
         rapidjson::Value child(rapidjson::kArrayType);
         if (size != static_cast<std::size_t>(-1)) {
@@ -114,9 +121,8 @@ public:
         auto& inserted = (*parent->value)[parent->value->Size() - 1];
         return {&inserted};
     }
-    OutputObjectType addObjectToObject(std::string_view name, const std::size_t size, OutputObjectType* parent) {
-        rapidjson::Value key;
-        key.SetString(name.data(), static_cast<rapidjson::SizeType>(name.size()), mDoc.GetAllocator());
+    OutputObjectType addObjectToObject(const json::Key& name, const std::size_t size, OutputObjectType* parent) {
+        auto key = _key(name);
 
         rapidjson::Value child(rapidjson::kObjectType);
         if (size != static_cast<std::size_t>(-1)) {
@@ -146,9 +152,8 @@ public:
         return {&inserted};
     }
     template <typename T>
-    OutputValueType addValueToObject(std::string_view name, const T& value, OutputObjectType* parent) {
-        rapidjson::Value key;
-        key.SetString(name.data(), static_cast<rapidjson::SizeType>(name.size()), mDoc.GetAllocator());
+    OutputValueType addValueToObject(const json::Key& name, const T& value, OutputObjectType* parent) {
+        auto key = _key(name);
 
         auto val = _fromBasicType(value);
         parent->value->AddMember(key, val, mDoc.GetAllocator());
@@ -157,9 +162,8 @@ public:
         --member;
         return {&member->value};
     }
-    OutputValueType addValueToObject(std::string_view name, const rapidjson::Value& value, OutputObjectType* parent) {
-        rapidjson::Value key;
-        key.SetString(name.data(), static_cast<rapidjson::SizeType>(name.size()), mDoc.GetAllocator());
+    OutputValueType addValueToObject(const json::Key& name, const rapidjson::Value& value, OutputObjectType* parent) {
+        auto key = _key(name);
 
         rapidjson::Value val;
         val.CopyFrom(value, mDoc.GetAllocator());
@@ -176,9 +180,8 @@ public:
         auto& inserted = (*parent->value)[parent->value->Size() - 1];
         return {&inserted};
     }
-    OutputValueType addNullToObject(std::string_view name, OutputObjectType* parent) {
-        rapidjson::Value key;
-        key.SetString(name.data(), static_cast<rapidjson::SizeType>(name.size()), mDoc.GetAllocator());
+    OutputValueType addNullToObject(const json::Key& name, OutputObjectType* parent) {
+        auto key = _key(name);
 
         rapidjson::Value val(rapidjson::kNullType);
         parent->value->AddMember(key, val, mDoc.GetAllocator());
@@ -191,6 +194,17 @@ public:
     void endObject(OutputObjectType* /*unused*/) noexcept {}
 
 private:
+    rapidjson::Value _key(const json::Key& name) {
+        rapidjson::Value key;
+        if (!name.fragment.empty()) {
+            // Reflected field names have static storage, so the tree can refer to them without a copy.
+            key.SetString(rapidjson::StringRef(name.name.data(), static_cast<rapidjson::SizeType>(name.name.size())));
+        } else {
+            key.SetString(name.name.data(), static_cast<rapidjson::SizeType>(name.name.size()), mDoc.GetAllocator());
+        }
+        return key;
+    }
+
     template <typename T>
     rapidjson::Value _fromBasicType(const T& value) {
         using U = std::remove_cv_t<std::remove_reference_t<T>>;
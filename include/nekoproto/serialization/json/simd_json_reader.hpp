@@ -5,6 +5,7 @@
 #if defined(NEKO_PROTO_ENABLE_SIMDJSON)
 
 #include "nekoproto/serialization/error.hpp"
+#include "nekoproto/serialization/parsing/value_kind.hpp"
 
 #include <limits>
 #include <memory>
@@ -44,6 +45,16 @@ struct Reader {
         return {array.value.at(index).value_unsafe(), array.owner};
     }
 
+    template <typename Fn>
+    static bool forEachArrayElement(const InputArrayType& array, Fn&& fn) {
+        for (const auto element : array.value) {
+            if (!fn(InputValueType{element, array.owner})) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     static std::size_t objectSize(const InputObjectType& object) noexcept { return object.value.size(); }
 
     static sa::Result<InputValueType> objectField(const InputObjectType& object, std::string_view name) noexcept {
@@ -68,6 +79,28 @@ struct Reader {
 
     static bool isEmpty(const InputValueType& value) noexcept { return value.value.is_null(); }
 
+    static sa::Result<parsing::ValueKind> valueKind(const InputValueType& value) noexcept {
+        switch (value.value.type()) {
+        case simdjson::dom::element_type::NULL_VALUE:
+            return parsing::ValueKind::Null;
+        case simdjson::dom::element_type::BOOL:
+            return parsing::ValueKind::Bool;
+        case simdjson::dom::element_type::INT64:
+            return parsing::ValueKind::Signed;
+        case simdjson::dom::element_type::UINT64:
+            return parsing::ValueKind::Unsigned;
+        case simdjson::dom::element_type::DOUBLE:
+            return parsing::ValueKind::Float;
+        case simdjson::dom::element_type::STRING:
+            return parsing::ValueKind::String;
+        case simdjson::dom::element_type::ARRAY:
+            return parsing::ValueKind::Array;
+        case simdjson::dom::element_type::OBJECT:
+            return parsing::ValueKind::Object;
+        }
+        return sa::error(sa::ErrorCode::InvalidType, "Unknown simdjson element type");
+    }
+
     static sa::Result<std::string> toRawString(const InputValueType& value) noexcept {
         try {
             return simdjson::minify(value.value);
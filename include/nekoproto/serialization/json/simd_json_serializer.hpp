@@ -4,11 +4,14 @@
 
 #if defined(NEKO_PROTO_ENABLE_SIMDJSON)
 
+#include "nekoproto/serialization/json/json_lines.hpp"
 #include "nekoproto/serialization/json/simd_json_reader.hpp"
 #include "nekoproto/serialization/json/simd_json_writer.hpp"
 #include "nekoproto/serialization/parsing/parsers.hpp"
 #include "nekoproto/serialization/serializer_adapter.hpp"
 
+#include <algorithm>
+#include <istream>
 #include <memory>
 #include <ostream>
 #include <simdjson.h>
@@ -211,6 +214,36 @@ struct SimdJsonBackend {
         sa::Result<void> result;
     };
 
+    /**
+     * @brief JSON Lines input state.
+     *
+     * Complete records are pulled through a bounded window and decoded with
+     * `parse_many`, so a large buffer or stream is never parsed as a whole.
+     * A caller-owned `padded_string` is streamed in place without copying.
+     */
+    template <typename SourceT>
+    struct RecordInputState {
+        RecordInputState(const char* buffer, std::size_t size,
+                         std::size_t chunkSize = json::RecordWindow::KDefaultChunkSize)
+            : window(buffer, size, simdjson::SIMDJSON_PADDING, chunkSize) {}
+
+        explicit RecordInputState(std::istream& stream, std::size_t chunkSize = json::RecordWindow::KDefaultChunkSize)
+            : window(stream, simdjson::SIMDJSON_PADDING, chunkSize) {}
+
+        explicit RecordInputState(const simdjson::padded_string& buffer)
+            : window(buffer.data(), buffer.size()) {}
+
+        json::RecordWindow window;
+        std::size_t batchSize = simdjson::dom::DEFAULT_BATCH_SIZE;
+        std::shared_ptr<detail::simd::JsonParser> parser = std::make_shared<detail::simd::JsonParser>();
+        simdjson::dom::document_stream stream;
+        simdjson::dom::document_stream::iterator current;
+        simdjson::dom::document_stream::iterator last;
+        bool streaming = false;
+        bool advance   = false;
+        bool failed    = false;
+    };
+
     template <typename BufferT, typename T>
     static sa::Result<void> write(OutputState<BufferT>& state, const T& value) {
         state.writer.reset();
@@ -239,11 +272,93 @@ struct SimdJsonBackend {
         return state.hasRoot && static_cast<bool>(result);
     }
 
+    template <typename BufferT>
+    static sa::Result<void> endRecord(OutputState<BufferT>& state) {
+        detail::simd::appendJson(state.buffer, "\n");
+        return sa::success();
+    }
+
     template <typename SourceT>
     static sa::Result<void> inputResult(const InputState<SourceT>& state) {
         return state.result;
     }
 
+    template <typename SourceT, typename T>
+    static sa::Result<bool> readRecord(RecordInputState<SourceT>& state, T& value) {
+        if (state.failed) {
+            return sa::Err(sa::ErrorCode::ParseError, "JSON Lines input already failed");
+        }
+        for (;;) {
+            if (!state.streaming) {
+                auto batch = state.window.next();
+                if (!batch) {
+                    state.failed = true;
+                    return sa::Err(std::move(batch.error()));
+                }
+                if (batch->empty()) {
+                    return false;
+                }
+                if (json::is_blank_record(*batch)) {
+                    continue;
+                }
+                // parse_many buffers one batch at a time; only a single record
+                // longer than the batch size needs a larger one.
+                const auto batchSize = batch->size() <= state.batchSize
+                                           ? batch->size()
+                                           : std::max(state.batchSize, json::longest_record(*batch));
+                auto error = state.parser->parse_many(batch->data(), batch->size(), batchSize).get(state.stream);
+                if (error != simdjson::SUCCESS) {
+                    state.failed = true;
+                    return sa::Err(sa::ErrorCode::ParseError, "simdjson parse error near offset " +
+                                                                  std::to_string(state.window.offset()) + ": " +
+                                                                  simdjson::error_message(error));
+                }
+                state.current   = state.stream.begin();
+                state.last      = state.stream.end();
+                state.streaming = true;
+                state.advance   = false;
+            }
+            // The parser reuses one document for the whole stream, so the
+            // iterator only moves once the previous record has been decoded.
+            if (state.advance) {
+                ++state.current;
+                state.advance = false;
+            }
+            if (!(state.current != state.last)) {
+                state.streaming = false;
+                if (state.stream.truncated_bytes() != 0) {
+                    state.failed = true;
+                    return sa::Err(sa::ErrorCode::ParseError,
+                                   "simdjson parse error near offset " +
+                                       std::to_string(state.window.offset() + state.stream.size_in_bytes() -
+                                                      state.stream.truncated_bytes()) +
+                                       ": incomplete JSON record");
+                }
+                continue;
+            }
+            auto element  = *state.current;
+            state.advance = true;
+            if (element.error() != simdjson::SUCCESS) {
+                state.failed = true;
+                return sa::Err(sa::ErrorCode::ParseError,
+                               "simdjson parse error near offset " +
+                                   std::to_string(state.window.offset() + state.current.current_index()) + ": " +
+                                   simdjson::error_message(element.error()));
+            }
+            auto result = parser_read<detail::simd::Reader>(
+                detail::simd::InputValue{element.value_unsafe(), state.parser}, value);
+            if (!result) {
+                return sa::Err(std::move(result.error()));
+            }
+            return true;
+        }
+    }
+
+    template <typename SourceT>
+    static bool recordStreamFailed(const RecordInputState<SourceT>& state) noexcept {
+        return state.failed;
+    }
+
     template <typename SourceT, typename T>
     static sa::Result<void> read(InputState<SourceT>& state, T& value) {
         return parser_read<detail::simd::Reader>(state.root, value);
@@ -269,13 +384,38 @@ public:
     using Base::Base;
 };
 
+/**
+ * @brief JSON Lines (NDJSON) writer: one compact document per line.
+ */
+template <typename BufferT = SimdJsonBackend::DefaultOutputBuffer>
+class SimdJsonLinesOutputSerializer : public detail::RecordOutputSerializerAdapter<SimdJsonBackend, BufferT> {
+public:
+    using Base = detail::RecordOutputSerializerAdapter<SimdJsonBackend, BufferT>;
+    using Base::Base;
+};
+
+template <typename BufferT>
+SimdJsonLinesOutputSerializer(BufferT&) -> SimdJsonLinesOutputSerializer<BufferT>;
+
+/**
+ * @brief Lazy JSON Lines (NDJSON) reader over a buffer, a padded buffer or an input stream.
+ */
+class SimdJsonLinesInputSerializer
+    : public detail::RecordInputSerializerAdapter<SimdJsonBackend, SimdJsonBackend::DefaultInputSource> {
+public:
+    using Base = detail::RecordInputSerializerAdapter<SimdJsonBackend, SimdJsonBackend::DefaultInputSource>;
+    using Base::Base;
+};
+
 struct SimdJsonSerializer {
-    using OutputSerializer     = SimdJsonOutputSerializer<>;
-    using ByteOutputSerializer = SimdJsonByteOutputSerializer;
-    using InputSerializer      = SimdJsonInputSerializer;
-    using JsonValue            = detail::simd::SimdJsonValue;
-    using Reader               = detail::simd::Reader;
-    using Writer               = detail::simd::Writer;
+    using OutputSerializer      = SimdJsonOutputSerializer<>;
+    using ByteOutputSerializer  = SimdJsonByteOutputSerializer;
+    using InputSerializer       = SimdJsonInputSerializer;
+    using LinesOutputSerializer = SimdJsonLinesOutputSerializer<>;
+    using LinesInputSerializer  = SimdJsonLinesInputSerializer;
+    using JsonValue             = detail::simd::SimdJsonValue;
+    using Reader                = detail::simd::Reader;
+    using Writer                = detail::simd::Writer;
 };
 
 NEKO_END_NAMESPACE
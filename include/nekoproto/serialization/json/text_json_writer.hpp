@@ -1,6 +1,7 @@
 #pragma once
 
 #include "nekoproto/global/global.hpp"
+#include "nekoproto/serialization/json/json_key.hpp"
 
 #include <charconv>
 #include <cmath>
@@ -24,6 +25,14 @@ struct RawValue {
 
 class TextWriter {
 private:
+    /// Encoded `"name":` text of one member, borrowed from a static table or owned when built at runtime.
+    struct MemberKey {
+        std::string_view fragment;
+        std::string encoded;
+
+        std::string_view text() const noexcept { return fragment.empty() ? std::string_view{encoded} : fragment; }
+    };
+
     struct Node {
         enum class Kind { Null, Scalar, String, Raw, Array, Object };
 
@@ -31,27 +40,29 @@ private:
         std::string value;
         std::vector<Node> array;
 
-        std::vector<std::string> objectNames;
+        std::vector<MemberKey> objectKeys;
         std::vector<Node> objectValues;
 
-        auto emplaceObject(const std::string& name, Node&& node) {
-            objectNames.push_back(name);
-            objectValues.push_back(std::move(node));
-            return std::pair<std::string_view, Node&>(objectNames.back(), objectValues.back());
+        Node& emplaceObject(const Key& key, Node&& node) {
+            auto& member = objectKeys.emplace_back();
+            if (!key.fragment.empty()) {
+                member.fragment = key.fragment;
+            } else {
+                member.encoded.resize(Key::fragmentSize(key.name));
+                Key::encodeFragment(key.name, member.encoded.data());
+            }
+            return objectValues.emplace_back(std::move(node));
         }
 
         void reserveObject(size_t size) {
-            objectNames.reserve(size);
+            objectKeys.reserve(size);
             objectValues.reserve(size);
         }
-
-        std::pair<std::string_view, const Node&> object(int index) const {
-            return {objectNames[index], objectValues[index]};
-        }
     };
 
 public:
-    using RawValueType = RawValue;
+    using RawValueType  = RawValue;
+    using OutputKeyType = Key;
 
     struct OutputArrayType {
         Node* value;
@@ -94,8 +105,8 @@ public:
         return {&child};
     }
 
-    static OutputArrayType addArrayToObject(std::string_view name, std::size_t size, OutputObjectType* parent) {
-        auto& child = parent->value->emplaceObject(std::string{name}, Node{}).second;
+    static OutputArrayType addArrayToObject(const Key& name, std::size_t size, OutputObjectType* parent) {
+        auto& child = parent->value->emplaceObject(name, Node{});
         _initializeArray(child, size);
         return {&child};
     }
@@ -106,8 +117,8 @@ public:
         return {&child};
     }
 
-    static OutputObjectType addObjectToObject(std::string_view name, std::size_t size, OutputObjectType* parent) {
-        auto& child = parent->value->emplaceObject(std::string{name}, Node{}).second;
+    static OutputObjectType addObjectToObject(const Key& name, std::size_t size, OutputObjectType* parent) {
+        auto& child = parent->value->emplaceObject(name, Node{});
         _initializeObject(child, size);
         return {&child};
     }
@@ -120,8 +131,8 @@ public:
     }
 
     template <typename T>
-    OutputValueType addValueToObject(std::string_view name, const T& value, OutputObjectType* parent) {
-        auto& child = parent->value->emplaceObject(std::string{name}, Node{}).second;
+    OutputValueType addValueToObject(const Key& name, const T& value, OutputObjectType* parent) {
+        auto& child = parent->value->emplaceObject(name, Node{});
         _setValue(child, value);
         return {&child};
     }
@@ -131,8 +142,8 @@ public:
         return {&child};
     }
 
-    static OutputValueType addNullToObject(std::string_view name, OutputObjectType* parent) {
-        auto& child = parent->value->emplaceObject(std::string{name}, Node{}).second;
+    static OutputValueType addNullToObject(const Key& name, OutputObjectType* parent) {
+        auto& child = parent->value->emplaceObject(name, Node{});
         return {&child};
     }
 
@@ -159,45 +170,10 @@ private:
         }
     }
 
-    static std::string _escape(std::string_view value) {
-        std::string output;
-        output.reserve(value.size() + 2);
-        for (const unsigned char ch : value) {
-            switch (ch) {
-            case '"':
-                output += "\\\"";
-                break;
-            case '\\':
-                output += "\\\\";
-                break;
-            case '\b':
-                output += "\\b";
-                break;
-            case '\f':
-                output += "\\f";
-                break;
-            case '\n':
-                output += "\\n";
-                break;
-            case '\r':
-                output += "\\r";
-                break;
-            case '\t':
-                output += "\\t";
-                break;
-            default:
-                if (ch < 0x20U) {
-                    constexpr char KHex[] = "0123456789abcdef";
-                    output += "\\u00";
-                    output.push_back(KHex[(ch >> 4U) & 0x0FU]);
-                    output.push_back(KHex[ch & 0x0FU]);
-                } else {
-                    output.push_back(static_cast<char>(ch));
-                }
-                break;
-            }
-        }
-        return output;
+    static void _appendEscaped(std::string_view value, std::string& output) {
+        const auto offset = output.size();
+        output.resize(offset + escaped_size(value));
+        escape_to(value, output.data() + offset);
     }
 
     template <typename T>
@@ -260,7 +236,7 @@ private:
             break;
         case Node::Kind::String:
             output.push_back('"');
-            output += _escape(node.value);
+            _appendEscaped(node.value, output);
             output.push_back('"');
             break;
         case Node::Kind::Array:
@@ -275,14 +251,12 @@ private:
             break;
         case Node::Kind::Object:
             output.push_back('{');
-            for (std::size_t i = 0; i < node.objectNames.size(); ++i) {
+            for (std::size_t i = 0; i < node.objectKeys.size(); ++i) {
                 if (i != 0) {
                     output.push_back(',');
                 }
-                output.push_back('"');
-                output += _escape(node.object(i).first);
-                output += "\":";
-                _render(node.object(i).second, output);
+                output += node.objectKeys[i].text();
+                _render(node.objectValues[i], output);
             }
             output.push_back('}');
             break;
@@ -4,6 +4,7 @@
 #include "nekoproto/serialization/parsing/schemaful/IsSchemafulWriter.hpp"
 #include "nekoproto/serialization/parsing/supports_attributes.hpp"
 #include "nekoproto/serialization/parsing/supports_comments.hpp"
+#include "nekoproto/serialization/parsing/supports_key_fragments.hpp"
 #include "nekoproto/serialization/private/tags.hpp"
 
 #include <string_view>
@@ -51,7 +52,9 @@ struct Parent {
         std::string_view name;
         OutputObjectType* object;
         bool isAttribute = false;
-        Object asAttribute() { return {name, object, true}; }
+        /// Pre-encoded member name for writers that support key fragments, empty when unknown.
+        std::string_view key = {};
+        Object asAttribute() { return {name, object, true, key}; }
     };
 
     struct IdObject {
@@ -77,8 +80,8 @@ struct Parent {
             NEKO_RETURN_TAGGED(writer.addArrayToArray(size, parent.array, tags),
                                writer.addArrayToArray(size, parent.array));
         } else if constexpr (std::is_same<Type, Object>()) {
-            NEKO_RETURN_TAGGED(writer.addArrayToObject(parent.name, size, parent.object, tags),
-                               writer.addArrayToObject(parent.name, size, parent.object));
+            NEKO_RETURN_TAGGED(writer.addArrayToObject(_objectKey(parent), size, parent.object, tags),
+                               writer.addArrayToObject(_objectKey(parent), size, parent.object));
         } else if constexpr (std::is_same<Type, IdObject>()) {
             NEKO_RETURN_TAGGED(writer.addArrayToObject(parent.name, size, parent.object, tags),
                                writer.addArrayToObject(parent.name, size, parent.object));
@@ -140,8 +143,8 @@ struct Parent {
             NEKO_RETURN_TAGGED(writer.addObjectToArray(size, parent.array, tags),
                                writer.addObjectToArray(size, parent.array));
         } else if constexpr (std::is_same<Type, Object>()) {
-            NEKO_RETURN_TAGGED(writer.addObjectToObject(parent.name, size, parent.object, tags),
-                               writer.addObjectToObject(parent.name, size, parent.object));
+            NEKO_RETURN_TAGGED(writer.addObjectToObject(_objectKey(parent), size, parent.object, tags),
+                               writer.addObjectToObject(_objectKey(parent), size, parent.object));
         } else if constexpr (std::is_same<Type, IdObject>()) {
             NEKO_RETURN_TAGGED(writer.addObjectToObject(parent.name, size, parent.object, tags),
                                writer.addObjectToObject(parent.name, size, parent.object));
@@ -178,7 +181,7 @@ struct Parent {
     static void beginUnframedObject(W& writer, const ParentType& parent) {
         using Type = std::remove_cvref_t<ParentType>;
         if constexpr (std::is_same<Type, Object>()) {
-            writer.addUnframedObjectToObject(parent.name, parent.object);
+            writer.addUnframedObjectToObject(_objectKey(parent), parent.object);
         } else if constexpr (std::is_same<Type, Array>() || std::is_same<Type, Root>()) {
             static_cast<void>(writer);
             static_cast<void>(parent);
@@ -195,11 +198,11 @@ struct Parent {
 
         } else if constexpr (std::is_same<Type, Object>()) {
             if constexpr (supports_attributes<std::remove_cvref_t<W>>) {
-                NEKO_RETURN_TAGGED(writer.addNullToObject(parent.name, parent.object, parent.isAttribute, tags),
-                                   writer.addNullToObject(parent.name, parent.object, parent.isAttribute));
+                NEKO_RETURN_TAGGED(writer.addNullToObject(_objectKey(parent), parent.object, parent.isAttribute, tags),
+                                   writer.addNullToObject(_objectKey(parent), parent.object, parent.isAttribute));
             } else {
-                NEKO_RETURN_TAGGED(writer.addNullToObject(parent.name, parent.object, tags),
-                                   writer.addNullToObject(parent.name, parent.object));
+                NEKO_RETURN_TAGGED(writer.addNullToObject(_objectKey(parent), parent.object, tags),
+                                   writer.addNullToObject(_objectKey(parent), parent.object));
             }
 
         } else if constexpr (std::is_same<Type, IdObject>()) {
@@ -234,11 +237,12 @@ struct Parent {
 
         } else if constexpr (std::is_same<Type, Object>()) {
             if constexpr (supports_attributes<std::remove_cvref_t<W>>) {
-                NEKO_RETURN_TAGGED(writer.addValueToObject(parent.name, var, parent.object, parent.isAttribute, tags),
-                                   writer.addValueToObject(parent.name, var, parent.object, parent.isAttribute));
+                NEKO_RETURN_TAGGED(
+                    writer.addValueToObject(_objectKey(parent), var, parent.object, parent.isAttribute, tags),
+                    writer.addValueToObject(_objectKey(parent), var, parent.object, parent.isAttribute));
             } else {
-                NEKO_RETURN_TAGGED(writer.addValueToObject(parent.name, var, parent.object, tags),
-                                   writer.addValueToObject(parent.name, var, parent.object));
+                NEKO_RETURN_TAGGED(writer.addValueToObject(_objectKey(parent), var, parent.object, tags),
+                                   writer.addValueToObject(_objectKey(parent), var, parent.object));
             }
 
         } else if constexpr (std::is_same<Type, IdObject>()) {
@@ -273,8 +277,8 @@ struct Parent {
                                writer.addFixedValueToArray(var, size, parent.array));
 
         } else if constexpr (std::is_same<Type, Object>()) {
-            NEKO_RETURN_TAGGED(writer.addFixedValueToObject(parent.name, var, size, parent.object, tags),
-                               writer.addFixedValueToObject(parent.name, var, size, parent.object));
+            NEKO_RETURN_TAGGED(writer.addFixedValueToObject(_objectKey(parent), var, size, parent.object, tags),
+                               writer.addFixedValueToObject(_objectKey(parent), var, size, parent.object));
         } else if constexpr (std::is_same<Type, IdObject>()) {
             NEKO_RETURN_TAGGED(writer.addFixedValueToObject(parent.name, var, size, parent.object, tags),
                                writer.addFixedValueToObject(parent.name, var, size, parent.object));
@@ -286,6 +290,15 @@ struct Parent {
             static_assert(always_false_v<Type>, "Unsupported fixed-value parent.");
         }
     }
+
+private:
+    static auto _objectKey(const Object& parent) {
+        if constexpr (supports_key_fragments<W>) {
+            return typename W::OutputKeyType{parent.name, parent.key};
+        } else {
+            return parent.name;
+        }
+    }
 };
 #undef NEKO_RETURN_TAGGED
 } // namespace parsing
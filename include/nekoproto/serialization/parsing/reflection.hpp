@@ -1,11 +1,13 @@
 #pragma once
 
 #include "nekoproto/serialization/parsing/parser.hpp"
+#include "nekoproto/serialization/parsing/supports_key_fragments.hpp"
 #include "nekoproto/serialization/parsing/supports_unframed_objects.hpp"
 #include "nekoproto/global/traits.hpp"
 #include "nekoproto/serialization/reflection.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
 #include <string>
 #include <string_view>
@@ -179,9 +181,54 @@ parsing::schema::Type parser_schema_positional_reflection() {
     return array;
 }
 
+/**
+ * @brief Member names of `T` encoded by `KeyType` once, at compile time.
+ *
+ * Renamed fields use their wire name. Fragments for all fields share one
+ * contiguous buffer, so writing a field name is a single copy.
+ */
+template <typename KeyType, typename T>
+struct reflect_key_fragments {
+    static constexpr std::size_t count = static_cast<std::size_t>(Reflect<T>::value_count); // NOLINT
+
+    static constexpr auto names = [] { // NOLINT
+        std::array<std::string_view, count> result{};
+        std::size_t index = 0;
+        Reflect<T>::forEachMeta([&result, &index](std::string_view name, const auto& tags) {
+            if constexpr (tag_query::has<tag_property::name>(std::remove_cvref_t<decltype(tags)>{})) {
+                result[index] = tag_query::get<tag_property::name>(tags);
+            } else {
+                result[index] = name;
+            }
+            ++index;
+        });
+        return result;
+    }();
+
+    static constexpr auto offsets = [] { // NOLINT
+        std::array<std::size_t, count + 1> result{};
+        for (std::size_t i = 0; i < count; ++i) {
+            result[i + 1] = result[i] + KeyType::fragmentSize(names[i]);
+        }
+        return result;
+    }();
+
+    static constexpr auto storage = [] { // NOLINT
+        std::array<char, offsets[count]> result{};
+        for (std::size_t i = 0; i < count; ++i) {
+            KeyType::encodeFragment(names[i], result.data() + offsets[i]);
+        }
+        return result;
+    }();
+
+    static constexpr std::string_view at(std::size_t index) noexcept {
+        return {storage.data() + offsets[index], offsets[index + 1] - offsets[index]};
+    }
+};
+
 template <typename W, typename ObjectType, typename T, typename Tags>
-ParserResult parser_write_reflect_field(W& writer, ObjectType& object, const T& field,
-                                        std::string_view name, const Tags& tags) {
+ParserResult parser_write_reflect_field(W& writer, ObjectType& object, const T& field, std::string_view name,
+                                        const Tags& tags, std::string_view key = {}) {
     using FieldType = std::decay_t<T>;
     if (parser_should_ignore_reflect_field(tags)) {
         return sa::success();
@@ -204,7 +251,7 @@ ParserResult parser_write_reflect_field(W& writer, ObjectType& object, const T&
                 parser_write_trailing_comment(writer, parent, tags);
             };
             if constexpr (std::is_same_v<ObjectType, typename W::OutputObjectType>) {
-                writeNull(typename parsing::Parent<W>::Object{name, &object});
+                writeNull(typename parsing::Parent<W>::Object{name, &object, false, key});
             } else {
                 writeNull(typename parsing::Parent<W>::IdObject{name, &object});
             }
@@ -226,7 +273,7 @@ ParserResult parser_write_reflect_field(W& writer, ObjectType& object, const T&
         return result;
     };
     if constexpr (std::is_same_v<ObjectType, typename W::OutputObjectType>) {
-        return writeField(typename parsing::Parent<W>::Object{fieldName, &object});
+        return writeField(typename parsing::Parent<W>::Object{fieldName, &object, false, key});
     } else {
         return writeField(typename parsing::Parent<W>::IdObject{fieldName, &object});
     }
@@ -272,12 +319,24 @@ ParserResult parser_read_reflect_field(typename R::InputValueType in, T& field,
 template <typename W, typename ObjectType, typename T>
 ParserResult parser_write_reflect_fields(W& writer, ObjectType& object, const T& value) {
     ParserResult result;
-    Reflect<std::decay_t<T>>::forEach(
-        value, [&result, &writer, &object](auto&& field, std::string_view name, const auto& tags) {
-            if (result) {
-                result = parser_write_reflect_field<W>(writer, object, field, name, tags);
-            }
-        });
+    if constexpr (parsing::supports_key_fragments<W> && std::is_same_v<ObjectType, typename W::OutputObjectType>) {
+        using Fragments   = reflect_key_fragments<typename W::OutputKeyType, std::decay_t<T>>;
+        std::size_t index = 0;
+        Reflect<std::decay_t<T>>::forEach(
+            value, [&result, &writer, &object, &index](auto&& field, std::string_view name, const auto& tags) {
+                if (result) {
+                    result = parser_write_reflect_field<W>(writer, object, field, name, tags, Fragments::at(index));
+                }
+                ++index;
+            });
+    } else {
+        Reflect<std::decay_t<T>>::forEach(
+            value, [&result, &writer, &object](auto&& field, std::string_view name, const auto& tags) {
+                if (result) {
+                    result = parser_write_reflect_field<W>(writer, object, field, name, tags);
+                }
+            });
+    }
     return result;
 }
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "nekoproto/global/global.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <string_view>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace parsing {
+/**
+ * @brief Writers whose object member names can be encoded ahead of time.
+ *
+ * `W::OutputKeyType` describes the encoding of one member name and is what the
+ * writer's `add*ToObject` functions take in place of a plain name. Reflected
+ * fields pass a key carrying the pre-encoded fragment, everything else passes
+ * the bare name.
+ */
+template <typename W>
+concept supports_key_fragments = requires(std::string_view name, char* output) {
+    typename W::OutputKeyType;
+    { W::OutputKeyType::fragmentSize(name) } -> std::same_as<std::size_t>;
+    { W::OutputKeyType::encodeFragment(name, output) } -> std::same_as<char*>;
+    { typename W::OutputKeyType{name, name} };
+};
+} // namespace parsing
+
+NEKO_END_NAMESPACE
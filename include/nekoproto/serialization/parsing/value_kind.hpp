@@ -0,0 +1,47 @@
+#pragma once
+
+#include "nekoproto/global/global.hpp"
+#include "nekoproto/serialization/error.hpp"
+
+#include <concepts>
+#include <cstdint>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace parsing {
+/**
+ * @brief Structural kind of one input node, independent of any target C++ type.
+ */
+enum class ValueKind : std::uint8_t {
+    Null,
+    Bool,
+    Signed,
+    Unsigned,
+    Float,
+    String,
+    Array,
+    Object,
+};
+
+/**
+ * @brief Readers that can name the kind of a node without converting it.
+ *
+ * Schema-less consumers such as the transcoder use this to pick a conversion
+ * up front. Readers without the hook are probed through the `reader_*`
+ * helpers instead.
+ */
+template <typename R>
+concept reports_value_kind = requires(const typename R::InputValueType& input) {
+    { R::valueKind(input) } -> std::same_as<sa::Result<ValueKind>>;
+};
+
+/**
+ * @brief Readers that can visit array elements in order without indexed lookup.
+ */
+template <typename R>
+concept supports_array_iteration = requires(const typename R::InputArrayType& array) {
+    { R::forEachArrayElement(array, [](const typename R::InputValueType&) { return true; }) } -> std::same_as<bool>;
+};
+} // namespace parsing
+
+NEKO_END_NAMESPACE
@@ -5,11 +5,22 @@
 
 #include <concepts>
 #include <cstddef>
+#include <string_view>
 #include <utility>
 
 NEKO_BEGIN_NAMESPACE
 namespace detail {
 
+/// Contiguous character buffers a streaming writer can append to and truncate in place.
+template <typename BufferT>
+concept resizable_char_buffer = requires(BufferT& buffer, std::string_view text) {
+    requires std::same_as<typename BufferT::value_type, char>;
+    buffer.insert(buffer.end(), text.begin(), text.end());
+    buffer.resize(std::size_t{});
+    { buffer.data() } -> std::same_as<char*>;
+    { buffer.size() } -> std::convertible_to<std::size_t>;
+};
+
 template <typename Backend, typename BufferT>
 class OutputSerializerAdapter {
 public:
@@ -151,5 +162,113 @@ private:
     bool mDocumentAttempted = false;
 };
 
+/**
+ * @brief Multi-document writer sharing one backend state across records.
+ *
+ * Every call serializes one root value and appends it to the output followed
+ * by the backend's record separator, so many records can be streamed into a
+ * single buffer or stream without reconstructing the serializer. A failed
+ * record leaves no partial output behind and does not prevent later records.
+ */
+template <typename Backend, typename BufferT>
+class RecordOutputSerializerAdapter {
+public:
+    using BackendType = Backend;
+    using StateType   = typename Backend::template OutputState<BufferT>;
+
+    template <typename... Args>
+    explicit RecordOutputSerializerAdapter(Args&&... args) : mState(std::forward<Args>(args)...) {}
+
+    RecordOutputSerializerAdapter(const RecordOutputSerializerAdapter&)            = delete;
+    RecordOutputSerializerAdapter(RecordOutputSerializerAdapter&&)                 = delete;
+    RecordOutputSerializerAdapter& operator=(const RecordOutputSerializerAdapter&) = delete;
+    RecordOutputSerializerAdapter& operator=(RecordOutputSerializerAdapter&&)      = delete;
+
+    template <typename T>
+    bool operator()(const T& value) {
+        mLastResult = Backend::write(mState, value);
+        mLastResult = Backend::finish(mState, mLastResult);
+        if (mLastResult) {
+            mLastResult = Backend::endRecord(mState);
+        }
+        if (mLastResult) {
+            ++mRecordCount;
+        }
+        return static_cast<bool>(mLastResult);
+    }
+
+    bool end() const noexcept { return static_cast<bool>(mLastResult); }
+
+    explicit operator bool() const noexcept { return static_cast<bool>(mLastResult); }
+    const sa::Error* error() const noexcept { return sa::error_ptr(mLastResult); }
+    std::size_t recordCount() const noexcept { return mRecordCount; }
+
+    StateType& state() noexcept { return mState; }
+    const StateType& state() const noexcept { return mState; }
+
+private:
+    StateType mState;
+    sa::Result<void> mLastResult;
+    std::size_t mRecordCount = 0;
+};
+
+/**
+ * @brief Lazy multi-document reader over one backend record state.
+ *
+ * Each call decodes the next record into @p value and returns false once the
+ * input is exhausted or a record fails. `eof()` distinguishes the clean end of
+ * input from an error; syntax errors stop the iteration, while a record that
+ * parses but does not match the target type only fails that call.
+ */
+template <typename Backend, typename SourceT>
+class RecordInputSerializerAdapter {
+public:
+    using BackendType = Backend;
+    using StateType   = typename Backend::template RecordInputState<SourceT>;
+
+    template <typename... Args>
+    explicit RecordInputSerializerAdapter(Args&&... args) : mState(std::forward<Args>(args)...) {}
+
+    RecordInputSerializerAdapter(const RecordInputSerializerAdapter&)            = delete;
+    RecordInputSerializerAdapter(RecordInputSerializerAdapter&&)                 = delete;
+    RecordInputSerializerAdapter& operator=(const RecordInputSerializerAdapter&) = delete;
+    RecordInputSerializerAdapter& operator=(RecordInputSerializerAdapter&&)      = delete;
+
+    template <typename T>
+    bool operator()(T& value) {
+        if (mEof) {
+            return false;
+        }
+        auto next = Backend::readRecord(mState, value);
+        if (!next) {
+            mLastResult = sa::Err(std::move(next.error()));
+            mEof        = Backend::recordStreamFailed(mState);
+            return false;
+        }
+        mLastResult = sa::success();
+        if (!next.value()) {
+            mEof = true;
+            return false;
+        }
+        ++mRecordCount;
+        return true;
+    }
+
+    bool eof() const noexcept { return mEof && static_cast<bool>(mLastResult); }
+
+    explicit operator bool() const noexcept { return static_cast<bool>(mLastResult); }
+    const sa::Error* error() const noexcept { return sa::error_ptr(mLastResult); }
+    std::size_t recordCount() const noexcept { return mRecordCount; }
+
+    StateType& state() noexcept { return mState; }
+    const StateType& state() const noexcept { return mState; }
+
+private:
+    StateType mState;
+    sa::Result<void> mLastResult;
+    std::size_t mRecordCount = 0;
+    bool mEof                = false;
+};
+
 } // namespace detail
 NEKO_END_NAMESPACE
@@ -0,0 +1,423 @@
+#pragma once
+
+// Direct conversion between serialization formats.
+
+#include "nekoproto/global/global.hpp"
+#include "nekoproto/global/traits.hpp"
+#include "nekoproto/serialization/error.hpp"
+#include "nekoproto/serialization/parsing/parent.hpp"
+#include "nekoproto/serialization/parsing/parser.hpp"
+#include "nekoproto/serialization/parsing/reader.hpp"
+#include "nekoproto/serialization/parsing/reflection.hpp"
+#include "nekoproto/serialization/parsing/value_kind.hpp"
+#include "nekoproto/serialization/private/tags.hpp"
+#include "nekoproto/serialization/reflection.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+NEKO_BEGIN_NAMESPACE
+namespace detail {
+
+/// Root placeholder read through an input serializer; it keeps the root node instead of decoding it.
+template <typename R>
+struct TranscodeInput {
+    std::optional<typename R::InputValueType> input;
+};
+
+/// Root placeholder written through an output serializer; it replays @p input into the writer.
+template <typename R, typename Schema>
+struct TranscodeOutput {
+    typename R::InputValueType input;
+};
+
+template <typename R>
+struct disable_reflect_parser<TranscodeInput<R>> : std::true_type {};
+
+template <typename R, typename Schema>
+struct disable_reflect_parser<TranscodeOutput<R, Schema>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool transcode_reflected_v = // NOLINT
+    has_values_meta<T> && has_names_meta<T> && !is_tagged_field_v<T> && !std::is_enum_v<T> &&
+    !disable_reflect_parser<T>::value;
+
+template <typename T>
+inline constexpr bool transcode_string_map_v = requires { // NOLINT
+    typename T::key_type;
+    typename T::mapped_type;
+    requires traits::is_string_like_v<typename T::key_type>;
+};
+
+template <typename T>
+inline constexpr bool transcode_sequence_v = // NOLINT
+    std::ranges::range<T> && !traits::is_string_like_v<T> && !requires { typename T::mapped_type; };
+
+template <typename R>
+sa::Result<parsing::ValueKind> transcode_value_kind(const typename R::InputValueType& in) {
+    if constexpr (parsing::reports_value_kind<R>) {
+        return R::valueKind(in);
+    } else {
+        // Probe from the most to the least specific interpretation; scalar
+        // readers without the hook are free to accept several of these.
+        if (parsing::reader_is_empty<R>(in, NoTags{})) {
+            return parsing::ValueKind::Null;
+        }
+        if (parsing::reader_to_object<R>(in, NoTags{})) {
+            return parsing::ValueKind::Object;
+        }
+        if (parsing::reader_to_array<R>(in, NoTags{})) {
+            return parsing::ValueKind::Array;
+        }
+        if (parsing::reader_to_basic<R, bool>(in, NoTags{})) {
+            return parsing::ValueKind::Bool;
+        }
+        if (parsing::reader_to_basic<R, std::int64_t>(in, NoTags{})) {
+            return parsing::ValueKind::Signed;
+        }
+        if (parsing::reader_to_basic<R, std::uint64_t>(in, NoTags{})) {
+            return parsing::ValueKind::Unsigned;
+        }
+        if (parsing::reader_to_basic<R, double>(in, NoTags{})) {
+            return parsing::ValueKind::Float;
+        }
+        if (parsing::reader_to_basic<R, std::string>(in, NoTags{})) {
+            return parsing::ValueKind::String;
+        }
+        return sa::error(sa::ErrorCode::InvalidType, "Value has no transcodable kind");
+    }
+}
+
+template <typename R, typename W, typename T, typename ParentType>
+ParserResult transcode_write_basic(W& writer, const typename R::InputValueType& in, const ParentType& parent) {
+    auto value = parsing::reader_to_basic<R, T>(in, NoTags{});
+    if (!value) {
+        return sa::Err(std::move(value.error()));
+    }
+    parsing::Parent<W>::addValue(writer, value.value(), parent);
+    return sa::success();
+}
+
+/// Integers may be stored at a fixed width; the narrower reads are tried only after the variable-width one fails.
+template <typename R, typename W, typename T, typename Narrow, typename... Narrower, typename ParentType>
+ParserResult transcode_write_integer(W& writer, const typename R::InputValueType& in, const ParentType& parent) {
+    auto value = parsing::reader_to_basic<R, T>(in, NoTags{});
+    if constexpr (requires { R::template toFixedBasicType<Narrow>(in, sizeof(Narrow)); }) {
+        if (!value) {
+            auto fixed = parsing::reader_to_fixed_basic<R, Narrow>(in, sizeof(Narrow), NoTags{});
+            if (fixed) {
+                value = static_cast<T>(fixed.value());
+            } else if constexpr (sizeof...(Narrower) != 0) {
+                return transcode_write_integer<R, W, Narrow, Narrower...>(writer, in, parent);
+            }
+        }
+    }
+    if (!value) {
+        return sa::Err(std::move(value.error()));
+    }
+    parsing::Parent<W>::addValue(writer, value.value(), parent);
+    return sa::success();
+}
+
+template <typename R, typename W, typename ParentType>
+ParserResult transcode_write_value(W& writer, const typename R::InputValueType& in, const ParentType& parent);
+
+template <typename R, typename W, typename ParentType>
+ParserResult transcode_write_array(W& writer, const typename R::InputValueType& in, const ParentType& parent,
+                                   auto&& element) {
+    auto array = parsing::reader_to_array<R>(in, NoTags{});
+    if (!array) {
+        return sa::Err(std::move(array.error()));
+    }
+    auto output = parsing::Parent<W>::addArray(writer, R::arraySize(array.value()), parent);
+    const auto child = typename parsing::Parent<W>::Array{&output};
+    ParserResult result;
+    if constexpr (parsing::supports_array_iteration<R>) {
+        std::size_t index = 0;
+        R::forEachArrayElement(array.value(), [&](const typename R::InputValueType& item) {
+            result = element(item, child);
+            if (!result) {
+                result =
+                    parser_context(std::move(result), "Failed to transcode element " + std::to_string(index) + ": ");
+            }
+            ++index;
+            return static_cast<bool>(result);
+        });
+    } else {
+        const auto size = R::arraySize(array.value());
+        for (std::size_t index = 0; index < size && result; ++index) {
+            result = element(R::arrayElement(array.value(), index), child);
+            if (!result) {
+                result =
+                    parser_context(std::move(result), "Failed to transcode element " + std::to_string(index) + ": ");
+            }
+        }
+    }
+    return result;
+}
+
+template <typename R, typename W, typename ParentType>
+ParserResult transcode_write_object(W& writer, const typename R::InputValueType& in, const ParentType& parent,
+                                    auto&& member) {
+    auto object = parsing::reader_to_object<R>(in, NoTags{});
+    if (!object) {
+        return sa::Err(std::move(object.error()));
+    }
+    auto output = parsing::Parent<W>::addObject(writer, R::objectSize(object.value()), parent);
+    ParserResult result;
+    const bool visited = parsing::reader_for_each_object_member<R>(
+        object.value(),
+        [&](const auto& name, const typename R::InputValueType& value) {
+            const std::string_view key{name};
+            result = member(value, typename parsing::Parent<W>::Object{key, &output});
+            if (!result) {
+                result = parser_context(std::move(result), "Failed to transcode member '" + std::string(key) + "': ");
+            }
+            return static_cast<bool>(result);
+        },
+        NoTags{});
+    if (result && !visited) {
+        return sa::error(sa::ErrorCode::InvalidType,
+                         "Object members cannot be enumerated; transcode hashed id objects with a schema type");
+    }
+    return result;
+}
+
+template <typename R, typename W, typename ParentType>
+ParserResult transcode_write_value(W& writer, const typename R::InputValueType& in, const ParentType& parent) {
+    auto kind = transcode_value_kind<R>(in);
+    if (!kind) {
+        return sa::Err(std::move(kind.error()));
+    }
+    switch (kind.value()) {
+    case parsing::ValueKind::Null:
+        parsing::Parent<W>::addNull(writer, parent);
+        return sa::success();
+    case parsing::ValueKind::Bool:
+        return transcode_write_basic<R, W, bool>(writer, in, parent);
+    case parsing::ValueKind::Signed:
+        return transcode_write_integer<R, W, std::int64_t, std::int64_t, std::int32_t, std::int16_t, std::int8_t>(
+            writer, in, parent);
+    case parsing::ValueKind::Unsigned:
+        return transcode_write_integer<R, W, std::uint64_t, std::uint64_t, std::uint32_t, std::uint16_t,
+                                       std::uint8_t>(writer, in, parent);
+    case parsing::ValueKind::Float: {
+        auto value = parsing::reader_to_basic<R, double>(in, NoTags{});
+        if (!value) {
+            return transcode_write_basic<R, W, float>(writer, in, parent);
+        }
+        parsing::Parent<W>::addValue(writer, value.value(), parent);
+        return sa::success();
+    }
+    case parsing::ValueKind::String:
+        if constexpr (requires { parsing::reader_to_string_view<R, char, std::char_traits<char>>(in, NoTags{}); }) {
+            auto value = parsing::reader_to_string_view<R, char, std::char_traits<char>>(in, NoTags{});
+            if (!value) {
+                return sa::Err(std::move(value.error()));
+            }
+            parsing::Parent<W>::addValue(writer, value.value(), parent);
+            return sa::success();
+        } else {
+            return transcode_write_basic<R, W, std::string>(writer, in, parent);
+        }
+    case parsing::ValueKind::Array:
+        return transcode_write_array<R, W>(writer, in, parent, [&writer](const auto& item, const auto& child) {
+            return transcode_write_value<R, W>(writer, item, child);
+        });
+    case parsing::ValueKind::Object:
+        return transcode_write_object<R, W>(writer, in, parent, [&writer](const auto& value, const auto& child) {
+            return transcode_write_value<R, W>(writer, value, child);
+        });
+    }
+    return sa::error(sa::ErrorCode::InvalidType, "Unknown value kind");
+}
+
+template <typename R, typename W, typename T, typename ParentType>
+ParserResult transcode_write_schema(W& writer, const typename R::InputValueType& in, const ParentType& parent) {
+    if constexpr (transcode_reflected_v<T> || traits::optional_like<T> || transcode_sequence_v<T> ||
+                  transcode_string_map_v<T>) {
+        if (parsing::reader_is_empty<R>(in, NoTags{})) {
+            parsing::Parent<W>::addNull(writer, parent);
+            return sa::success();
+        }
+    }
+    if constexpr (transcode_reflected_v<T>) {
+        auto object = parsing::reader_to_object<R>(in, NoTags{});
+        if (!object) {
+            return sa::Err(std::move(object.error()));
+        }
+        std::array<std::optional<typename R::InputValueType>, Reflect<T>::value_count> fields;
+        std::size_t count = 0;
+        std::size_t index = 0;
+        Reflect<T>::forEachMeta([&](auto type, std::string_view name, const auto& tags) {
+            auto& field = fields[index++];
+            if (parser_should_ignore_reflect_field(tags)) {
+                return;
+            }
+            if constexpr (tag_query::has<tag_property::name>(std::remove_cvref_t<decltype(tags)>{})) {
+                name = tag_query::get<tag_property::name>(tags);
+            }
+            auto value = parsing::reader_object_field<R>(object.value(), name, tags);
+            if (!value) {
+                return;
+            }
+#if !defined(NEKO_WRITE_NULL_FOR_EMPTY_OPTIONAL)
+            // Empty optionals are left out, as the reflected writer would.
+            if constexpr (traits::optional_like_type<typename decltype(type)::type>::value) {
+                if (parsing::reader_is_empty<R>(value.value(), tags)) {
+                    return;
+                }
+            }
+#else
+            static_cast<void>(type);
+#endif
+            field = std::move(value.value());
+            ++count;
+        });
+        auto writeFields = [&](auto& output, auto makeParent) {
+            ParserResult result;
+            std::size_t index = 0;
+            Reflect<T>::forEachMeta([&](auto type, std::string_view name, const auto& tags) {
+                const auto& field = fields[index++];
+                if (!result || !field.has_value()) {
+                    return;
+                }
+                if constexpr (tag_query::has<tag_property::name>(std::remove_cvref_t<decltype(tags)>{})) {
+                    name = tag_query::get<tag_property::name>(tags);
+                }
+                using FieldType = std::remove_cvref_t<typename decltype(type)::type>;
+                result = transcode_write_schema<R, W, FieldType>(writer, *field, makeParent(name, output));
+                if (!result) {
+                    result = parser_context(std::move(result),
+                                            "Failed to transcode field '" + std::string(name) + "': ");
+                }
+            });
+            return result;
+        };
+        if constexpr (requires { typename W::OutputIdObjectType; }) {
+            auto output = parsing::Parent<W>::addIdObject(writer, count, parent);
+            return writeFields(output, [](std::string_view name, auto& target) {
+                return typename parsing::Parent<W>::IdObject{name, &target};
+            });
+        } else {
+            auto output = parsing::Parent<W>::addObject(writer, count, parent);
+            return writeFields(output, [](std::string_view name, auto& target) {
+                return typename parsing::Parent<W>::Object{name, &target};
+            });
+        }
+    } else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        // The schema settles signedness and width that the input format may not record.
+        return transcode_write_integer<R, W, T, T>(writer, in, parent);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        return transcode_write_basic<R, W, T>(writer, in, parent);
+    } else if constexpr (traits::optional_like<T>) {
+        return transcode_write_schema<R, W, typename T::value_type>(writer, in, parent);
+    } else if constexpr (transcode_sequence_v<T>) {
+        using Element = std::remove_cvref_t<std::ranges::range_value_t<T>>;
+        return transcode_write_array<R, W>(writer, in, parent, [&writer](const auto& item, const auto& child) {
+            return transcode_write_schema<R, W, Element>(writer, item, child);
+        });
+    } else if constexpr (transcode_string_map_v<T>) {
+        return transcode_write_object<R, W>(writer, in, parent, [&writer](const auto& value, const auto& child) {
+            return transcode_write_schema<R, W, typename T::mapped_type>(writer, value, child);
+        });
+    } else {
+        return transcode_write_value<R, W>(writer, in, parent);
+    }
+}
+
+template <typename R>
+struct ReadParser<R, TranscodeInput<R>, void> {
+    template <typename Tags>
+    static ParserResult read(typename R::InputValueType in, TranscodeInput<R>& value, const Tags& /*tags*/) {
+        if constexpr (parsing::reports_value_kind<R>) {
+            // Surface root parse failures here rather than as a later trailing-data error.
+            if (auto kind = R::valueKind(in); !kind) {
+                return sa::Err(std::move(kind.error()));
+            }
+        }
+        value.input = std::move(in);
+        return sa::success();
+    }
+};
+
+template <typename W, typename R, typename Schema>
+struct WriteParser<W, TranscodeOutput<R, Schema>, void> {
+    template <typename ParentType, typename Tags>
+    static ParserResult write(W& writer, const TranscodeOutput<R, Schema>& value, const ParentType& parent,
+                              const Tags& /*tags*/) {
+        if constexpr (std::is_void_v<Schema>) {
+            return transcode_write_value<R, W>(writer, value.input, parent);
+        } else {
+            return transcode_write_schema<R, W, Schema>(writer, value.input, parent);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Replays the document of @p input into @p output.
+ *
+ * Both arguments are ordinary document serializers, so each backend applies
+ * its own parse limits, framing and trailing-data checks. With a `Schema`
+ * type the object layout follows its `Meta<T>`; otherwise every node is
+ * copied as it is.
+ */
+template <typename Schema = void, typename InputSerializerT, typename OutputSerializerT>
+sa::Result<void> transcode(InputSerializerT& input, OutputSerializerT& output) {
+    using Reader = typename InputSerializerT::BackendType::Reader;
+    detail::TranscodeInput<Reader> root;
+    if (!input(root)) {
+        return sa::Err(*input.error());
+    }
+    if (!output(detail::TranscodeOutput<Reader, Schema>{*root.input}) || !output.end()) {
+        return sa::Err(*output.error());
+    }
+    return sa::success();
+}
+
+/**
+ * @brief Converts one document from format `From` to format `To`.
+ *
+ * `From` and `To` are serializer families such as `JsonSerializer` or
+ * `BinarySerializer`. The node tree of the `From` reader is replayed into
+ * the `To` writer through `parsing::Parent`, so a document can change
+ * format without a C++ type for it. The converted document is appended to
+ * @p out.
+ *
+ * @code {.c++}
+ * std::vector<char> binary;
+ * auto result = transcode<JsonSerializer, BinarySerializer>(json.data(), json.size(), binary);
+ * @endcode
+ */
+template <typename From, typename To>
+sa::Result<void> transcode(const char* data, std::size_t size, std::vector<char>& out) {
+    typename From::InputSerializer input(data, size);
+    typename To::OutputSerializer output(out);
+    return transcode(input, output);
+}
+
+/**
+ * @brief Converts one document from `From` to `To` using the layout of the reflected type `Schema`.
+ *
+ * The fields of `Meta<Schema>` are looked up by their reflected names and
+ * written the way the type itself would be, which means IdObject keys for
+ * the binary writer. Members outside the schema are dropped; values below a
+ * non-reflected field are copied as they are.
+ */
+template <typename From, typename To, typename Schema>
+sa::Result<void> transcode(const char* data, std::size_t size, std::vector<char>& out) {
+    typename From::InputSerializer input(data, size);
+    typename To::OutputSerializer output(out);
+    return transcode<Schema>(input, output);
+}
+
+NEKO_END_NAMESPACE
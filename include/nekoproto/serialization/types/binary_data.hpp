@@ -13,81 +13,258 @@
 #include "../json_serializer.hpp"
 #include "../parsing/parser.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstring>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#if defined(__SSE4_1__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 NEKO_BEGIN_NAMESPACE
 
 /// ================== Base 64 ==========================
-struct Base64Covert {
-#if NEKO_CPP_PLUS >= 17
-    constexpr static const char Table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-#else
-    static const char Table[65];
+namespace detail::base64 {
+inline constexpr char KEncodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+inline constexpr uint8_t KInvalid    = 0xFF;
+
+// Maps every byte to its 6-bit value, or KInvalid. OR-ing the lookups of a
+// quantum and testing the high bit validates it without a separate pass.
+inline constexpr auto KDecodeTable = [] {
+    std::array<uint8_t, 256> table{};
+    for (auto& item : table) {
+        item = KInvalid;
+    }
+    for (uint8_t i = 0; i < 64; ++i) {
+        table[static_cast<uint8_t>(KEncodeTable[i])] = i;
+    }
+    return table;
+}();
+
+inline void encode_quantum(const uint8_t* input, char* output) noexcept {
+    const uint32_t value = (uint32_t(input[0]) << 16U) | (uint32_t(input[1]) << 8U) | uint32_t(input[2]);
+    output[0]            = KEncodeTable[(value >> 18U) & 0x3FU];
+    output[1]            = KEncodeTable[(value >> 12U) & 0x3FU];
+    output[2]            = KEncodeTable[(value >> 6U) & 0x3FU];
+    output[3]            = KEncodeTable[value & 0x3FU];
+}
+
+inline bool decode_quantum(const uint8_t* input, uint8_t* output) noexcept {
+    const uint8_t a = KDecodeTable[input[0]];
+    const uint8_t b = KDecodeTable[input[1]];
+    const uint8_t c = KDecodeTable[input[2]];
+    const uint8_t d = KDecodeTable[input[3]];
+    const uint32_t value = (uint32_t(a) << 18U) | (uint32_t(b) << 12U) | (uint32_t(c) << 6U) | uint32_t(d);
+    output[0]            = static_cast<uint8_t>(value >> 16U);
+    output[1]            = static_cast<uint8_t>(value >> 8U);
+    output[2]            = static_cast<uint8_t>(value);
+    return ((a | b | c | d) & 0x80U) == 0;
+}
+
+#if defined(__SSE4_1__)
+// Vector kernels follow W. Muła and D. Lemire, "Faster Base64 Encoding and
+// Decoding using AVX2 Instructions": bytes are regrouped into 6-bit indices
+// with one shuffle and two multiplies, and characters are classified by
+// nibble lookups, which doubles as validation.
+inline __m128i encode_indices(__m128i input) noexcept {
+    input = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(input, _mm_set1_epi32(0x0FC0FC00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(input, _mm_set1_epi32(0x003F03F0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+inline __m128i encode_characters(__m128i indices) noexcept {
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i result      = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less  = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result              = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+inline bool decode_values(__m128i input, __m128i& values) noexcept {
+    const __m128i shiftTable = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i maskTable  = _mm_setr_epi8(
+        static_cast<char>(0xA8), static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF8),
+        static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF8),
+        static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF0), 0x54, 0x50, 0x50, 0x50, 0x54);
+    const __m128i bitTable = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0,
+                                           0, 0, 0, 0, 0, 0);
+    const __m128i high     = _mm_and_si128(_mm_srli_epi32(input, 4), _mm_set1_epi8(0x0F));
+    const __m128i low      = _mm_and_si128(input, _mm_set1_epi8(0x0F));
+    const __m128i mask     = _mm_shuffle_epi8(maskTable, low);
+    const __m128i bit      = _mm_shuffle_epi8(bitTable, high);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(mask, bit), _mm_setzero_si128())) != 0) {
+        return false;
+    }
+    const __m128i slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+    const __m128i shift = _mm_blendv_epi8(_mm_shuffle_epi8(shiftTable, high), _mm_set1_epi8(16), slash);
+    values              = _mm_add_epi8(input, shift);
+    return true;
+}
+
+inline __m128i decode_pack(__m128i values) noexcept {
+    const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
 #endif
-    static inline uint8_t QueryTable(uint8_t ch) noexcept {
-        // search on table
-        return (uint8_t)(strchr(Table, ch) - Table);
+
+#if defined(__AVX2__)
+inline __m256i encode_indices(__m256i input) noexcept {
+    input = _mm256_shuffle_epi8(input, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, 10, 11, 9,
+                                                       10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(input, _mm256_set1_epi32(0x0FC0FC00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(input, _mm256_set1_epi32(0x003F03F0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+
+inline __m256i encode_characters(__m256i indices) noexcept {
+    const __m256i shift = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                      '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0));
+    __m256i result      = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less  = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result              = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+}
+
+inline bool decode_values(__m256i input, __m256i& values) noexcept {
+    const __m256i shiftTable =
+        _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+    const __m256i maskTable = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        static_cast<char>(0xA8), static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF8),
+        static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF8),
+        static_cast<char>(0xF8), static_cast<char>(0xF8), static_cast<char>(0xF0), 0x54, 0x50, 0x50, 0x50, 0x54));
+    const __m256i bitTable = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, static_cast<char>(0x80), 0, 0, 0, 0, 0, 0, 0, 0));
+    const __m256i high = _mm256_and_si256(_mm256_srli_epi32(input, 4), _mm256_set1_epi8(0x0F));
+    const __m256i low  = _mm256_and_si256(input, _mm256_set1_epi8(0x0F));
+    const __m256i mask = _mm256_shuffle_epi8(maskTable, low);
+    const __m256i bit  = _mm256_shuffle_epi8(bitTable, high);
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(mask, bit), _mm256_setzero_si256())) != 0) {
+        return false;
+    }
+    const __m256i slash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+    const __m256i shift = _mm256_blendv_epi8(_mm256_shuffle_epi8(shiftTable, high), _mm256_set1_epi8(16), slash);
+    values              = _mm256_add_epi8(input, shift);
+    return true;
+}
+
+inline __m256i decode_pack(__m256i values) noexcept {
+    const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    const __m256i lanes  = _mm256_shuffle_epi8(
+        packed, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                  14, 13, 12, -1, -1, -1, -1));
+    return _mm256_permutevar8x32_epi32(lanes, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+#endif
+} // namespace detail::base64
+
+struct Base64Covert {
+    static constexpr const char* Table = detail::base64::KEncodeTable;
+
+    /// Returns the 6-bit value of a base64 character, or 0xFF if it is not one.
+    static inline uint8_t QueryTable(uint8_t ch) noexcept { return detail::base64::KDecodeTable[ch]; }
+
+    static constexpr std::size_t EncodedSize(std::size_t datalen) noexcept { return ((datalen + 2) / 3) * 4; }
+
+    /// Size of the data encoded by `datalen` characters, ignoring up to two trailing '='.
+    static std::size_t DecodedSize(const uint8_t* data, std::size_t datalen) noexcept {
+        std::size_t padding = 0;
+        while (padding < 2 && padding < datalen && data[datalen - 1 - padding] == '=') {
+            ++padding;
+        }
+        return (datalen / 4) * 3 - std::min(padding, (datalen / 4) * 3);
     }
+
     static std::vector<char> Encode(const std::vector<char>& str) {
         // encode string to base64
         return Encode(str.data(), str.size());
     }
     static std::vector<char> Encode(const char* str) { return Encode(str, strlen(str)); }
     static std::vector<char> Encode(const char* str, std::size_t datalen) {
-        std::vector<uint8_t> buf;
-        Encode(reinterpret_cast<const uint8_t*>(str), datalen, buf);
-        return std::vector<char>((char*)(buf.data()), (char*)(buf.data()) + buf.size());
+        std::vector<char> buf(EncodedSize(datalen));
+        Encode(reinterpret_cast<const uint8_t*>(str), datalen, buf.data());
+        return buf;
     }
     static void Encode(const uint8_t* data, std::size_t datalen, std::vector<uint8_t>& buf) {
-        auto cptr  = data;
-        auto table = Table;
-        buf.resize(((datalen + 2) / 3) * 4, '=');
-        auto bufptr = buf.data();
+        buf.resize(EncodedSize(datalen));
+        Encode(data, datalen, reinterpret_cast<char*>(buf.data()));
+    }
+    /**
+     * @brief Encodes `datalen` bytes into `output`, which must hold `EncodedSize(datalen)` characters.
+     *
+     * @return the number of characters written
+     */
+    static std::size_t Encode(const uint8_t* data, std::size_t datalen, char* output) noexcept {
+        const auto* const begin = output;
+#if defined(__AVX2__)
+        // Each step reads 28 bytes (two 16-byte loads, 12 bytes apart) and consumes 24.
+        while (datalen >= 28) {
+            const __m256i input = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 12)), 1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                                detail::base64::encode_characters(detail::base64::encode_indices(input)));
+            data += 24;
+            datalen -= 24;
+            output += 32;
+        }
+#endif
+#if defined(__SSE4_1__)
+        // Each step reads 16 bytes and consumes 12.
+        while (datalen >= 16) {
+            const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                             detail::base64::encode_characters(detail::base64::encode_indices(input)));
+            data += 12;
+            datalen -= 12;
+            output += 16;
+        }
+#endif
         while (datalen > 2) {
-            // encode
-            // 3 chars to 4 base64 chars
-            // xxxxxx|xx xxxx|xxxx xx|xxxxxx
-            bufptr[0] = table[(cptr[0] >> 2) & 0x3f];                    // get highest 6 bits
-            bufptr[1] = table[((cptr[0] << 4) | (cptr[1] >> 4)) & 0x3f]; // get middle 6 bits
-            bufptr[2] = table[((cptr[1] << 2) | (cptr[2] >> 6)) & 0x3f];
-            bufptr[3] = table[cptr[2] & 0x3f];
-
-            // move raw data pointer to next 3 chars
-            cptr += 3;
-            bufptr += 4;
+            detail::base64::encode_quantum(data, output);
+            data += 3;
             datalen -= 3;
+            output += 4;
         }
-        switch (datalen) {
-        case 2: {
-            // only 2 chars
-            // xxxxxx|xx xxxx|xxxx 00|000000
-            bufptr[0] = table[(cptr[0] >> 2) & 0x3f];
-            bufptr[1] = table[((cptr[0] << 4) | (cptr[1] >> 4)) & 0x3f];
-            bufptr[2] = table[(cptr[1] & 0x0f) << 2];
-            bufptr += 4;
-            break;
-        }
-        case 1: {
-            // only 1 char
-            // xxxxxx|xx 0000|00 00|000000
-            bufptr[0] = table[(cptr[0] >> 2) & 0x3f];
-            bufptr[1] = table[(cptr[0] << 4) & 0x3f];
-            bufptr += 4;
-            break;
-        }
-        }
-        NEKO_ASSERT(bufptr == buf.data() + buf.size(), "BinarySerializer", "Bad Base64 String");
+        if (datalen != 0) {
+            // xxxxxx|xx xxxx|xxxx 00|000000 padded with '='
+            const uint8_t tail[3] = {data[0], datalen == 2 ? data[1] : uint8_t{0}, 0};
+            detail::base64::encode_quantum(tail, output);
+            output[3] = '=';
+            if (datalen == 1) {
+                output[2] = '=';
+            }
+            output += 4;
+        }
+        return static_cast<std::size_t>(output - begin);
     }
+
     static std::vector<char> Decode(const std::vector<char>& str) { return Decode(str.data(), str.size()); }
     static std::vector<char> Decode(const char* str) { return Decode(str, strlen(str)); }
     static std::vector<char> Decode(const char* str, std::size_t datalen) {
-        std::vector<uint8_t> buf;
-        Decode(reinterpret_cast<const uint8_t*>(str), datalen, buf);
-        return std::vector<char>((char*)(buf.data()), (char*)(buf.data()) + buf.size());
+        std::vector<char> buf;
+        const auto* data = reinterpret_cast<const uint8_t*>(str);
+        if ((datalen % 4) == 0) {
+            buf.resize(DecodedSize(data, datalen));
+            if (!Decode(data, datalen, reinterpret_cast<uint8_t*>(buf.data()))) {
+                buf.clear();
+            }
+        } else {
+            NEKO_LOG_ERROR("proto", "Bad Base64 String len({}), data({:.{}s})", datalen, str, datalen);
+        }
+        return buf;
     }
     static bool Decode(const uint8_t* data, std::size_t datalen, std::vector<uint8_t>& buf) {
         if ((datalen % 4) != 0) {
@@ -95,60 +272,76 @@ struct Base64Covert {
                            reinterpret_cast<const char*>(data), datalen);
             return false;
         }
-
-        if (datalen == 0) {
+        buf.resize(DecodedSize(data, datalen));
+        if (!Decode(data, datalen, buf.data())) {
             buf.clear();
-            return true;
+            return false;
         }
-
-        int len          = (int)(datalen / 4) * 3;
-        const auto* cptr = data;
-        while (data[datalen - 1] == '=') {
-            --datalen; // remove '='
-            --len;
-        }
-        buf.resize(len, '=');
-
-        uint8_t array[4];
-        auto* bufptr = buf.data();
-        while (datalen > 3) {
-            array[0]  = QueryTable(cptr[0]);
-            array[1]  = QueryTable(cptr[1]);
-            array[2]  = QueryTable(cptr[2]);
-            array[3]  = QueryTable(cptr[3]);
-            bufptr[0] = ((array[0] << 2) | (array[1] >> 4));
-            bufptr[1] = ((array[1] << 4) | (array[2] >> 2));
-            bufptr[2] = ((array[2] << 6) | array[3]);
-            cptr += 4;
-            bufptr += 3;
-            datalen -= 4;
-        }
-        NEKO_ASSERT(datalen != 1, "BinarySerializer", "Bad Base64 String");
-        switch (datalen) {
-        case 2: {
-            array[0]  = QueryTable(cptr[0]);
-            array[1]  = QueryTable(cptr[1]);
-            bufptr[0] = ((array[0] << 2) | (array[1] >> 4));
-            bufptr += 1;
-            break;
-        }
-        case 3: {
-            array[0]  = QueryTable(cptr[0]);
-            array[1]  = QueryTable(cptr[1]);
-            array[2]  = QueryTable(cptr[2]);
-            bufptr[0] = ((array[0] << 2) | (array[1] >> 4));
-            bufptr[1] = ((array[1] << 4) | (array[2] >> 2));
-            bufptr += 2;
-            break;
-        }
-        }
-        NEKO_ASSERT(bufptr == buf.data() + buf.size(), "BinarySerializer", "Bad Base64 String");
         return true;
     }
-};
-#if NEKO_CPP_PLUS < 17
-const char Base64Covert::Table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    /**
+     * @brief Decodes and validates `datalen` characters in one pass.
+     *
+     * `output` must hold `DecodedSize(data, datalen)` bytes. Fails on a length
+     * that is not a multiple of four, on characters outside the alphabet and
+     * on misplaced padding; `output` may be partially written in that case.
+     */
+    static bool Decode(const uint8_t* data, std::size_t datalen, uint8_t* output) noexcept {
+        if ((datalen % 4) != 0) {
+            return false;
+        }
+        if (datalen == 0) {
+            return true;
+        }
+        // The last quantum may carry padding and is always decoded by the scalar tail.
+        std::size_t body = datalen - 4;
+#if defined(__AVX2__)
+        while (body >= 32) {
+            __m256i values;
+            if (!detail::base64::decode_values(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), values)) {
+                return false;
+            }
+            const __m256i packed = detail::base64::decode_pack(values);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm256_castsi256_si128(packed));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 16), _mm256_extracti128_si256(packed, 1));
+            data += 32;
+            body -= 32;
+            output += 24;
+        }
 #endif
+#if defined(__SSE4_1__)
+        while (body >= 16) {
+            __m128i values;
+            if (!detail::base64::decode_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), values)) {
+                return false;
+            }
+            const __m128i packed = detail::base64::decode_pack(values);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output), packed);
+            const auto last = static_cast<uint32_t>(_mm_extract_epi32(packed, 2));
+            std::memcpy(output + 8, &last, sizeof(last));
+            data += 16;
+            body -= 16;
+            output += 12;
+        }
+#endif
+        uint8_t invalid = 0;
+        while (body != 0) {
+            invalid |= static_cast<uint8_t>(!detail::base64::decode_quantum(data, output));
+            data += 4;
+            body -= 4;
+            output += 3;
+        }
+        const std::size_t padding = data[3] != '=' ? 0 : (data[2] != '=' ? 1 : 2);
+        uint8_t tail[4]           = {data[0], data[1], data[2], data[3]};
+        for (std::size_t i = 0; i < padding; ++i) {
+            tail[3 - i] = 'A';
+        }
+        uint8_t decoded[3];
+        invalid |= static_cast<uint8_t>(!detail::base64::decode_quantum(tail, decoded));
+        std::memcpy(output, decoded, 3 - padding);
+        return invalid == 0;
+    }
+};
 /// ===================end base 64=========================
 
 template <class T>
@@ -162,8 +355,9 @@ public:
     Type* data;
     std::size_t size;
 
-    // for InputSerializer, please ensure that the remaining valid space of the data block is greater than or equal to
-    // the length of the obtained data, and the size value is not used in the obtained data.
+    // for InputSerializer, a non-zero size is the capacity of the data block and longer data fails the read, a zero
+    // size leaves the capacity to the caller. The block is only written when the whole input is valid, and size is
+    // set to the decoded length.
     // for OutputSerializer, while write data of size to JSON
     BinaryData(Type* data, std::size_t size) : data(data), size(size) {}
     BinaryData(Type* data) : data(data), size(0) {}
@@ -175,10 +369,9 @@ template <typename W, typename T>
 struct WriteParser<W, BinaryData<T>, void> {
     template <typename ParentType, typename Tags>
     static ParserResult write(W& writer, const BinaryData<T>& value, const ParentType& parent, const Tags& tags) {
-        std::vector<uint8_t> buf;
-        Base64Covert::Encode(reinterpret_cast<const uint8_t*>(value.data), value.size, buf);
-        return parser_write<W>(writer, std::string_view{reinterpret_cast<const char*>(buf.data()), buf.size()}, parent,
-                               tags);
+        std::string buf(Base64Covert::EncodedSize(value.size), '\0');
+        Base64Covert::Encode(reinterpret_cast<const uint8_t*>(value.data), value.size, buf.data());
+        return parser_write<W>(writer, std::string_view{buf}, parent, tags);
     }
 };
 
@@ -191,12 +384,25 @@ struct ReadParser<R, BinaryData<T>, void> {
         if (!result) {
             return parser_context(std::move(result), "Failed to parse encoded binary data: ");
         }
-        std::vector<uint8_t> buf;
-        auto ret = Base64Covert::Decode(reinterpret_cast<const uint8_t*>(sv.data()), sv.size(), buf);
-        if (!ret) {
+        const auto* data = reinterpret_cast<const uint8_t*>(sv.data());
+        if ((sv.size() % 4) != 0) {
             return parser_error(sa::ErrorCode::ParseError, "Invalid base64 data");
         }
-        std::memcpy(value.data, buf.data(), buf.size());
+        const auto decodedSize = Base64Covert::DecodedSize(data, sv.size());
+        if (value.size != 0 && decodedSize > value.size) {
+            return parser_error(sa::ErrorCode::InvalidLength, "Binary data of " + std::to_string(decodedSize) +
+                                                                  " bytes does not fit in " +
+                                                                  std::to_string(value.size) + " bytes");
+        }
+        // Decode aside so invalid input never leaves a partially written block behind.
+        std::vector<uint8_t> decoded(decodedSize);
+        if (!Base64Covert::Decode(data, sv.size(), decoded.data())) {
+            return parser_error(sa::ErrorCode::ParseError, "Invalid base64 data");
+        }
+        if (decodedSize != 0) {
+            std::memcpy(value.data, decoded.data(), decodedSize);
+        }
+        value.size = decodedSize;
         return sa::success();
     }
 };
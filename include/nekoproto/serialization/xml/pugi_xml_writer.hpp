@@ -5,17 +5,16 @@
 
 #if defined(NEKO_PROTO_ENABLE_PUGIXML)
 
-#include <pugixml.hpp>
-
+#include <algorithm>
 #include <charconv>
 #include <cmath>
 #include <cstddef>
-#include <iomanip>
+#include <cstring>
 #include <limits>
-#include <sstream>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <vector>
 
 NEKO_BEGIN_NAMESPACE
 namespace xml {
@@ -27,204 +26,435 @@ inline constexpr std::string_view NullMarker     = "nil";
 inline constexpr std::string_view XmlContent     = "xml_content";
 inline constexpr std::string_view ArrayItem      = "item";
 
-class Writer {
+/**
+ * @brief Streaming XML writer.
+ *
+ * Markup is appended to the output buffer as the parser visits the value, no
+ * document tree is built. The parser layer never announces the end of an
+ * object or array, so elements are closed implicitly: writing into an element
+ * closes every element opened below it, and `finish()` closes the rest. An
+ * array that received no item is written as its `neko-array="empty"`
+ * placeholder once something else is written to its parent. Attributes that
+ * arrive after an element already has content are inserted into its start tag.
+ *
+ * `BufferT` is a contiguous character container such as `std::string` or
+ * `std::vector<char>`.
+ */
+template <typename BufferT>
+class BasicWriter {
 public:
     struct OutputArrayType {
-        std::string name;
-        pugi::xml_node parent;
-        pugi::xml_node placeholder;
+        std::size_t depth;
+        std::size_t id;
     };
 
     struct OutputObjectType {
-        pugi::xml_node node;
+        std::size_t depth;
     };
 
     struct OutputValueType {
-        pugi::xml_node node;
+        std::size_t depth;
     };
 
     using OutputVarType = OutputValueType;
 
-    explicit Writer(std::string rootName = "root") : mRootName(std::move(rootName)) { reset(mRootName); }
+    explicit BasicWriter(BufferT& output, std::string rootName = "root", std::string indent = "    ")
+        : mOutput(&output), mRootName(std::move(rootName)), mIndent(std::move(indent)) {}
 
+    /// Starts a new document at the end of the output buffer.
     void reset(std::string rootName) {
-        mDocument.reset();
-        mRootName                                = std::move(rootName);
-        auto declaration                         = mDocument.append_child(pugi::node_declaration);
-        declaration.append_attribute("version")  = "1.0";
-        declaration.append_attribute("encoding") = "UTF-8";
+        mRootName = std::move(rootName);
+        mDepth    = 0;
+        _append(R"(<?xml version="1.0" encoding="UTF-8"?>)");
+        _append("\n");
+    }
+
+    /// Closes every open element. The document is complete afterwards.
+    void finish() {
+        while (mDepth != 0) {
+            _closeTop();
+        }
     }
 
     OutputArrayType arrayAsRoot(std::size_t /*size*/) {
-        auto root                                 = _appendElement(mDocument, mRootName);
-        root.append_attribute(ArrayMarker.data()) = ArrayContainer.data();
-        auto placeholder                          = _appendEmptyArray(root, ArrayItem);
-        return {std::string{ArrayItem}, root, placeholder};
+        const auto root = _openElement(mRootName);
+        _appendAttribute(root, ArrayMarker, ArrayContainer);
+        return _beginArray(root, ArrayItem);
     }
 
-    OutputObjectType objectAsRoot(std::size_t /*size*/) { return {_appendElement(mDocument, mRootName)}; }
+    OutputObjectType objectAsRoot(std::size_t /*size*/) { return {_openElement(mRootName)}; }
 
     OutputValueType nullAsRoot() {
-        auto root = _appendElement(mDocument, mRootName);
-        _markNull(root);
+        const auto root = _openElement(mRootName);
+        _appendAttribute(root, NullMarker, "true");
         return {root};
     }
 
     template <typename T>
     OutputValueType valueAsRoot(const T& value) {
-        auto root = _appendElement(mDocument, mRootName);
-        _setText(root, _toString(value));
+        const auto root = _openElement(mRootName);
+        _appendText(root, value);
         return {root};
     }
 
-    static OutputArrayType addArrayToArray(std::size_t /*size*/, OutputArrayType* parent) {
-        _removePlaceholder(parent);
-        auto container                                 = _appendElement(parent->parent, parent->name);
-        container.append_attribute(ArrayMarker.data()) = ArrayContainer.data();
-        auto placeholder                               = _appendEmptyArray(container, ArrayItem);
-        return {std::string{ArrayItem}, container, placeholder};
+    OutputArrayType addArrayToArray(std::size_t /*size*/, OutputArrayType* parent) {
+        const auto depth     = _beginItem(*parent);
+        const auto container = _openChild(depth, mStack[depth].arrayName);
+        _appendAttribute(container, ArrayMarker, ArrayContainer);
+        return _beginArray(container, ArrayItem);
     }
 
-    static OutputArrayType addArrayToObject(std::string_view name, std::size_t /*size*/, OutputObjectType* parent) {
-        auto placeholder = _appendEmptyArray(parent->node, name);
-        return {std::string{name}, parent->node, placeholder};
+    OutputArrayType addArrayToObject(std::string_view name, std::size_t /*size*/, OutputObjectType* parent) {
+        _settle(parent->depth);
+        return _beginArray(parent->depth, name);
     }
 
-    static OutputObjectType addObjectToArray(std::size_t /*size*/, OutputArrayType* parent) {
-        _removePlaceholder(parent);
-        return {_appendElement(parent->parent, parent->name)};
+    OutputObjectType addObjectToArray(std::size_t /*size*/, OutputArrayType* parent) {
+        const auto depth = _beginItem(*parent);
+        return {_openChild(depth, mStack[depth].arrayName)};
     }
 
-    static OutputObjectType addObjectToObject(std::string_view name, std::size_t /*size*/, OutputObjectType* parent) {
-        return {_appendElement(parent->node, name)};
+    OutputObjectType addObjectToObject(std::string_view name, std::size_t /*size*/, OutputObjectType* parent) {
+        _settle(parent->depth);
+        return {_openChild(parent->depth, name)};
     }
 
     template <typename T>
-    static OutputValueType addValueToArray(const T& value, OutputArrayType* parent) {
-        _removePlaceholder(parent);
-        auto node = _appendElement(parent->parent, parent->name);
-        _setText(node, _toString(value));
-        return {node};
+    OutputValueType addValueToArray(const T& value, OutputArrayType* parent) {
+        const auto depth = _beginItem(*parent);
+        _appendValueElement(depth, mStack[depth].arrayName, value);
+        return {depth};
     }
 
     template <typename T>
-    static OutputValueType addValueToObject(std::string_view name, const T& value, OutputObjectType* parent,
-                                            bool isAttribute = false) {
-        const auto text = _toString(value);
+    OutputValueType addValueToObject(std::string_view name, const T& value, OutputObjectType* parent,
+                                     bool isAttribute = false) {
         if (isAttribute) {
-            const auto ownedName = std::string{name};
-            parent->node.append_attribute(ownedName.c_str()).set_value(text.c_str());
-            return {parent->node};
+            _closeDeeper(parent->depth);
+            _appendAttribute(parent->depth, name, value);
+            return {parent->depth};
         }
+        _settle(parent->depth);
         if (name == XmlContent) {
-            _setText(parent->node, text);
-            return {parent->node};
+            _appendText(parent->depth, value);
+            return {parent->depth};
         }
-        auto node = _appendElement(parent->node, name);
-        _setText(node, text);
-        return {node};
+        _appendValueElement(parent->depth, name, value);
+        return {parent->depth};
     }
 
-    static OutputValueType addNullToArray(OutputArrayType* parent) {
-        _removePlaceholder(parent);
-        auto node = _appendElement(parent->parent, parent->name);
-        _markNull(node);
-        return {node};
+    OutputValueType addNullToArray(OutputArrayType* parent) {
+        const auto depth = _beginItem(*parent);
+        _appendNullElement(depth, mStack[depth].arrayName);
+        return {depth};
     }
 
-    static OutputValueType addNullToObject(std::string_view name, OutputObjectType* parent, bool isAttribute = false) {
+    OutputValueType addNullToObject(std::string_view name, OutputObjectType* parent, bool isAttribute = false) {
         if (isAttribute) {
-            const auto ownedName = std::string{name};
-            parent->node.append_attribute(ownedName.c_str()).set_value("null");
-            return {parent->node};
+            _closeDeeper(parent->depth);
+            _appendAttribute(parent->depth, name, std::string_view{"null"});
+            return {parent->depth};
         }
-        if (name == XmlContent) {
-            return {parent->node};
+        _settle(parent->depth);
+        if (name != XmlContent) {
+            _appendNullElement(parent->depth, name);
         }
-        auto node = _appendElement(parent->node, name);
-        _markNull(node);
-        return {node};
+        return {parent->depth};
+    }
+
+    void addCommentToArray(std::string_view comment, OutputArrayType* parent) {
+        // Comments around array items belong to the array, so an empty array stays pending.
+        _closeDeeper(parent->depth);
+        _appendComment(parent->depth, comment);
     }
 
-    static void addCommentToArray(std::string_view comment, OutputArrayType* parent) {
-        _appendComment(parent->parent, comment);
+    void addCommentToObject(std::string_view comment, OutputObjectType* parent) {
+        _settle(parent->depth);
+        _appendComment(parent->depth, comment);
     }
 
-    static void addCommentToObject(std::string_view comment, OutputObjectType* parent) {
-        _appendComment(parent->node, comment);
+    void endArray(OutputArrayType* /*unused*/) noexcept {}
+    void endObject(OutputObjectType* /*unused*/) noexcept {}
+
+private:
+    struct Element {
+        std::size_t nameOffset = 0;
+        std::size_t nameSize   = 0;
+        std::size_t attributeEnd = 0;
+        bool startTagOpen        = true;
+        bool hasChildren         = false;
+        bool hasText             = false;
+        std::size_t arrayId      = 0;
+        bool arrayEmpty          = false;
+        std::string arrayName;
+    };
+
+    Element& _push() {
+        if (mDepth == mStack.size()) {
+            mStack.emplace_back();
+        }
+        auto& element = mStack[mDepth++];
+        element.startTagOpen = true;
+        element.hasChildren  = false;
+        element.hasText      = false;
+        element.arrayId      = 0;
+        element.arrayEmpty   = false;
+        return element;
     }
 
-    static void endArray(OutputArrayType* /*array*/) noexcept {}
-    static void endObject(OutputObjectType* /*object*/) noexcept {}
+    std::size_t _openElement(std::string_view name) {
+        // `name` may refer to an array name held by the stack, so write it before growing the stack.
+        _append("<");
+        const auto nameOffset = mOutput->size();
+        _append(name);
+        auto& element        = _push();
+        element.nameOffset   = nameOffset;
+        element.nameSize     = name.size();
+        element.attributeEnd = mOutput->size();
+        return mDepth - 1;
+    }
 
-    std::string str(std::string_view indent = "    ") const {
-        std::ostringstream stream;
-        const auto indentation = std::string{indent};
-        mDocument.save(stream, indentation.c_str(), pugi::format_default, pugi::encoding_utf8);
-        return stream.str();
+    std::size_t _openChild(std::size_t depth, std::string_view name) {
+        _beginChild(depth);
+        return _openElement(name);
     }
 
-private:
-    static pugi::xml_node _appendElement(pugi::xml_node parent, std::string_view name) {
-        const auto ownedName = std::string{name};
-        return parent.append_child(ownedName.c_str());
+    OutputArrayType _beginArray(std::size_t depth, std::string_view name) {
+        auto& element      = mStack[depth];
+        element.arrayId    = ++mArrayCounter;
+        element.arrayEmpty = true;
+        element.arrayName.assign(name.data(), name.size());
+        return {depth, element.arrayId};
+    }
+
+    std::size_t _beginItem(const OutputArrayType& array) {
+        _closeDeeper(array.depth);
+        auto& element = mStack[array.depth];
+        if (element.arrayId == array.id) {
+            element.arrayEmpty = false;
+        }
+        return array.depth;
+    }
+
+    /// Finishes everything written below `depth`, including a pending empty array.
+    void _settle(std::size_t depth) {
+        _closeDeeper(depth);
+        auto& element = mStack[depth];
+        if (element.arrayId != 0) {
+            const bool empty   = element.arrayEmpty;
+            element.arrayId    = 0;
+            element.arrayEmpty = false;
+            if (empty) {
+                _beginChild(depth);
+                _append("<");
+                _append(element.arrayName);
+                _append(" ");
+                _append(ArrayMarker);
+                _append(R"(=")");
+                _append(ArrayEmpty);
+                _append(R"(" />)");
+            }
+        }
+    }
+
+    void _closeDeeper(std::size_t depth) {
+        while (mDepth > depth + 1) {
+            _closeTop();
+        }
+    }
+
+    void _closeTop() {
+        const auto depth = mDepth - 1;
+        _settle(depth);
+        auto& element = mStack[depth];
+        if (element.startTagOpen) {
+            _append(" />");
+        } else {
+            if (element.hasChildren && !element.hasText) {
+                _appendNewline(depth);
+            }
+            _append("</");
+            _appendFromOutput(element.nameOffset, element.nameSize);
+            _append(">");
+        }
+        --mDepth;
+        if (mDepth == 0) {
+            _append("\n");
+        }
+    }
+
+    void _closeStartTag(Element& element) {
+        if (element.startTagOpen) {
+            _append(">");
+            element.startTagOpen = false;
+        }
+    }
+
+    void _beginChild(std::size_t depth) {
+        auto& element = mStack[depth];
+        _closeStartTag(element);
+        if (!element.hasText) {
+            _appendNewline(depth + 1);
+        }
+        element.hasChildren = true;
+    }
+
+    template <typename T>
+    void _appendValueElement(std::size_t depth, std::string_view name, const T& value) {
+        _beginChild(depth);
+        _append("<");
+        _append(name);
+        _append(">");
+        _appendValue(value, false);
+        _append("</");
+        _append(name);
+        _append(">");
+    }
+
+    void _appendNullElement(std::size_t depth, std::string_view name) {
+        _beginChild(depth);
+        _append("<");
+        _append(name);
+        _append(" ");
+        _append(NullMarker);
+        _append(R"(="true" />)");
+    }
+
+    template <typename T>
+    void _appendText(std::size_t depth, const T& value) {
+        auto& element = mStack[depth];
+        _closeStartTag(element);
+        element.hasText = true;
+        _appendValue(value, false);
     }
 
-    static pugi::xml_node _appendEmptyArray(pugi::xml_node parent, std::string_view name) {
-        auto node                                 = _appendElement(parent, name);
-        node.append_attribute(ArrayMarker.data()) = ArrayEmpty.data();
-        return node;
+    template <typename T>
+    void _appendAttribute(std::size_t depth, std::string_view name, const T& value) {
+        auto& element = mStack[depth];
+        if (element.startTagOpen) {
+            _append(" ");
+            _append(name);
+            _append(R"(=")");
+            _appendValue(value, true);
+            _append(R"(")");
+            element.attributeEnd = mOutput->size();
+            return;
+        }
+        // The start tag is already closed: render the attribute at the end
+        // of the output and rotate it into place.
+        const auto begin = mOutput->size();
+        _append(" ");
+        _append(name);
+        _append(R"(=")");
+        _appendValue(value, true);
+        _append(R"(")");
+        std::rotate(mOutput->begin() + static_cast<std::ptrdiff_t>(element.attributeEnd),
+                    mOutput->begin() + static_cast<std::ptrdiff_t>(begin), mOutput->end());
+        element.attributeEnd += mOutput->size() - begin;
     }
 
-    static void _removePlaceholder(OutputArrayType* parent) {
-        if (parent->placeholder != nullptr) {
-            parent->parent.remove_child(parent->placeholder);
-            parent->placeholder = {};
+    void _appendComment(std::size_t depth, std::string_view comment) {
+        _beginChild(depth);
+        _append("<!--");
+        _append(comment);
+        _append("-->");
+    }
+
+    void _appendNewline(std::size_t depth) {
+        _append("\n");
+        for (std::size_t i = 0; i < depth; ++i) {
+            _append(mIndent);
         }
     }
 
-    static void _markNull(pugi::xml_node node) { node.append_attribute(NullMarker.data()) = "true"; }
+    void _append(std::string_view text) { mOutput->insert(mOutput->end(), text.begin(), text.end()); }
 
-    static void _setText(pugi::xml_node node, const std::string& value) { node.text().set(value.c_str()); }
+    void _appendFromOutput(std::size_t offset, std::size_t size) {
+        const auto end = mOutput->size();
+        mOutput->resize(end + size);
+        std::memcpy(mOutput->data() + end, mOutput->data() + offset, size);
+    }
 
-    static void _appendComment(pugi::xml_node parent, std::string_view comment) {
-        const auto ownedComment = std::string{comment};
-        parent.append_child(pugi::node_comment).set_value(ownedComment.c_str());
+    void _appendEscaped(std::string_view text, bool attribute) {
+        std::size_t run = 0;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            const auto ch = static_cast<unsigned char>(text[i]);
+            std::string_view replacement;
+            switch (ch) {
+            case '&':
+                replacement = "&amp;";
+                break;
+            case '<':
+                replacement = "&lt;";
+                break;
+            case '>':
+                replacement = "&gt;";
+                break;
+            case '"':
+                replacement = attribute ? std::string_view{"&quot;"} : std::string_view{};
+                break;
+            default:
+                break;
+            }
+            const bool control = ch < 0x20U && ch != '\t' && (attribute || (ch != '\n' && ch != '\r'));
+            if (replacement.empty() && !control) {
+                continue;
+            }
+            _append(text.substr(run, i - run));
+            run = i + 1;
+            if (control) {
+                char buffer[8] = "&#";
+                const auto [end, error] = std::to_chars(buffer + 2, buffer + sizeof(buffer) - 1, ch);
+                *end                    = ';';
+                _append(std::string_view{buffer, static_cast<std::size_t>(end + 1 - buffer)});
+            } else {
+                _append(replacement);
+            }
+        }
+        _append(text.substr(run));
     }
 
     template <typename T>
-    static std::string _toString(const T& value) {
+    void _appendValue(const T& value, bool attribute) {
         using U = std::remove_cvref_t<T>;
-        if constexpr (std::is_same_v<U, std::string>) {
-            return value;
-        } else if constexpr (std::is_same_v<U, std::string_view>) {
-            return std::string{value};
+        if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>) {
+            _appendEscaped(value, attribute);
+        } else if constexpr (std::is_convertible_v<const U&, std::string_view>) {
+            _appendEscaped(std::string_view{value}, attribute);
         } else if constexpr (std::is_same_v<U, bool>) {
-            return value ? "true" : "false";
+            _append(value ? "true" : "false");
         } else if constexpr (std::is_integral_v<U>) {
-            char buffer[128];
+            char buffer[64];
             const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
             if (error == std::errc{}) {
-                return {buffer, end};
+                _append(std::string_view{buffer, static_cast<std::size_t>(end - buffer)});
             }
-            return {};
         } else if constexpr (std::is_floating_point_v<U>) {
             if (!std::isfinite(value)) {
-                return {};
+                return;
+            }
+            char buffer[64];
+            const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general,
+                                                    std::numeric_limits<U>::max_digits10);
+            if (error == std::errc{}) {
+                _append(std::string_view{buffer, static_cast<std::size_t>(end - buffer)});
             }
-            std::ostringstream stream;
-            stream << std::setprecision(std::numeric_limits<U>::max_digits10) << value;
-            return stream.str();
         } else {
             static_assert(std::is_same_v<U, void>, "Unsupported XML basic type");
         }
     }
 
 private:
-    pugi::xml_document mDocument;
+    BufferT* mOutput;
     std::string mRootName;
+    std::string mIndent;
+    std::vector<Element> mStack;
+    std::size_t mDepth        = 0;
+    std::size_t mArrayCounter = 0;
 };
 
+using Writer = BasicWriter<std::string>;
+
 } // namespace xml
 NEKO_END_NAMESPACE
 
@@ -25,6 +25,7 @@
 #include <cctype>
 #include <istream>
 #include <iterator>
+#include <span>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -77,35 +78,89 @@ struct PugiXmlBackend {
     using DefaultOutputBuffer = std::vector<char>;
     using DefaultInputSource  = void;
 
+    /// Parse flags for caller-owned buffers: entities and CDATA only, no end-of-line or attribute normalization.
+    static constexpr unsigned int KInplaceParseOptions = pugi::parse_cdata | pugi::parse_escapes;
+
+    /**
+     * @brief Streams the document into the output buffer.
+     *
+     * Contiguous character buffers are written in place; other outputs such as
+     * streams receive the document from a scratch string once it is complete.
+     */
     template <typename BufferT>
     struct OutputState {
-        explicit OutputState(BufferT& outputBuffer) noexcept : buffer(outputBuffer) {}
+        static constexpr bool KDirect = detail::resizable_char_buffer<BufferT>;
+        using TargetType              = std::conditional_t<KDirect, BufferT, std::string>;
+        using WriterType              = xml::BasicWriter<TargetType>;
+
+        explicit OutputState(BufferT& outputBuffer) noexcept
+            : buffer(outputBuffer), writer(_target(outputBuffer, scratch)) {}
 
         OutputState(BufferT& outputBuffer, std::string rootName, std::string indent = "    ") noexcept
-            : buffer(outputBuffer), configuredRootName(std::move(rootName)), indentation(std::move(indent)) {}
+            : buffer(outputBuffer), writer(_target(outputBuffer, scratch), {}, std::move(indent)),
+              configuredRootName(std::move(rootName)) {}
+
+        TargetType& target() noexcept { return _target(buffer, scratch); }
 
         BufferT& buffer;
-        xml::Writer writer;
+        std::string scratch;
+        WriterType writer;
         std::string configuredRootName;
-        std::string indentation = "    ";
-        bool hasRoot            = false;
-        bool flushed            = false;
+        std::size_t documentStart = 0;
+        bool hasRoot              = false;
+        bool flushed              = false;
+
+    private:
+        static TargetType& _target(BufferT& outputBuffer, std::string& scratchBuffer) noexcept {
+            if constexpr (KDirect) {
+                return outputBuffer;
+            } else {
+                return scratchBuffer;
+            }
+        }
     };
 
     template <typename SourceT>
     struct InputState {
         explicit InputState(const char* buffer, std::size_t size) noexcept { parse(buffer, size); }
 
-        explicit InputState(std::istream& stream) noexcept {
-            const std::string input{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
-            parse(input.data(), input.size());
+        /**
+         * @brief Parses a caller-owned buffer in place.
+         *
+         * pugixml decodes entities inside @p buffer and node names and values
+         * point into it, so strings read as views stay valid as long as the
+         * buffer does. The buffer must outlive the deserializer.
+         */
+        explicit InputState(std::span<char> buffer) noexcept {
+            parseInplace(buffer.data(), buffer.size(), KInplaceParseOptions);
+        }
+
+        explicit InputState(std::istream& stream) noexcept
+            : input(std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}) {
+            parseInplace(input.data(), input.size(), pugi::parse_default);
         }
 
         void parse(const char* buffer, std::size_t size) noexcept {
             while (size > 0 && buffer[size - 1] == '\0') {
                 --size;
             }
-            const auto parseResult = document.load_buffer(buffer, size, pugi::parse_default, pugi::encoding_utf8);
+            _setResult(document.load_buffer(buffer, size, pugi::parse_default, pugi::encoding_utf8));
+        }
+
+        void parseInplace(char* buffer, std::size_t size, unsigned int options) noexcept {
+            while (size > 0 && buffer[size - 1] == '\0') {
+                --size;
+            }
+            _setResult(document.load_buffer_inplace(buffer, size, options, pugi::encoding_utf8));
+        }
+
+        std::string input;
+        pugi::xml_document document;
+        pugi::xml_node root;
+        sa::Result<void> result;
+
+    private:
+        void _setResult(const pugi::xml_parse_result& parseResult) noexcept {
             if (!parseResult) {
                 result = sa::error(sa::ErrorCode::ParseError, "pugixml parse error at offset " +
                                                                   std::to_string(parseResult.offset) + ": " +
@@ -117,10 +172,6 @@ struct PugiXmlBackend {
                 result = sa::error(sa::ErrorCode::ParseError, "XML document has no root element");
             }
         }
-
-        pugi::xml_document document;
-        pugi::xml_node root;
-        sa::Result<void> result;
     };
 
     template <typename BufferT, typename T>
@@ -131,9 +182,22 @@ struct PugiXmlBackend {
             state.hasRoot = false;
             return sa::error(sa::ErrorCode::InvalidField, "Invalid XML root name '" + rootName + "'");
         }
+        using WriterType = typename OutputState<BufferT>::WriterType;
+        auto& target     = state.target();
+        if (state.hasRoot && !state.flushed) {
+            target.resize(state.documentStart);
+        }
+        state.documentStart = target.size();
         state.writer.reset(rootName);
-        auto result   = parser_write<xml::Writer>(state.writer, value, parsing::Parent<xml::Writer>::Root{});
-        state.hasRoot = static_cast<bool>(result);
+        auto result = parser_write<WriterType>(state.writer, value, typename parsing::Parent<WriterType>::Root{});
+        if (!result) {
+            // Drop the partial document so a failed write leaves the output untouched.
+            target.resize(state.documentStart);
+            state.hasRoot = false;
+            return result;
+        }
+        state.writer.finish();
+        state.hasRoot = true;
         state.flushed = false;
         return result;
     }
@@ -144,8 +208,10 @@ struct PugiXmlBackend {
             return result;
         }
         if (!state.flushed) {
-            const auto output = state.writer.str(state.indentation);
-            detail::append_xml(state.buffer, output);
+            if constexpr (!OutputState<BufferT>::KDirect) {
+                detail::append_xml(state.buffer, state.scratch);
+                state.scratch.clear();
+            }
             state.flushed = true;
         }
         return result;
@@ -191,6 +257,7 @@ public:
 };
 
 PugiXmlInputSerializer(const char*, std::size_t) -> PugiXmlInputSerializer<>;
+PugiXmlInputSerializer(std::span<char>) -> PugiXmlInputSerializer<>;
 PugiXmlInputSerializer(std::istream&) -> PugiXmlInputSerializer<>;
 
 struct PugiXmlSerializer {
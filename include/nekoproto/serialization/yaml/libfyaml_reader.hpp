@@ -11,75 +11,371 @@
 #include <cerrno>
 #include <charconv>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 NEKO_BEGIN_NAMESPACE
+namespace detail {
+inline std::string first_yaml_diag_message(fy_diag* diag) {
+    if (diag == nullptr) {
+        return "libfyaml parse error";
+    }
+    void* iter = nullptr;
+    if (auto* error = fy_diag_errors_iterate(diag, &iter); error != nullptr && error->msg != nullptr) {
+        std::string message = error->msg;
+        if (error->line > 0 && error->column > 0) {
+            message += " at line " + std::to_string(error->line) + ", column " + std::to_string(error->column);
+        }
+        return message;
+    }
+    return "libfyaml parse error";
+}
+} // namespace detail
+
 namespace yaml {
 
-class Reader {
+/**
+ * @brief Parsed YAML document indexed from the libfyaml event stream.
+ *
+ * The parser's events are consumed one at a time into a flat node table,
+ * without building an `fy_document`. Scalar text is copied once into a single
+ * arena and the children of every collection are stored contiguously, so
+ * lookups by index and by key stay cheap. Aliases resolve to the node that
+ * carries their anchor, and merge keys (`<<: *base` or `<<: [*a, *b]`) are
+ * expanded when their mapping closes: explicit keys win over merged ones,
+ * and earlier sources over later ones. Only the first document of the
+ * stream is read.
+ *
+ * The whole document stays addressable until the read ends, because the
+ * reader looks fields up by name and elements by index and variants retry a
+ * value with each alternative. Aliases share the node they refer to, so only
+ * merge keys copy entries. The load fails once nesting exceeds KMaxDepth,
+ * the table exceeds KMaxNodes, or merge keys have copied more than
+ * KMaxMergedEntries entries, so `<<: *a` chains cannot grow it quadratically.
+ */
+class Document {
 public:
-    struct InputArrayType {
-        fy_node* node = nullptr;
+    enum class Kind : std::uint8_t {
+        Null,
+        Scalar,
+        Sequence,
+        Mapping,
     };
 
-    struct InputObjectType {
-        fy_node* node = nullptr;
+    static constexpr std::size_t KMaxDepth         = 512;
+    static constexpr std::size_t KMaxNodes         = 4U * 1024U * 1024U;
+    static constexpr std::size_t KMaxMergedEntries = 1024U * 1024U;
+
+    struct Node {
+        Kind kind = Kind::Null;
+        /// Scalar text range in the arena, or the children range of a collection.
+        std::uint32_t offset = 0;
+        std::uint32_t size   = 0;
+        /// A plain `<<` scalar, which as a mapping key merges other mappings in.
+        bool merge = false;
     };
 
-    using InputValueType = fy_node*;
+    sa::Result<void> parse(const fy_parse_cfg* cfg, const char* data, std::size_t size) {
+        mNodes.clear();
+        mChildren.clear();
+        mText.clear();
+        mAnchors.clear();
+        mDepth  = 0;
+        mMerged = 0;
 
-    static std::size_t arraySize(const InputArrayType& array) noexcept {
-        const int count = fy_node_sequence_item_count(array.node);
-        return count < 0 ? 0U : static_cast<std::size_t>(count);
+        auto* parser = fy_parser_create(cfg);
+        if (parser == nullptr) {
+            return sa::error(sa::ErrorCode::Unknown, "Could not create YAML parser");
+        }
+        sa::Result<void> result;
+        if (fy_parser_set_string(parser, data, size) != 0) {
+            result = sa::error(sa::ErrorCode::ParseError, "Could not set YAML parser input");
+        }
+        bool done = !result;
+        while (!done) {
+            auto* event = fy_parser_parse(parser);
+            if (event == nullptr) {
+                break;
+            }
+            result = _consume(event, done);
+            fy_parser_event_free(parser, event);
+            done = done || !result;
+        }
+        if (result && fy_parser_get_stream_error(parser)) {
+            result = sa::error(sa::ErrorCode::ParseError, detail::first_yaml_diag_message(cfg->diag));
+        }
+        if (result && mNodes.empty()) {
+            result = sa::error(sa::ErrorCode::ParseError, "YAML document has no root node");
+        }
+        fy_parser_destroy(parser);
+        return result;
     }
 
-    static InputValueType arrayElement(const InputArrayType& array, std::size_t index) noexcept {
-        if (index > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
-            return nullptr;
+    const Node& node(std::uint32_t index) const noexcept { return mNodes[index]; }
+
+    std::uint32_t child(const Node& node, std::size_t index) const noexcept {
+        return mChildren[node.offset + index];
+    }
+
+    std::string_view text(const Node& node) const noexcept { return {mText.data() + node.offset, node.size}; }
+
+private:
+    struct OpenCollection {
+        std::uint32_t node;
+        std::size_t children;
+    };
+
+    sa::Result<void> _consume(fy_event* event, bool& done) {
+        switch (event->type) {
+        case FYET_SCALAR: {
+            if (mNodes.size() >= KMaxNodes) {
+                return _tooLarge();
+            }
+            std::size_t size = 0;
+            const char* text = fy_token_get_text(event->scalar.value, &size);
+            if (text == nullptr) {
+                text = "";
+                size = 0;
+            }
+            const std::string_view value{text, size};
+            const bool plain = fy_token_scalar_style(event->scalar.value) == FYSS_PLAIN;
+            const auto kind  = plain && _isNull(value) ? Kind::Null : Kind::Scalar;
+            const auto index = _addNode(kind, static_cast<std::uint32_t>(mText.size()), static_cast<std::uint32_t>(size));
+            mNodes[index].merge = plain && value == "<<";
+            mText.append(value);
+            _anchor(event->scalar.anchor, index);
+            return sa::success();
+        }
+        case FYET_ALIAS: {
+            const auto anchor = _tokenText(event->alias.anchor);
+            for (auto it = mAnchors.rbegin(); it != mAnchors.rend(); ++it) {
+                if (it->first == anchor) {
+                    _attach(it->second);
+                    return sa::success();
+                }
+            }
+            return sa::error(sa::ErrorCode::ParseError, "Unknown YAML alias '" + std::string{anchor} + "'");
+        }
+        case FYET_SEQUENCE_START:
+        case FYET_MAPPING_START: {
+            if (mNodes.size() >= KMaxNodes) {
+                return _tooLarge();
+            }
+            if (mDepth >= KMaxDepth) {
+                return sa::error(sa::ErrorCode::ParseError,
+                                 "YAML nesting is deeper than " + std::to_string(KMaxDepth) + " levels");
+            }
+            const bool mapping = event->type == FYET_MAPPING_START;
+            const auto index   = _addNode(mapping ? Kind::Mapping : Kind::Sequence, 0, 0);
+            _anchor(mapping ? event->mapping_start.anchor : event->sequence_start.anchor, index);
+            if (mOpen.size() == mDepth) {
+                mOpen.emplace_back();
+            }
+            mOpen[mDepth++] = OpenCollection{index, mPending.size()};
+            return sa::success();
+        }
+        case FYET_SEQUENCE_END:
+        case FYET_MAPPING_END: {
+            const auto open = mOpen[--mDepth];
+            if (event->type == FYET_MAPPING_END) {
+                if (auto merged = _mergeKeys(open); !merged) {
+                    return merged;
+                }
+            }
+            auto& node  = mNodes[open.node];
+            node.offset = static_cast<std::uint32_t>(mChildren.size());
+            node.size   = static_cast<std::uint32_t>(mPending.size() - open.children);
+            mChildren.insert(mChildren.end(), mPending.begin() + static_cast<std::ptrdiff_t>(open.children),
+                             mPending.end());
+            mPending.resize(open.children);
+            return sa::success();
+        }
+        case FYET_DOCUMENT_END:
+            done = true;
+            return sa::success();
+        default:
+            return sa::success();
         }
-        return fy_node_sequence_get_by_index(array.node, static_cast<int>(index));
     }
 
-    static std::size_t objectSize(const InputObjectType& object) noexcept {
-        const int count = fy_node_mapping_item_count(object.node);
-        return count < 0 ? 0U : static_cast<std::size_t>(count);
+    /// Replace the merge keys among the pending pairs of @p open by the pairs they merge in.
+    sa::Result<void> _mergeKeys(const OpenCollection& open) {
+        const auto begin = open.children;
+        bool any         = false;
+        for (auto i = begin; i + 1 < mPending.size(); i += 2) {
+            any = any || mNodes[mPending[i]].merge;
+        }
+        if (!any) {
+            return sa::success();
+        }
+        std::vector<std::uint32_t> pairs;
+        std::vector<std::uint32_t> sources;
+        std::unordered_set<std::string_view> keys;
+        for (auto i = begin; i + 1 < mPending.size(); i += 2) {
+            if (!mNodes[mPending[i]].merge) {
+                pairs.push_back(mPending[i]);
+                pairs.push_back(mPending[i + 1]);
+                if (_isScalarKey(mPending[i])) {
+                    keys.insert(text(mNodes[mPending[i]]));
+                }
+                continue;
+            }
+            const auto& value = mNodes[mPending[i + 1]];
+            if (value.kind == Kind::Sequence) {
+                for (std::uint32_t j = 0; j < value.size; ++j) {
+                    sources.push_back(mChildren[value.offset + j]);
+                }
+            } else {
+                sources.push_back(mPending[i + 1]);
+            }
+        }
+        for (const auto source : sources) {
+            const auto& mapping = mNodes[source];
+            if (mapping.kind != Kind::Mapping || _isOpen(source)) {
+                return sa::error(sa::ErrorCode::ParseError, "YAML merge key needs a mapping or a sequence of mappings");
+            }
+            mMerged += mapping.size;
+            if (mMerged > KMaxMergedEntries) {
+                return sa::error(sa::ErrorCode::ParseError, "YAML merge keys expand to more than " +
+                                                                std::to_string(KMaxMergedEntries) + " entries");
+            }
+            for (std::uint32_t j = 0; j + 1 < mapping.size; j += 2) {
+                const auto key = mChildren[mapping.offset + j];
+                if (!_isScalarKey(key) || keys.insert(text(mNodes[key])).second) {
+                    pairs.push_back(key);
+                    pairs.push_back(mChildren[mapping.offset + j + 1]);
+                }
+            }
+        }
+        mPending.resize(begin);
+        mPending.insert(mPending.end(), pairs.begin(), pairs.end());
+        return sa::success();
     }
 
+    static sa::Result<void> _tooLarge() {
+        return sa::error(sa::ErrorCode::ParseError,
+                         "YAML document has more than " + std::to_string(KMaxNodes) + " nodes");
+    }
+
+    bool _isScalarKey(std::uint32_t index) const noexcept {
+        return mNodes[index].kind == Kind::Scalar || mNodes[index].kind == Kind::Null;
+    }
+
+    /// Whether @p index is a collection that has not ended yet, whose children are still pending.
+    bool _isOpen(std::uint32_t index) const noexcept {
+        for (std::size_t i = 0; i <= mDepth && i < mOpen.size(); ++i) {
+            if (mOpen[i].node == index) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::uint32_t _addNode(Kind kind, std::uint32_t offset, std::uint32_t size) {
+        const auto index = static_cast<std::uint32_t>(mNodes.size());
+        mNodes.push_back(Node{kind, offset, size});
+        _attach(index);
+        return index;
+    }
+
+    void _attach(std::uint32_t index) {
+        if (mDepth != 0) {
+            mPending.push_back(index);
+        }
+    }
+
+    void _anchor(fy_token* anchor, std::uint32_t index) {
+        if (anchor != nullptr) {
+            mAnchors.emplace_back(std::string{_tokenText(anchor)}, index);
+        }
+    }
+
+    static std::string_view _tokenText(fy_token* token) noexcept {
+        std::size_t size = 0;
+        const char* text = token == nullptr ? nullptr : fy_token_get_text(token, &size);
+        return text == nullptr ? std::string_view{} : std::string_view{text, size};
+    }
+
+    static bool _isNull(std::string_view value) noexcept {
+        return value.empty() || value == "~" || value == "null" || value == "Null" || value == "NULL";
+    }
+
+private:
+    std::vector<Node> mNodes;
+    std::vector<std::uint32_t> mChildren;
+    std::string mText;
+    std::vector<std::pair<std::string, std::uint32_t>> mAnchors;
+    /// Children of the open collections, innermost last.
+    std::vector<std::uint32_t> mPending;
+    std::vector<OpenCollection> mOpen;
+    std::size_t mDepth  = 0;
+    std::size_t mMerged = 0;
+};
+
+class Reader {
+public:
+    struct InputValueType {
+        const Document* document = nullptr;
+        std::uint32_t index      = 0;
+    };
+
+    struct InputArrayType {
+        const Document* document = nullptr;
+        const Document::Node* node = nullptr;
+    };
+
+    using InputObjectType = InputArrayType;
+
+    static std::size_t arraySize(const InputArrayType& array) noexcept { return array.node->size; }
+
+    static InputValueType arrayElement(const InputArrayType& array, std::size_t index) noexcept {
+        if (index >= array.node->size) {
+            return {};
+        }
+        return {array.document, array.document->child(*array.node, index)};
+    }
+
+    static std::size_t objectSize(const InputObjectType& object) noexcept { return object.node->size / 2; }
+
     static sa::Result<InputValueType> objectField(const InputObjectType& object, std::string_view name) noexcept {
-        auto* node = fy_node_mapping_lookup_value_by_simple_key(object.node, name.data(), name.size());
-        if (node != nullptr) {
-            return node;
+        for (std::size_t i = 0; i + 1 < object.node->size; i += 2) {
+            const auto& key = object.document->node(object.document->child(*object.node, i));
+            if (key.kind == Document::Kind::Scalar && object.document->text(key) == name) {
+                return InputValueType{object.document, object.document->child(*object.node, i + 1)};
+            }
         }
         return sa::error(sa::ErrorCode::InvalidField, "Field '" + std::string{name} + "' not found");
     }
 
     template <typename Fn>
     static bool forEachObjectMember(const InputObjectType& object, Fn&& fn) {
-        void* iter = nullptr;
-        while (auto* pair = fy_node_mapping_iterate(object.node, &iter)) {
-            auto* key   = fy_node_pair_key(pair);
-            auto* value = fy_node_pair_value(pair);
-            size_t size = 0;
-            const char* text = fy_node_get_scalar(key, &size);
-            if (text == nullptr) {
+        for (std::size_t i = 0; i + 1 < object.node->size; i += 2) {
+            const auto& key = object.document->node(object.document->child(*object.node, i));
+            if (key.kind != Document::Kind::Scalar && key.kind != Document::Kind::Null) {
                 return false;
             }
-            if (!fn(std::string_view{text, size}, value)) {
+            if (!fn(object.document->text(key),
+                    InputValueType{object.document, object.document->child(*object.node, i + 1)})) {
                 return false;
             }
         }
         return true;
     }
 
-    static bool isEmpty(InputValueType value) noexcept { return value == nullptr || fy_node_is_null(value); }
+    static bool isEmpty(const InputValueType& value) noexcept {
+        return value.document == nullptr || value.document->node(value.index).kind == Document::Kind::Null;
+    }
 
     template <typename CharT, typename Traits>
-    static sa::Result<std::basic_string_view<CharT, Traits>> toStringView(InputValueType value) noexcept {
+    static sa::Result<std::basic_string_view<CharT, Traits>> toStringView(const InputValueType& value) noexcept {
         static_assert(sizeof(CharT) == sizeof(char), "YAML string views require byte-sized characters");
         auto text = _scalarView(value);
         if (!text) {
@@ -90,7 +386,7 @@ public:
     }
 
     template <typename T>
-    static sa::Result<T> toBasicType(InputValueType value) noexcept {
+    static sa::Result<T> toBasicType(const InputValueType& value) noexcept {
         using U = std::remove_cvref_t<T>;
         auto text = _scalarView(value);
         if (!text) {
@@ -130,31 +426,30 @@ public:
         }
     }
 
-    static sa::Result<InputArrayType> toArray(InputValueType value) noexcept {
-        if (value == nullptr || !fy_node_is_sequence(value)) {
+    static sa::Result<InputArrayType> toArray(const InputValueType& value) noexcept {
+        if (value.document == nullptr || value.document->node(value.index).kind != Document::Kind::Sequence) {
             return sa::error(sa::ErrorCode::InvalidType, "Could not cast YAML node to sequence");
         }
-        return InputArrayType{value};
+        return InputArrayType{value.document, &value.document->node(value.index)};
     }
 
-    static sa::Result<InputObjectType> toObject(InputValueType value) noexcept {
-        if (value == nullptr || !fy_node_is_mapping(value)) {
+    static sa::Result<InputObjectType> toObject(const InputValueType& value) noexcept {
+        if (value.document == nullptr || value.document->node(value.index).kind != Document::Kind::Mapping) {
             return sa::error(sa::ErrorCode::InvalidType, "Could not cast YAML node to mapping");
         }
-        return InputObjectType{value};
+        return InputObjectType{value.document, &value.document->node(value.index)};
     }
 
 private:
-    static sa::Result<std::string_view> _scalarView(InputValueType value) noexcept {
+    static sa::Result<std::string_view> _scalarView(const InputValueType& value) noexcept {
         if (isEmpty(value)) {
             return sa::error(sa::ErrorCode::InvalidType, "Expected scalar, got null");
         }
-        size_t size       = 0;
-        const char* text  = fy_node_get_scalar(value, &size);
-        if (text == nullptr) {
+        const auto& node = value.document->node(value.index);
+        if (node.kind != Document::Kind::Scalar) {
             return sa::error(sa::ErrorCode::InvalidType, "Expected YAML scalar");
         }
-        return std::string_view{text, size};
+        return value.document->text(node);
     }
 };
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "nekoproto/global/global.hpp"
+#include "nekoproto/global/log.hpp"
 
 #if defined(NEKO_PROTO_ENABLE_LIBFYAML)
 
@@ -9,24 +10,35 @@
 
 #include <libfyaml.h>
 
+#include <array>
 #include <charconv>
 #include <cmath>
 #include <cstddef>
-#include <deque>
-#include <iomanip>
 #include <limits>
-#include <sstream>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <vector>
 
 NEKO_BEGIN_NAMESPACE
 namespace yaml {
 
+/**
+ * @brief Event-stream YAML writer.
+ *
+ * Values are emitted as libfyaml events while the parser walks the input, so
+ * no `fy_document` is built and memory stays proportional to the nesting
+ * depth. The parser layer never announces the end of an object or array:
+ * writing into a collection ends every collection opened below it, and
+ * `finish()` ends the rest together with the document.
+ */
 class Writer {
 public:
+    /// Receives the emitted text.
+    using Sink = void (*)(void* context, std::string_view text);
+
     struct OutputNodeType {
-        fy_node* node = nullptr;
+        std::size_t depth = 0;
     };
 
     using OutputArrayType  = OutputNodeType;
@@ -34,348 +46,359 @@ public:
     using OutputValueType  = OutputNodeType;
 
     Writer() = default;
-    explicit Writer(fy_document* document) noexcept : mDocument(document) {}
+    Writer(const Writer&)            = delete;
+    Writer(Writer&&)                 = delete;
+    Writer& operator=(const Writer&) = delete;
+    Writer& operator=(Writer&&)      = delete;
+    ~Writer() { _destroyEmitter(); }
+
+    /// Starts a new document whose text goes to @p sink.
+    void reset(Sink sink, void* context) {
+        _destroyEmitter();
+        mSink      = sink;
+        mContext   = context;
+        mResult    = sa::success();
+        mDepth     = 0;
+        mEventText = 0;
+
+        fy_emitter_cfg cfg{};
+        cfg.flags    = static_cast<fy_emitter_cfg_flags>(FYECF_MODE_MANUAL | FYECF_DOC_START_MARK_OFF);
+        cfg.output   = &Writer::_output;
+        cfg.userdata = this;
+        mEmitter     = fy_emitter_create(&cfg);
+        if (mEmitter == nullptr) {
+            _remember(sa::ErrorCode::Unknown, "Could not create YAML emitter");
+            return;
+        }
+        _emit(fy_emit_event_create(mEmitter, FYET_STREAM_START));
+        _emit(fy_emit_event_create(mEmitter, FYET_DOCUMENT_START, 1, nullptr, nullptr));
+    }
 
-    void reset(fy_document* document) noexcept {
-        mDocument = document;
-        mResult   = sa::success();
-        mTagStorage.clear();
+    /// Ends every open collection and the document.
+    sa::Result<void> finish() {
+        _closeTo(0);
+        if (mResult) {
+            _emit(fy_emit_event_create(mEmitter, FYET_DOCUMENT_END, 1));
+            _emit(fy_emit_event_create(mEmitter, FYET_STREAM_END));
+        }
+        _destroyEmitter();
+        return mResult;
     }
 
     const sa::Result<void>& result() const noexcept { return mResult; }
 
     template <typename Tags>
     OutputArrayType arrayAsRoot(std::size_t /*size*/, const Tags& tags) {
-        auto node = _createSequence();
-        _setRoot(node);
-        return _applyTags(OutputArrayType{node}, tags);
+        return _startCollection(FYET_SEQUENCE_START, tags);
     }
 
     template <typename Tags>
     OutputObjectType objectAsRoot(std::size_t /*size*/, const Tags& tags) {
-        auto node = _createMapping();
-        _setRoot(node);
-        return _applyTags(OutputObjectType{node}, tags);
+        return _startCollection(FYET_MAPPING_START, tags);
     }
 
     template <typename Tags>
     OutputValueType nullAsRoot(const Tags& tags) {
-        auto node = _createNull();
-        _setRoot(node);
-        return _applyTags(OutputValueType{node}, tags);
+        _scalar(KNull, FYSS_PLAIN, tags);
+        return {0};
     }
 
     template <typename T, typename Tags>
     OutputValueType valueAsRoot(const T& value, const Tags& tags) {
-        auto node = _createScalar(value);
-        _setRoot(node);
-        return _applyTags(OutputValueType{node}, tags);
+        _value(value, tags);
+        return {0};
     }
 
     template <typename Tags>
     OutputArrayType addArrayToArray(std::size_t /*size*/, OutputArrayType* parent, const Tags& tags) {
-        auto node = _createSequence();
-        _appendToSequence(parent, node);
-        return _applyTags(OutputArrayType{node}, tags);
+        _enter(parent);
+        return _startCollection(FYET_SEQUENCE_START, tags);
     }
 
     template <typename Tags>
     OutputArrayType addArrayToObject(std::string_view name, std::size_t /*size*/, OutputObjectType* parent,
                                      const Tags& tags) {
-        auto node = _createSequence();
-        _appendToMapping(parent, name, node);
-        return _applyTags(OutputArrayType{node}, tags);
+        _key(parent, name);
+        return _startCollection(FYET_SEQUENCE_START, tags);
     }
 
     template <typename Tags>
     OutputObjectType addObjectToArray(std::size_t /*size*/, OutputArrayType* parent, const Tags& tags) {
-        auto node = _createMapping();
-        _appendToSequence(parent, node);
-        return _applyTags(OutputObjectType{node}, tags);
+        _enter(parent);
+        return _startCollection(FYET_MAPPING_START, tags);
     }
 
     template <typename Tags>
     OutputObjectType addObjectToObject(std::string_view name, std::size_t /*size*/, OutputObjectType* parent,
                                        const Tags& tags) {
-        auto node = _createMapping();
-        _appendToMapping(parent, name, node);
-        return _applyTags(OutputObjectType{node}, tags);
+        _key(parent, name);
+        return _startCollection(FYET_MAPPING_START, tags);
     }
 
     template <typename T, typename Tags>
     OutputValueType addValueToArray(const T& value, OutputArrayType* parent, const Tags& tags) {
-        auto node = _createScalar(value);
-        _appendToSequence(parent, node);
-        return _applyTags(OutputValueType{node}, tags);
+        _enter(parent);
+        _value(value, tags);
+        return {parent->depth};
     }
 
     template <typename T, typename Tags>
     OutputValueType addValueToObject(std::string_view name, const T& value, OutputObjectType* parent,
                                      const Tags& tags) {
-        auto node = _createScalar(value);
-        _appendToMapping(parent, name, node);
-        return _applyTags(OutputValueType{node}, tags);
+        _key(parent, name);
+        _value(value, tags);
+        return {parent->depth};
     }
 
     template <typename Tags>
     OutputValueType addNullToArray(OutputArrayType* parent, const Tags& tags) {
-        auto node = _createNull();
-        _appendToSequence(parent, node);
-        return _applyTags(OutputValueType{node}, tags);
+        _enter(parent);
+        _scalar(KNull, FYSS_PLAIN, tags);
+        return {parent->depth};
     }
 
     template <typename Tags>
     OutputValueType addNullToObject(std::string_view name, OutputObjectType* parent, const Tags& tags) {
-        auto node = _createNull();
-        _appendToMapping(parent, name, node);
-        return _applyTags(OutputValueType{node}, tags);
+        _key(parent, name);
+        _scalar(KNull, FYSS_PLAIN, tags);
+        return {parent->depth};
     }
 
     void endArray(OutputArrayType* /*unused*/) noexcept {}
     void endObject(OutputObjectType* /*unused*/) noexcept {}
 
 private:
-    sa::Result<void> _remember(sa::ErrorCode code, std::string message) {
-        mResult = sa::error(code, std::move(message));
-        return mResult;
-    }
+    static constexpr std::string_view KNull = "null";
+    /**
+     * libfyaml references event text without copying it and queues at most
+     * KMaxQueuedEvents events of lookahead before writing them. Every event
+     * with text gets its own slot for its value, anchor and tag, and a slot
+     * is only reused KEventSlots events later, after the emitter let go of it.
+     */
+    static constexpr std::size_t KMaxQueuedEvents = 3;
+    static constexpr std::size_t KEventSlots      = 8;
+    static_assert(KEventSlots > KMaxQueuedEvents, "YAML event text must outlive the emitter's lookahead queue");
+
+    struct EventText {
+        std::array<std::string, 3> strings;
+        std::size_t used = 0;
+    };
 
-    template <typename Output, typename Tags>
-    Output _applyTags(Output output, const Tags& tags) {
-        if constexpr (tag_query::has<tag_property::yaml_tag>(Tags{})) {
-            _applyYamlTag(output.node, tag_query::get<tag_property::yaml_tag>(tags));
-        }
-        if constexpr (tag_query::has<tag_property::yaml_anchor>(Tags{})) {
-            _applyYamlAnchor(output.node, tag_query::get<tag_property::yaml_anchor>(tags));
-        }
-        if constexpr (tag_query::has<tag_property::yaml_scalar_style>(Tags{})) {
-            _applyYamlScalarStyle(output.node, tag_query::get<tag_property::yaml_scalar_style>(tags));
-        }
-        if constexpr (tag_query::has<tag_property::yaml_collection_style>(Tags{})) {
-            _applyYamlCollectionStyle(output.node, tag_query::get<tag_property::yaml_collection_style>(tags));
+    static int _output(fy_emitter* /*emitter*/, fy_emitter_write_type /*type*/, const char* text, int size,
+                       void* userdata) {
+        auto* self = static_cast<Writer*>(userdata);
+        if (size > 0) {
+            self->mSink(self->mContext, std::string_view{text, static_cast<std::size_t>(size)});
         }
-        return output;
+        return size;
     }
 
-    void _applyYamlTag(fy_node* node, std::string_view tag) {
-        if (tag.empty()) {
-            return;
-        }
-        if (node == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "Cannot apply YAML tag to an empty node");
-            return;
-        }
-        mTagStorage.emplace_back(tag);
-        const auto& ownedTag = mTagStorage.back();
-        if (fy_node_set_tag(node, ownedTag.data(), ownedTag.size()) != 0) {
-            _remember(sa::ErrorCode::InvalidType, "Could not apply YAML tag '" + std::string(tag) + "'");
+    void _destroyEmitter() noexcept {
+        if (mEmitter != nullptr) {
+            fy_emitter_destroy(mEmitter);
+            mEmitter = nullptr;
         }
     }
 
-    void _applyYamlAnchor(fy_node* node, std::string_view anchor) {
-        if (anchor.empty()) {
-            return;
-        }
-        if (node == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "Cannot apply YAML anchor to an empty node");
-            return;
-        }
-        if (fy_node_set_anchor_copy(node, anchor.data(), anchor.size()) != 0) {
-            _remember(sa::ErrorCode::InvalidType, "Could not apply YAML anchor '" + std::string(anchor) + "'");
+    sa::Result<void> _remember(sa::ErrorCode code, std::string message) {
+        if (mResult) {
+            mResult = sa::error(code, std::move(message));
         }
+        return mResult;
     }
 
-    void _applyYamlScalarStyle(fy_node* node, YamlScalarStyle style) {
-        if (style == YamlScalarStyle::Any) {
-            return;
-        }
-        if (node == nullptr || !fy_node_is_scalar(node)) {
-            _remember(sa::ErrorCode::InvalidType, "YAML scalar style can only be applied to scalar nodes");
+    void _emit(fy_event* event) {
+        if (event == nullptr) {
+            _remember(sa::ErrorCode::Unknown, "Could not create YAML event");
             return;
         }
-        const auto requested = _toLibfyamlStyle(style);
-        const auto actual    = fy_node_set_style(node, requested);
-        if (actual != requested) {
-            _remember(sa::ErrorCode::InvalidType, "Could not apply requested YAML scalar style");
+        if (fy_emit_event(mEmitter, event) != 0) {
+            _remember(sa::ErrorCode::Unknown, "Could not emit YAML event");
         }
     }
 
-    void _applyYamlCollectionStyle(fy_node* node, YamlCollectionStyle style) {
-        if (style == YamlCollectionStyle::Any) {
-            return;
+    void _closeTo(std::size_t depth) {
+        while (mDepth > depth) {
+            --mDepth;
+            if (mResult) {
+                _emit(fy_emit_event_create(mEmitter, mMappings[mDepth] ? FYET_MAPPING_END : FYET_SEQUENCE_END));
+            }
         }
-        if (node == nullptr || (!fy_node_is_sequence(node) && !fy_node_is_mapping(node))) {
-            _remember(sa::ErrorCode::InvalidType, "YAML collection style can only be applied to sequence or mapping nodes");
+    }
+
+    void _enter(const OutputNodeType* parent) {
+        if (parent == nullptr || parent->depth == 0 || parent->depth > mDepth) {
+            _remember(sa::ErrorCode::InvalidType, "Cannot append to a closed YAML collection");
             return;
         }
-        const auto requested = _toLibfyamlStyle(style);
-        const auto actual    = fy_node_set_style(node, requested);
-        if (actual != requested) {
-            _remember(sa::ErrorCode::InvalidType, "Could not apply requested YAML collection style");
-        }
+        _closeTo(parent->depth);
     }
 
-    static fy_node_style _toLibfyamlStyle(YamlScalarStyle style) noexcept {
-        switch (style) {
-        case YamlScalarStyle::Any:
-            return FYNS_ANY;
-        case YamlScalarStyle::Plain:
-            return FYNS_PLAIN;
-        case YamlScalarStyle::SingleQuoted:
-            return FYNS_SINGLE_QUOTED;
-        case YamlScalarStyle::DoubleQuoted:
-            return FYNS_DOUBLE_QUOTED;
-        case YamlScalarStyle::Literal:
-            return FYNS_LITERAL;
-        case YamlScalarStyle::Folded:
-            return FYNS_FOLDED;
+    void _key(const OutputObjectType* parent, std::string_view name) {
+        _enter(parent);
+        if (mResult) {
+            _beginEventText();
+            _emit(fy_emit_event_create(mEmitter, FYET_SCALAR, FYSS_PLAIN, _text(name), name.size(), nullptr, nullptr));
         }
-        return FYNS_ANY;
     }
 
-    static fy_node_style _toLibfyamlStyle(YamlCollectionStyle style) noexcept {
-        switch (style) {
-        case YamlCollectionStyle::Any:
-            return FYNS_ANY;
-        case YamlCollectionStyle::Flow:
-            return FYNS_FLOW;
-        case YamlCollectionStyle::Block:
-            return FYNS_BLOCK;
-        }
-        return FYNS_ANY;
+    /// Move to the slot of the next event, whose text _text() then stores.
+    void _beginEventText() {
+        mEventText                   = (mEventText + 1) % KEventSlots;
+        mEventTexts[mEventText].used = 0;
     }
 
-    fy_node* _createSequence() {
-        if (mDocument == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "YAML document is not initialized");
-            return nullptr;
-        }
-        auto* node = fy_node_create_sequence(mDocument);
-        if (node == nullptr) {
-            _remember(sa::ErrorCode::Unknown, "Could not create YAML sequence node");
-        }
-        return node;
+    const char* _text(std::string_view text) {
+        auto& slot = mEventTexts[mEventText];
+        NEKO_ASSERT(slot.used < slot.strings.size(), "yaml", "YAML event carries more than {} strings",
+                    slot.strings.size());
+        auto& owned = slot.strings[slot.used++];
+        owned.assign(text.data(), text.size());
+        return owned.c_str();
     }
 
-    fy_node* _createMapping() {
-        if (mDocument == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "YAML document is not initialized");
+    template <typename Tags>
+    const char* _tag(const Tags& tags) {
+        if constexpr (tag_query::has<tag_property::yaml_tag>(Tags{})) {
+            const std::string_view tag = tag_query::get<tag_property::yaml_tag>(tags);
+            return tag.empty() ? nullptr : _text(tag);
+        } else {
             return nullptr;
         }
-        auto* node = fy_node_create_mapping(mDocument);
-        if (node == nullptr) {
-            _remember(sa::ErrorCode::Unknown, "Could not create YAML mapping node");
-        }
-        return node;
     }
 
-    fy_node* _createNull() {
-        if (mDocument == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "YAML document is not initialized");
+    template <typename Tags>
+    const char* _anchor(const Tags& tags) {
+        if constexpr (tag_query::has<tag_property::yaml_anchor>(Tags{})) {
+            const std::string_view anchor = tag_query::get<tag_property::yaml_anchor>(tags);
+            return anchor.empty() ? nullptr : _text(anchor);
+        } else {
             return nullptr;
         }
-        auto* node = fy_node_build_from_string(mDocument, "null", 4);
-        if (node == nullptr) {
-            _remember(sa::ErrorCode::Unknown, "Could not create YAML null node");
-        }
-        return node;
     }
 
-    template <typename T>
-    fy_node* _createScalar(const T& value) {
-        if (mDocument == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "YAML document is not initialized");
-            return nullptr;
-        }
-        if constexpr (std::is_floating_point_v<std::remove_cvref_t<T>>) {
-            if (!std::isfinite(value)) {
-                _remember(sa::ErrorCode::InvalidType, "Cannot serialize non-finite floating point value to YAML");
-                return nullptr;
+    template <typename Tags>
+    OutputNodeType _startCollection(fy_event_type type, const Tags& tags) {
+        if constexpr (tag_query::has<tag_property::yaml_scalar_style>(Tags{})) {
+            if (tag_query::get<tag_property::yaml_scalar_style>(tags) != YamlScalarStyle::Any) {
+                _remember(sa::ErrorCode::InvalidType, "YAML scalar style can only be applied to scalar nodes");
             }
         }
-        const auto text = _toString(value);
-        auto* node      = fy_node_create_scalar_copy(mDocument, text.data(), text.size());
-        if (node == nullptr) {
-            _remember(sa::ErrorCode::Unknown, "Could not create YAML scalar node");
-            return nullptr;
-        }
-        if constexpr (std::is_same_v<std::remove_cvref_t<T>, std::string> ||
-                      std::is_same_v<std::remove_cvref_t<T>, std::string_view>) {
-            fy_node_set_style(node, FYNS_DOUBLE_QUOTED);
+        auto style = FYNS_ANY;
+        if constexpr (tag_query::has<tag_property::yaml_collection_style>(Tags{})) {
+            style = _toLibfyamlStyle(tag_query::get<tag_property::yaml_collection_style>(tags));
         }
-        return node;
-    }
-
-    void _setRoot(fy_node* node) {
-        if (node == nullptr) {
-            return;
+        if (!mResult) {
+            return {mDepth};
         }
-        if (fy_document_set_root(mDocument, node) != 0) {
-            _remember(sa::ErrorCode::Unknown, "Could not set YAML document root");
+        _beginEventText();
+        const char* anchor = _anchor(tags);
+        const char* tag    = _tag(tags);
+        _emit(fy_emit_event_create(mEmitter, type, style, anchor, tag));
+        if (mMappings.size() == mDepth) {
+            mMappings.push_back(false);
         }
+        mMappings[mDepth] = type == FYET_MAPPING_START;
+        return {++mDepth};
     }
 
-    void _appendToSequence(OutputArrayType* parent, fy_node* node) {
-        if (parent == nullptr || parent->node == nullptr || node == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "Cannot append to an empty YAML sequence");
-            return;
-        }
-        if (fy_node_sequence_append(parent->node, node) != 0) {
-            _remember(sa::ErrorCode::InvalidType, "Could not append YAML sequence item");
+    template <typename Tags>
+    void _scalar(std::string_view text, fy_scalar_style style, const Tags& tags) {
+        if constexpr (tag_query::has<tag_property::yaml_collection_style>(Tags{})) {
+            if (tag_query::get<tag_property::yaml_collection_style>(tags) != YamlCollectionStyle::Any) {
+                _remember(sa::ErrorCode::InvalidType,
+                          "YAML collection style can only be applied to sequence or mapping nodes");
+            }
         }
-    }
-
-    void _appendToMapping(OutputObjectType* parent, std::string_view name, fy_node* node) {
-        if (parent == nullptr || parent->node == nullptr || node == nullptr) {
-            _remember(sa::ErrorCode::InvalidType, "Cannot append to an empty YAML mapping");
-            return;
+        if constexpr (tag_query::has<tag_property::yaml_scalar_style>(Tags{})) {
+            if (const auto requested = tag_query::get<tag_property::yaml_scalar_style>(tags);
+                requested != YamlScalarStyle::Any) {
+                style = _toLibfyamlStyle(requested);
+            }
         }
-        auto* key = fy_node_create_scalar_copy(mDocument, name.data(), name.size());
-        if (key == nullptr) {
-            _remember(sa::ErrorCode::Unknown, "Could not create YAML mapping key '" + std::string(name) + "'");
+        if (!mResult) {
             return;
         }
-        fy_node_set_style(key, FYNS_PLAIN);
-        if (fy_node_mapping_append(parent->node, key, node) != 0) {
-            _remember(sa::ErrorCode::InvalidField, "Could not append YAML mapping field '" + std::string(name) + "'");
-        }
+        _beginEventText();
+        const char* value  = _text(text);
+        const char* anchor = _anchor(tags);
+        const char* tag    = _tag(tags);
+        _emit(fy_emit_event_create(mEmitter, FYET_SCALAR, style, value, text.size(), anchor, tag));
     }
 
-    template <typename T>
-    static std::string _toString(const T& value) {
+    template <typename T, typename Tags>
+    void _value(const T& value, const Tags& tags) {
         using U = std::remove_cvref_t<T>;
-        if constexpr (std::is_same_v<U, std::string>) {
-            return value;
-        } else if constexpr (std::is_same_v<U, std::string_view>) {
-            return std::string{value};
+        if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>) {
+            _scalar(value, FYSS_DOUBLE_QUOTED, tags);
         } else if constexpr (std::is_same_v<U, bool>) {
-            return value ? "true" : "false";
-        } else if constexpr (std::is_integral_v<U>) {
+            _scalar(value ? "true" : "false", FYSS_ANY, tags);
+        } else if constexpr (std::is_enum_v<U>) {
+            _value(static_cast<std::underlying_type_t<U>>(value), tags);
+        } else if constexpr (std::is_arithmetic_v<U>) {
+            if constexpr (std::is_floating_point_v<U>) {
+                if (!std::isfinite(value)) {
+                    _remember(sa::ErrorCode::InvalidType, "Cannot serialize non-finite floating point value to YAML");
+                    return;
+                }
+            }
             char buffer[128];
-            const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
-            if (error == std::errc{}) {
-                return {buffer, end};
+            std::to_chars_result converted;
+            if constexpr (std::is_floating_point_v<U>) {
+                converted = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general,
+                                          std::numeric_limits<U>::max_digits10);
+            } else {
+                converted = std::to_chars(buffer, buffer + sizeof(buffer), value);
             }
-            return {};
-        } else if constexpr (std::is_floating_point_v<U>) {
-            if (!std::isfinite(value)) {
-                return {};
+            if (converted.ec != std::errc{}) {
+                _remember(sa::ErrorCode::InvalidType, "Could not format YAML scalar");
+                return;
             }
-            std::ostringstream stream;
-            stream << std::setprecision(std::numeric_limits<U>::max_digits10) << value;
-            return stream.str();
-        } else if constexpr (std::is_enum_v<U>) {
-            using I = std::underlying_type_t<U>;
-            return _toString(static_cast<I>(value));
+            _scalar(std::string_view{buffer, static_cast<std::size_t>(converted.ptr - buffer)}, FYSS_ANY, tags);
         } else {
             static_assert(std::is_same_v<U, void>, "Unsupported YAML scalar type");
         }
     }
 
+    static fy_scalar_style _toLibfyamlStyle(YamlScalarStyle style) noexcept {
+        switch (style) {
+        case YamlScalarStyle::Any:
+            return FYSS_ANY;
+        case YamlScalarStyle::Plain:
+            return FYSS_PLAIN;
+        case YamlScalarStyle::SingleQuoted:
+            return FYSS_SINGLE_QUOTED;
+        case YamlScalarStyle::DoubleQuoted:
+            return FYSS_DOUBLE_QUOTED;
+        case YamlScalarStyle::Literal:
+            return FYSS_LITERAL;
+        case YamlScalarStyle::Folded:
+            return FYSS_FOLDED;
+        }
+        return FYSS_ANY;
+    }
+
+    static fy_node_style _toLibfyamlStyle(YamlCollectionStyle style) noexcept {
+        switch (style) {
+        case YamlCollectionStyle::Any:
+            return FYNS_ANY;
+        case YamlCollectionStyle::Flow:
+            return FYNS_FLOW;
+        case YamlCollectionStyle::Block:
+            return FYNS_BLOCK;
+        }
+        return FYNS_ANY;
+    }
+
 private:
-    fy_document* mDocument = nullptr;
+    fy_emitter* mEmitter = nullptr;
+    Sink mSink           = nullptr;
+    void* mContext       = nullptr;
     sa::Result<void> mResult;
-    std::deque<std::string> mTagStorage;
+    std::vector<bool> mMappings;
+    std::size_t mDepth = 0;
+    std::array<EventText, KEventSlots> mEventTexts;
+    std::size_t mEventText = 0;
 };
 
 } // namespace yaml
@@ -19,8 +19,6 @@
 
 #include <libfyaml.h>
 
-#include <cstdlib>
-#include <cstring>
 #include <utility>
 #endif
 
@@ -65,21 +63,6 @@ inline fy_diag* create_quiet_yaml_diag() {
     return diag;
 }
 
-inline std::string first_yaml_diag_message(fy_diag* diag) {
-    if (diag == nullptr) {
-        return "libfyaml parse error";
-    }
-    void* iter = nullptr;
-    if (auto* error = fy_diag_errors_iterate(diag, &iter); error != nullptr && error->msg != nullptr) {
-        std::string message = error->msg;
-        if (error->line > 0 && error->column > 0) {
-            message += " at line " + std::to_string(error->line) + ", column " + std::to_string(error->column);
-        }
-        return message;
-    }
-    return "libfyaml parse error";
-}
-
 inline fy_parse_cfg default_yaml_parse_cfg(fy_diag* diag = nullptr) {
     fy_parse_cfg cfg{};
     cfg.flags = static_cast<fy_parse_cfg_flags>(FYPCF_QUIET | FYPCF_COLLECT_DIAG | FYPCF_RESOLVE_DOCUMENT |
@@ -95,49 +78,38 @@ struct LibfyamlBackend {
     using DefaultOutputBuffer = std::vector<char>;
     using DefaultInputSource  = void;
 
+    /**
+     * @brief Emits the document into the output buffer as it is written.
+     *
+     * Contiguous character buffers receive the emitter output directly; other
+     * outputs such as streams receive it from a scratch string once the
+     * document is complete.
+     */
     template <typename BufferT>
     struct OutputState {
-        explicit OutputState(BufferT& outputBuffer) : buffer(outputBuffer) { resetDocument(); }
+        static constexpr bool KDirect = detail::resizable_char_buffer<BufferT>;
+        using TargetType              = std::conditional_t<KDirect, BufferT, std::string>;
 
-        OutputState(const OutputState&)            = delete;
-        OutputState(OutputState&&)                 = delete;
-        OutputState& operator=(const OutputState&) = delete;
-        OutputState& operator=(OutputState&&)      = delete;
+        explicit OutputState(BufferT& outputBuffer) : buffer(outputBuffer) {}
 
-        ~OutputState() {
-            if (document != nullptr) {
-                fy_document_destroy(document);
-            }
-            if (diag != nullptr) {
-                fy_diag_destroy(diag);
+        TargetType& target() noexcept {
+            if constexpr (KDirect) {
+                return buffer;
+            } else {
+                return scratch;
             }
         }
 
-        void resetDocument() {
-            if (document != nullptr) {
-                fy_document_destroy(document);
-            }
-            if (diag != nullptr) {
-                fy_diag_destroy(diag);
-            }
-            diag        = detail::create_quiet_yaml_diag();
-            parseConfig = detail::default_yaml_parse_cfg(diag);
-            document    = fy_document_create(&parseConfig);
-            writer.reset(document);
-            result  = document == nullptr ? sa::error(sa::ErrorCode::Unknown, "Could not create YAML document")
-                                          : sa::success();
-            hasRoot = false;
-            flushed = false;
+        static void append(void* context, std::string_view text) {
+            detail::append_yaml(*static_cast<TargetType*>(context), text);
         }
 
         BufferT& buffer;
-        fy_parse_cfg parseConfig{};
-        fy_diag* diag = nullptr;
-        fy_document* document = nullptr;
+        std::string scratch;
         yaml::Writer writer;
-        sa::Result<void> result;
-        bool hasRoot = false;
-        bool flushed = false;
+        std::size_t documentStart = 0;
+        bool hasRoot              = false;
+        bool flushed              = false;
     };
 
     template <typename SourceT>
@@ -145,8 +117,8 @@ struct LibfyamlBackend {
         explicit InputState(const char* buffer, std::size_t size) { parse(buffer, size); }
 
         explicit InputState(std::istream& stream) {
-            ownedInput.assign(std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{});
-            parse(ownedInput.data(), ownedInput.size(), false);
+            const std::string input{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+            parse(input.data(), input.size());
         }
 
         InputState(const InputState&)            = delete;
@@ -155,81 +127,61 @@ struct LibfyamlBackend {
         InputState& operator=(InputState&&)      = delete;
 
         ~InputState() {
-            if (document != nullptr) {
-                fy_document_destroy(document);
-            }
             if (diag != nullptr) {
                 fy_diag_destroy(diag);
             }
         }
 
-        void parse(const char* buffer, std::size_t size, bool copy = true) {
+        void parse(const char* buffer, std::size_t size) {
             while (size > 0 && buffer[size - 1] == '\0') {
                 --size;
             }
-            if (copy) {
-                ownedInput.assign(buffer, size);
-                buffer = ownedInput.data();
-            }
             if (diag != nullptr) {
                 fy_diag_destroy(diag);
             }
             diag        = detail::create_quiet_yaml_diag();
             parseConfig = detail::default_yaml_parse_cfg(diag);
-            document    = fy_document_build_from_string(&parseConfig, buffer, size);
-            if (document == nullptr) {
-                result = sa::error(sa::ErrorCode::ParseError, detail::first_yaml_diag_message(diag));
-                return;
-            }
-            root = fy_document_root(document);
-            if (root == nullptr) {
-                result = sa::error(sa::ErrorCode::ParseError, "YAML document has no root node");
-                return;
-            }
-            result = sa::success();
+            result      = document.parse(&parseConfig, buffer, size);
         }
 
-        std::string ownedInput;
         fy_parse_cfg parseConfig{};
         fy_diag* diag = nullptr;
-        fy_document* document = nullptr;
-        fy_node* root = nullptr;
+        yaml::Document document;
         sa::Result<void> result;
     };
 
     template <typename BufferT, typename T>
     static sa::Result<void> write(OutputState<BufferT>& state, const T& value) {
-        state.resetDocument();
-        if (!state.result) {
-            return state.result;
+        auto& target = state.target();
+        if (state.hasRoot && !state.flushed) {
+            target.resize(state.documentStart);
         }
+        state.documentStart = target.size();
+        state.writer.reset(&OutputState<BufferT>::append, &target);
         auto result   = parser_write<yaml::Writer>(state.writer, value, parsing::Parent<yaml::Writer>::Root{});
-        state.hasRoot = static_cast<bool>(result) && static_cast<bool>(state.writer.result());
-        if (!state.writer.result()) {
-            return state.writer.result();
+        auto finished = state.writer.finish();
+        if (result && !finished) {
+            result = std::move(finished);
+        }
+        state.hasRoot = static_cast<bool>(result);
+        state.flushed = false;
+        if (!result) {
+            // Drop the partial document so a failed write leaves the output untouched.
+            target.resize(state.documentStart);
         }
         return result;
     }
 
     template <typename BufferT>
     static sa::Result<void> finish(OutputState<BufferT>& state, sa::Result<void> result) {
-        if (!result) {
-            return result;
-        }
-        if (!state.writer.result()) {
-            return state.writer.result();
-        }
-        if (!state.hasRoot) {
+        if (!result || !state.hasRoot) {
             return result;
         }
         if (!state.flushed) {
-            char* output = fy_emit_document_to_string(
-                state.document, static_cast<fy_emitter_cfg_flags>(FYECF_MODE_MANUAL | FYECF_DOC_START_MARK_OFF));
-            if (output == nullptr) {
-                return sa::error(sa::ErrorCode::Unknown, "Could not emit YAML document");
+            if constexpr (!OutputState<BufferT>::KDirect) {
+                detail::append_yaml(state.buffer, state.scratch);
+                state.scratch.clear();
             }
-            detail::append_yaml(state.buffer, std::string_view{output, std::strlen(output)});
-            std::free(output);
             state.flushed = true;
         }
         return result;
@@ -237,7 +189,7 @@ struct LibfyamlBackend {
 
     template <typename BufferT>
     static bool outputReady(const OutputState<BufferT>& state, const sa::Result<void>& result) noexcept {
-        return state.hasRoot && static_cast<bool>(result) && static_cast<bool>(state.writer.result());
+        return state.hasRoot && static_cast<bool>(result);
     }
 
     template <typename SourceT>
@@ -247,7 +199,7 @@ struct LibfyamlBackend {
 
     template <typename SourceT, typename T>
     static sa::Result<void> read(InputState<SourceT>& state, T& value) {
-        return parser_read<yaml::Reader>(state.root, value);
+        return parser_read<yaml::Reader>(yaml::Reader::InputValueType{&state.document, 0}, value);
     }
 };
 
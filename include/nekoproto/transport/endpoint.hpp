@@ -2,6 +2,9 @@
 
 // Ilias-based stream and message endpoint helpers shared by optional transport modules.
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
@@ -46,6 +49,12 @@ concept MessageEndpointSendSize = requires(T endpoint, std::span<const std::byte
     { endpoint.send(in) } -> std::same_as<ilias::IoTask<std::size_t>>;
 };
 
+/// A stream that writes several pieces in one call, returning how many bytes it took like write() does.
+template <typename T>
+concept VectoredWriteStream = requires(T& stream, std::span<const std::span<const std::byte>> pieces) {
+    { stream.writeVectored(pieces) } -> std::same_as<ilias::IoTask<std::size_t>>;
+};
+
 template <typename T>
 concept MessageEndpointSendVoid = requires(T endpoint, std::span<const std::byte> in) {
     { endpoint.send(in) } -> std::same_as<ilias::IoTask<void>>;
@@ -131,6 +140,86 @@ auto send_message_endpoint(T& endpoint, std::span<const std::byte> buffer) -> il
     }
 }
 
+/// Join @p pieces into one contiguous message.
+inline auto join_message_pieces(std::span<const std::span<const std::byte>> pieces) -> std::vector<std::byte> {
+    std::size_t total = 0;
+    for (const auto& piece : pieces) {
+        total += piece.size();
+    }
+    std::vector<std::byte> message;
+    message.reserve(total);
+    for (const auto& piece : pieces) {
+        message.insert(message.end(), piece.begin(), piece.end());
+    }
+    return message;
+}
+
+template <typename T>
+auto send_message_endpoint_vectored(T& endpoint, std::span<const std::span<const std::byte>> pieces)
+    -> ilias::IoTask<std::size_t> {
+    if constexpr (requires {
+                      { endpoint.sendVectored(pieces) } -> std::same_as<ilias::IoTask<std::size_t>>;
+                  }) {
+        co_return co_await endpoint.sendVectored(pieces);
+    } else {
+        const auto message = join_message_pieces(pieces);
+        co_return co_await send_message_endpoint(endpoint, std::span<const std::byte>{message});
+    }
+}
+
+/// Pieces below this size are copied together before writing instead of written one by one.
+inline constexpr std::size_t KGatherPieceBytes = 4096U;
+
+/**
+ * @brief Write @p pieces to @p stream in order, without joining them first.
+ *
+ * Streams with writeVectored() get all pieces in one call. Otherwise small
+ * pieces are gathered in @p scratch so a frame header does not go out in a
+ * write of its own, and larger pieces are written straight from the caller's
+ * memory. Returns the number of bytes written.
+ */
+template <CommunicationStream StreamT>
+auto write_stream_pieces(StreamT& stream, std::span<const std::span<const std::byte>> pieces,
+                         std::vector<std::byte>& scratch) -> ilias::IoTask<std::size_t> {
+    if constexpr (detail::VectoredWriteStream<StreamT>) {
+        co_return co_await stream.writeVectored(pieces);
+    } else {
+        std::size_t total = 0;
+        scratch.clear();
+        for (const auto& piece : pieces) {
+            if (piece.size() < KGatherPieceBytes) {
+                scratch.insert(scratch.end(), piece.begin(), piece.end());
+                continue;
+            }
+            if (!scratch.empty()) {
+                ILIAS_CO_TRY(auto written, co_await ilias::io::writeAll(stream, std::span<const std::byte>{scratch}));
+                total += written;
+                if (written != scratch.size()) {
+                    co_return total;
+                }
+                scratch.clear();
+            }
+            ILIAS_CO_TRY(auto written, co_await ilias::io::writeAll(stream, piece));
+            total += written;
+            if (written != piece.size()) {
+                co_return total;
+            }
+        }
+        if (!scratch.empty()) {
+            ILIAS_CO_TRY(auto written, co_await ilias::io::writeAll(stream, std::span<const std::byte>{scratch}));
+            total += written;
+            scratch.clear();
+        }
+        co_return total;
+    }
+}
+
+/// A received message and, when it lives outside the caller's buffer, the object that keeps it alive.
+struct HeldMessage {
+    std::span<const std::byte> bytes;
+    std::shared_ptr<const void> holder;
+};
+
 class IMessageEndpoint {
 public:
     IMessageEndpoint()          = default;
@@ -141,6 +230,29 @@ public:
     virtual auto close() -> void                                                       = 0;
     virtual auto shutdown() -> ilias::IoTask<void>                                     = 0;
     virtual auto flush() -> ilias::IoTask<void>                                        = 0;
+
+    /**
+     * @brief Send one message made of @p pieces laid end to end.
+     *
+     * Endpoints that can write the pieces in place override this; the default
+     * joins them and calls send().
+     */
+    virtual auto sendVectored(std::span<const std::span<const std::byte>> pieces) -> ilias::IoTask<std::size_t> {
+        const auto message = join_message_pieces(pieces);
+        co_return co_await send(std::span<const std::byte>{message});
+    }
+
+    /**
+     * @brief Receive one message that may outlive the next receive.
+     *
+     * The default receives into @p buffer and returns a view of it. Endpoints
+     * that can hand a message out without copying it, such as a mapped memfd,
+     * return a view of their own storage together with its holder instead.
+     */
+    virtual auto recvHeld(std::vector<std::byte>& buffer) -> ilias::IoTask<HeldMessage> {
+        ILIAS_CO_TRYV(co_await recv(buffer));
+        co_return HeldMessage{.bytes = std::span<const std::byte>{buffer}, .holder = nullptr};
+    }
 };
 
 template <typename T, typename = void>
@@ -157,6 +269,9 @@ public:
     auto send(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> override {
         co_return co_await send_message_endpoint(mEndpoint, buffer);
     }
+    auto sendVectored(std::span<const std::span<const std::byte>> pieces) -> ilias::IoTask<std::size_t> override {
+        co_return co_await send_message_endpoint_vectored(mEndpoint, pieces);
+    }
     auto close() -> void override { return mEndpoint.close(); }
     auto shutdown() -> ilias::IoTask<void> override { return mEndpoint.shutdown(); }
     auto flush() -> ilias::IoTask<void> override { return mEndpoint.flush(); }
@@ -173,6 +288,127 @@ struct is_message_endpoint : std::false_type {};
 template <MessageEndpoint T>
 struct is_message_endpoint<T, std::enable_if_t<std::is_base_of_v<IMessageEndpoint, T>>> : std::true_type {};
 
+/**
+ * @brief Batching policy for stream message writes.
+ *
+ * Messages that queue up behind an in-flight write always leave together in
+ * the next write. A non-zero window additionally holds a batch back for that
+ * long after its first message so more messages can join, unless it already
+ * holds max_batch_bytes. Senders wait out the window before taking the write
+ * lock, so it never delays a write in flight.
+ */
+struct StreamWriteCoalescing {
+    std::chrono::microseconds window{0};
+    std::size_t max_batch_bytes = 64U * 1024U;
+};
+
+/**
+ * @brief Per-connection read-ahead buffer for framed stream protocols.
+ *
+ * Every read asks the stream for as much as the free space allows, so a burst
+ * of small frames is drained with one read and then parsed out of memory.
+ * Reads at least as large as the buffer bypass it and go straight into the
+ * destination.
+ */
+class StreamReadBuffer {
+public:
+    static constexpr std::size_t KDefaultCapacity = 64U * 1024U;
+
+    explicit StreamReadBuffer(std::error_code unexpectedEof = ilias::IoError::UnexpectedEOF,
+                              std::size_t capacity          = KDefaultCapacity)
+        : mUnexpectedEof(unexpectedEof), mCapacity(capacity == 0U ? 1U : capacity) {}
+
+    /// Bytes already read from the stream and not consumed yet.
+    auto buffered() const noexcept -> std::span<const std::byte> { return {mStorage.data() + mBegin, mEnd - mBegin}; }
+    auto size() const noexcept -> std::size_t { return mEnd - mBegin; }
+    auto capacity() const noexcept -> std::size_t { return mCapacity; }
+    /// Number of stream reads issued so far.
+    auto readCount() const noexcept -> std::size_t { return mReadCount; }
+
+    auto consume(std::size_t count) noexcept -> void {
+        mBegin += std::min(count, size());
+        if (mBegin == mEnd) {
+            mBegin = 0;
+            mEnd   = 0;
+        }
+    }
+    auto clear() noexcept -> void {
+        mBegin = 0;
+        mEnd   = 0;
+    }
+
+    /**
+     * @brief Read until at least @p minimum bytes are buffered.
+     *
+     * The buffer grows past its capacity only when @p minimum requires it.
+     */
+    template <CommunicationStream StreamT>
+    auto fill(StreamT& stream, std::size_t minimum) -> ilias::IoTask<void> {
+        while (size() < minimum) {
+            if (mStorage.size() - mEnd < minimum - size()) {
+                _compact();
+            }
+            if (mStorage.size() < std::max(minimum, mCapacity)) {
+                mStorage.resize(std::max(minimum, mCapacity));
+            }
+            ILIAS_CO_TRY(auto readSize, co_await stream.read({mStorage.data() + mEnd, mStorage.size() - mEnd}));
+            ++mReadCount;
+            if (readSize == 0U) {
+                co_return ilias::Err(mUnexpectedEof);
+            }
+            mEnd += readSize;
+        }
+        co_return {};
+    }
+
+    /// Fill @p buffer completely, from buffered bytes first and then from the stream.
+    template <CommunicationStream StreamT>
+    auto readExact(StreamT& stream, std::span<std::byte> buffer) -> ilias::IoTask<void> {
+        auto copied = std::min(size(), buffer.size());
+        if (copied != 0U) {
+            std::memcpy(buffer.data(), mStorage.data() + mBegin, copied);
+            consume(copied);
+            buffer = buffer.subspan(copied);
+        }
+        if (buffer.empty()) {
+            co_return {};
+        }
+        if (buffer.size() < mCapacity) {
+            ILIAS_CO_TRYV(co_await fill(stream, buffer.size()));
+            std::memcpy(buffer.data(), mStorage.data() + mBegin, buffer.size());
+            consume(buffer.size());
+            co_return {};
+        }
+        while (!buffer.empty()) {
+            ILIAS_CO_TRY(auto readSize, co_await stream.read(buffer));
+            ++mReadCount;
+            if (readSize == 0U) {
+                co_return ilias::Err(mUnexpectedEof);
+            }
+            buffer = buffer.subspan(readSize);
+        }
+        co_return {};
+    }
+
+private:
+    auto _compact() noexcept -> void {
+        if (mBegin == 0U) {
+            return;
+        }
+        std::memmove(mStorage.data(), mStorage.data() + mBegin, size());
+        mEnd -= mBegin;
+        mBegin = 0;
+    }
+
+private:
+    std::vector<std::byte> mStorage;
+    std::size_t mBegin             = 0;
+    std::size_t mEnd               = 0;
+    std::size_t mReadCount         = 0;
+    std::error_code mUnexpectedEof = ilias::IoError::UnexpectedEOF;
+    std::size_t mCapacity          = KDefaultCapacity;
+};
+
 template <CommunicationStream StreamT>
 class LengthPrefixedStreamMessageEndpoint {
 public:
@@ -185,40 +421,91 @@ public:
         : mStream(std::move(stream)), mMessageTooLarge(messageTooLarge), mMaxMessageBytes(maxMessageBytes) {}
 
     auto recv(std::vector<std::byte>& buffer) -> ilias::IoTask<std::size_t> {
-        ILIAS_CO_TRY(auto size, co_await ilias::io::readU32Le(mStream));
-        if (size > mMaxMessageBytes) {
-            co_return ilias::Err(mMessageTooLarge);
-        }
+        ILIAS_CO_TRY(auto size, co_await _recvLength());
+        mReadBuffer.consume(KLengthBytes);
         buffer.resize(size);
         if (size == 0U) {
             co_return buffer.size();
         }
 
-        ILIAS_CO_TRY(auto bodySize,
-                     co_await (ilias::io::readAll(mStream, std::span<std::byte>{buffer.data(), buffer.size()}) |
-                               ilias::unstoppable()));
-        if (bodySize != buffer.size()) {
-            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
-        }
+        ILIAS_CO_TRYV(co_await (mReadBuffer.readExact(mStream, std::span<std::byte>{buffer.data(), buffer.size()}) |
+                                ilias::unstoppable()));
         co_return buffer.size();
     }
 
+    /**
+     * @brief Receive one message without copying it out of the read-ahead buffer.
+     *
+     * The returned view stays valid until the next recv or recvView call on
+     * this endpoint. Messages larger than the read-ahead buffer are assembled
+     * in a side buffer instead.
+     */
+    auto recvView() -> ilias::IoTask<std::span<const std::byte>> {
+        ILIAS_CO_TRY(auto size, co_await _recvLength());
+        if (KLengthBytes + size <= mReadBuffer.capacity()) {
+            ILIAS_CO_TRYV(co_await mReadBuffer.fill(mStream, KLengthBytes + size));
+            mPendingBytes = KLengthBytes + size;
+            co_return mReadBuffer.buffered().subspan(KLengthBytes, size);
+        }
+        mReadBuffer.consume(KLengthBytes);
+        mLargeMessage.resize(size);
+        ILIAS_CO_TRYV(co_await (mReadBuffer.readExact(mStream, std::span<std::byte>{mLargeMessage}) |
+                                ilias::unstoppable()));
+        co_return std::span<const std::byte>{mLargeMessage};
+    }
+
+    /// Number of reads issued on the underlying stream.
+    auto readCount() const noexcept -> std::size_t { return mReadBuffer.readCount(); }
+
+    /**
+     * @brief Send one message and return once it has been written.
+     *
+     * A message larger than the batch limit, or one that finds the connection
+     * idle with no coalescing window, is written straight from @p buffer after
+     * anything queued ahead of it. Smaller messages that meet a write in flight
+     * are copied into the next batch, so concurrent senders share writes and
+     * flushes.
+     */
     auto send(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> {
-        auto guard = co_await mWriteMutex->lock();
         if (buffer.size() > std::numeric_limits<std::uint32_t>::max() || buffer.size() > mMaxMessageBytes) {
             co_return ilias::Err(mMessageTooLarge);
         }
-        ILIAS_CO_TRYV(co_await ilias::io::writeU32Le(mStream, static_cast<std::uint32_t>(buffer.size())));
-        ILIAS_CO_TRY(auto writtenSize, co_await (ilias::io::writeAll(mStream, buffer) | ilias::unstoppable()));
-        if (writtenSize != buffer.size()) {
-            co_return ilias::Err(ilias::IoError::WriteZero);
+        auto& queue = *mWriteQueue;
+        if (queue.error) {
+            co_return ilias::Err(queue.error);
         }
-        if (auto flushRet = co_await flush(); !flushRet) {
-            co_return ilias::Err(flushRet.error());
+        const auto size = static_cast<std::uint32_t>(buffer.size());
+        std::array<std::byte, KLengthBytes> prefix{};
+        for (std::size_t idx = 0; idx < KLengthBytes; ++idx) {
+            prefix[idx] = static_cast<std::byte>((size >> (idx * 8U)) & 0xFFU);
+        }
+        const bool idle = queue.senders == 0U && queue.coalescing.window.count() == 0;
+        ++queue.senders;
+        struct SenderGuard {
+            WriteQueue& queue;
+            ~SenderGuard() { --queue.senders; }
+        } senderGuard{queue};
+        // Once started or queued the message is written even if this sender is cancelled.
+        if (idle || buffer.size() > queue.coalescing.max_batch_bytes) {
+            ILIAS_CO_TRYV(co_await (_writeDirect(prefix, buffer) | ilias::unstoppable()));
+            co_return buffer.size();
+        }
+        if (queue.pending.empty()) {
+            queue.batchDeadline = std::chrono::steady_clock::now() + queue.coalescing.window;
         }
+        queue.pending.insert(queue.pending.end(), prefix.begin(), prefix.end());
+        queue.pending.insert(queue.pending.end(), buffer.begin(), buffer.end());
+        ILIAS_CO_TRYV(co_await (_drainWrites(++queue.queued) | ilias::unstoppable()));
         co_return buffer.size();
     }
 
+    auto setWriteCoalescing(const StreamWriteCoalescing& coalescing) noexcept -> void {
+        mWriteQueue->coalescing = coalescing;
+    }
+    auto writeCoalescing() const noexcept -> const StreamWriteCoalescing& { return mWriteQueue->coalescing; }
+    /// Number of batched writes issued on the underlying stream.
+    auto writeCount() const noexcept -> std::size_t { return mWriteQueue->writes; }
+
     auto close() -> void { close_stream(mStream); }
     auto shutdown() -> ilias::IoTask<void> { co_return co_await shutdown_stream(mStream); }
     auto flush() -> ilias::IoTask<void> { co_return co_await flush_stream(mStream); }
@@ -228,10 +515,107 @@ protected:
     auto _stream() const noexcept -> const StreamT& { return mStream; }
 
 private:
+    static constexpr std::size_t KLengthBytes = sizeof(std::uint32_t);
+
+    /// Release the previous view, then buffer and decode the next length prefix without consuming it.
+    auto _recvLength() -> ilias::IoTask<std::size_t> {
+        mReadBuffer.consume(std::exchange(mPendingBytes, 0U));
+        ILIAS_CO_TRYV(co_await mReadBuffer.fill(mStream, KLengthBytes));
+        const auto prefix = mReadBuffer.buffered();
+        std::size_t size  = 0;
+        for (std::size_t idx = KLengthBytes; idx > 0; --idx) {
+            size = (size << 8U) | std::to_integer<std::size_t>(prefix[idx - 1]);
+        }
+        if (size > mMaxMessageBytes) {
+            co_return ilias::Err(mMessageTooLarge);
+        }
+        co_return size;
+    }
+
+    struct WriteQueue {
+        ilias::Mutex mutex;
+        StreamWriteCoalescing coalescing;
+        std::vector<std::byte> pending;
+        std::vector<std::byte> writing;
+        std::vector<std::byte> scratch; // small pieces gathered by write_stream_pieces
+        std::uint64_t queued    = 0;    // ticket of the last queued message
+        std::uint64_t committed = 0;    // ticket of the last message known to be written
+        std::size_t senders     = 0;    // sends that have not returned yet
+        std::size_t writes      = 0;
+        std::chrono::steady_clock::time_point batchDeadline; // the pending batch stops waiting for more messages
+        std::error_code error;
+    };
+
+    /// Wait until message @p ticket is written, writing the pending batch when this sender gets the lock first.
+    auto _drainWrites(std::uint64_t ticket) -> ilias::IoTask<void> {
+        auto& queue = *mWriteQueue;
+        // Sleep without the lock, so the batch ahead keeps writing and more senders can join this one.
+        if (queue.coalescing.window.count() > 0 && queue.pending.size() < queue.coalescing.max_batch_bytes) {
+            const auto now = std::chrono::steady_clock::now();
+            if (ticket > queue.committed && now < queue.batchDeadline) {
+                co_await ilias::sleep(
+                    std::chrono::duration_cast<decltype(queue.coalescing.window)>(queue.batchDeadline - now));
+            }
+        }
+        auto guard = co_await queue.mutex.lock();
+        if (ticket <= queue.committed) {
+            co_return {};
+        }
+        if (queue.error) {
+            co_return ilias::Err(queue.error);
+        }
+        co_return co_await _writeLocked({}, {});
+    }
+
+    /// Write one message from the caller's memory, behind the batch already queued.
+    auto _writeDirect(std::span<const std::byte> prefix, std::span<const std::byte> body) -> ilias::IoTask<void> {
+        auto& queue = *mWriteQueue;
+        auto guard  = co_await queue.mutex.lock();
+        if (queue.error) {
+            co_return ilias::Err(queue.error);
+        }
+        co_return co_await _writeLocked(prefix, body);
+    }
+
+    /// Write the pending batch followed by @p prefix and @p body; the caller holds the queue mutex.
+    auto _writeLocked(std::span<const std::byte> prefix, std::span<const std::byte> body) -> ilias::IoTask<void> {
+        auto& queue = *mWriteQueue;
+        std::swap(queue.pending, queue.writing);
+        const auto batchEnd = queue.queued;
+        std::array<std::span<const std::byte>, 3> pieces{};
+        std::size_t count    = 0;
+        std::size_t expected = 0;
+        for (const auto piece : {std::span<const std::byte>{queue.writing}, prefix, body}) {
+            if (!piece.empty()) {
+                pieces[count++] = piece;
+                expected += piece.size();
+            }
+        }
+        auto written = co_await write_stream_pieces(mStream, std::span{pieces.data(), count}, queue.scratch);
+        ++queue.writes;
+        queue.writing.clear();
+        if (queue.writing.capacity() > queue.coalescing.max_batch_bytes * 4U) {
+            queue.writing.shrink_to_fit();
+        }
+        if (!written || written.value() != expected) {
+            queue.error = written ? std::error_code{ilias::IoError::WriteZero} : written.error();
+            co_return ilias::Err(queue.error);
+        }
+        if (auto flushRet = co_await flush(); !flushRet) {
+            queue.error = flushRet.error();
+            co_return ilias::Err(queue.error);
+        }
+        queue.committed = batchEnd;
+        co_return {};
+    }
+
     StreamT mStream;
     std::error_code mMessageTooLarge = ilias::IoError::MessageTooLarge;
     std::size_t mMaxMessageBytes = 16U * 1024U * 1024U;
-    std::unique_ptr<ilias::Mutex> mWriteMutex = std::make_unique<ilias::Mutex>();
+    std::unique_ptr<WriteQueue> mWriteQueue = std::make_unique<WriteQueue>();
+    StreamReadBuffer mReadBuffer;
+    std::size_t mPendingBytes = 0;
+    std::vector<std::byte> mLargeMessage;
 };
 
 template <typename DatagramT, typename EndpointT>
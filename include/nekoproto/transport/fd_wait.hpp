@@ -0,0 +1,109 @@
+#pragma once
+
+// Reactor-driven readiness waits for endpoints that own raw descriptors.
+
+#include "nekoproto/global/global.hpp"
+
+#if defined(__linux__)
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <ilias/io/context.hpp>
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/task.hpp>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+/// A private epoll set registered with the current IoContext for one wait.
+struct FdWaitSet {
+    int epoll                       = -1;
+    ilias::IoContext* context       = nullptr;
+    ilias::IoDescriptor* descriptor = nullptr;
+
+    FdWaitSet()                                    = default;
+    FdWaitSet(const FdWaitSet&)                    = delete;
+    auto operator=(const FdWaitSet&) -> FdWaitSet& = delete;
+    ~FdWaitSet() {
+        if (descriptor != nullptr) {
+            (void)context->removeDescriptor(descriptor);
+        }
+        if (epoll >= 0) {
+            ::close(epoll);
+        }
+    }
+
+    template <std::size_t N>
+    auto open(const std::array<pollfd, N>& fds) -> ilias::Result<void, std::error_code> {
+        context = ilias::IoContext::currentThread();
+        if (context == nullptr) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        for (const auto& fd : fds) {
+            epoll_event event{};
+            event.events  = static_cast<std::uint32_t>(static_cast<unsigned short>(fd.events));
+            event.data.fd = fd.fd;
+            if (::epoll_ctl(epoll, EPOLL_CTL_ADD, fd.fd, &event) != 0) {
+                return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+        }
+        auto added = context->addDescriptor(epoll, ilias::IoDescriptor::Unknown);
+        if (!added) {
+            return ilias::Err(added.error());
+        }
+        descriptor = *added;
+        return {};
+    }
+};
+
+/**
+ * @brief Wait until one of @p fds is ready, returning their revents.
+ *
+ * A ready descriptor is reported without suspending. Otherwise the fds go
+ * into a private epoll set that the current IoContext polls like any other
+ * descriptor, so the wait parks no thread and stopping the task cancels the
+ * reactor poll with IoError::Canceled. @p owner keeps the descriptors open
+ * until the wait ends, the endpoint may be moved or destroyed meanwhile.
+ */
+template <std::size_t N>
+auto poll_fds(std::shared_ptr<const void> owner, std::array<pollfd, N> fds) -> ilias::IoTask<std::array<pollfd, N>> {
+    (void)owner;
+    FdWaitSet set;
+    while (true) {
+        int count = 0;
+        do {
+            count = ::poll(fds.data(), fds.size(), 0);
+        } while (count < 0 && errno == EINTR);
+        if (count < 0) {
+            co_return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        if (count > 0) {
+            co_return fds;
+        }
+        if (set.descriptor == nullptr) {
+            if (auto opened = set.open(fds); !opened) {
+                co_return ilias::Err(opened.error());
+            }
+        }
+        ILIAS_CO_TRYV(co_await set.context->poll(set.descriptor, EPOLLIN));
+    }
+}
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
+#endif
@@ -0,0 +1,565 @@
+#pragma once
+
+// Datagram message endpoint that splits large messages into fragments and reassembles them.
+
+#include "nekoproto/global/log.hpp"
+#include "nekoproto/transport/endpoint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/sync/mutex.hpp>
+#include <ilias/task.hpp>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+struct DatagramFragmentOptions {
+    std::size_t max_datagram_bytes   = 1472U; // fragment payload plus trailer; both peers must agree
+    std::size_t max_message_bytes    = 16U * 1024U * 1024U;
+    std::size_t max_reassembly_bytes = 64U * 1024U * 1024U; // all partial messages together, oldest go first
+    std::chrono::milliseconds reassembly_timeout{2000};
+    bool selective_ack = false; // receivers report gaps and senders resend the missing fragments
+    std::chrono::milliseconds ack_delay{20};
+    std::size_t retain_bytes = 4U * 1024U * 1024U; // sent messages kept for resending
+};
+
+/**
+ * @brief Datagram message endpoint for messages larger than one datagram.
+ *
+ * Every datagram carries a 16-byte trailer with the message id, the total
+ * message size and the fragment index, so it does not interoperate with
+ * ChunkedDatagramMessageEndpoint. A message of one fragment is received
+ * straight into the caller's buffer. Once the first fragment of a larger
+ * message has arrived the whole destination is allocated, and each further
+ * fragment that arrives in order is received directly at its final offset.
+ * Only fragments that arrive out of order are copied. Partial messages are
+ * dropped after reassembly_timeout or when max_reassembly_bytes runs out.
+ *
+ * With selective_ack, a receiver that has heard nothing new for ack_delay
+ * sends a bitmap of the fragments it holds, and the sender resends the
+ * missing ones from a copy it retains. Messages are not acknowledged
+ * otherwise, so a message whose every fragment is lost stays lost. Acks are
+ * handled inside recv(), so resends need a receive loop running, as an rpc
+ * client or server always has.
+ */
+template <typename DatagramT, typename EndpointT>
+    requires DatagramPeerEndpoint<DatagramT, EndpointT>
+class FragmentedDatagramMessageEndpoint {
+public:
+    using Options = DatagramFragmentOptions;
+    using Clock   = std::chrono::steady_clock;
+
+    struct Metrics {
+        std::uint64_t messages_sent      = 0;
+        std::uint64_t fragments_sent     = 0;
+        std::uint64_t messages_received  = 0;
+        std::uint64_t fragments_received = 0;
+        std::uint64_t in_place_fragments = 0; // received at their final offset without a copy
+        std::uint64_t expired            = 0; // partial messages dropped after reassembly_timeout
+        std::uint64_t evicted            = 0; // partial messages dropped for max_reassembly_bytes
+        std::uint64_t dropped_fragments  = 0; // malformed, duplicate, or acks matching no retained message
+        std::uint64_t acks_sent          = 0;
+        std::uint64_t ack_failures       = 0; // acks that could not be sent
+        std::uint64_t fragments_resent   = 0;
+    };
+
+    static constexpr std::size_t KTrailerBytes = 16U;
+
+    FragmentedDatagramMessageEndpoint(DatagramT&& datagram, EndpointT endpoint, Options options = {},
+                                      std::error_code messageTooLarge = ilias::IoError::MessageTooLarge)
+        : mDatagram(std::move(datagram)), mEndpoint(std::move(endpoint)), mOptions(options),
+          mMessageTooLarge(messageTooLarge), mNextId(std::random_device{}()) {
+        mOptions.max_datagram_bytes = std::max(mOptions.max_datagram_bytes, KTrailerBytes + 1U);
+        mPayloadBytes               = mOptions.max_datagram_bytes - KTrailerBytes;
+        mSendBuffer.resize(mOptions.max_datagram_bytes);
+    }
+
+    auto options() const noexcept -> const Options& { return mOptions; }
+    auto metrics() const noexcept -> const Metrics& { return mMetrics; }
+
+    auto recv(std::vector<std::byte>& buffer) -> ilias::IoTask<std::size_t> {
+        const auto current = buffer.size();
+        while (true) {
+            ILIAS_CO_TRYV(co_await _expire());
+            const auto predicted  = _predict();
+            const bool intoBuffer = predicted == mPartials.end();
+            std::span<std::byte> target;
+            std::array<std::byte, KTrailerBytes> saved{};
+            std::byte* savedAt = nullptr;
+            if (!intoBuffer) {
+                // Receive where the next fragment of this message belongs. Its
+                // trailer then lands on the start of the following fragment,
+                // so those bytes are put back if that fragment is already here.
+                target = {predicted->data.data() + predicted->cursor * mPayloadBytes, mOptions.max_datagram_bytes};
+                if (predicted->cursor + 1U < predicted->fragments && predicted->have[predicted->cursor + 1U]) {
+                    savedAt = target.data() + mPayloadBytes;
+                    std::memcpy(saved.data(), savedAt, saved.size());
+                }
+            } else {
+                buffer.resize(current + mOptions.max_datagram_bytes);
+                target = {buffer.data() + current, mOptions.max_datagram_bytes};
+            }
+            const auto restore = [&]() {
+                if (savedAt != nullptr) {
+                    std::memcpy(savedAt, saved.data(), saved.size());
+                }
+            };
+            const auto truncate = [&]() {
+                if (intoBuffer) {
+                    buffer.resize(current);
+                }
+            };
+
+            std::optional<ilias::Result<std::pair<std::size_t, EndpointT>, std::error_code>> ret;
+            if (mPartials.empty()) {
+                ret.emplace(co_await mDatagram.recvfrom(target));
+            } else {
+                auto received = co_await ilias::timeout(mDatagram.recvfrom(target), _untilNextDeadline());
+                if (!received) {
+                    restore();
+                    truncate();
+                    continue;
+                }
+                ret.emplace(std::move(*received));
+            }
+            if (!*ret) {
+                restore();
+                truncate();
+                co_return ilias::Err(ret->error());
+            }
+
+            const auto size = ret->value().first;
+            auto& source    = ret->value().second;
+            Trailer trailer;
+            const bool valid = size >= KTrailerBytes && trailer.unpack(target.subspan(size - KTrailerBytes));
+            restore();
+            if (!valid) {
+                truncate();
+                ++mMetrics.dropped_fragments;
+                continue;
+            }
+            std::span<const std::byte> payload = target.first(size - KTrailerBytes);
+            if (trailer.kind == Trailer::KAck) {
+                auto acked = co_await _onAck(trailer, payload, source);
+                truncate();
+                if (!acked) {
+                    co_return ilias::Err(acked.error());
+                }
+                continue;
+            }
+            if (!_validFragment(trailer, payload.size())) {
+                truncate();
+                ++mMetrics.dropped_fragments;
+                continue;
+            }
+            ++mMetrics.fragments_received;
+
+            if (trailer.total <= mPayloadBytes) {
+                if (intoBuffer) {
+                    buffer.resize(current + payload.size());
+                } else {
+                    buffer.insert(buffer.end(), payload.begin(), payload.end());
+                }
+                mEndpoint = std::move(source);
+                ++mMetrics.messages_received;
+                co_return payload.size();
+            }
+
+            auto partial = _findPartial(trailer.id, source);
+            if (partial == mPartials.end()) {
+                if (_recentlyCompleted(trailer.id, source)) {
+                    truncate();
+                    ++mMetrics.dropped_fragments;
+                    continue;
+                }
+                if (!intoBuffer) {
+                    // Starting a partial may evict the one this datagram was received into.
+                    mScratch.assign(payload.begin(), payload.end());
+                    payload = mScratch;
+                }
+                partial = _startPartial(trailer, source);
+                if (partial == mPartials.end()) {
+                    truncate();
+                    continue;
+                }
+            }
+            // The index was checked against this datagram's total only, which must be the one the buffers were
+            // sized for.
+            if (trailer.total != partial->total || partial->have[trailer.index]) {
+                truncate();
+                ++mMetrics.dropped_fragments;
+                continue;
+            }
+            auto* destination = partial->data.data() + trailer.index * mPayloadBytes;
+            if (destination == payload.data()) {
+                ++mMetrics.in_place_fragments;
+            } else {
+                std::memmove(destination, payload.data(), payload.size());
+            }
+            truncate();
+            _markReceived(partial, trailer.index);
+            if (partial->received < partial->fragments) {
+                continue;
+            }
+
+            const auto total = partial->total;
+            auto data        = std::move(partial->data);
+            data.resize(total);
+            _rememberCompleted(partial->id, partial->source);
+            _dropPartial(partial);
+            mEndpoint = std::move(source);
+            ++mMetrics.messages_received;
+            if (current == 0U) {
+                buffer = std::move(data);
+            } else {
+                buffer.insert(buffer.end(), data.begin(), data.end());
+            }
+            co_return static_cast<std::size_t>(total);
+        }
+    }
+
+    auto send(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> {
+        if (buffer.size() > mOptions.max_message_bytes || buffer.size() > KMaxMessageBytes) {
+            co_return ilias::Err(mMessageTooLarge);
+        }
+        const auto fragments = std::max<std::size_t>((buffer.size() + mPayloadBytes - 1U) / mPayloadBytes, 1U);
+        const auto id        = mNextId++;
+        auto guard           = co_await mSendMutex->lock();
+        for (std::size_t index = 0; index < fragments; ++index) {
+            ILIAS_CO_TRYV(co_await _sendFragment(buffer, id, index, mEndpoint));
+        }
+        ++mMetrics.messages_sent;
+        if (mOptions.selective_ack && fragments > 1U) {
+            _retain(id, buffer, mEndpoint);
+        }
+        co_return buffer.size();
+    }
+
+    auto close() -> void { mDatagram.close(); }
+    auto shutdown() -> ilias::IoTask<void> { co_return {}; }
+    auto flush() -> ilias::IoTask<void> { co_return {}; }
+
+protected:
+    auto _datagram() noexcept -> DatagramT& { return mDatagram; }
+    auto _endpoint() noexcept -> EndpointT& { return mEndpoint; }
+
+private:
+    /// Little-endian: kind, reserved[3], id, total size, fragment index (or first bit of an ack bitmap).
+    struct Trailer {
+        static constexpr std::uint8_t KData = 0xD1;
+        static constexpr std::uint8_t KAck  = 0xA1;
+
+        std::uint8_t kind  = KData;
+        std::uint32_t id    = 0;
+        std::uint32_t total = 0;
+        std::uint32_t index = 0;
+
+        auto pack(std::byte* out) const -> void {
+            out[0] = static_cast<std::byte>(kind);
+            out[1] = out[2] = out[3] = std::byte{0};
+            _store(out + 4, id);
+            _store(out + 8, total);
+            _store(out + 12, index);
+        }
+
+        auto unpack(std::span<const std::byte> in) -> bool {
+            kind  = static_cast<std::uint8_t>(in[0]);
+            id    = _load(in.data() + 4);
+            total = _load(in.data() + 8);
+            index = _load(in.data() + 12);
+            return kind == KData || kind == KAck;
+        }
+
+        static auto _store(std::byte* out, std::uint32_t value) -> void {
+            for (std::size_t idx = 0; idx < 4U; ++idx) {
+                out[idx] = static_cast<std::byte>(value >> (idx * 8U));
+            }
+        }
+        static auto _load(const std::byte* in) -> std::uint32_t {
+            std::uint32_t value = 0;
+            for (std::size_t idx = 0; idx < 4U; ++idx) {
+                value |= static_cast<std::uint32_t>(in[idx]) << (idx * 8U);
+            }
+            return value;
+        }
+    };
+
+    struct Partial {
+        std::uint32_t id    = 0;
+        std::uint32_t total = 0;
+        EndpointT source;
+        std::size_t fragments = 0;
+        std::size_t received  = 0;
+        std::size_t cursor    = 0; // first missing fragment after the last one received
+        std::size_t reserved  = 0;
+        std::vector<bool> have;
+        std::vector<std::byte> data; // trailer-sized slack at the end, in-place receives of the last fragment use it
+        Clock::time_point started;
+        Clock::time_point nextAck;
+    };
+
+    struct Retained {
+        std::uint32_t id = 0;
+        EndpointT destination;
+        std::shared_ptr<const std::vector<std::byte>> data;
+    };
+
+    using PartialIter = typename std::list<Partial>::iterator;
+
+    auto _fragmentSize(std::size_t total, std::size_t index) const -> std::size_t {
+        return std::min(mPayloadBytes, total - index * mPayloadBytes);
+    }
+
+    auto _validFragment(const Trailer& trailer, std::size_t payloadSize) const -> bool {
+        if (trailer.total > mOptions.max_message_bytes) {
+            return false;
+        }
+        const auto fragments = std::max<std::size_t>((trailer.total + mPayloadBytes - 1U) / mPayloadBytes, 1U);
+        if (trailer.index >= fragments) {
+            return false;
+        }
+        return trailer.total == 0U ? payloadSize == 0U : payloadSize == _fragmentSize(trailer.total, trailer.index);
+    }
+
+    static auto _samePeer(const EndpointT& lhs, const EndpointT& rhs) -> bool {
+        if constexpr (std::equality_comparable<EndpointT>) {
+            return lhs == rhs;
+        } else {
+            return true;
+        }
+    }
+
+    /// Partials are kept in order of activity, so the last one most likely owns the next datagram.
+    auto _predict() -> PartialIter { return mPartials.empty() ? mPartials.end() : std::prev(mPartials.end()); }
+
+    auto _findPartial(std::uint32_t id, const EndpointT& source) -> PartialIter {
+        return std::find_if(mPartials.begin(), mPartials.end(), [&](const Partial& partial) {
+            return partial.id == id && _samePeer(partial.source, source);
+        });
+    }
+
+    auto _startPartial(const Trailer& trailer, const EndpointT& source) -> PartialIter {
+        const auto fragments = (static_cast<std::size_t>(trailer.total) + mPayloadBytes - 1U) / mPayloadBytes;
+        const auto reserved  = fragments * mPayloadBytes + KTrailerBytes;
+        if (reserved > mOptions.max_reassembly_bytes) {
+            ++mMetrics.evicted;
+            return mPartials.end();
+        }
+        // The front partial is the one that has been quiet the longest.
+        while (mReassemblyBytes + reserved > mOptions.max_reassembly_bytes && !mPartials.empty()) {
+            _dropPartial(mPartials.begin());
+            ++mMetrics.evicted;
+        }
+        Partial partial;
+        partial.id        = trailer.id;
+        partial.total     = trailer.total;
+        partial.source    = source;
+        partial.fragments = fragments;
+        partial.reserved  = reserved;
+        partial.have.assign(fragments, false);
+        partial.data.resize(reserved);
+        partial.started = Clock::now();
+        partial.nextAck = partial.started + mOptions.ack_delay;
+        mReassemblyBytes += reserved;
+        return mPartials.insert(mPartials.end(), std::move(partial));
+    }
+
+    auto _markReceived(PartialIter partial, std::size_t index) -> void {
+        partial->have[index] = true;
+        ++partial->received;
+        partial->cursor = index + 1U;
+        while (partial->cursor < partial->fragments && partial->have[partial->cursor]) {
+            ++partial->cursor;
+        }
+        if (partial->cursor == partial->fragments) {
+            partial->cursor = static_cast<std::size_t>(
+                std::distance(partial->have.begin(), std::find(partial->have.begin(), partial->have.end(), false)));
+        }
+        partial->nextAck = Clock::now() + mOptions.ack_delay;
+        mPartials.splice(mPartials.end(), mPartials, partial);
+    }
+
+    auto _dropPartial(PartialIter partial) -> void {
+        mReassemblyBytes -= partial->reserved;
+        mPartials.erase(partial);
+    }
+
+    auto _recentlyCompleted(std::uint32_t id, const EndpointT& source) const -> bool {
+        return std::any_of(mCompleted.begin(), mCompleted.end(), [&](const auto& completed) {
+            return completed.first == id && _samePeer(completed.second, source);
+        });
+    }
+
+    /// Late resends of a finished message must not start a new partial that can never complete.
+    auto _rememberCompleted(std::uint32_t id, const EndpointT& source) -> void {
+        mCompleted.emplace_back(id, source);
+        if (mCompleted.size() > KCompletedHistory) {
+            mCompleted.pop_front();
+        }
+    }
+
+    auto _untilNextDeadline() const -> std::chrono::milliseconds {
+        auto deadline = Clock::time_point::max();
+        for (const auto& partial : mPartials) {
+            deadline = std::min(deadline, partial.started + mOptions.reassembly_timeout);
+            if (mOptions.selective_ack) {
+                deadline = std::min(deadline, partial.nextAck);
+            }
+        }
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+        return std::max(remaining, std::chrono::milliseconds(1));
+    }
+
+    /// Drop partial messages past reassembly_timeout and send the acks that are due.
+    auto _expire() -> ilias::IoTask<void> {
+        const auto now = Clock::now();
+        for (auto partial = mPartials.begin(); partial != mPartials.end();) {
+            if (now >= partial->started + mOptions.reassembly_timeout) {
+                _rememberCompleted(partial->id, partial->source);
+                _dropPartial(partial++);
+                ++mMetrics.expired;
+                continue;
+            }
+            if (mOptions.selective_ack && now >= partial->nextAck) {
+                partial->nextAck = now + mOptions.ack_delay;
+                // An ack only speeds up retransmission, so a failed send
+                // must not fail the receive and end the server loop.
+                if (auto acked = co_await _sendAck(*partial); !acked) {
+                    ++mMetrics.ack_failures;
+                    NEKO_LOG_WARN("transport", "fragment ack for message {} not sent: {}", partial->id,
+                                  acked.error().message());
+                }
+            }
+            ++partial;
+        }
+        co_return {};
+    }
+
+    /// Report the fragments held from the first missing one on, as many as one datagram can describe.
+    auto _sendAck(const Partial& partial) -> ilias::IoTask<void> {
+        auto guard       = co_await mSendMutex->lock();
+        const auto first = std::distance(partial.have.begin(),
+                                         std::find(partial.have.begin(), partial.have.end(), false));
+        const auto bits  = std::min(partial.fragments - static_cast<std::size_t>(first), mPayloadBytes * 8U);
+        const auto bytes = (bits + 7U) / 8U;
+        std::fill_n(mSendBuffer.begin(), bytes, std::byte{0});
+        for (std::size_t bit = 0; bit < bits; ++bit) {
+            if (partial.have[static_cast<std::size_t>(first) + bit]) {
+                mSendBuffer[bit / 8U] |= static_cast<std::byte>(1U << (bit % 8U));
+            }
+        }
+        Trailer trailer;
+        trailer.kind  = Trailer::KAck;
+        trailer.id    = partial.id;
+        trailer.total = static_cast<std::uint32_t>(partial.fragments);
+        trailer.index = static_cast<std::uint32_t>(first);
+        trailer.pack(mSendBuffer.data() + bytes);
+        ILIAS_CO_TRY(auto sent, co_await mDatagram.sendto({mSendBuffer.data(), bytes + KTrailerBytes}, partial.source));
+        (void)sent;
+        ++mMetrics.acks_sent;
+        co_return {};
+    }
+
+    /// Acks are only honoured from the peer the message went to, anyone else could make us resend it.
+    auto _onAck(const Trailer& trailer, std::span<const std::byte> bitmap, const EndpointT& source)
+        -> ilias::IoTask<void> {
+        const auto retained = std::find_if(mRetained.begin(), mRetained.end(), [&](const Retained& message) {
+            return message.id == trailer.id && _samePeer(message.destination, source);
+        });
+        if (retained == mRetained.end()) {
+            ++mMetrics.dropped_fragments;
+            co_return {};
+        }
+        // Newer sends may evict the message while a resend waits, so hold on to it here.
+        const auto message     = retained->data;
+        const auto destination = retained->destination;
+        const auto fragments   = (message->size() + mPayloadBytes - 1U) / mPayloadBytes;
+        auto guard             = co_await mSendMutex->lock();
+        for (std::size_t bit = 0; bit < bitmap.size() * 8U; ++bit) {
+            const auto index = static_cast<std::size_t>(trailer.index) + bit;
+            if (index >= fragments) {
+                break;
+            }
+            if ((static_cast<unsigned>(bitmap[bit / 8U]) & (1U << (bit % 8U))) == 0U) {
+                ILIAS_CO_TRYV(co_await _sendFragment(*message, trailer.id, index, destination));
+                ++mMetrics.fragments_resent;
+            }
+        }
+        co_return {};
+    }
+
+    /// Callers hold mSendMutex, mSendBuffer is shared.
+    auto _sendFragment(std::span<const std::byte> message, std::uint32_t id, std::size_t index,
+                       const EndpointT& destination) -> ilias::IoTask<void> {
+        const auto offset = index * mPayloadBytes;
+        const auto size   = message.empty() ? 0U : _fragmentSize(message.size(), index);
+        if (size > 0U) {
+            std::memcpy(mSendBuffer.data(), message.data() + offset, size);
+        }
+        Trailer trailer;
+        trailer.id    = id;
+        trailer.total = static_cast<std::uint32_t>(message.size());
+        trailer.index = static_cast<std::uint32_t>(index);
+        trailer.pack(mSendBuffer.data() + size);
+        ILIAS_CO_TRY(auto sent, co_await mDatagram.sendto({mSendBuffer.data(), size + KTrailerBytes}, destination));
+        if (sent != size + KTrailerBytes) {
+            co_return ilias::Err(mMessageTooLarge);
+        }
+        ++mMetrics.fragments_sent;
+        co_return {};
+    }
+
+    auto _retain(std::uint32_t id, std::span<const std::byte> message, const EndpointT& destination) -> void {
+        if (message.size() > mOptions.retain_bytes) {
+            return;
+        }
+        mRetained.push_back(
+            {id, destination, std::make_shared<const std::vector<std::byte>>(message.begin(), message.end())});
+        mRetainedBytes += message.size();
+        while (mRetainedBytes > mOptions.retain_bytes) {
+            mRetainedBytes -= mRetained.front().data->size();
+            mRetained.pop_front();
+        }
+    }
+
+    static constexpr std::size_t KMaxMessageBytes  = 0xFFFFFFFFU;
+    static constexpr std::size_t KCompletedHistory = 64U;
+
+    DatagramT mDatagram;
+    EndpointT mEndpoint;
+    Options mOptions;
+    std::error_code mMessageTooLarge = ilias::IoError::MessageTooLarge;
+    std::size_t mPayloadBytes        = 0;
+    std::uint32_t mNextId            = 0;
+    Metrics mMetrics;
+    std::unique_ptr<ilias::Mutex> mSendMutex = std::make_unique<ilias::Mutex>();
+    std::vector<std::byte> mSendBuffer;
+    std::list<Partial> mPartials; // least recently active first
+    std::size_t mReassemblyBytes = 0;
+    std::vector<std::byte> mScratch;
+    std::deque<std::pair<std::uint32_t, EndpointT>> mCompleted;
+    std::deque<Retained> mRetained;
+    std::size_t mRetainedBytes = 0;
+};
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
@@ -0,0 +1,1001 @@
+#pragma once
+
+// Stream over io_uring with multishot receive into a provided buffer ring.
+
+#include "nekoproto/transport/endpoint.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// Multishot recv and provided buffer rings need the uapi of Linux 6.0 or newer.
+#if defined(__linux__) && defined(IORING_RECV_MULTISHOT)
+#define NEKO_IO_URING_STREAM 1
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/runtime/executor.hpp>
+#include <ilias/task.hpp>
+#include <ilias/task/scope.hpp>
+
+#include "nekoproto/transport/fd_wait.hpp"
+#include "nekoproto/transport/socket_address.hpp"
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+struct IoUringContextOptions {
+    unsigned entries = 256U; // submission queue size, the completion queue is four times larger
+};
+
+struct IoUringStreamOptions {
+    std::size_t buffer_count = 64U; // receive buffers in the ring, rounded up to a power of two
+    std::size_t buffer_bytes = 16U * 1024U;
+    bool multishot           = true; // false receives with one recv submission per read
+};
+
+/**
+ * @brief One io_uring instance, reaped from the executor that uses it.
+ *
+ * Any thread may submit. While operations are in flight a reaper task runs
+ * on the executor of the first submitter: it waits for the ring descriptor
+ * on the IoContext reactor, like any other socket, and hands every CQE to
+ * the Operation whose address is in its user_data. An awaiting coroutine is
+ * then resumed by posting it to the executor it was suspended on, which for
+ * the per-thread instance() is the reaper's own, so no completion crosses a
+ * thread. The reaper ends once nothing is in flight. Destroy a context only
+ * after its operations have completed.
+ */
+class IoUringContext {
+public:
+    using Options = IoUringContextOptions;
+
+    /// A submission in flight; complete() runs on the reaper once per CQE.
+    struct Operation {
+        void (*complete)(Operation* self, int result, std::uint32_t flags) = nullptr;
+    };
+
+    struct Completion {
+        int result        = 0; // first failure of the batch, otherwise the result of its last entry
+        std::size_t bytes = 0; // sum of the positive results
+    };
+
+    /**
+     * @brief co_await submits @p count linked-or-not entries filled by @p prepare and waits for all of them.
+     *
+     * Must be awaited from a coroutine running on an ilias executor.
+     */
+    template <typename Prepare>
+    class Awaiter : private Operation {
+    public:
+        Awaiter(IoUringContext& context, std::size_t count, Prepare prepare)
+            : mContext(context), mPrepare(std::move(prepare)), mPending(count) {
+            complete = &Awaiter::_complete;
+        }
+
+        auto await_ready() const noexcept -> bool { return false; }
+        auto await_suspend(std::coroutine_handle<> handle) -> bool {
+            mHandle   = handle;
+            mExecutor = ilias::runtime::Executor::currentThread();
+            if (mExecutor == nullptr) {
+                mCompletion.result = -EINVAL;
+                return false;
+            }
+            const auto error = mContext.submit(mPending, [this](io_uring_sqe* sqe, std::size_t index) {
+                mPrepare(sqe, index);
+                sqe->user_data = reinterpret_cast<std::uint64_t>(static_cast<Operation*>(this));
+            });
+            if (error) {
+                mCompletion.result = -error.value();
+                return false;
+            }
+            return true;
+        }
+        auto await_resume() const noexcept -> Completion { return mCompletion; }
+
+    private:
+        static auto _complete(Operation* self, int result, std::uint32_t /*flags*/) -> void {
+            auto* awaiter = static_cast<Awaiter*>(self);
+            if (result > 0) {
+                awaiter->mCompletion.bytes += static_cast<std::size_t>(result);
+            }
+            if (awaiter->mCompletion.result >= 0) {
+                awaiter->mCompletion.result = result;
+            }
+            if (--awaiter->mPending == 0U) {
+                awaiter->mExecutor->post(
+                    [](void* address) { std::coroutine_handle<>::from_address(address).resume(); },
+                    awaiter->mHandle.address());
+            }
+        }
+
+        IoUringContext& mContext;
+        Prepare mPrepare;
+        std::size_t mPending;
+        Completion mCompletion;
+        std::coroutine_handle<> mHandle;
+        ilias::runtime::Executor* mExecutor = nullptr;
+    };
+
+    static auto create(Options options = {}) -> ilias::Result<std::unique_ptr<IoUringContext>, std::error_code> {
+        std::unique_ptr<IoUringContext> context(new IoUringContext());
+        if (auto error = context->_setup(options); error) {
+            return ilias::Err(error);
+        }
+        return context;
+    }
+
+    /// Context of the calling thread for streams that do not bring their own; null when the kernel refuses io_uring.
+    static auto instance() -> IoUringContext* {
+        static thread_local auto kInstance = create();
+        return kInstance ? kInstance.value().get() : nullptr;
+    }
+
+    IoUringContext(const IoUringContext&)                    = delete;
+    auto operator=(const IoUringContext&) -> IoUringContext& = delete;
+
+    ~IoUringContext() {
+        if (mReaping.load(std::memory_order_acquire)) {
+            mReapers.stop();
+            mReapers.waitAll().wait();
+        }
+        if (mSqRing != nullptr && mSqRing != MAP_FAILED) {
+            ::munmap(mSqRing, mSqRingBytes);
+        }
+        if (mCqRing != nullptr && mCqRing != MAP_FAILED && mCqRing != mSqRing) {
+            ::munmap(mCqRing, mCqRingBytes);
+        }
+        if (mSqes != nullptr && mSqes != MAP_FAILED) {
+            ::munmap(mSqes, mSqesBytes);
+        }
+        if (mFd >= 0) {
+            ::close(mFd);
+        }
+    }
+
+    /**
+     * @brief Fill @p count entries with @p prepare(sqe, index) and submit them with one io_uring_enter.
+     *
+     * Entries that get an Operation as user_data keep the reaper running
+     * until their last CQE. When the completion queue is full the entries
+     * stay queued and the reaper submits them after it has drained it.
+     */
+    template <typename Prepare>
+    auto submit(std::size_t count, Prepare&& prepare) -> std::error_code {
+        std::size_t tracked = 0;
+        {
+            std::scoped_lock lock(mSubmitMutex);
+            const auto head = std::atomic_ref<unsigned>(*mSqHead).load(std::memory_order_acquire);
+            auto tail       = *mSqTail;
+            if (count == 0U || tail - head + count > mSqEntries) {
+                return std::make_error_code(std::errc::no_buffer_space);
+            }
+            for (std::size_t index = 0; index < count; ++index) {
+                const auto slot = tail & mSqMask;
+                auto* sqe       = &mSqes[slot];
+                std::memset(sqe, 0, sizeof(*sqe));
+                prepare(sqe, index);
+                if (sqe->user_data != KIgnoreTag) {
+                    ++tracked;
+                }
+                mSqArray[slot] = slot;
+                ++tail;
+            }
+            std::atomic_ref<unsigned>(*mSqTail).store(tail, std::memory_order_release);
+            mPending.fetch_add(tracked, std::memory_order_seq_cst);
+            if (auto error = _enter(count); error) {
+                mPending.fetch_sub(tracked, std::memory_order_seq_cst);
+                return error;
+            }
+        }
+        if (tracked != 0U) {
+            _startReaper();
+        }
+        return {};
+    }
+
+    /// Register a provided-buffer ring of @p entries slots at @p ring and return its group id.
+    auto registerBufferRing(void* ring, unsigned entries) -> ilias::Result<std::uint16_t, std::error_code> {
+        const auto group = _takeGroup();
+        io_uring_buf_reg registration{};
+        registration.ring_addr    = reinterpret_cast<std::uint64_t>(ring);
+        registration.ring_entries = entries;
+        registration.bgid         = group;
+        if (::syscall(__NR_io_uring_register, mFd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+            const std::error_code error(errno, std::system_category());
+            _releaseGroup(group);
+            return ilias::Err(error);
+        }
+        return group;
+    }
+
+    auto unregisterBufferRing(std::uint16_t group) -> void {
+        io_uring_buf_reg registration{};
+        registration.bgid = group;
+        (void)::syscall(__NR_io_uring_register, mFd, IORING_UNREGISTER_PBUF_RING, &registration, 1);
+        _releaseGroup(group);
+    }
+
+private:
+    static constexpr std::uint64_t KIgnoreTag = 0; // completions nobody waits for, e.g. cancel requests
+
+    IoUringContext() = default;
+
+    auto _setup(const Options& options) -> std::error_code {
+        io_uring_params params{};
+        params.flags      = IORING_SETUP_CQSIZE;
+        params.cq_entries = std::max(options.entries, 1U) * 4U;
+        mFd = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(options.entries, 1U), &params));
+        if (mFd < 0) {
+            return std::error_code(errno, std::system_category());
+        }
+        mSqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0U) {
+            mSqRingBytes = mCqRingBytes = std::max(mSqRingBytes, mCqRingBytes);
+        }
+        mSqRing = ::mmap(nullptr, mSqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd,
+                         IORING_OFF_SQ_RING);
+        if (mSqRing == MAP_FAILED) {
+            return std::error_code(errno, std::system_category());
+        }
+        mCqRing = mSqRing;
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0U) {
+            mCqRing = ::mmap(nullptr, mCqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd,
+                             IORING_OFF_CQ_RING);
+            if (mCqRing == MAP_FAILED) {
+                return std::error_code(errno, std::system_category());
+            }
+        }
+        mSqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        auto* sqes = ::mmap(nullptr, mSqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return std::error_code(errno, std::system_category());
+        }
+        mSqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq   = static_cast<std::byte*>(mSqRing);
+        auto* cq   = static_cast<std::byte*>(mCqRing);
+        mSqHead    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        mSqTail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        mSqMask    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        mSqArray   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        mSqEntries = params.sq_entries;
+        mCqHead    = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        mCqTail    = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        mCqMask    = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        mCqes      = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return {};
+    }
+
+    /// Submit up to @p count queued entries. Callers hold mSubmitMutex.
+    auto _enter(std::size_t count) -> std::error_code {
+        std::size_t submitted = 0;
+        while (submitted < count) {
+            const auto ret = ::syscall(__NR_io_uring_enter, mFd, static_cast<unsigned>(count - submitted), 0U, 0U,
+                                       nullptr, 0U);
+            if (ret >= 0) {
+                submitted += static_cast<std::size_t>(ret);
+                continue;
+            }
+            if (errno == EAGAIN || errno == EBUSY) {
+                // The completion queue is full; the entries stay queued for the reaper to submit.
+                mBacklog.store(true, std::memory_order_release);
+                return {};
+            }
+            if (errno != EINTR) {
+                return std::error_code(errno, std::system_category());
+            }
+        }
+        return {};
+    }
+
+    /**
+     * @brief Start a reaper on the calling executor unless one is already running.
+     *
+     * The start is posted rather than spawned in place: submitters may hold
+     * a stream mutex that the first reaped completion takes.
+     */
+    auto _startReaper() -> void {
+        auto* executor = ilias::runtime::Executor::currentThread();
+        if (executor == nullptr || mReaping.exchange(true, std::memory_order_seq_cst)) {
+            return;
+        }
+        executor->post(
+            [](void* self) {
+                auto* context = static_cast<IoUringContext*>(self);
+                context->mReapers.spawn([context]() -> ilias::Task<void> { (void)co_await context->_reapLoop(); });
+            },
+            this);
+    }
+
+    /// Reap until nothing is in flight, sleeping on the reactor while the completion queue is empty.
+    auto _reapLoop() -> ilias::IoTask<void> {
+        while (true) {
+            _reap();
+            if (mBacklog.exchange(false, std::memory_order_acq_rel)) {
+                std::scoped_lock lock(mSubmitMutex);
+                const auto head = std::atomic_ref<unsigned>(*mSqHead).load(std::memory_order_acquire);
+                (void)_enter(*mSqTail - head);
+            }
+            if (mPending.load(std::memory_order_seq_cst) == 0U) {
+                // A submitter that saw mReaping still set relies on this check to keep the loop alive.
+                mReaping.store(false, std::memory_order_seq_cst);
+                if (mPending.load(std::memory_order_seq_cst) == 0U || mReaping.exchange(true)) {
+                    co_return {};
+                }
+            }
+            auto polled = co_await poll_fds<1>(nullptr, {{{mFd, POLLIN, 0}}});
+            if (!polled) {
+                mReaping.store(false, std::memory_order_seq_cst);
+                co_return ilias::Err(polled.error());
+            }
+        }
+    }
+
+    /// Hand every queued CQE to its Operation.
+    auto _reap() -> void {
+        std::scoped_lock lock(mReapMutex);
+        auto head = *mCqHead;
+        auto tail = std::atomic_ref<unsigned>(*mCqTail).load(std::memory_order_acquire);
+        if (head == tail) {
+            // Run completion work the kernel deferred to this task, without waiting.
+            (void)::syscall(__NR_io_uring_enter, mFd, 0U, 0U, IORING_ENTER_GETEVENTS, nullptr, 0U);
+            tail = std::atomic_ref<unsigned>(*mCqTail).load(std::memory_order_acquire);
+        }
+        std::size_t finished = 0;
+        while (head != tail) {
+            const auto cqe = mCqes[head & mCqMask];
+            std::atomic_ref<unsigned>(*mCqHead).store(++head, std::memory_order_release);
+            if (cqe.user_data == KIgnoreTag) {
+                continue;
+            }
+            if ((cqe.flags & IORING_CQE_F_MORE) == 0U) {
+                ++finished;
+            }
+            auto* operation = reinterpret_cast<Operation*>(cqe.user_data);
+            operation->complete(operation, cqe.res, cqe.flags);
+        }
+        mPending.fetch_sub(finished, std::memory_order_seq_cst);
+    }
+
+    auto _takeGroup() -> std::uint16_t {
+        std::scoped_lock lock(mGroupMutex);
+        if (!mFreeGroups.empty()) {
+            const auto group = mFreeGroups.back();
+            mFreeGroups.pop_back();
+            return group;
+        }
+        return mNextGroup++;
+    }
+    auto _releaseGroup(std::uint16_t group) -> void {
+        std::scoped_lock lock(mGroupMutex);
+        mFreeGroups.push_back(group);
+    }
+
+    int mFd = -1;
+    void* mSqRing            = nullptr;
+    void* mCqRing            = nullptr;
+    io_uring_sqe* mSqes      = nullptr;
+    std::size_t mSqRingBytes = 0;
+    std::size_t mCqRingBytes = 0;
+    std::size_t mSqesBytes   = 0;
+    unsigned* mSqHead        = nullptr;
+    unsigned* mSqTail        = nullptr;
+    unsigned* mSqArray       = nullptr;
+    unsigned mSqMask         = 0;
+    unsigned mSqEntries      = 0;
+    unsigned* mCqHead        = nullptr;
+    unsigned* mCqTail        = nullptr;
+    unsigned mCqMask         = 0;
+    io_uring_cqe* mCqes      = nullptr;
+    std::mutex mSubmitMutex;
+    std::mutex mReapMutex;
+    std::mutex mGroupMutex;
+    std::vector<std::uint16_t> mFreeGroups;
+    std::uint16_t mNextGroup = 0;
+    std::atomic<std::size_t> mPending{0}; // entries whose last CQE has not been reaped
+    std::atomic<bool> mReaping{false};
+    std::atomic<bool> mBacklog{false};
+    ilias::TaskScope mReapers;
+};
+
+/**
+ * @brief Connected TCP socket driven by io_uring, usable wherever an ilias stream is.
+ *
+ * Receiving arms one multishot recv that keeps filling buffers from a ring
+ * registered with the kernel, so a stream of frames costs no submission per
+ * read; read() copies out of those buffers and hands each one back as soon as
+ * it is drained. A header read followed by a body read, as the rpc stream
+ * endpoint does, is usually served from the same buffer. writeVectored()
+ * sends several pieces as linked entries in one submission. Kernels without
+ * buffer rings or multishot recv get one recv submission per read instead.
+ *
+ * A read waiting on the armed receive ends with IoError::Canceled when its
+ * task is stopped: the receive is cancelled and armed again by the next read,
+ * and data that had already arrived stays buffered. Other pending operations
+ * are not interrupted by task cancellation; close() ends them by shutting the
+ * socket down.
+ */
+class IoUringStream {
+public:
+    using Options = IoUringStreamOptions;
+
+    struct Metrics {
+        std::uint64_t recv_submissions = 0; // multishot arms, or single recvs without a buffer ring
+        std::uint64_t recv_completions = 0;
+        std::uint64_t send_submissions = 0;
+        std::uint64_t buffers_recycled = 0;
+    };
+
+    IoUringStream() = default;
+    IoUringStream(IoUringStream&&) noexcept = default;
+    auto operator=(IoUringStream&& other) noexcept -> IoUringStream& {
+        if (this != &other) {
+            close();
+            mState = std::move(other.mState);
+        }
+        return *this;
+    }
+    ~IoUringStream() { close(); }
+
+    /// Take ownership of the connected socket @p fd.
+    static auto adopt(int fd, Options options = {}, IoUringContext* context = IoUringContext::instance())
+        -> ilias::Result<IoUringStream, std::error_code> {
+        if (context == nullptr) {
+            ::close(fd);
+            return ilias::Err(std::make_error_code(std::errc::function_not_supported));
+        }
+        auto state     = std::make_shared<State>();
+        state->context = context;
+        state->fd      = fd;
+        state->options = options;
+        const int one  = 1;
+        (void)::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (options.multishot) {
+            state->setupBufferRing();
+        }
+        IoUringStream stream;
+        stream.mState = std::move(state);
+        return stream;
+    }
+
+    /// Connect to "ip:port" or "[ipv6]:port".
+    static auto connect(std::string_view address, Options options = {},
+                        IoUringContext* context = IoUringContext::instance()) -> ilias::IoTask<IoUringStream> {
+        sockaddr_storage remote{};
+        socklen_t remoteLength = 0;
+        if (!parse_socket_address(address, remote, remoteLength)) {
+            co_return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        if (context == nullptr) {
+            co_return ilias::Err(std::make_error_code(std::errc::function_not_supported));
+        }
+        const int fd = ::socket(remote.ss_family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (fd < 0) {
+            co_return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        const auto done = co_await IoUringContext::Awaiter(*context, 1U, [&](io_uring_sqe* sqe, std::size_t) {
+            sqe->opcode = IORING_OP_CONNECT;
+            sqe->fd     = fd;
+            sqe->addr   = reinterpret_cast<std::uint64_t>(&remote);
+            sqe->off    = remoteLength;
+        });
+        if (done.result < 0) {
+            ::close(fd);
+            co_return ilias::Err(std::error_code(-done.result, std::system_category()));
+        }
+        co_return adopt(fd, options, context);
+    }
+
+    auto read(std::span<std::byte> buffer) -> ilias::IoTask<std::size_t> {
+        const auto state = mState;
+        if (state == nullptr) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        if (buffer.empty()) {
+            co_return 0U;
+        }
+        const auto token = co_await ilias::this_coro::stopToken();
+        while (true) {
+            bool plain = false;
+            {
+                std::scoped_lock lock(state->mutex);
+                if (!state->chunks.empty()) {
+                    co_return state->copyOut(buffer);
+                }
+                if (state->ended) {
+                    if (state->endResult < 0) {
+                        co_return ilias::Err(std::error_code(-state->endResult, std::system_category()));
+                    }
+                    co_return 0U;
+                }
+                plain = state->ring == nullptr;
+                if (!plain && !state->armed) {
+                    if (auto error = state->arm(state); error) {
+                        co_return ilias::Err(error);
+                    }
+                }
+            }
+            if (plain) {
+                co_return co_await _recvOnce(*state, buffer);
+            }
+            std::stop_callback cancelOnStop(token, [raw = state.get()]() { raw->cancelRead(); });
+            co_await ReadWait{*state, token};
+            if (token.stop_requested()) {
+                co_return ilias::Err(ilias::IoError::Canceled);
+            }
+        }
+    }
+
+    auto write(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> {
+        const std::array<std::span<const std::byte>, 1> pieces{buffer};
+        co_return co_await writeVectored(pieces);
+    }
+
+    /**
+     * @brief Send @p pieces back to back, up to KMaxLinked of them per submission.
+     *
+     * The entries of one submission are linked, so they go out in order and
+     * a failed or short send cancels the rest of the chain. Whatever a chain
+     * left unsent is then sent piece by piece.
+     */
+    auto writeVectored(std::span<const std::span<const std::byte>> pieces) -> ilias::IoTask<std::size_t> {
+        const auto state = mState;
+        if (state == nullptr) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        std::size_t total = 0;
+        while (!pieces.empty()) {
+            const auto batch = pieces.first(std::min(pieces.size(), KMaxLinked));
+            std::size_t expected = 0;
+            for (const auto& piece : batch) {
+                expected += piece.size();
+            }
+            state->countSend();
+            const int fd    = state->fd;
+            const auto done = co_await IoUringContext::Awaiter(
+                *state->context, batch.size(), [&batch, fd](io_uring_sqe* sqe, std::size_t index) {
+                    sqe->opcode    = IORING_OP_SEND;
+                    sqe->fd        = fd;
+                    sqe->addr      = reinterpret_cast<std::uint64_t>(batch[index].data());
+                    sqe->len       = static_cast<std::uint32_t>(batch[index].size());
+                    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+                    if (index + 1U < batch.size()) {
+                        sqe->flags = IOSQE_IO_LINK;
+                    }
+                });
+            if (done.bytes < expected) {
+                if (done.result < 0 && done.result != -ECANCELED && done.bytes == 0U) {
+                    co_return ilias::Err(std::error_code(-done.result, std::system_category()));
+                }
+                ILIAS_CO_TRYV(co_await _sendRest(*state, batch, done.bytes));
+            }
+            total += expected;
+            pieces = pieces.subspan(batch.size());
+        }
+        co_return total;
+    }
+
+    auto shutdown() -> ilias::IoTask<void> {
+        if (mState != nullptr) {
+            (void)::shutdown(mState->fd, SHUT_WR);
+        }
+        co_return {};
+    }
+    auto flush() -> ilias::IoTask<void> { co_return {}; }
+
+    /// Shut the socket down, which also ends the armed receive; the descriptor is closed once that completes.
+    auto close() -> void {
+        if (auto state = std::exchange(mState, nullptr); state != nullptr) {
+            state->close();
+        }
+    }
+
+    auto metrics() const -> Metrics {
+        if (mState == nullptr) {
+            return {};
+        }
+        std::scoped_lock lock(mState->mutex);
+        return mState->metrics;
+    }
+
+    /// Whether receives use the buffer ring; false on kernels without it or with multishot disabled.
+    auto multishot() const -> bool {
+        if (mState == nullptr) {
+            return false;
+        }
+        std::scoped_lock lock(mState->mutex);
+        return mState->ring != nullptr;
+    }
+
+    static constexpr std::size_t KMaxLinked = 16U;
+
+private:
+    struct Chunk {
+        std::uint16_t buffer = 0;
+        std::size_t length   = 0;
+    };
+
+    struct State : IoUringContext::Operation {
+        IoUringContext* context = nullptr;
+        int fd                  = -1;
+        Options options;
+        std::mutex mutex;
+        Metrics metrics;
+        // Filled ring buffers in arrival order; frontOffset bytes of the first one are already read.
+        std::deque<Chunk> chunks;
+        std::size_t frontOffset = 0;
+        bool armed              = false;
+        bool ended              = false;
+        int endResult           = 0;
+        bool closed             = false;
+        std::coroutine_handle<> reader;
+        ilias::runtime::Executor* readerExecutor = nullptr;
+        std::shared_ptr<State> self; // keeps the state alive while a multishot receive is armed
+        // Provided buffer ring.
+        io_uring_buf_ring* ring = nullptr;
+        std::size_t ringBytes   = 0;
+        unsigned ringEntries    = 0;
+        std::uint16_t ringTail  = 0;
+        std::uint16_t group     = 0;
+        std::unique_ptr<std::byte[]> buffers;
+
+        State() { complete = &State::_onRecv; }
+
+        ~State() {
+            if (ring != nullptr) {
+                context->unregisterBufferRing(group);
+                ::munmap(ring, ringBytes);
+            }
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        auto setupBufferRing() -> void {
+            ringEntries = std::bit_ceil(
+                static_cast<unsigned>(std::clamp<std::size_t>(options.buffer_count, 1U, KMaxRingEntries)));
+            options.buffer_bytes = std::max<std::size_t>(options.buffer_bytes, 1U);
+            ringBytes            = ringEntries * sizeof(io_uring_buf);
+            auto* memory = ::mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                return;
+            }
+            auto registered = context->registerBufferRing(memory, ringEntries);
+            if (!registered) {
+                ::munmap(memory, ringBytes);
+                return;
+            }
+            ring    = static_cast<io_uring_buf_ring*>(memory);
+            group   = registered.value();
+            buffers = std::make_unique<std::byte[]>(ringEntries * options.buffer_bytes);
+            for (unsigned idx = 0; idx < ringEntries; ++idx) {
+                recycle(static_cast<std::uint16_t>(idx));
+            }
+        }
+
+        /// Hand buffer @p id back to the kernel. Callers hold the mutex, except during setup.
+        auto recycle(std::uint16_t id) -> void {
+            // Index the slots by hand: under C++ the uapi flexible array member starts past the ring header.
+            auto& slot = reinterpret_cast<io_uring_buf*>(ring)[ringTail & (ringEntries - 1U)];
+            slot.addr  = reinterpret_cast<std::uint64_t>(buffers.get() + id * options.buffer_bytes);
+            slot.len   = static_cast<std::uint32_t>(options.buffer_bytes);
+            slot.bid   = id;
+            std::atomic_ref<std::uint16_t>(ring->tail).store(++ringTail, std::memory_order_release);
+        }
+
+        /// Copy buffered bytes into @p out, recycling each buffer that is drained. Callers hold the mutex.
+        auto copyOut(std::span<std::byte> out) -> std::size_t {
+            std::size_t copied = 0;
+            while (copied < out.size() && !chunks.empty()) {
+                const auto& chunk = chunks.front();
+                const auto size   = std::min(chunk.length - frontOffset, out.size() - copied);
+                std::memcpy(out.data() + copied, buffers.get() + chunk.buffer * options.buffer_bytes + frontOffset,
+                            size);
+                copied += size;
+                frontOffset += size;
+                if (frontOffset == chunk.length) {
+                    recycle(chunk.buffer);
+                    ++metrics.buffers_recycled;
+                    chunks.pop_front();
+                    frontOffset = 0;
+                }
+            }
+            return copied;
+        }
+
+        /// Submit the multishot receive. Callers hold the mutex.
+        auto arm(const std::shared_ptr<State>& owner) -> std::error_code {
+            if (closed) {
+                ended     = true;
+                endResult = 0;
+                return {};
+            }
+            const auto error = context->submit(1U, [this](io_uring_sqe* sqe, std::size_t) {
+                sqe->opcode    = IORING_OP_RECV;
+                sqe->fd        = fd;
+                sqe->ioprio    = IORING_RECV_MULTISHOT;
+                sqe->flags     = IOSQE_BUFFER_SELECT;
+                sqe->buf_group = group;
+                sqe->user_data = reinterpret_cast<std::uint64_t>(static_cast<IoUringContext::Operation*>(this));
+            });
+            if (!error) {
+                armed = true;
+                self  = owner;
+                ++metrics.recv_submissions;
+            }
+            return error;
+        }
+
+        /// Wake a reader whose task was stopped and cancel the armed receive it was waiting on.
+        auto cancelRead() -> void {
+            std::coroutine_handle<> handle;
+            ilias::runtime::Executor* executor = nullptr;
+            {
+                std::scoped_lock lock(mutex);
+                handle   = std::exchange(reader, {});
+                executor = readerExecutor;
+                if (armed && !closed) {
+                    (void)context->submit(1U, [this](io_uring_sqe* sqe, std::size_t) {
+                        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                        sqe->addr   = reinterpret_cast<std::uint64_t>(static_cast<IoUringContext::Operation*>(this));
+                    });
+                }
+            }
+            if (handle) {
+                executor->post([](void* address) { std::coroutine_handle<>::from_address(address).resume(); },
+                               handle.address());
+            }
+        }
+
+        auto countSend() -> void {
+            std::scoped_lock lock(mutex);
+            ++metrics.send_submissions;
+        }
+
+        auto close() -> void {
+            {
+                std::scoped_lock lock(mutex);
+                closed = true;
+            }
+            (void)::shutdown(fd, SHUT_RDWR);
+            // Sockets that never connected ignore shutdown, cancel whatever is still queued on them.
+            (void)context->submit(1U, [this](io_uring_sqe* sqe, std::size_t) {
+                sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+                sqe->fd           = fd;
+                sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+            });
+        }
+
+        static auto _onRecv(IoUringContext::Operation* operation, int result, std::uint32_t flags) -> void {
+            auto* state = static_cast<State*>(operation);
+            std::shared_ptr<State> release;
+            std::coroutine_handle<> reader;
+            ilias::runtime::Executor* executor = nullptr;
+            {
+                std::scoped_lock lock(state->mutex);
+                ++state->metrics.recv_completions;
+                const bool hasBuffer = (flags & IORING_CQE_F_BUFFER) != 0U;
+                const auto id        = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+                if (result > 0 && hasBuffer) {
+                    state->chunks.push_back({id, static_cast<std::size_t>(result)});
+                } else {
+                    if (hasBuffer) {
+                        state->recycle(id);
+                    }
+                    if (result == -EINVAL && state->metrics.recv_completions == 1U) {
+                        // No multishot recv on this kernel, fall back to one recv per read.
+                        state->context->unregisterBufferRing(state->group);
+                        ::munmap(state->ring, state->ringBytes);
+                        state->ring = nullptr;
+                    } else if (result == -ECANCELED && !state->closed) {
+                        // Cancelled by cancelRead(), not by close(); the next read arms it again.
+                    } else if (result != -ENOBUFS) {
+                        // ENOBUFS only means every buffer is queued; the next read re-arms.
+                        state->ended     = true;
+                        state->endResult = result == -ECANCELED ? 0 : result;
+                    }
+                }
+                if ((flags & IORING_CQE_F_MORE) == 0U) {
+                    state->armed = false;
+                    release      = std::move(state->self);
+                }
+                reader   = std::exchange(state->reader, {});
+                executor = state->readerExecutor;
+            }
+            if (reader) {
+                executor->post([](void* address) { std::coroutine_handle<>::from_address(address).resume(); },
+                               reader.address());
+            }
+        }
+    };
+
+    /// Suspend a reader until the armed receive delivers data or ends, or its task is stopped.
+    struct ReadWait {
+        State& state;
+        const std::stop_token& token;
+
+        auto await_ready() const noexcept -> bool { return false; }
+        auto await_suspend(std::coroutine_handle<> handle) -> bool {
+            // Checked under the mutex cancelRead() takes, so a stop either lands here or finds the reader.
+            std::scoped_lock lock(state.mutex);
+            auto* executor = ilias::runtime::Executor::currentThread();
+            if (token.stop_requested() || !state.chunks.empty() || state.ended || !state.armed ||
+                executor == nullptr) {
+                return false;
+            }
+            state.reader         = handle;
+            state.readerExecutor = executor;
+            return true;
+        }
+        auto await_resume() const noexcept -> void {}
+    };
+
+    static auto _recvOnce(State& state, std::span<std::byte> buffer) -> ilias::IoTask<std::size_t> {
+        {
+            std::scoped_lock lock(state.mutex);
+            ++state.metrics.recv_submissions;
+        }
+        const int fd    = state.fd;
+        const auto done = co_await IoUringContext::Awaiter(*state.context, 1U, [&](io_uring_sqe* sqe, std::size_t) {
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd     = fd;
+            sqe->addr   = reinterpret_cast<std::uint64_t>(buffer.data());
+            sqe->len    = static_cast<std::uint32_t>(std::min<std::size_t>(buffer.size(), 0x7FFFFFFFU));
+        });
+        if (done.result < 0) {
+            if (done.result == -ECANCELED) {
+                co_return 0U;
+            }
+            co_return ilias::Err(std::error_code(-done.result, std::system_category()));
+        }
+        co_return static_cast<std::size_t>(done.result);
+    }
+
+    /// Finish a chain that stopped after @p sent bytes, one send at a time.
+    static auto _sendRest(State& state, std::span<const std::span<const std::byte>> pieces, std::size_t sent)
+        -> ilias::IoTask<void> {
+        for (const auto& piece : pieces) {
+            if (sent >= piece.size()) {
+                sent -= piece.size();
+                continue;
+            }
+            auto rest = piece.subspan(sent);
+            sent      = 0;
+            while (!rest.empty()) {
+                state.countSend();
+                const int fd    = state.fd;
+                const auto done = co_await IoUringContext::Awaiter(
+                    *state.context, 1U, [&rest, fd](io_uring_sqe* sqe, std::size_t) {
+                        sqe->opcode    = IORING_OP_SEND;
+                        sqe->fd        = fd;
+                        sqe->addr      = reinterpret_cast<std::uint64_t>(rest.data());
+                        sqe->len       = static_cast<std::uint32_t>(rest.size());
+                        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+                    });
+                if (done.result <= 0) {
+                    co_return ilias::Err(done.result == 0 ? std::error_code(ilias::IoError::WriteZero)
+                                                          : std::error_code(-done.result, std::system_category()));
+                }
+                rest = rest.subspan(static_cast<std::size_t>(done.result));
+            }
+        }
+        co_return {};
+    }
+
+    static constexpr std::size_t KMaxRingEntries = 32768U;
+
+    std::shared_ptr<State> mState;
+};
+
+/// Listening TCP socket whose accepts go through io_uring.
+class IoUringListener {
+public:
+    IoUringListener() = default;
+    IoUringListener(IoUringListener&& other) noexcept
+        : mFd(std::exchange(other.mFd, -1)), mContext(other.mContext) {}
+    auto operator=(IoUringListener&& other) noexcept -> IoUringListener& {
+        if (this != &other) {
+            close();
+            mFd      = std::exchange(other.mFd, -1);
+            mContext = other.mContext;
+        }
+        return *this;
+    }
+    ~IoUringListener() { close(); }
+
+    /// Listen on "ip:port" or "[ipv6]:port".
+    static auto bind(std::string_view address, int backlog = SOMAXCONN,
+                     IoUringContext* context = IoUringContext::instance())
+        -> ilias::Result<IoUringListener, std::error_code> {
+        sockaddr_storage local{};
+        socklen_t localLength = 0;
+        if (!parse_socket_address(address, local, localLength)) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        if (context == nullptr) {
+            return ilias::Err(std::make_error_code(std::errc::function_not_supported));
+        }
+        IoUringListener listener;
+        listener.mContext = context;
+        listener.mFd      = ::socket(local.ss_family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (listener.mFd < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        const int one = 1;
+        (void)::setsockopt(listener.mFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(listener.mFd, reinterpret_cast<const sockaddr*>(&local), localLength) != 0 ||
+            ::listen(listener.mFd, backlog) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        return listener;
+    }
+
+    auto accept(IoUringStream::Options options = {}) -> ilias::IoTask<IoUringStream> {
+        if (mFd < 0) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        const int fd    = mFd;
+        const auto done = co_await IoUringContext::Awaiter(*mContext, 1U, [fd](io_uring_sqe* sqe, std::size_t) {
+            sqe->opcode       = IORING_OP_ACCEPT;
+            sqe->fd           = fd;
+            sqe->accept_flags = SOCK_CLOEXEC;
+        });
+        if (done.result < 0) {
+            co_return ilias::Err(std::error_code(-done.result, std::system_category()));
+        }
+        co_return IoUringStream::adopt(done.result, options, mContext);
+    }
+
+    /// Cancel pending accepts and close the socket.
+    auto close() -> void {
+        if (mFd < 0) {
+            return;
+        }
+        const int fd = std::exchange(mFd, -1);
+        (void)mContext->submit(1U, [fd](io_uring_sqe* sqe, std::size_t) {
+            sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+            sqe->fd           = fd;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        });
+        ::close(fd);
+    }
+
+private:
+    int mFd                   = -1;
+    IoUringContext* mContext = nullptr;
+};
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
+#endif
@@ -0,0 +1,519 @@
+#pragma once
+
+// Shared-memory message endpoint for peers on the same host.
+
+#include "nekoproto/transport/endpoint.hpp"
+#include "nekoproto/transport/fd_wait.hpp"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/sync/mutex.hpp>
+#include <ilias/task.hpp>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+/**
+ * @brief Single-producer/single-consumer byte ring living in shared memory.
+ *
+ * Records are stored as a 4 byte little-endian length followed by the body
+ * and may wrap around the end of the ring. The top bit of the length marks
+ * a record that is followed by more of the same message, so a message larger
+ * than maxRecordBytes() is streamed through as several records. head and
+ * tail count bytes ever written and read, so they never need to be reset.
+ *
+ * The control block lives in memory the peer can write, so peek checks each
+ * record against head and the ring bounds before handing out views.
+ */
+class ShmRing {
+public:
+    struct Control {
+        alignas(64) std::atomic<std::uint64_t> head{0}; // written by the producer
+        alignas(64) std::atomic<std::uint64_t> tail{0}; // written by the consumer
+        alignas(64) std::atomic<std::uint32_t> consumerWaiting{0};
+        std::atomic<std::uint32_t> producerWaiting{0};
+        std::atomic<std::uint32_t> closed{0};
+        std::uint64_t capacity = 0;
+    };
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory rings need lock-free atomics");
+
+    static constexpr std::size_t KLengthBytes   = sizeof(std::uint32_t);
+    static constexpr std::uint32_t KMoreRecords = 0x80000000U;
+    static constexpr std::size_t KMinCapacity   = 4096U;
+    static constexpr std::size_t KMaxCapacity   = 1024U * 1024U * 1024U;
+
+    /// One record located by peek, split in two parts when it wraps around the end of the ring.
+    struct Record {
+        std::span<const std::byte> first;
+        std::span<const std::byte> second;
+        bool more = false; // another record of the same message follows
+
+        auto size() const noexcept -> std::size_t { return first.size() + second.size(); }
+    };
+
+    enum class PeekStatus : std::uint8_t {
+        Empty,
+        Ready,
+        Corrupt, // head, tail or a length prefix points outside what the producer wrote
+    };
+
+    /// Bytes of shared memory one ring of @p capacity occupies.
+    static constexpr auto regionBytes(std::size_t capacity) noexcept -> std::size_t {
+        return sizeof(Control) + capacity;
+    }
+
+    ShmRing() = default;
+    /// @p capacity must be a power of two. Only the side that creates the memory passes @p initialize.
+    ShmRing(std::byte* region, std::size_t capacity, bool initialize) noexcept
+        : mControl(reinterpret_cast<Control*>(region)), mData(region + sizeof(Control)), mMask(capacity - 1U) {
+        if (initialize) {
+            mControl           = new (region) Control{};
+            mControl->capacity = capacity;
+        }
+    }
+
+    auto control() noexcept -> Control& { return *mControl; }
+    auto capacity() const noexcept -> std::size_t { return mMask + 1U; }
+    /// Largest body of one record; half the ring, so the producer can write the next record meanwhile.
+    auto maxRecordBytes() const noexcept -> std::size_t { return capacity() / 2U - KLengthBytes; }
+
+    /// Copy @p record into the ring, false if there is not enough free space yet.
+    auto tryWrite(std::span<const std::byte> record, bool more) noexcept -> bool {
+        const auto head = mControl->head.load(std::memory_order_relaxed);
+        const auto tail = mControl->tail.load(std::memory_order_acquire);
+        if (head - tail > capacity() || capacity() - (head - tail) < KLengthBytes + record.size()) {
+            return false;
+        }
+        const auto prefix = static_cast<std::uint32_t>(record.size()) | (more ? KMoreRecords : 0U);
+        std::array<std::byte, KLengthBytes> length{};
+        for (std::size_t idx = 0; idx < KLengthBytes; ++idx) {
+            length[idx] = static_cast<std::byte>((prefix >> (8U * idx)) & 0xFFU);
+        }
+        _copyIn(head, length);
+        _copyIn(head + KLengthBytes, record);
+        // seq_cst pairs with the consumer publishing consumerWaiting before it rechecks head.
+        mControl->head.store(head + KLengthBytes + record.size(), std::memory_order_seq_cst);
+        return true;
+    }
+
+    /// Locate the next record without consuming it.
+    auto peek(Record& record) const noexcept -> PeekStatus {
+        const auto tail = mControl->tail.load(std::memory_order_relaxed);
+        const auto head = mControl->head.load(std::memory_order_acquire);
+        if (head == tail) {
+            return PeekStatus::Empty;
+        }
+        const auto used = head - tail;
+        if (used < KLengthBytes || used > capacity()) {
+            return PeekStatus::Corrupt;
+        }
+        std::array<std::byte, KLengthBytes> length{};
+        _copyOut(tail, length);
+        std::uint32_t prefix = 0;
+        for (std::size_t idx = KLengthBytes; idx > 0; --idx) {
+            prefix = (prefix << 8U) | std::to_integer<std::uint32_t>(length[idx - 1]);
+        }
+        const std::size_t size = prefix & ~KMoreRecords;
+        if (size > used - KLengthBytes || size > maxRecordBytes()) {
+            return PeekStatus::Corrupt;
+        }
+        const auto offset = static_cast<std::size_t>((tail + KLengthBytes) & mMask);
+        const auto before = std::min(size, capacity() - offset);
+        record.first      = {mData + offset, before};
+        record.second     = {mData, size - before};
+        record.more       = (prefix & KMoreRecords) != 0U;
+        return PeekStatus::Ready;
+    }
+
+    /// Release the record returned by the last peek.
+    auto consume(std::size_t size) noexcept -> void {
+        const auto tail = mControl->tail.load(std::memory_order_relaxed);
+        // seq_cst pairs with the producer publishing producerWaiting before it rechecks tail.
+        mControl->tail.store(tail + KLengthBytes + size, std::memory_order_seq_cst);
+    }
+
+    auto empty() const noexcept -> bool {
+        return mControl->head.load(std::memory_order_seq_cst) == mControl->tail.load(std::memory_order_relaxed);
+    }
+    auto freeBytes() const noexcept -> std::size_t {
+        const auto used =
+            mControl->head.load(std::memory_order_relaxed) - mControl->tail.load(std::memory_order_seq_cst);
+        return used > capacity() ? 0U : capacity() - used;
+    }
+
+private:
+    auto _copyIn(std::uint64_t position, std::span<const std::byte> bytes) noexcept -> void {
+        if (bytes.empty()) {
+            return;
+        }
+        const auto offset = static_cast<std::size_t>(position & mMask);
+        const auto before = std::min(bytes.size(), capacity() - offset);
+        std::memcpy(mData + offset, bytes.data(), before);
+        std::memcpy(mData, bytes.data() + before, bytes.size() - before);
+    }
+    auto _copyOut(std::uint64_t position, std::span<std::byte> bytes) const noexcept -> void {
+        const auto offset = static_cast<std::size_t>(position & mMask);
+        const auto before = std::min(bytes.size(), capacity() - offset);
+        std::memcpy(bytes.data(), mData + offset, before);
+        std::memcpy(bytes.data() + before, mData, bytes.size() - before);
+    }
+
+    Control* mControl   = nullptr;
+    std::byte* mData    = nullptr;
+    std::uint64_t mMask = 0;
+};
+
+/// File descriptors that let a second process attach to a ShmMessageEndpoint.
+struct ShmEndpointHandles {
+    int memory = -1;
+    // data and space eventfds of the creator->opener ring, then of the opener->creator ring.
+    std::array<int, 4> events{-1, -1, -1, -1};
+    std::size_t capacity = 0;
+};
+
+/**
+ * @brief IMessageEndpoint over two shared-memory rings, one per direction.
+ *
+ * send copies the message straight into the ring and recv copies it straight
+ * into the caller's buffer; recvView skips that copy for messages that fit
+ * one record and do not wrap. Messages up to KMaxMessageBytes that do not
+ * fit one record are streamed through in records and reassembled. Each ring
+ * has an eventfd for "data available" and one for "space available", which
+ * are only written while the other side is asleep, so a busy pair exchanges
+ * messages without system calls. Sleeping waits for the eventfd on the
+ * IoContext reactor and ends early when the waiting task is stopped.
+ */
+class ShmMessageEndpoint : public IMessageEndpoint {
+public:
+    static constexpr std::size_t KDefaultCapacity = 1024U * 1024U;
+    static constexpr std::size_t KMaxMessageBytes = 16U * 1024U * 1024U;
+
+    /// Create the shared memory and return the creating side.
+    static auto create(std::size_t capacity = KDefaultCapacity) -> ilias::Result<ShmMessageEndpoint, std::error_code> {
+        capacity        = std::bit_ceil(std::clamp(capacity, ShmRing::KMinCapacity, ShmRing::KMaxCapacity));
+        auto mapping    = std::make_shared<Mapping>();
+        mapping->memory = ::memfd_create("nekoproto-shm", MFD_CLOEXEC);
+        if (mapping->memory < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        for (auto& event : mapping->events) {
+            event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (event < 0) {
+                return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+        }
+        mapping->capacity = capacity;
+        if (::ftruncate(mapping->memory, static_cast<off_t>(2U * ShmRing::regionBytes(capacity))) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        if (auto ret = mapping->map(); !ret) {
+            return ilias::Err(ret.error());
+        }
+        return ShmMessageEndpoint(std::move(mapping), true);
+    }
+
+    /// Attach to memory created by another endpoint, the handles are duplicated.
+    static auto open(const ShmEndpointHandles& handles) -> ilias::Result<ShmMessageEndpoint, std::error_code> {
+        // The handles may come from another process; never map more than the file holds.
+        if (!std::has_single_bit(handles.capacity) || handles.capacity < ShmRing::KMinCapacity ||
+            handles.capacity > ShmRing::KMaxCapacity) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        auto mapping      = std::make_shared<Mapping>();
+        mapping->capacity = handles.capacity;
+        mapping->memory   = ::fcntl(handles.memory, F_DUPFD_CLOEXEC, 0);
+        if (mapping->memory < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        struct stat memory{};
+        if (::fstat(mapping->memory, &memory) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        if (static_cast<std::size_t>(memory.st_size) < 2U * ShmRing::regionBytes(handles.capacity)) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        for (std::size_t idx = 0; idx < handles.events.size(); ++idx) {
+            mapping->events[idx] = ::fcntl(handles.events[idx], F_DUPFD_CLOEXEC, 0);
+            if (mapping->events[idx] < 0) {
+                return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+        }
+        if (auto ret = mapping->map(); !ret) {
+            return ilias::Err(ret.error());
+        }
+        ShmMessageEndpoint endpoint(std::move(mapping), false);
+        if (endpoint.mTx.control().capacity != handles.capacity ||
+            endpoint.mRx.control().capacity != handles.capacity) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        return endpoint;
+    }
+
+    /// Both sides of a connection, e.g. for a server and client in one process or across fork.
+    static auto createPair(std::size_t capacity = KDefaultCapacity)
+        -> ilias::Result<std::pair<ShmMessageEndpoint, ShmMessageEndpoint>, std::error_code> {
+        auto creator = create(capacity);
+        if (!creator) {
+            return ilias::Err(creator.error());
+        }
+        auto opener = open(creator->handles());
+        if (!opener) {
+            return ilias::Err(opener.error());
+        }
+        return std::make_pair(std::move(creator.value()), std::move(opener.value()));
+    }
+
+    ShmMessageEndpoint(ShmMessageEndpoint&& other) noexcept
+        : mMapping(std::move(other.mMapping)), mTx(other.mTx), mRx(other.mRx), mTxEvents(other.mTxEvents),
+          mRxEvents(other.mRxEvents), mPendingBytes(std::exchange(other.mPendingBytes, 0U)),
+          mHasPending(std::exchange(other.mHasPending, false)), mWrapped(std::move(other.mWrapped)) {}
+    ~ShmMessageEndpoint() override { close(); }
+
+    /// Handles to pass to the peer process, valid while this endpoint lives.
+    auto handles() const noexcept -> ShmEndpointHandles {
+        return {mMapping->memory, mMapping->events, mMapping->capacity};
+    }
+
+    auto recv(std::vector<std::byte>& buffer) -> ilias::IoTask<std::size_t> override {
+        ILIAS_CO_TRY(auto body, co_await recvView());
+        buffer.assign(body.begin(), body.end());
+        _release();
+        co_return buffer.size();
+    }
+
+    /**
+     * @brief Receive one message without copying it out of shared memory.
+     *
+     * The view stays valid until the next recv or recvView call. A message
+     * that wraps around the end of the ring or spans several records is
+     * assembled in a side buffer.
+     */
+    auto recvView() -> ilias::IoTask<std::span<const std::byte>> {
+        _release();
+        ILIAS_CO_TRY(auto record, co_await _nextRecord());
+        if (!record.more) {
+            mPendingBytes = record.size();
+            mHasPending   = true;
+            if (record.second.empty()) {
+                co_return record.first;
+            }
+            mWrapped.assign(record.first.begin(), record.first.end());
+            mWrapped.insert(mWrapped.end(), record.second.begin(), record.second.end());
+            co_return std::span<const std::byte>{mWrapped};
+        }
+
+        mWrapped.clear();
+        while (true) {
+            if (record.size() > KMaxMessageBytes - mWrapped.size()) {
+                // The rest of the message is still queued, so the stream cannot resync.
+                close();
+                co_return ilias::Err(ilias::IoError::MessageTooLarge);
+            }
+            mWrapped.insert(mWrapped.end(), record.first.begin(), record.first.end());
+            mWrapped.insert(mWrapped.end(), record.second.begin(), record.second.end());
+            // Hand each record back at once, the producer needs the space for the rest of the message.
+            mRx.consume(record.size());
+            _notify(mRx.control().producerWaiting, mRxEvents[1]);
+            if (!record.more) {
+                co_return std::span<const std::byte>{mWrapped};
+            }
+            ILIAS_CO_TRY(record, co_await _nextRecord());
+        }
+    }
+
+    auto send(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> override {
+        if (mMapping == nullptr) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        if (buffer.size() > KMaxMessageBytes) {
+            co_return ilias::Err(ilias::IoError::MessageTooLarge);
+        }
+        // One waiter per ring: the space eventfd wakes a single sleeper.
+        auto guard         = co_await mMapping->sendMutex.lock();
+        std::size_t offset = 0;
+        do {
+            const auto record = buffer.subspan(offset, std::min(buffer.size() - offset, mTx.maxRecordBytes()));
+            const bool more   = offset + record.size() < buffer.size();
+            while (!mTx.tryWrite(record, more)) {
+                if (mTx.control().closed.load(std::memory_order_acquire) != 0U) {
+                    co_return ilias::Err(ilias::IoError::ConnectionReset);
+                }
+                const auto needed = ShmRing::KLengthBytes + record.size();
+                ILIAS_CO_TRYV(co_await _wait(mTx.control().producerWaiting, mTxEvents[1],
+                                             [this, needed]() { return mTx.freeBytes() >= needed; }));
+            }
+            _notify(mTx.control().consumerWaiting, mTxEvents[0]);
+            offset += record.size();
+        } while (offset < buffer.size());
+        co_return buffer.size();
+    }
+
+    /// Mark both rings closed. The peer still drains what was sent before.
+    auto close() -> void override {
+        if (mMapping == nullptr || mMapping->region == nullptr) {
+            return;
+        }
+        mTx.control().closed.store(1U, std::memory_order_release);
+        mRx.control().closed.store(1U, std::memory_order_release);
+        for (auto event : mMapping->events) {
+            const std::uint64_t one = 1;
+            (void)::write(event, &one, sizeof(one));
+        }
+    }
+    auto shutdown() -> ilias::IoTask<void> override {
+        close();
+        co_return {};
+    }
+    auto flush() -> ilias::IoTask<void> override { co_return {}; }
+
+private:
+    struct Mapping {
+        int memory = -1;
+        std::array<int, 4> events{-1, -1, -1, -1};
+        std::size_t capacity = 0;
+        std::byte* region    = nullptr;
+        ilias::Mutex sendMutex;
+
+        auto map() -> ilias::Result<void, std::error_code> {
+            const auto size = 2U * ShmRing::regionBytes(capacity);
+            void* address   = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+            if (address == MAP_FAILED) {
+                return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+            region = static_cast<std::byte*>(address);
+            return {};
+        }
+        ~Mapping() {
+            if (region != nullptr) {
+                ::munmap(region, 2U * ShmRing::regionBytes(capacity));
+            }
+            for (auto fd : events) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+            if (memory >= 0) {
+                ::close(memory);
+            }
+        }
+    };
+
+    ShmMessageEndpoint(std::shared_ptr<Mapping> mapping, bool creator) noexcept : mMapping(std::move(mapping)) {
+        auto* forward      = mMapping->region;
+        auto* backward     = forward + ShmRing::regionBytes(mMapping->capacity);
+        const auto& events = mMapping->events;
+        if (creator) {
+            mTx       = ShmRing(forward, mMapping->capacity, true);
+            mRx       = ShmRing(backward, mMapping->capacity, true);
+            mTxEvents = {events[0], events[1]};
+            mRxEvents = {events[2], events[3]};
+        } else {
+            mTx       = ShmRing(backward, mMapping->capacity, false);
+            mRx       = ShmRing(forward, mMapping->capacity, false);
+            mTxEvents = {events[2], events[3]};
+            mRxEvents = {events[0], events[1]};
+        }
+    }
+
+    /// Hand the space of the previous view back to the producer.
+    auto _release() -> void {
+        if (!std::exchange(mHasPending, false)) {
+            return;
+        }
+        mRx.consume(std::exchange(mPendingBytes, 0U));
+        _notify(mRx.control().producerWaiting, mRxEvents[1]);
+    }
+
+    /// Wait for the next record; a record that breaks the ring bounds closes the endpoint.
+    auto _nextRecord() -> ilias::IoTask<ShmRing::Record> {
+        ShmRing::Record record;
+        while (true) {
+            switch (mRx.peek(record)) {
+            case ShmRing::PeekStatus::Ready:
+                co_return record;
+            case ShmRing::PeekStatus::Corrupt:
+                close();
+                co_return ilias::Err(std::make_error_code(std::errc::bad_message));
+            case ShmRing::PeekStatus::Empty:
+                break;
+            }
+            if (mRx.control().closed.load(std::memory_order_acquire) != 0U) {
+                co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+            }
+            ILIAS_CO_TRYV(co_await _wait(mRx.control().consumerWaiting, mRxEvents[0],
+                                         [this]() { return !mRx.empty(); }));
+        }
+    }
+
+    /// Wake the other side only if it announced that it is going to sleep.
+    static auto _notify(std::atomic<std::uint32_t>& waiting, int event) -> void {
+        if (waiting.load(std::memory_order_seq_cst) != 0U) {
+            const std::uint64_t one = 1;
+            (void)::write(event, &one, sizeof(one));
+        }
+    }
+
+    /// Spin briefly, then announce the sleep and poll @p event until @p ready holds or the task stops.
+    template <typename Ready>
+    auto _wait(std::atomic<std::uint32_t>& waiting, int event, Ready ready) -> ilias::IoTask<void> {
+        for (std::size_t spin = 0; spin < KSpinCount; ++spin) {
+            if (ready()) {
+                co_return {};
+            }
+        }
+        waiting.store(1U, std::memory_order_seq_cst);
+        if (!ready() && mTx.control().closed.load(std::memory_order_acquire) == 0U) {
+            auto polled = co_await poll_fds<1>(mMapping, {{{event, POLLIN, 0}}});
+            if (!polled) {
+                waiting.store(0U, std::memory_order_relaxed);
+                co_return ilias::Err(polled.error());
+            }
+            if ((polled->front().revents & POLLIN) != 0) {
+                std::uint64_t count = 0;
+                (void)::read(event, &count, sizeof(count));
+            }
+        }
+        waiting.store(0U, std::memory_order_relaxed);
+        co_return {};
+    }
+
+    static constexpr std::size_t KSpinCount = 256;
+
+    std::shared_ptr<Mapping> mMapping;
+    ShmRing mTx;
+    ShmRing mRx;
+    std::array<int, 2> mTxEvents{-1, -1}; // data, space
+    std::array<int, 2> mRxEvents{-1, -1}; // data, space
+    std::size_t mPendingBytes = 0;
+    bool mHasPending          = false;
+    std::vector<std::byte> mWrapped;
+};
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
+#endif
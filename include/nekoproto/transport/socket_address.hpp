@@ -0,0 +1,73 @@
+#pragma once
+
+// Numeric "ip:port" and unix socket path parsing for endpoints that own raw sockets.
+
+#include "nekoproto/global/global.hpp"
+
+#if defined(__linux__)
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+/// Parse "ip:port" or "[ipv6]:port" into @p storage without name lookups.
+inline auto parse_socket_address(std::string_view address, sockaddr_storage& storage, socklen_t& length) -> bool {
+    std::string host;
+    std::string port;
+    if (address.starts_with('[')) {
+        const auto close = address.find("]:");
+        if (close == std::string_view::npos) {
+            return false;
+        }
+        host = std::string(address.substr(1, close - 1));
+        port = std::string(address.substr(close + 2));
+    } else {
+        const auto colon = address.rfind(':');
+        if (colon == std::string_view::npos) {
+            return false;
+        }
+        host = std::string(address.substr(0, colon));
+        port = std::string(address.substr(colon + 1));
+    }
+    addrinfo hints{};
+    hints.ai_family  = AF_UNSPEC;
+    hints.ai_flags   = AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo* result = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr) {
+        return false;
+    }
+    std::memcpy(&storage, result->ai_addr, result->ai_addrlen);
+    length = static_cast<socklen_t>(result->ai_addrlen);
+    ::freeaddrinfo(result);
+    return true;
+}
+
+/// Fill @p storage for the unix socket at @p path; a leading '@' names an abstract socket.
+inline auto parse_unix_address(std::string_view path, sockaddr_un& storage, socklen_t& length) -> bool {
+    storage            = {};
+    storage.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(storage.sun_path)) {
+        return false;
+    }
+    std::memcpy(storage.sun_path, path.data(), path.size());
+    if (path.front() == '@') {
+        storage.sun_path[0] = '\0';
+        length              = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+    } else {
+        length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1U);
+    }
+    return true;
+}
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
+#endif
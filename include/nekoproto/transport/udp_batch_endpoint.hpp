@@ -0,0 +1,414 @@
+#pragma once
+
+// Batched UDP message endpoint that moves many datagrams per system call.
+
+#include "nekoproto/transport/endpoint.hpp"
+#include "nekoproto/transport/fd_wait.hpp"
+#include "nekoproto/transport/socket_address.hpp"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/sync/mutex.hpp>
+#include <ilias/task.hpp>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+struct UdpBatchOptions {
+    std::size_t batch_size         = 32U;   // datagrams per recvmmsg/sendmmsg call
+    std::size_t max_datagram_bytes = 1472U; // one Ethernet frame; larger sends are rejected
+    bool gso                       = false; // send runs of equal-sized datagrams as one UDP_SEGMENT train
+    bool gro                       = false; // accept trains coalesced by the kernel and split them again
+};
+
+/**
+ * @brief Datagram IMessageEndpoint that receives and sends up to batch_size datagrams per system call.
+ *
+ * One datagram is one message, as with ChunkedDatagramMessageEndpoint, and
+ * replies go to the sender of the last message handed out. Received
+ * datagrams land in a buffer pool allocated once at open, and recvView /
+ * recvBatch hand them out as views into that pool. With gro each pool slot
+ * grows to 64 KiB so that a coalesced train fits. Sleeping waits go through
+ * the IoContext reactor and end when the waiting task is stopped; the socket
+ * itself is non-blocking.
+ */
+class UdpBatchMessageEndpoint : public IMessageEndpoint {
+public:
+    using Options = UdpBatchOptions;
+
+    struct Metrics {
+        std::uint64_t recv_calls         = 0;
+        std::uint64_t datagrams_received = 0;
+        std::uint64_t send_calls         = 0;
+        std::uint64_t datagrams_sent     = 0;
+        std::uint64_t truncated          = 0; // dropped because they did not fit a pool slot
+    };
+
+    /// Bind to @p bindAddress and send to @p remoteAddress, both "ip:port" or "[ipv6]:port".
+    static auto open(std::string_view bindAddress, std::string_view remoteAddress, Options options = {})
+        -> ilias::Result<UdpBatchMessageEndpoint, std::error_code> {
+        sockaddr_storage local{};
+        socklen_t localLength = 0;
+        sockaddr_storage remote{};
+        socklen_t remoteLength = 0;
+        if (!parse_socket_address(bindAddress, local, localLength) ||
+            !parse_socket_address(remoteAddress, remote, remoteLength) || local.ss_family != remote.ss_family) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        options.batch_size         = std::clamp<std::size_t>(options.batch_size, 1U, KMaxBatch);
+        options.max_datagram_bytes = std::clamp<std::size_t>(options.max_datagram_bytes, 1U, KMaxDatagramBytes);
+
+        auto socket = std::make_shared<Socket>();
+        socket->fd  = ::socket(local.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        if (socket->fd < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        socket->wake = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (socket->wake < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        const int one = 1;
+        (void)::setsockopt(socket->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(socket->fd, reinterpret_cast<const sockaddr*>(&local), localLength) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+#if defined(UDP_GRO)
+        if (options.gro && ::setsockopt(socket->fd, IPPROTO_UDP, UDP_GRO, &one, sizeof(one)) != 0) {
+            options.gro = false;
+        }
+#else
+        options.gro = false;
+#endif
+#if !defined(UDP_SEGMENT)
+        options.gso = false;
+#endif
+        return UdpBatchMessageEndpoint(std::move(socket), remote, remoteLength, options);
+    }
+
+    UdpBatchMessageEndpoint(UdpBatchMessageEndpoint&&) noexcept = default;
+    ~UdpBatchMessageEndpoint() override { close(); }
+
+    auto options() const noexcept -> const Options& { return mOptions; }
+    auto metrics() const noexcept -> Metrics { return mMetrics; }
+
+    auto recv(std::vector<std::byte>& buffer) -> ilias::IoTask<std::size_t> override {
+        ILIAS_CO_TRY(auto datagram, co_await recvView());
+        buffer.assign(datagram.begin(), datagram.end());
+        co_return buffer.size();
+    }
+
+    /**
+     * @brief Receive one datagram without copying it out of the pool.
+     *
+     * The view stays valid until a call to recv, recvView or recvBatch has
+     * to refill the pool, i.e. until every datagram of the current batch has
+     * been handed out.
+     */
+    auto recvView() -> ilias::IoTask<std::span<const std::byte>> {
+        if (mNext == mReady.size()) {
+            ILIAS_CO_TRYV(co_await _fill());
+        }
+        _adoptSource(mReadySlots[mNext]);
+        co_return mReady[mNext++];
+    }
+
+    /// Hand out every datagram still waiting in the pool, receiving a new batch first if there is none.
+    auto recvBatch() -> ilias::IoTask<std::span<const std::span<const std::byte>>> {
+        if (mNext == mReady.size()) {
+            ILIAS_CO_TRYV(co_await _fill());
+        }
+        const auto first = std::exchange(mNext, mReady.size());
+        _adoptSource(mReadySlots.back());
+        co_return std::span<const std::span<const std::byte>>(mReady).subspan(first);
+    }
+
+    auto send(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> override {
+        const std::array<std::span<const std::byte>, 1> messages{buffer};
+        ILIAS_CO_TRYV(co_await sendBatch(messages));
+        co_return buffer.size();
+    }
+
+    /// Send every message as its own datagram, batch_size datagrams per sendmmsg. Returns the message count.
+    auto sendBatch(std::span<const std::span<const std::byte>> messages) -> ilias::IoTask<std::size_t> {
+        if (mSocket == nullptr) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        for (const auto& message : messages) {
+            if (message.size() > mOptions.max_datagram_bytes) {
+                co_return ilias::Err(ilias::IoError::MessageTooLarge);
+            }
+        }
+        auto guard       = co_await mSocket->sendMutex.lock();
+        std::size_t done = 0;
+        while (done < messages.size()) {
+            if (mSocket->closed.load(std::memory_order_acquire)) {
+                co_return ilias::Err(ilias::IoError::ConnectionReset);
+            }
+            const auto headers = _prepareSend(messages.subspan(done));
+            const int sent     = ::sendmmsg(mSocket->fd, mSendHeaders.data(), static_cast<unsigned>(headers),
+                                            MSG_DONTWAIT);
+            if (sent > 0) {
+                ++mMetrics.send_calls;
+                for (int idx = 0; idx < sent; ++idx) {
+                    done += mSendCounts[static_cast<std::size_t>(idx)];
+                    mMetrics.datagrams_sent += mSendCounts[static_cast<std::size_t>(idx)];
+                }
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EIO && mOptions.gso) {
+                // No segmentation offload on this route, send the datagrams one by one from now on.
+                mOptions.gso = false;
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                co_return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+            ILIAS_CO_TRYV(co_await _waitFor(POLLOUT));
+        }
+        co_return done;
+    }
+
+    /// Wake any waiting recv or send; they fail from then on.
+    auto close() -> void override {
+        if (mSocket == nullptr || mSocket->closed.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        const std::uint64_t one = 1;
+        (void)::write(mSocket->wake, &one, sizeof(one));
+    }
+    auto shutdown() -> ilias::IoTask<void> override {
+        close();
+        co_return {};
+    }
+    auto flush() -> ilias::IoTask<void> override { co_return {}; }
+
+private:
+    struct Socket {
+        int fd   = -1;
+        int wake = -1;
+        std::atomic<bool> closed{false};
+        ilias::Mutex sendMutex;
+
+        ~Socket() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (wake >= 0) {
+                ::close(wake);
+            }
+        }
+    };
+
+    UdpBatchMessageEndpoint(std::shared_ptr<Socket> socket, const sockaddr_storage& remote, socklen_t remoteLength,
+                            const Options& options)
+        : mSocket(std::move(socket)), mOptions(options), mRemote(remote), mRemoteLength(remoteLength) {
+        const auto batch = mOptions.batch_size;
+        mSlotBytes       = mOptions.gro ? KMaxDatagramBytes : mOptions.max_datagram_bytes;
+        mRecvBuffer.resize(batch * mSlotBytes);
+        mRecvHeaders.resize(batch);
+        mRecvIov.resize(batch);
+        mRecvNames.resize(batch);
+        mRecvControl.resize(batch * KControlBytes);
+        for (std::size_t idx = 0; idx < batch; ++idx) {
+            mRecvIov[idx]                         = {mRecvBuffer.data() + idx * mSlotBytes, mSlotBytes};
+            mRecvHeaders[idx].msg_hdr.msg_name    = &mRecvNames[idx];
+            mRecvHeaders[idx].msg_hdr.msg_iov     = &mRecvIov[idx];
+            mRecvHeaders[idx].msg_hdr.msg_iovlen  = 1;
+            mRecvHeaders[idx].msg_hdr.msg_control = mRecvControl.data() + idx * KControlBytes;
+        }
+        mSendHeaders.resize(batch);
+        mSendIov.resize(batch);
+        mSendCounts.resize(batch);
+        mSendControl.resize(batch * KControlBytes);
+        mReady.reserve(batch);
+        mReadySlots.reserve(batch);
+    }
+
+    /// Receive the next batch into the pool, waiting for the socket when nothing is queued.
+    auto _fill() -> ilias::IoTask<void> {
+        mReady.clear();
+        mReadySlots.clear();
+        mNext = 0;
+        if (mSocket == nullptr) {
+            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+        }
+        while (mReady.empty()) {
+            if (mSocket->closed.load(std::memory_order_acquire)) {
+                co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+            }
+            for (auto& header : mRecvHeaders) {
+                header.msg_hdr.msg_namelen    = sizeof(sockaddr_storage);
+                header.msg_hdr.msg_controllen = mOptions.gro ? KControlBytes : 0U;
+                header.msg_hdr.msg_flags      = 0;
+            }
+            const int received = ::recvmmsg(mSocket->fd, mRecvHeaders.data(),
+                                            static_cast<unsigned>(mRecvHeaders.size()), MSG_DONTWAIT, nullptr);
+            if (received > 0) {
+                ++mMetrics.recv_calls;
+                _collect(static_cast<std::size_t>(received));
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                co_return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+            ILIAS_CO_TRYV(co_await _waitFor(POLLIN));
+        }
+        co_return {};
+    }
+
+    /// Turn the filled slots into views, splitting coalesced GRO trains back into datagrams.
+    auto _collect(std::size_t count) -> void {
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            const auto& header = mRecvHeaders[idx];
+            if ((header.msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                ++mMetrics.truncated;
+                continue;
+            }
+            const auto* slot   = mRecvBuffer.data() + idx * mSlotBytes;
+            const auto length  = static_cast<std::size_t>(header.msg_len);
+            std::size_t stride = length;
+#if defined(UDP_GRO)
+            auto* message = const_cast<msghdr*>(&header.msg_hdr);
+            for (auto* cmsg = CMSG_FIRSTHDR(message); cmsg != nullptr; cmsg = CMSG_NXTHDR(message, cmsg)) {
+                if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    int segment = 0;
+                    std::memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+                    stride = segment > 0 ? static_cast<std::size_t>(segment) : length;
+                }
+            }
+#endif
+            std::size_t offset = 0;
+            do {
+                const auto size = std::min(stride, length - offset);
+                mReady.emplace_back(slot + offset, size);
+                mReadySlots.push_back(idx);
+                offset += size;
+                ++mMetrics.datagrams_received;
+            } while (offset < length);
+        }
+    }
+
+    /// Replies go to whoever sent the datagram handed out last.
+    auto _adoptSource(std::size_t slot) -> void {
+        mRemote       = mRecvNames[slot];
+        mRemoteLength = mRecvHeaders[slot].msg_hdr.msg_namelen;
+    }
+
+    /// Fill the send headers for the front of @p messages and return how many headers are in use.
+    auto _prepareSend(std::span<const std::span<const std::byte>> messages) -> std::size_t {
+        std::size_t headers = 0;
+        std::size_t message = 0;
+        while (headers < mSendHeaders.size() && message < messages.size() && message < mSendIov.size()) {
+            auto& header    = mSendHeaders[headers];
+            header          = {};
+            const auto size = messages[message].size();
+            std::size_t run = 1;
+            if (mOptions.gso && size > 0U) {
+                // A train is a run of equal-sized datagrams, only its last one may be shorter.
+                std::size_t total = size;
+                while (message + run < messages.size() && message + run < mSendIov.size() && run < KMaxSegments) {
+                    const auto next = messages[message + run].size();
+                    if (next == 0U || next > size || total + next > KMaxDatagramBytes) {
+                        break;
+                    }
+                    total += next;
+                    ++run;
+                    if (next < size) {
+                        break;
+                    }
+                }
+            }
+            for (std::size_t idx = 0; idx < run; ++idx) {
+                const auto& body       = messages[message + idx];
+                mSendIov[message + idx] = {const_cast<std::byte*>(body.data()), body.size()};
+            }
+            header.msg_hdr.msg_name    = &mRemote;
+            header.msg_hdr.msg_namelen = mRemoteLength;
+            header.msg_hdr.msg_iov     = &mSendIov[message];
+            header.msg_hdr.msg_iovlen  = run;
+#if defined(UDP_SEGMENT)
+            if (run > 1U) {
+                auto* control                 = mSendControl.data() + headers * KControlBytes;
+                header.msg_hdr.msg_control    = control;
+                header.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(std::uint16_t));
+                auto* cmsg                    = CMSG_FIRSTHDR(&header.msg_hdr);
+                cmsg->cmsg_level              = IPPROTO_UDP;
+                cmsg->cmsg_type               = UDP_SEGMENT;
+                cmsg->cmsg_len                = CMSG_LEN(sizeof(std::uint16_t));
+                const auto segment            = static_cast<std::uint16_t>(size);
+                std::memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+            }
+#endif
+            mSendCounts[headers] = run;
+            message += run;
+            ++headers;
+        }
+        return headers;
+    }
+
+    /// Wait until the socket is ready for @p events, the endpoint is closed or the task stops.
+    auto _waitFor(short events) -> ilias::IoTask<void> {
+        const auto socket = mSocket;
+        ILIAS_CO_TRYV(co_await poll_fds<2>(socket, {{{socket->fd, events, 0}, {socket->wake, POLLIN, 0}}}));
+        co_return {};
+    }
+
+    static constexpr std::size_t KMaxBatch         = 1024U;
+    static constexpr std::size_t KMaxDatagramBytes = 65507U;
+    static constexpr std::size_t KMaxSegments      = 64U;
+    static constexpr std::size_t KControlBytes     = CMSG_SPACE(sizeof(int));
+
+    std::shared_ptr<Socket> mSocket;
+    Options mOptions;
+    Metrics mMetrics;
+    sockaddr_storage mRemote{};
+    socklen_t mRemoteLength = 0;
+    std::size_t mSlotBytes  = 0;
+    // Receive pool, set up once: slot i of mRecvBuffer belongs to header i.
+    std::vector<std::byte> mRecvBuffer;
+    std::vector<mmsghdr> mRecvHeaders;
+    std::vector<iovec> mRecvIov;
+    std::vector<sockaddr_storage> mRecvNames;
+    std::vector<unsigned char> mRecvControl;
+    std::vector<std::span<const std::byte>> mReady;
+    std::vector<std::size_t> mReadySlots;
+    std::size_t mNext = 0;
+    std::vector<mmsghdr> mSendHeaders;
+    std::vector<iovec> mSendIov;
+    std::vector<std::size_t> mSendCounts;
+    std::vector<unsigned char> mSendControl;
+};
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
+#endif
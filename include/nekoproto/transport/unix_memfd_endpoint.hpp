@@ -0,0 +1,624 @@
+#pragma once
+
+// Unix domain socket message endpoint that hands large messages over as sealed memfds.
+
+#include "nekoproto/transport/endpoint.hpp"
+#include "nekoproto/transport/fd_wait.hpp"
+#include "nekoproto/transport/socket_address.hpp"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <ilias/io/error.hpp>
+#include <ilias/result.hpp>
+#include <ilias/sync/mutex.hpp>
+#include <ilias/task.hpp>
+
+NEKO_BEGIN_NAMESPACE
+
+namespace detail {
+
+struct UnixMemfdOptions {
+    // Messages at least this large travel as a memfd, smaller ones inline. Both peers must agree: a larger
+    // inline frame fails the recv.
+    std::size_t memfd_threshold   = 256U * 1024U;
+    std::size_t max_message_bytes = 1024U * 1024U * 1024U; // larger incoming memfd messages fail the recv
+};
+
+/**
+ * @brief Stream IMessageEndpoint over a unix domain socket for peers on the same host.
+ *
+ * Small messages are length-prefixed on the socket. A message of at least
+ * memfd_threshold bytes is assembled once in a memfd, sealed against
+ * writes and resizing, and only its descriptor crosses the socket with
+ * SCM_RIGHTS. The receiver maps it read-only, so recvView() and recvHeld()
+ * hand out a large message without copying it; recv() copies it once into
+ * the vector. Descriptors that arrive without the seals are refused, so the
+ * peer can neither change a message under the reader nor truncate it, and
+ * only a few unclaimed descriptors may queue before the recv fails. An
+ * inline frame of memfd_threshold bytes or more fails the recv as well, so
+ * a peer cannot make the read buffer grow past the threshold; after a frame
+ * larger than the default read buffer the buffer shrinks back. A sender
+ * that cannot create a memfd fails such a message instead of inlining it.
+ *
+ * Each frame starts with a little-endian u64 holding the body length, with
+ * the top bit set for a memfd frame. Sleeping waits go through the IoContext
+ * reactor and end when the awaiting task is stopped; the socket itself is
+ * non-blocking.
+ */
+class UnixMemfdMessageEndpoint : public IMessageEndpoint {
+public:
+    using Options = UnixMemfdOptions;
+
+    struct Metrics {
+        std::uint64_t inline_sent      = 0;
+        std::uint64_t memfd_sent       = 0;
+        std::uint64_t memfd_received   = 0;
+        std::uint64_t memfd_bytes_sent = 0;
+    };
+
+    /// Connect to the socket at @p path; a leading '@' names an abstract socket.
+    static auto connect(std::string_view path, Options options = {})
+        -> ilias::Result<UnixMemfdMessageEndpoint, std::error_code> {
+        sockaddr_un address{};
+        socklen_t addressLength = 0;
+        if (!parse_unix_address(path, address, addressLength)) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), addressLength) != 0) {
+            const std::error_code error(errno, std::system_category());
+            ::close(fd);
+            return ilias::Err(error);
+        }
+        return adopt(fd, options);
+    }
+
+    /// Two connected endpoints, e.g. for a parent and the child it forks.
+    static auto createPair(Options options = {})
+        -> ilias::Result<std::pair<UnixMemfdMessageEndpoint, UnixMemfdMessageEndpoint>, std::error_code> {
+        std::array<int, 2> fds{-1, -1};
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds.data()) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        auto first = adopt(fds[0], options);
+        if (!first) {
+            ::close(fds[1]);
+            return ilias::Err(first.error());
+        }
+        auto second = adopt(fds[1], options);
+        if (!second) {
+            return ilias::Err(second.error());
+        }
+        return std::make_pair(std::move(first.value()), std::move(second.value()));
+    }
+
+    /// Take ownership of the connected unix stream socket @p fd.
+    static auto adopt(int fd, Options options = {}) -> ilias::Result<UnixMemfdMessageEndpoint, std::error_code> {
+        auto socket = std::make_shared<Socket>();
+        socket->fd  = fd;
+        const int flags = ::fcntl(fd, F_GETFL);
+        if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        socket->wake = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (socket->wake < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        return UnixMemfdMessageEndpoint(std::move(socket), options);
+    }
+
+    UnixMemfdMessageEndpoint(UnixMemfdMessageEndpoint&& other) noexcept
+        : mSocket(std::move(other.mSocket)), mOptions(other.mOptions), mMetrics(other.mMetrics),
+          mReadBuffer(std::move(other.mReadBuffer)), mStart(std::exchange(other.mStart, 0)),
+          mEnd(std::exchange(other.mEnd, 0)), mFds(std::move(other.mFds)),
+          mMapping(std::exchange(other.mMapping, nullptr)), mMappingBytes(std::exchange(other.mMappingBytes, 0)) {}
+    ~UnixMemfdMessageEndpoint() override {
+        close();
+        _unmap();
+        for (const int fd : mFds) {
+            ::close(fd);
+        }
+    }
+
+    auto options() const noexcept -> const Options& { return mOptions; }
+    auto metrics() const noexcept -> Metrics { return mMetrics; }
+
+    auto recv(std::vector<std::byte>& buffer) -> ilias::IoTask<std::size_t> override {
+        ILIAS_CO_TRY(auto message, co_await recvView());
+        buffer.assign(message.begin(), message.end());
+        _unmap();
+        co_return buffer.size();
+    }
+
+    /// A memfd message keeps its mapping, which goes with the last copy of the holder; a small one is copied.
+    auto recvHeld(std::vector<std::byte>& buffer) -> ilias::IoTask<HeldMessage> override {
+        ILIAS_CO_TRY(auto message, co_await recvView());
+        if (mMapping == nullptr) {
+            buffer.assign(message.begin(), message.end());
+            co_return HeldMessage{.bytes = std::span<const std::byte>{buffer}, .holder = nullptr};
+        }
+        std::shared_ptr<const void> holder(std::exchange(mMapping, nullptr),
+                                           [bytes = std::exchange(mMappingBytes, 0)](void* mapping) {
+                                               ::munmap(mapping, bytes);
+                                           });
+        co_return HeldMessage{.bytes = message, .holder = std::move(holder)};
+    }
+
+    /**
+     * @brief Receive one message without copying it.
+     *
+     * A memfd message is viewed through its read-only mapping, a small one
+     * inside the read buffer. The view stays valid until the next recv,
+     * recvHeld or recvView call.
+     */
+    auto recvView() -> ilias::IoTask<std::span<const std::byte>> {
+        _unmap();
+        _shrinkReadBuffer();
+        ILIAS_CO_TRYV(co_await _ensure(KHeaderBytes));
+        std::uint64_t header = 0;
+        for (std::size_t idx = 0; idx < KHeaderBytes; ++idx) {
+            header |= static_cast<std::uint64_t>(mReadBuffer[mStart + idx]) << (8U * idx);
+        }
+        mStart += KHeaderBytes;
+        const auto length = static_cast<std::size_t>(header & ~KMemfdFlag);
+        if ((header & KMemfdFlag) != 0U) {
+            if (length > mOptions.max_message_bytes) {
+                co_return ilias::Err(ilias::IoError::MessageTooLarge);
+            }
+            co_return _mapMemfd(length);
+        }
+        // Anything this large must come as a memfd, so the read buffer never grows past the threshold.
+        if (length >= mOptions.memfd_threshold || length > mOptions.max_message_bytes) {
+            co_return ilias::Err(ilias::IoError::MessageTooLarge);
+        }
+        ILIAS_CO_TRYV(co_await _ensure(length));
+        const std::span<const std::byte> message(mReadBuffer.data() + mStart, length);
+        mStart += length;
+        co_return message;
+    }
+
+    auto send(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> override {
+        const std::array<std::span<const std::byte>, 1> pieces{buffer};
+        co_return co_await sendVectored(pieces);
+    }
+
+    /**
+     * @brief Send one message made of @p pieces laid end to end.
+     *
+     * A memfd message is assembled in a shared mapping of the memfd, so the
+     * pieces are copied exactly once, and an inline one leaves as a single
+     * sendmsg with an iovec per piece. Neither path joins the pieces first.
+     */
+    auto sendVectored(std::span<const std::span<const std::byte>> pieces) -> ilias::IoTask<std::size_t> override {
+        if (mSocket == nullptr) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        std::size_t size = 0;
+        for (const auto piece : pieces) {
+            size += piece.size();
+        }
+        auto guard = co_await mSocket->sendMutex.lock();
+        int memfd  = -1;
+        if (size >= mOptions.memfd_threshold) {
+            // The receiver refuses inline frames this large, so without a memfd the message cannot go at all.
+            ILIAS_CO_TRY(memfd, _makeMemfd(pieces, size));
+        }
+        std::array<std::byte, KHeaderBytes> header{};
+        const std::uint64_t value = size | (memfd >= 0 ? KMemfdFlag : 0U);
+        for (std::size_t idx = 0; idx < KHeaderBytes; ++idx) {
+            header[idx] = static_cast<std::byte>((value >> (8U * idx)) & 0xFFU);
+        }
+        std::vector<std::span<const std::byte>> frame;
+        frame.reserve(pieces.size() + 1U);
+        frame.emplace_back(header);
+        if (memfd < 0) {
+            frame.insert(frame.end(), pieces.begin(), pieces.end());
+        }
+        auto sent = co_await _sendAll(frame, memfd);
+        if (memfd >= 0) {
+            ::close(memfd);
+        }
+        if (!sent) {
+            co_return ilias::Err(sent.error());
+        }
+        if (memfd >= 0) {
+            ++mMetrics.memfd_sent;
+            mMetrics.memfd_bytes_sent += size;
+        } else {
+            ++mMetrics.inline_sent;
+        }
+        co_return size;
+    }
+
+    /// Wake any waiting recv or send; they fail from then on.
+    auto close() -> void override {
+        if (mSocket == nullptr || mSocket->closed.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        const std::uint64_t one = 1;
+        (void)::write(mSocket->wake, &one, sizeof(one));
+    }
+    auto shutdown() -> ilias::IoTask<void> override {
+        if (mSocket != nullptr) {
+            (void)::shutdown(mSocket->fd, SHUT_WR);
+        }
+        co_return {};
+    }
+    auto flush() -> ilias::IoTask<void> override { co_return {}; }
+
+private:
+    struct Socket {
+        int fd   = -1;
+        int wake = -1;
+        std::atomic<bool> closed{false};
+        ilias::Mutex sendMutex;
+
+        ~Socket() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (wake >= 0) {
+                ::close(wake);
+            }
+        }
+    };
+
+    UnixMemfdMessageEndpoint(std::shared_ptr<Socket> socket, const Options& options)
+        : mSocket(std::move(socket)), mOptions(options), mReadBuffer(KReadBufferBytes) {}
+
+    /// Read until at least @p bytes are buffered past mStart, growing the buffer for large inline frames.
+    auto _ensure(std::size_t bytes) -> ilias::IoTask<void> {
+        while (mEnd - mStart < bytes) {
+            if (mReadBuffer.size() - mStart < bytes) {
+                std::memmove(mReadBuffer.data(), mReadBuffer.data() + mStart, mEnd - mStart);
+                mEnd -= mStart;
+                mStart = 0;
+                if (mReadBuffer.size() < bytes) {
+                    mReadBuffer.resize(bytes);
+                }
+            }
+            ILIAS_CO_TRYV(co_await _readSome());
+        }
+        co_return {};
+    }
+
+    /// One recvmsg into the free tail of the read buffer, queueing any descriptors that came with it.
+    auto _readSome() -> ilias::IoTask<void> {
+        if (mSocket == nullptr) {
+            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+        }
+        while (true) {
+            if (mSocket->closed.load(std::memory_order_acquire)) {
+                co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+            }
+            iovec iov{mReadBuffer.data() + mEnd, mReadBuffer.size() - mEnd};
+            alignas(cmsghdr) std::array<unsigned char, KControlBytes> control{};
+            msghdr message{};
+            message.msg_iov        = &iov;
+            message.msg_iovlen     = 1;
+            message.msg_control    = control.data();
+            message.msg_controllen = control.size();
+            const auto received    = ::recvmsg(mSocket->fd, &message, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+            if (received >= 0) {
+                // A sender attaches one descriptor per memfd header. Extras in the same chunk can never be
+                // claimed, so they are closed at once; a queue that still fills up means the peer is misbehaving.
+                bool kept     = false;
+                bool overflow = false;
+                for (auto* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                        const auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                        for (std::size_t idx = 0; idx < count; ++idx) {
+                            int fd = -1;
+                            std::memcpy(&fd, CMSG_DATA(cmsg) + idx * sizeof(int), sizeof(int));
+                            if (kept || mFds.size() >= KMaxQueuedFds) {
+                                overflow = overflow || !kept;
+                                ::close(fd);
+                                continue;
+                            }
+                            mFds.push_back(fd);
+                            kept = true;
+                        }
+                    }
+                }
+                if ((message.msg_flags & MSG_CTRUNC) != 0 || overflow) {
+                    co_return ilias::Err(ilias::IoError::MessageTooLarge);
+                }
+                if (received == 0) {
+                    co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+                }
+                mEnd += static_cast<std::size_t>(received);
+                co_return {};
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                co_return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+            ILIAS_CO_TRYV(co_await _waitFor(POLLIN));
+        }
+    }
+
+    /// Map the descriptor that came with the current header, after checking its seals and size.
+    auto _mapMemfd(std::size_t length) -> ilias::Result<std::span<const std::byte>, std::error_code> {
+        if (mFds.empty()) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        const int fd = mFds.front();
+        mFds.pop_front();
+        const int seals = ::fcntl(fd, F_GET_SEALS);
+        struct stat info {};
+        if (seals < 0 || (seals & (F_SEAL_WRITE | F_SEAL_SHRINK)) != (F_SEAL_WRITE | F_SEAL_SHRINK) ||
+            ::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < length) {
+            ::close(fd);
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        ++mMetrics.memfd_received;
+        if (length == 0U) {
+            ::close(fd);
+            return std::span<const std::byte>();
+        }
+        // A private read-only mapping, which the write seal allows on every kernel that has seals.
+        auto* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        const std::error_code error(errno, std::system_category());
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return ilias::Err(error);
+        }
+        mMapping      = mapping;
+        mMappingBytes = length;
+        return std::span<const std::byte>(static_cast<const std::byte*>(mapping), length);
+    }
+
+    /// Give back the memory of an oversized inline frame once what is still buffered fits the default size.
+    auto _shrinkReadBuffer() -> void {
+        if (mReadBuffer.size() <= KReadBufferBytes || mEnd - mStart > KReadBufferBytes) {
+            return;
+        }
+        std::vector<std::byte> buffer(KReadBufferBytes);
+        std::memcpy(buffer.data(), mReadBuffer.data() + mStart, mEnd - mStart);
+        mReadBuffer = std::move(buffer);
+        mEnd -= mStart;
+        mStart = 0;
+    }
+
+    auto _unmap() -> void {
+        if (mMapping != nullptr) {
+            ::munmap(mMapping, mMappingBytes);
+            mMapping      = nullptr;
+            mMappingBytes = 0;
+        }
+    }
+
+    /// A sealed memfd of @p size bytes holding @p pieces back to back.
+    static auto _makeMemfd(std::span<const std::span<const std::byte>> pieces, std::size_t size)
+        -> ilias::Result<int, std::error_code> {
+        const int fd = ::memfd_create("nekoproto-message", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        const auto fail = [fd]() {
+            const std::error_code error(errno, std::system_category());
+            ::close(fd);
+            return ilias::Err(error);
+        };
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            return fail();
+        }
+        // The pieces go straight into the page cache pages the receiver will map. The mapping must be gone
+        // before the write seal is added, the kernel refuses it while a writable shared mapping exists.
+        if (size > 0U) {
+            auto* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED) {
+                return fail();
+            }
+            auto* out = static_cast<std::byte*>(mapping);
+            for (const auto piece : pieces) {
+                if (!piece.empty()) {
+                    std::memcpy(out, piece.data(), piece.size());
+                    out += piece.size();
+                }
+            }
+            ::munmap(mapping, size);
+        }
+        if (::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+            return fail();
+        }
+        return fd;
+    }
+
+    /// Send @p pieces back to back; @p memfd, if any, rides along with the first byte.
+    auto _sendAll(std::span<const std::span<const std::byte>> pieces, int memfd) -> ilias::IoTask<void> {
+        std::size_t piece  = 0;
+        std::size_t offset = 0;
+        bool fdPending     = memfd >= 0;
+        std::vector<iovec> iov;
+        while (piece < pieces.size()) {
+            if (mSocket->closed.load(std::memory_order_acquire)) {
+                co_return ilias::Err(ilias::IoError::ConnectionReset);
+            }
+            iov.clear();
+            for (auto idx = piece; idx < pieces.size() && iov.size() < static_cast<std::size_t>(IOV_MAX); ++idx) {
+                const auto skip = idx == piece ? offset : 0U;
+                if (pieces[idx].size() > skip) {
+                    iov.push_back({const_cast<std::byte*>(pieces[idx].data() + skip), pieces[idx].size() - skip});
+                }
+            }
+            const auto count = iov.size();
+            if (count == 0U) {
+                break;
+            }
+            alignas(cmsghdr) std::array<unsigned char, CMSG_SPACE(sizeof(int))> control{};
+            msghdr message{};
+            message.msg_iov    = iov.data();
+            message.msg_iovlen = count;
+            if (fdPending) {
+                message.msg_control    = control.data();
+                message.msg_controllen = control.size();
+                auto* cmsg             = CMSG_FIRSTHDR(&message);
+                cmsg->cmsg_level       = SOL_SOCKET;
+                cmsg->cmsg_type        = SCM_RIGHTS;
+                cmsg->cmsg_len         = CMSG_LEN(sizeof(int));
+                std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+            }
+            const auto sent = ::sendmsg(mSocket->fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent >= 0) {
+                fdPending = fdPending && sent == 0;
+                offset += static_cast<std::size_t>(sent);
+                while (piece < pieces.size() && offset >= pieces[piece].size()) {
+                    offset -= pieces[piece].size();
+                    ++piece;
+                }
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                co_return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+            ILIAS_CO_TRYV(co_await _waitFor(POLLOUT));
+        }
+        co_return {};
+    }
+
+    /// Wait until the socket is ready for @p events, the endpoint is closed or the task stops.
+    auto _waitFor(short events) -> ilias::IoTask<void> {
+        const auto& socket = mSocket;
+        ILIAS_CO_TRYV(co_await poll_fds<2>(socket, {{{socket->fd, events, 0}, {socket->wake, POLLIN, 0}}}));
+        co_return {};
+    }
+
+    static constexpr std::size_t KHeaderBytes     = 8U;
+    static constexpr std::uint64_t KMemfdFlag     = std::uint64_t{1} << 63U;
+    static constexpr std::size_t KReadBufferBytes = 64U * 1024U;
+    // The kernel stops a stream recvmsg after the first chunk that carries descriptors, one per memfd frame.
+    static constexpr std::size_t KControlBytes = CMSG_SPACE(sizeof(int) * 4U);
+    // Descriptors waiting for their header; the reader is never more than one memfd frame ahead.
+    static constexpr std::size_t KMaxQueuedFds = 4U;
+
+    std::shared_ptr<Socket> mSocket;
+    Options mOptions;
+    Metrics mMetrics;
+    std::vector<std::byte> mReadBuffer;
+    std::size_t mStart = 0;
+    std::size_t mEnd   = 0;
+    std::deque<int> mFds;
+    void* mMapping            = nullptr;
+    std::size_t mMappingBytes = 0;
+};
+
+/// Listening unix stream socket that hands out UnixMemfdMessageEndpoints.
+class UnixMemfdListener {
+public:
+    /// Listen on @p path; a leading '@' names an abstract socket. A filesystem path is removed again on close.
+    static auto bind(std::string_view path, int backlog = SOMAXCONN)
+        -> ilias::Result<UnixMemfdListener, std::error_code> {
+        sockaddr_un address{};
+        socklen_t addressLength = 0;
+        if (!parse_unix_address(path, address, addressLength)) {
+            return ilias::Err(ilias::IoError::InvalidArgument);
+        }
+        auto state  = std::make_shared<State>();
+        state->fd   = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        state->wake = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (state->fd < 0 || state->wake < 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        if (::bind(state->fd, reinterpret_cast<const sockaddr*>(&address), addressLength) != 0 ||
+            ::listen(state->fd, backlog) != 0) {
+            return ilias::Err(std::error_code(errno, std::system_category()));
+        }
+        if (!path.starts_with('@')) {
+            state->path = std::string(path);
+        }
+        UnixMemfdListener listener;
+        listener.mState = std::move(state);
+        return listener;
+    }
+
+    auto accept(UnixMemfdOptions options = {}) -> ilias::IoTask<UnixMemfdMessageEndpoint> {
+        // Held until poll returns, the listener may be moved or destroyed meanwhile.
+        const auto state = mState;
+        while (state != nullptr) {
+            const int fd = ::accept4(state->fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                co_return UnixMemfdMessageEndpoint::adopt(fd, options);
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                co_return ilias::Err(std::error_code(errno, std::system_category()));
+            }
+            ILIAS_CO_TRY(auto ready,
+                         co_await poll_fds<2>(state, {{{state->fd, POLLIN, 0}, {state->wake, POLLIN, 0}}}));
+            if ((ready[1].revents & POLLIN) != 0) {
+                break;
+            }
+        }
+        co_return ilias::Err(ilias::IoError::ConnectionReset);
+    }
+
+    /// Wake a pending accept, which then fails.
+    auto close() -> void {
+        if (mState != nullptr) {
+            const std::uint64_t one = 1;
+            (void)::write(mState->wake, &one, sizeof(one));
+        }
+    }
+
+private:
+    struct State {
+        int fd   = -1;
+        int wake = -1;
+        std::string path;
+
+        ~State() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (wake >= 0) {
+                ::close(wake);
+            }
+            if (!path.empty()) {
+                ::unlink(path.c_str());
+            }
+        }
+    };
+
+    std::shared_ptr<State> mState;
+};
+
+} // namespace detail
+
+NEKO_END_NAMESPACE
+#endif
@@ -1,7 +1,9 @@
 #include "nekoproto/jsonrpc/jsonrpc.hpp"
 #include "nekoproto/jsonrpc/jsonrpc_error.hpp"
 #include "nekoproto/jsonrpc/message_stream_wrapper.hpp"
+#include <optional>
 #include <string>
+#include <utility>
 
 namespace NEKO_NAMESPACE::detail {
 
@@ -38,28 +40,27 @@ NEKO_PROTO_API
 auto make_tcp_stream_client(const std::string& url) -> IoTask<IliasLengthPrefixedMessageEndpoint> {
     return make_tcp_stream_client(std::string_view(url));
 }
-NEKO_PROTO_API
-auto make_udp_stream_client(IPEndpoint bindIpendpoint, IPEndpoint remoteIpendpoint)
-    -> IoTask<IliasChunkedDatagramMessageEndpoint> {
-    if (auto ret = ilias::Socket::make(bindIpendpoint.family(), SOCK_DGRAM, 0); ret) {
-        auto socket = std::move(ret.value());
-        socket.setOption(ilias::sockopt::ReuseAddress(1));
-        if (auto ret1 = socket.bind(bindIpendpoint); !ret1) {
-            socket.close();
-            co_return Err(ret1.error());
-        }
-        auto udpclient = IliasUdpSocket::from(std::move(socket));
-        co_return IliasChunkedDatagramMessageEndpoint(std::move(udpclient.value()), remoteIpendpoint,
-                                                      JsonRpcError::MessageToolLarge);
-    } else {
-        co_return Err(ret.error());
+static auto bind_udp_socket(const IPEndpoint& bindIpendpoint) -> ilias::Result<IliasUdpSocket, std::error_code> {
+    auto ret = ilias::Socket::make(bindIpendpoint.family(), SOCK_DGRAM, 0);
+    if (!ret) {
+        return Err(ret.error());
     }
+    auto socket = std::move(ret.value());
+    socket.setOption(ilias::sockopt::ReuseAddress(1));
+    if (auto ret1 = socket.bind(bindIpendpoint); !ret1) {
+        socket.close();
+        return Err(ret1.error());
+    }
+    auto udpclient = IliasUdpSocket::from(std::move(socket));
+    if (!udpclient) {
+        return Err(udpclient.error());
+    }
+    return std::move(udpclient.value());
 }
 
 // like udp://127.0.0.1:12345-127.0.0.1:12346
 // 127.0.0.1:12345-127.0.0.1:12346
-NEKO_PROTO_API
-auto make_udp_stream_client(std::string_view url) -> IoTask<IliasChunkedDatagramMessageEndpoint> {
+static auto parse_udp_url(std::string_view url) -> std::optional<std::pair<IPEndpoint, IPEndpoint>> {
     std::string_view bindRemoteIp;
     if (url.substr(0, 6) == "udp://") {
         bindRemoteIp = url.substr(6);
@@ -68,14 +69,34 @@ auto make_udp_stream_client(std::string_view url) -> IoTask<IliasChunkedDatagram
     }
     auto pos = bindRemoteIp.find('-');
     if (pos == std::string_view::npos) {
-        co_return Err(ilias::IoError::InvalidArgument);
+        return std::nullopt;
     }
     auto bindIpendpoint   = IPEndpoint::fromString(bindRemoteIp.substr(0, pos));
     auto remoteIpendpoint = IPEndpoint::fromString(bindRemoteIp.substr(pos + 1));
     if (!bindIpendpoint || !remoteIpendpoint) {
+        return std::nullopt;
+    }
+    return std::make_pair(bindIpendpoint.value(), remoteIpendpoint.value());
+}
+
+NEKO_PROTO_API
+auto make_udp_stream_client(IPEndpoint bindIpendpoint, IPEndpoint remoteIpendpoint)
+    -> IoTask<IliasChunkedDatagramMessageEndpoint> {
+    auto udpclient = bind_udp_socket(bindIpendpoint);
+    if (!udpclient) {
+        co_return Err(udpclient.error());
+    }
+    co_return IliasChunkedDatagramMessageEndpoint(std::move(udpclient.value()), remoteIpendpoint,
+                                                  JsonRpcError::MessageToolLarge);
+}
+
+NEKO_PROTO_API
+auto make_udp_stream_client(std::string_view url) -> IoTask<IliasChunkedDatagramMessageEndpoint> {
+    auto endpoints = parse_udp_url(url);
+    if (!endpoints) {
         co_return Err(ilias::IoError::InvalidArgument);
     }
-    co_return co_await make_udp_stream_client(bindIpendpoint.value(), remoteIpendpoint.value());
+    co_return co_await make_udp_stream_client(endpoints->first, endpoints->second);
 }
 NEKO_PROTO_API
 auto make_udp_stream_client(const char* url) -> IoTask<IliasChunkedDatagramMessageEndpoint> {
@@ -85,4 +106,33 @@ NEKO_PROTO_API
 auto make_udp_stream_client(const std::string& url) -> IoTask<IliasChunkedDatagramMessageEndpoint> {
     co_return co_await make_udp_stream_client(std::string_view(url));
 }
+NEKO_PROTO_API
+auto make_fragmented_udp_stream_client(IPEndpoint bindIpendpoint, IPEndpoint remoteIpendpoint,
+                                       DatagramFragmentOptions options)
+    -> IoTask<IliasFragmentedDatagramMessageEndpoint> {
+    auto udpclient = bind_udp_socket(bindIpendpoint);
+    if (!udpclient) {
+        co_return Err(udpclient.error());
+    }
+    co_return IliasFragmentedDatagramMessageEndpoint(std::move(udpclient.value()), remoteIpendpoint, options,
+                                                     JsonRpcError::MessageToolLarge);
+}
+NEKO_PROTO_API
+auto make_fragmented_udp_stream_client(std::string_view url, DatagramFragmentOptions options)
+    -> IoTask<IliasFragmentedDatagramMessageEndpoint> {
+    auto endpoints = parse_udp_url(url);
+    if (!endpoints) {
+        co_return Err(ilias::IoError::InvalidArgument);
+    }
+    co_return co_await make_fragmented_udp_stream_client(endpoints->first, endpoints->second, options);
+}
+#if defined(__linux__)
+NEKO_PROTO_API
+auto make_unix_stream_client(std::string_view url, UnixMemfdOptions options) -> IoTask<UnixMemfdMessageEndpoint> {
+    if (url.substr(0, 7) == "unix://") {
+        url = url.substr(7);
+    }
+    co_return UnixMemfdMessageEndpoint::connect(url, options);
+}
+#endif
 } // namespace NEKO_NAMESPACE::detail
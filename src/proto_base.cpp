@@ -12,6 +12,7 @@
 #include "nekoproto/proto/proto_base.hpp"
 #include "nekoproto/global/log.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 
@@ -63,9 +64,26 @@ void ProtoFactory::regist(const NEKO_STRING_VIEW& name, std::function<IProto()>
     }
 }
 
+namespace {
+/// Hash entry of a name that shares its hash with another declared name.
+constexpr int KCollidedProtoHash = -2;
+/// Remote types above this are not translated, a dense table that large means a bogus peer table.
+constexpr uint32_t KMaxTranslatedProtoType = 0xFFFF;
+} // namespace
+
 int ProtoFactory::_protoType(const NEKO_STRING_VIEW& name, const bool isDeclared, const int specifyType) NEKO_NOEXCEPT {
     auto& protoNameMap  = _staticProtoTypeMap();
     static int kCounter = NEKO_RESERVED_PROTO_TYPE_SIZE;
+
+    const auto declareHash = [&](const int type) {
+        auto [item, inserted] =
+            _staticProtoHashMap().try_emplace(detail::proto_name_hash(name), std::make_pair(name, type));
+        if (!inserted && item->second.first != name) {
+            NEKO_LOG_WARN("proto", "proto {} shares name hash {:#x} with {}, lookups by name will fall back to the map",
+                          name, item->first, item->second.first);
+            item->second.second = KCollidedProtoHash;
+        }
+    };
     if (name.empty()) {
         NEKO_LOG_ERROR("proto", "Empty proto name");
         return -1;
@@ -89,10 +107,12 @@ int ProtoFactory::_protoType(const NEKO_STRING_VIEW& name, const bool isDeclared
             }
             NEKO_LOG_INFO("proto", "proto {} type is declared as {}", name, specifyType);
             protoNameMap.insert(std::make_pair(name, specifyType));
+            declareHash(specifyType);
             return specifyType;
         }
         if (isDeclared) {
             protoNameMap.insert(std::make_pair(name, ++kCounter));
+            declareHash(kCounter);
             NEKO_LOG_INFO("proto", "proto {} type is declared as {}", name, kCounter);
             return kCounter;
         }
@@ -116,7 +136,52 @@ IProto ProtoFactory::create(int type) const NEKO_NOEXCEPT {
     return {};
 }
 
-IProto ProtoFactory::create(const char* name) const NEKO_NOEXCEPT { return create(_protoType(name, false)); }
+IProto ProtoFactory::create(const char* name) const NEKO_NOEXCEPT { return create(protoType(name)); }
+
+int ProtoFactory::protoType(const NEKO_STRING_VIEW& name) NEKO_NOEXCEPT {
+    const auto type = _findProtoType(name);
+    return type != -1 ? type : _protoType(name, false);
+}
+
+int ProtoFactory::_findProtoType(const NEKO_STRING_VIEW& name) NEKO_NOEXCEPT {
+    const auto& hashMap = _staticProtoHashMap();
+    auto item           = hashMap.find(detail::proto_name_hash(name));
+    if (item == hashMap.end()) {
+        return -1;
+    }
+    if (item->second.second != KCollidedProtoHash) {
+        return item->second.first == name ? item->second.second : -1;
+    }
+    const auto& nameMap = _staticProtoTypeMap();
+    auto named          = nameMap.find(name);
+    return named != nameMap.end() ? named->second : -1;
+}
+
+std::vector<int> ProtoFactory::translateProtoTypes(const std::map<uint32_t, std::string>& remoteTable) NEKO_NOEXCEPT {
+    std::vector<int> table;
+    if (remoteTable.empty()) {
+        return table;
+    }
+    const auto size = std::min(remoteTable.rbegin()->first, KMaxTranslatedProtoType) + 1;
+    table.resize(size, -1);
+    for (uint32_t type = 1; type <= NEKO_RESERVED_PROTO_TYPE_SIZE && type < size; ++type) {
+        table[type] = static_cast<int>(type);
+    }
+    for (const auto& [remoteType, name] : remoteTable) {
+        if (remoteType <= NEKO_RESERVED_PROTO_TYPE_SIZE) {
+            continue;
+        }
+        if (remoteType >= size) {
+            NEKO_LOG_WARN("proto", "remote proto {} has out of range type {}, ignored", name, remoteType);
+            continue;
+        }
+        table[remoteType] = _findProtoType(name);
+        if (table[remoteType] == -1) {
+            NEKO_LOG_INFO("proto", "remote proto {} ({}) is not declared locally", name, remoteType);
+        }
+    }
+    return table;
+}
 
 const std::map<NEKO_STRING_VIEW, int>& ProtoFactory::protoTypeMap() NEKO_NOEXCEPT { return _staticProtoTypeMap(); }
 
@@ -125,6 +190,11 @@ std::map<NEKO_STRING_VIEW, int>& ProtoFactory::_staticProtoTypeMap() {
     return kProtoNameMap;
 }
 
+std::unordered_map<uint32_t, std::pair<NEKO_STRING_VIEW, int>>& ProtoFactory::_staticProtoHashMap() {
+    static std::unordered_map<uint32_t, std::pair<NEKO_STRING_VIEW, int>> kProtoHashMap;
+    return kProtoHashMap;
+}
+
 ProtoFactory::~ProtoFactory() {
     // Nothing to do
 }
@@ -1,9 +1,6 @@
 #include "nekoproto/rpc/private/backend_base.hpp"
 #include "nekoproto/rpc/error.hpp"
 
-#include "nekoproto/serialization/reflection.hpp"
-
-#include <cstring>
 #include <limits>
 #include <utility>
 
@@ -24,36 +21,25 @@ auto append_bytes(NekoRpcFrameCodec::MessageType& out, std::span<const std::byte
 constexpr std::uint8_t MethodTableFormatVersion = 2U;
 
 auto read_header(std::span<const std::byte> data) -> NekoRpcFrameCodec::Header {
-    std::size_t offset = 0;
-    NekoRpcFrameCodec::Header header;
-    Reflect<NekoRpcFrameCodec::Header>::forEach(header, [&](auto& field) {
-        using ValueType = std::remove_reference_t<decltype(field)>;
-        if constexpr (std::is_enum_v<ValueType>) {
-            using WireType = std::underlying_type_t<ValueType>;
-            field          = static_cast<ValueType>(NekoRpcExtensionCodec::readInteger<WireType>(data, offset));
-            offset += sizeof(WireType);
-        } else if constexpr (std::is_integral_v<ValueType>) {
-            field = NekoRpcExtensionCodec::readInteger<ValueType>(data, offset);
-            offset += sizeof(ValueType);
-        } else {
-            static_assert(always_false_v<ValueType>, "Unsupported type");
-        }
-    });
-    return header;
-}
-
-auto append_header(NekoRpcFrameCodec::MessageType& out, const NekoRpcFrameCodec::Header& header) -> void {
-    Reflect<NekoRpcFrameCodec::Header>::forEach(header, [&](auto& field) {
-        using ValueType = std::remove_reference_t<decltype(field)>;
-        if constexpr (std::is_enum_v<ValueType>) {
-            NekoRpcExtensionCodec::appendInteger(out, static_cast<std::underlying_type_t<ValueType>>(field));
-        } else if constexpr (std::is_integral_v<ValueType>) {
-            NekoRpcExtensionCodec::appendInteger(out, field);
-        } else {
-            static_assert(always_false_v<ValueType>, "Unsupported type");
-        }
-    });
-}
+    return NekoRpcFrameCodec::unpackHeader(data.first<NekoRpcFrameCodec::HeaderBytes>());
+}
+
+constexpr auto header_round_trips() -> bool {
+    const NekoRpcFrameCodec::Header header{.kind           = NekoRpcKind::Response,
+                                           .flags          = 0x12U,
+                                           .codec          = 3U,
+                                           .extension_size = 0x0405U,
+                                           .id             = 0x060708090A0B0C0DULL,
+                                           .method_size    = 0x0E0F1011U,
+                                           .payload_size   = 0x12131415U};
+    const auto wire   = NekoRpcFrameCodec::packHeader(header);
+    const auto parsed = NekoRpcFrameCodec::unpackHeader(wire);
+    return wire[0] == std::byte{'N'} && wire[1] == std::byte{'R'} && parsed.magic == header.magic &&
+           parsed.version == header.version && parsed.kind == header.kind && parsed.flags == header.flags &&
+           parsed.codec == header.codec && parsed.extension_size == header.extension_size && parsed.id == header.id &&
+           parsed.method_size == header.method_size && parsed.payload_size == header.payload_size;
+}
+static_assert(header_round_trips());
 
 auto frame_body_size(const NekoRpcFrameCodec::Header& header) -> ilias::Result<std::size_t, std::error_code> {
     const auto method_size    = static_cast<std::size_t>(header.method_size);
@@ -189,12 +175,16 @@ auto parse_method_entries(const NekoRpcFrameCodec::ExtensionMapType& extensions,
 } // namespace
 
 auto NekoRpcFrameCodec::headerSize() noexcept -> std::size_t {
-    static const auto size = header_size();
-    return size;
+    static_assert(header_size() == HeaderBytes, "NekoRpcFrameCodec::Header no longer matches packHeader/unpackHeader");
+    return HeaderBytes;
 }
 
 auto NekoRpcFrameCodec::methodName(const DecodedRequest& request) noexcept -> std::string_view {
-    return request.method;
+    return request.owned_method ? std::string_view(*request.owned_method) : request.method;
+}
+
+auto NekoRpcFrameCodec::payload(const DecodedRequest& request) noexcept -> std::span<const std::byte> {
+    return request.owned_payload ? std::span<const std::byte>(*request.owned_payload) : request.payload;
 }
 
 auto NekoRpcFrameCodec::id(const DecodedRequest& request) noexcept -> const IdType& { return request.header.id; }
@@ -211,34 +201,39 @@ auto NekoRpcFrameCodec::encodeResponses(const ResponseValuesType& responses, boo
 }
 
 auto NekoRpcFrameCodec::encodeFrame(FrameParts frame) -> MessageType {
-    MessageType extensions;
-    if (!NekoRpcExtensionCodec::appendTlvs(extensions, frame.extensions)) {
+    auto encoded = encodeFrameSegments(std::move(frame));
+    if (!encoded) {
         return {};
     }
+    return encoded.value().flatten();
+}
+
+auto NekoRpcFrameCodec::encodeFrameSegments(FrameParts frame) -> ilias::Result<EncodedFrame, std::error_code> {
+    EncodedFrame encoded;
+    if (!NekoRpcExtensionCodec::appendTlvs(encoded.extensions, frame.extensions)) {
+        return ilias::Err(RpcError::InvalidRequest);
+    }
     if (frame.method.size() > std::numeric_limits<std::uint32_t>::max() ||
-        extensions.size() > std::numeric_limits<std::uint16_t>::max() ||
+        encoded.extensions.size() > std::numeric_limits<std::uint16_t>::max() ||
         frame.payload.size() > std::numeric_limits<std::uint32_t>::max()) {
-        return {};
+        return ilias::Err(ilias::IoError::MessageTooLarge);
     }
 
     frame.header.magic          = Magic;
     frame.header.version        = Version;
     frame.header.method_size    = static_cast<std::uint32_t>(frame.method.size());
-    frame.header.extension_size = static_cast<std::uint16_t>(extensions.size());
+    frame.header.extension_size = static_cast<std::uint16_t>(encoded.extensions.size());
     frame.header.payload_size   = static_cast<std::uint32_t>(frame.payload.size());
-    if (!extensions.empty()) {
+    if (!encoded.extensions.empty()) {
         frame.header.flags = static_cast<std::uint8_t>(frame.header.flags | NekoRpcFlag::HasExtensions);
     } else {
         frame.header.flags = static_cast<std::uint8_t>(frame.header.flags & ~NekoRpcFlag::HasExtensions);
     }
 
-    MessageType out;
-    out.reserve(headerSize() + frame.method.size() + extensions.size() + frame.payload.size());
-    append_header(out, frame.header);
-    append_bytes(out, frame.method);
-    append_bytes(out, NekoRpcExtensionCodec::asBytes(extensions));
-    append_bytes(out, frame.payload);
-    return out;
+    encoded.header = packHeader(frame.header);
+    encoded.method  = frame.method;
+    encoded.payload = frame.payload;
+    return encoded;
 }
 
 auto NekoRpcFrameCodec::encodeHello(ExtensionMapType extensions, std::uint8_t codec) -> MessageType {
@@ -261,11 +256,8 @@ auto NekoRpcFrameCodec::decodeFrame(std::span<const std::byte> data) -> ilias::R
 
     DecodedRequest request;
     request.header = parts.header;
-    request.method.assign(reinterpret_cast<const char*>(parts.method.data()), parts.method.size());
-    request.payload.resize(parts.payload.size());
-    if (!parts.payload.empty()) {
-        std::memcpy(request.payload.data(), parts.payload.data(), parts.payload.size());
-    }
+    request.method  = {reinterpret_cast<const char*>(parts.method.data()), parts.method.size()};
+    request.payload = parts.payload;
     return request;
 }
 
@@ -337,14 +329,14 @@ auto NekoRpcExtensionCodec::loadTlvs(std::span<const std::byte> data, ExtensionM
         if (data.size() - offset < size) {
             return false;
         }
-        const auto type = static_cast<ExtensionType>(wire_type);
-        if (extensions.contains(type)) {
-            NEKO_LOG_ERROR("rpcbackend", "Extension {} has duplicate", wire_type);
-            return false;
-        }
-        extensions.emplace(type, data.subspan(offset, size));
+        extensions.append(static_cast<ExtensionType>(wire_type), data.subspan(offset, size));
         offset += size;
     }
+    if (const auto duplicate = extensions.sortAndFindDuplicate(); duplicate != extensions.end()) {
+        NEKO_LOG_ERROR("rpcbackend", "Extension {} has duplicate",
+                       static_cast<std::underlying_type_t<ExtensionType>>(duplicate->first));
+        return false;
+    }
     return true;
 }
 
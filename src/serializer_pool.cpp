@@ -0,0 +1,268 @@
+/**
+ * @file serializer_pool.cpp
+ * @author llhsdmd (llhsdmd@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2025-02-20
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "nekoproto/communication/serializer_pool.hpp"
+
+#include <algorithm>
+
+NEKO_BEGIN_NAMESPACE
+
+SerializerPool::SerializerPool() : SerializerPool(Options{}) {}
+
+SerializerPool::SerializerPool(Options options) : mOptions(options) {
+    if (mOptions.threads == 0) {
+        mOptions.threads = std::max(std::thread::hardware_concurrency(), 2U) - 1U;
+    }
+    mOptions.max_queued_jobs = std::max<std::size_t>(mOptions.max_queued_jobs, 1U);
+    mThreads.reserve(mOptions.threads);
+    for (std::size_t idx = 0; idx < mOptions.threads; ++idx) {
+        mThreads.emplace_back([this]() { _workerLoop(); });
+    }
+}
+
+SerializerPool::~SerializerPool() {
+    {
+        std::scoped_lock lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+auto SerializerPool::instance() -> SerializerPool& {
+    static SerializerPool kInstance;
+    return kInstance;
+}
+
+auto SerializerPool::metrics() const -> Metrics {
+    const auto snapshot = [](const StageCounters& counters) {
+        StageMetrics stage;
+        stage.jobs           = counters.jobs.load(std::memory_order_relaxed);
+        stage.inline_jobs    = counters.inlineJobs.load(std::memory_order_relaxed);
+        stage.queue_time     = std::chrono::nanoseconds(counters.queueNs.load(std::memory_order_relaxed));
+        stage.max_queue_time = std::chrono::nanoseconds(counters.maxQueueNs.load(std::memory_order_relaxed));
+        stage.run_time       = std::chrono::nanoseconds(counters.runNs.load(std::memory_order_relaxed));
+        return stage;
+    };
+    return {snapshot(mCounters[static_cast<std::size_t>(Stage::Serialize)]),
+            snapshot(mCounters[static_cast<std::size_t>(Stage::Parse)])};
+}
+
+auto SerializerPool::_tryRunInline(Strand& strand, Job& job) -> bool {
+    {
+        std::scoped_lock lock(mMutex);
+        // A busy strand must queue behind its earlier jobs whatever the size.
+        if (strand.mScheduled || strand.mParked != 0U) {
+            return false;
+        }
+        const bool small = job.bytes <= mOptions.inline_bytes;
+        if (!small && !mThreads.empty() && ilias::runtime::Executor::currentThread() != nullptr) {
+            return false;
+        }
+    }
+    job.queued = Clock::now();
+    _runJob(job, true);
+    return true;
+}
+
+auto SerializerPool::_submit(const std::shared_ptr<Job>& job) -> bool {
+    job->queued = Clock::now();
+    bool wake   = false;
+    {
+        std::scoped_lock lock(mMutex);
+        // Stopped before it was submitted: resume right away with the job never run.
+        if (job->canceled) {
+            job->state = JobState::Finished;
+            return false;
+        }
+        // Park behind a full queue, and behind earlier parked jobs of the same strand to keep its order.
+        if (mQueuedJobs >= mOptions.max_queued_jobs || job->strand->mParked != 0U) {
+            job->state = JobState::Parked;
+            ++job->strand->mParked;
+            mParked.push_back(job);
+            return true;
+        }
+        wake = _enqueueLocked(job);
+    }
+    if (wake) {
+        mCondition.notify_one();
+    }
+    return true;
+}
+
+auto SerializerPool::_enqueueLocked(const std::shared_ptr<Job>& job) -> bool {
+    auto& strand = *job->strand;
+    job->state   = JobState::Queued;
+    strand.mJobs.push_back(job);
+    ++mQueuedJobs;
+    if (strand.mScheduled) {
+        return false;
+    }
+    strand.mScheduled = true;
+    mReady.push_back(job->strand);
+    return true;
+}
+
+auto SerializerPool::_cancel(const std::shared_ptr<Job>& job) -> void {
+    std::unique_lock lock(mMutex);
+    auto& strand = *job->strand;
+    switch (job->state) {
+    case JobState::Created:
+        // The awaiter has not suspended yet, _submit sees the flag and does not suspend at all.
+        job->canceled = true;
+        return;
+    case JobState::Parked:
+        std::erase_if(mParked, [&job](const auto& item) { return item == job; });
+        --strand.mParked;
+        break;
+    case JobState::Queued:
+        std::erase_if(strand.mJobs, [&job](const auto& item) { return item == job; });
+        --mQueuedJobs;
+        break;
+    case JobState::Running:
+    case JobState::Finished:
+        // A running job resumes its owner once it finishes, nobody waits for it here.
+        return;
+    }
+    job->canceled = true;
+    job->state    = JobState::Finished;
+    _resume(lock, job);
+}
+
+auto SerializerPool::_withdraw(Job& job) -> void {
+    std::unique_lock lock(mMutex);
+    auto& strand = *job.strand;
+    switch (job.state) {
+    case JobState::Created:
+        break;
+    case JobState::Parked:
+        std::erase_if(mParked, [&job](const auto& item) { return item.get() == &job; });
+        --strand.mParked;
+        break;
+    case JobState::Queued:
+        // The strand may stay in mReady with nothing left; the worker skips it.
+        std::erase_if(strand.mJobs, [&job](const auto& item) { return item.get() == &job; });
+        --mQueuedJobs;
+        break;
+    case JobState::Running:
+        // Only a frame destroyed without a stop request gets here. func lives in that frame, so it must not go
+        // away under the worker; a stopped task instead keeps waiting and is resumed when the job finishes.
+        mFinished.wait(lock, [&job]() { return job.state == JobState::Finished; });
+        break;
+    case JobState::Finished:
+        break;
+    }
+    job.abandoned = true;
+}
+
+auto SerializerPool::_workerLoop() -> void {
+    std::unique_lock lock(mMutex);
+    std::vector<std::shared_ptr<Job>> batch;
+    while (true) {
+        mCondition.wait(lock, [this]() { return mStopping || !mReady.empty(); });
+        if (mReady.empty()) {
+            return;
+        }
+        auto strand = std::move(mReady.front());
+        mReady.pop_front();
+        if (strand->mJobs.empty()) {
+            strand->mScheduled = false;
+            continue;
+        }
+
+        // Take a run of queued jobs from this strand, at least one and up to batch_bytes.
+        std::size_t size = 0;
+        do {
+            size += strand->mJobs.front()->bytes;
+            strand->mJobs.front()->state = JobState::Running;
+            batch.push_back(std::move(strand->mJobs.front()));
+            strand->mJobs.pop_front();
+        } while (!strand->mJobs.empty() && size + strand->mJobs.front()->bytes <= mOptions.batch_bytes);
+        mQueuedJobs -= batch.size();
+        // Freed slots go to parked jobs in arrival order.
+        bool wake = false;
+        while (!mParked.empty() && mQueuedJobs < mOptions.max_queued_jobs) {
+            auto parked = std::move(mParked.front());
+            mParked.pop_front();
+            --parked->strand->mParked;
+            wake = _enqueueLocked(parked) || wake;
+        }
+        if (wake) {
+            mCondition.notify_all();
+        }
+        lock.unlock();
+
+        for (const auto& job : batch) {
+            _runJob(*job, false);
+        }
+
+        // Settle the strand before resuming anyone: a resumed owner may start its next job right away.
+        lock.lock();
+        if (!strand->mJobs.empty()) {
+            mReady.push_back(strand);
+            mCondition.notify_one();
+        } else {
+            strand->mScheduled = false;
+        }
+        for (const auto& job : batch) {
+            job->state = JobState::Finished;
+        }
+        mFinished.notify_all();
+        for (const auto& job : batch) {
+            _resume(lock, job);
+        }
+        batch.clear();
+    }
+}
+
+auto SerializerPool::_resume(std::unique_lock<std::mutex>& lock, const std::shared_ptr<Job>& job) -> void {
+    if (job->abandoned) {
+        return;
+    }
+    if (job->executor != nullptr) {
+        job->self = job;
+        job->executor->post(
+            [](void* address) {
+                auto self = std::move(static_cast<Job*>(address)->self);
+                if (!self->abandoned) {
+                    self->handle.resume();
+                }
+            },
+            job.get());
+    } else {
+        lock.unlock();
+        job->handle.resume();
+        lock.lock();
+    }
+}
+
+auto SerializerPool::_runJob(Job& job, bool inlined) -> void {
+    const auto start = Clock::now();
+    job.result       = job.invoke(job.context);
+    const auto end   = Clock::now();
+
+    auto& counters      = mCounters[static_cast<std::size_t>(job.stage)];
+    const auto queueNs  = std::chrono::duration_cast<std::chrono::nanoseconds>(start - job.queued).count();
+    const auto runNs    = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    counters.jobs.fetch_add(1U, std::memory_order_relaxed);
+    if (inlined) {
+        counters.inlineJobs.fetch_add(1U, std::memory_order_relaxed);
+    }
+    counters.queueNs.fetch_add(queueNs, std::memory_order_relaxed);
+    counters.runNs.fetch_add(runNs, std::memory_order_relaxed);
+    auto maxQueueNs = counters.maxQueueNs.load(std::memory_order_relaxed);
+    while (queueNs > maxQueueNs &&
+           !counters.maxQueueNs.compare_exchange_weak(maxQueueNs, queueNs, std::memory_order_relaxed)) {
+    }
+}
+
+NEKO_END_NAMESPACE
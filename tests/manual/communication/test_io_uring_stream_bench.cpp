@@ -0,0 +1,164 @@
+#include "nekoproto/transport/endpoint.hpp"
+#include "nekoproto/transport/io_uring_stream.hpp"
+
+#include <ilias/net.hpp>
+#include <ilias/platform.hpp>
+#include <ilias/task.hpp>
+#include <ilias/task/group.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+using ilias::IPEndpoint;
+using ilias::TcpListener;
+using ilias::TcpStream;
+
+namespace {
+
+constexpr std::size_t KMessageBytes = 64;
+constexpr std::uint16_t KPort       = 10354;
+
+struct Report {
+    std::size_t roundTrips = 0;
+    std::size_t failures   = 0;
+    double seconds         = 0;
+};
+
+template <typename StreamT>
+auto echo_peer(StreamT stream, std::size_t rounds) -> ilias::IoTask<void> {
+    detail::LengthPrefixedStreamMessageEndpoint<StreamT> endpoint(std::move(stream));
+    std::vector<std::byte> message;
+    for (std::size_t idx = 0; idx < rounds; ++idx) {
+        ILIAS_CO_TRY(auto size, co_await endpoint.recv(message));
+        ILIAS_CO_TRYV(co_await endpoint.send(std::span<const std::byte>{message.data(), size}));
+    }
+    co_return {};
+}
+
+template <typename StreamT>
+auto ping_peer(StreamT stream, std::size_t rounds) -> ilias::IoTask<void> {
+    detail::LengthPrefixedStreamMessageEndpoint<StreamT> endpoint(std::move(stream));
+    const std::vector<std::byte> message(KMessageBytes, std::byte{0x5A});
+    for (std::size_t idx = 0; idx < rounds; ++idx) {
+        ILIAS_CO_TRYV(co_await endpoint.send(std::span<const std::byte>{message}));
+        ILIAS_CO_TRY(auto body, co_await endpoint.recvView());
+        if (body.size() != KMessageBytes) {
+            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+        }
+    }
+    co_return {};
+}
+
+template <typename Task>
+auto count_failure(Task task, Report& report) -> ilias::Task<void> {
+    if (!(co_await std::move(task))) {
+        ++report.failures;
+    }
+}
+
+// Every connection is set up before the clock starts, then all of them ping-pong at once.
+template <typename StreamT, typename Accept, typename Connect>
+auto run_case(std::size_t connections, std::size_t rounds, Report& report, Accept accept, Connect connect)
+    -> ilias::Task<void> {
+    std::vector<StreamT> servers;
+    std::vector<StreamT> clients;
+    for (std::size_t idx = 0; idx < connections; ++idx) {
+        auto client = co_await connect();
+        auto server = co_await accept();
+        if (!client || !server) {
+            ++report.failures;
+            co_return;
+        }
+        clients.push_back(std::move(client.value()));
+        servers.push_back(std::move(server.value()));
+    }
+    ilias::TaskGroup<void> group;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t idx = 0; idx < connections; ++idx) {
+        group.spawn(count_failure(echo_peer(std::move(servers[idx]), rounds), report));
+        group.spawn(count_failure(ping_peer(std::move(clients[idx]), rounds), report));
+    }
+    co_await group.waitAll();
+    report.seconds    = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.roundTrips = connections * rounds;
+}
+
+auto run_epoll(std::size_t connections, std::size_t rounds, Report& report) -> ilias::Task<void> {
+    const IPEndpoint local("127.0.0.1", KPort);
+    auto listener = co_await TcpListener::bind(local);
+    if (!listener) {
+        ++report.failures;
+        co_return;
+    }
+    co_await run_case<TcpStream>(
+        connections, rounds, report,
+        [&]() -> ilias::IoTask<TcpStream> {
+            ILIAS_CO_TRY(auto peer, co_await listener.value().accept());
+            co_return std::move(peer.first);
+        },
+        [&]() -> ilias::IoTask<TcpStream> { co_return co_await TcpStream::connect(local); });
+}
+
+auto run_io_uring(std::size_t connections, std::size_t rounds, Report& report) -> ilias::Task<void> {
+    const auto local = "127.0.0.1:" + std::to_string(KPort + 1);
+    auto listener    = detail::IoUringListener::bind(local);
+    if (!listener) {
+        ++report.failures;
+        co_return;
+    }
+    co_await run_case<detail::IoUringStream>(
+        connections, rounds, report, [&]() { return listener.value().accept(); },
+        [&]() { return detail::IoUringStream::connect(local); });
+}
+
+void print_row(const char* name, const Report& report) {
+    std::cout << std::setw(12) << name << std::fixed << std::setprecision(1) << std::setw(16)
+              << static_cast<double>(report.roundTrips) / report.seconds / 1000.0 << std::setprecision(2)
+              << std::setw(16) << report.seconds * 1e6 / static_cast<double>(report.roundTrips) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t connections = 256;
+    std::size_t rounds      = 200;
+    if (argc > 1) {
+        connections = static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        rounds = static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10));
+    }
+    if (detail::IoUringContext::instance() == nullptr) {
+        std::cerr << "io_uring is not available\n";
+        return EXIT_FAILURE;
+    }
+
+    ilias::PlatformContext context;
+    context.install();
+
+    Report epoll;
+    Report uring;
+    run_epoll(connections, rounds, epoll).wait();
+    run_io_uring(connections, rounds, uring).wait();
+    if (epoll.failures != 0 || uring.failures != 0) {
+        std::cerr << "loopback ping-pong failed\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << connections << " connections x " << rounds << " round trips of " << KMessageBytes
+              << " bytes over loopback tcp\n";
+    std::cout << std::setw(12) << "path" << std::setw(16) << "k round trips/s" << std::setw(16) << "us/round trip"
+              << "\n";
+    print_row("epoll", epoll);
+    print_row("io_uring", uring);
+    return EXIT_SUCCESS;
+}
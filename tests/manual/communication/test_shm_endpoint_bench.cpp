@@ -0,0 +1,139 @@
+#include "nekoproto/transport/endpoint.hpp"
+#include "nekoproto/transport/shm_endpoint.hpp"
+
+#include <ilias/net.hpp>
+#include <ilias/platform.hpp>
+#include <ilias/task.hpp>
+#include <ilias/task/when_all.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+using ilias::IPEndpoint;
+using ilias::TcpListener;
+using ilias::TcpStream;
+using TcpEndpoint = detail::LengthPrefixedStreamMessageEndpoint<TcpStream>;
+using ShmEndpoint = detail::ShmMessageEndpoint;
+
+namespace {
+
+struct Report {
+    std::vector<double> roundTrips; // microseconds
+};
+
+// One side sends and waits for the echo, as a client waits for an rpc reply.
+template <typename Endpoint>
+auto ping(Endpoint& endpoint, std::size_t count, std::size_t bytes, Report& report) -> ilias::IoTask<void> {
+    const std::vector<std::byte> message(bytes, std::byte{0x5A});
+    std::vector<std::byte> reply;
+    report.roundTrips.reserve(count);
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const auto start = std::chrono::steady_clock::now();
+        ILIAS_CO_TRYV(co_await endpoint.send(message));
+        ILIAS_CO_TRYV(co_await endpoint.recv(reply));
+        report.roundTrips.push_back(
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    co_return {};
+}
+
+template <typename Endpoint>
+auto pong(Endpoint& endpoint, std::size_t count) -> ilias::IoTask<void> {
+    std::vector<std::byte> message;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        ILIAS_CO_TRYV(co_await endpoint.recv(message));
+        ILIAS_CO_TRYV(co_await endpoint.send(message));
+    }
+    co_return {};
+}
+
+auto run_tcp(std::size_t count, std::size_t bytes, Report& report) -> ilias::IoTask<void> {
+    const IPEndpoint local("127.0.0.1", 10348);
+    ILIAS_CO_TRY(auto listener, co_await TcpListener::bind(local));
+    auto accept = [&]() -> ilias::IoTask<void> {
+        ILIAS_CO_TRY(auto peer, co_await listener.accept());
+        peer.first.setOption(ilias::sockopt::TcpNoDelay(1));
+        TcpEndpoint endpoint(std::move(peer.first));
+        co_return co_await pong(endpoint, count);
+    };
+    auto connect = [&]() -> ilias::IoTask<void> {
+        ILIAS_CO_TRY(auto stream, co_await TcpStream::connect(local));
+        stream.setOption(ilias::sockopt::TcpNoDelay(1));
+        TcpEndpoint endpoint(std::move(stream));
+        co_return co_await ping(endpoint, count, bytes, report);
+    };
+    auto [ret1, ret2] = co_await ilias::whenAll(accept(), connect());
+    if (!ret1) {
+        co_return ilias::Err(ret1.error());
+    }
+    if (!ret2) {
+        co_return ilias::Err(ret2.error());
+    }
+    co_return {};
+}
+
+auto run_shm(std::size_t count, std::size_t bytes, Report& report) -> ilias::IoTask<void> {
+    auto pair = ShmEndpoint::createPair();
+    if (!pair) {
+        co_return ilias::Err(pair.error());
+    }
+    auto& [client, server] = pair.value();
+    auto [ret1, ret2]      = co_await ilias::whenAll(pong(server, count), ping(client, count, bytes, report));
+    if (!ret1) {
+        co_return ilias::Err(ret1.error());
+    }
+    if (!ret2) {
+        co_return ilias::Err(ret2.error());
+    }
+    co_return {};
+}
+
+void print_row(const char* name, Report& report) {
+    auto& samples = report.roundTrips;
+    std::sort(samples.begin(), samples.end());
+    const auto at = [&](double quantile) {
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(quantile * samples.size()))];
+    };
+    std::cout << std::setw(10) << name << std::fixed << std::setprecision(2) << std::setw(12) << at(0.5)
+              << std::setw(12) << at(0.99) << std::setw(12) << samples.back() << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t count = 20000;
+    std::size_t bytes = 256;
+    if (argc > 1) {
+        count = static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        bytes = static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10));
+    }
+
+    ilias::PlatformContext context;
+    context.install();
+
+    // Both sides share this thread, so every shm round trip includes two eventfd wakeups.
+    // Peers in separate processes that stay busy skip most of them.
+    Report tcp;
+    Report shm;
+    if (!run_tcp(count, bytes, tcp).wait() || !run_shm(count, bytes, shm).wait()) {
+        std::cerr << "round trip failed\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << count << " round trips of " << bytes << " bytes\n";
+    std::cout << std::setw(10) << "transport" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+              << std::setw(12) << "max us" << "\n";
+    print_row("tcp", tcp);
+    print_row("shm", shm);
+    return EXIT_SUCCESS;
+}
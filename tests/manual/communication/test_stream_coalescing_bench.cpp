@@ -0,0 +1,127 @@
+#include "nekoproto/transport/endpoint.hpp"
+
+#include <ilias/net.hpp>
+#include <ilias/platform.hpp>
+#include <ilias/task.hpp>
+#include <ilias/task/when_all.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+using ilias::IPEndpoint;
+using ilias::TcpListener;
+using ilias::TcpStream;
+using Endpoint = detail::LengthPrefixedStreamMessageEndpoint<TcpStream>;
+
+namespace {
+
+constexpr std::size_t KMessageBytes = 64;
+constexpr std::size_t KSenders      = 4;
+
+struct Report {
+    std::size_t messages = 0;
+    std::size_t writes   = 0;
+    double seconds       = 0;
+};
+
+auto send_loop(Endpoint& endpoint, std::size_t count) -> ilias::IoTask<void> {
+    const std::vector<std::byte> message(KMessageBytes, std::byte{0x5A});
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        ILIAS_CO_TRYV(co_await endpoint.send(message));
+    }
+    co_return {};
+}
+
+// Several senders share one connection, as concurrent rpc responses do.
+auto write_messages(TcpStream stream, std::size_t count, detail::StreamWriteCoalescing coalescing, Report& report)
+    -> ilias::IoTask<void> {
+    Endpoint endpoint(std::move(stream));
+    endpoint.setWriteCoalescing(coalescing);
+    const auto start = std::chrono::steady_clock::now();
+    auto [ret1, ret2, ret3, ret4] = co_await ilias::whenAll(send_loop(endpoint, count), send_loop(endpoint, count),
+                                                            send_loop(endpoint, count), send_loop(endpoint, count));
+    for (auto* ret : {&ret1, &ret2, &ret3, &ret4}) {
+        if (!*ret) {
+            co_return ilias::Err(ret->error());
+        }
+    }
+    report.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.messages = count * KSenders;
+    report.writes   = endpoint.writeCount();
+    co_return {};
+}
+
+auto read_messages(TcpStream stream, std::size_t count) -> ilias::IoTask<void> {
+    Endpoint endpoint(std::move(stream));
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        ILIAS_CO_TRY(auto body, co_await endpoint.recvView());
+        if (body.size() != KMessageBytes) {
+            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+        }
+    }
+    co_return {};
+}
+
+auto run_case(std::size_t count, detail::StreamWriteCoalescing coalescing, Report& report) -> ilias::IoTask<void> {
+    const IPEndpoint local("127.0.0.1", 10347);
+    ILIAS_CO_TRY(auto listener, co_await TcpListener::bind(local));
+    auto accept = [&]() -> ilias::IoTask<void> {
+        ILIAS_CO_TRY(auto peer, co_await listener.accept());
+        co_return co_await read_messages(std::move(peer.first), count * KSenders);
+    };
+    auto connect = [&]() -> ilias::IoTask<void> {
+        ILIAS_CO_TRY(auto stream, co_await TcpStream::connect(local));
+        co_return co_await write_messages(std::move(stream), count, coalescing, report);
+    };
+    auto [ret1, ret2] = co_await ilias::whenAll(accept(), connect());
+    if (!ret1) {
+        co_return ilias::Err(ret1.error());
+    }
+    if (!ret2) {
+        co_return ilias::Err(ret2.error());
+    }
+    co_return {};
+}
+
+void print_row(const char* name, const Report& report) {
+    std::cout << std::setw(12) << name << std::setw(12) << report.writes << std::fixed << std::setprecision(2)
+              << std::setw(16) << static_cast<double>(report.messages) / static_cast<double>(report.writes)
+              << std::setprecision(1) << std::setw(14)
+              << static_cast<double>(report.messages) / report.seconds / 1000.0 << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t count = 50000;
+    if (argc > 1) {
+        count = static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+
+    ilias::PlatformContext context;
+    context.install();
+
+    Report immediate;
+    Report windowed;
+    detail::StreamWriteCoalescing window;
+    window.window = std::chrono::microseconds(50);
+    if (!run_case(count, {}, immediate).wait() || !run_case(count, window, windowed).wait()) {
+        std::cerr << "loopback transfer failed\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << KSenders << " senders x " << count << " messages of " << KMessageBytes
+              << " bytes over loopback tcp\n";
+    std::cout << std::setw(12) << "window" << std::setw(12) << "writes" << std::setw(16) << "messages/write"
+              << std::setw(14) << "kmsg/s" << "\n";
+    print_row("0us", immediate);
+    print_row("50us", windowed);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include "nekoproto/transport/endpoint.hpp"
+
+#include <ilias/io/method.hpp>
+#include <ilias/net.hpp>
+#include <ilias/platform.hpp>
+#include <ilias/task.hpp>
+#include <ilias/task/when_all.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+using ilias::IPEndpoint;
+using ilias::TcpListener;
+using ilias::TcpStream;
+
+namespace {
+
+constexpr std::size_t KMessageBytes = 64;
+constexpr std::size_t KBatch        = 256;
+
+struct Report {
+    std::size_t messages = 0;
+    std::size_t reads    = 0;
+    double seconds       = 0;
+};
+
+// One write per batch, so the receiver sees back-to-back frames like a busy peer would produce.
+auto write_frames(TcpStream stream, std::size_t count) -> ilias::IoTask<void> {
+    std::vector<std::byte> batch;
+    for (std::size_t idx = 0; idx < KBatch; ++idx) {
+        for (std::size_t shift = 0; shift < 32; shift += 8) {
+            batch.push_back(static_cast<std::byte>((KMessageBytes >> shift) & 0xFFU));
+        }
+        batch.insert(batch.end(), KMessageBytes, std::byte{0x5A});
+    }
+    for (std::size_t sent = 0; sent < count; sent += KBatch) {
+        ILIAS_CO_TRY(auto written, co_await ilias::io::writeAll(stream, std::span<const std::byte>{batch}));
+        if (written != batch.size()) {
+            co_return ilias::Err(ilias::IoError::WriteZero);
+        }
+    }
+    co_return {};
+}
+
+// The previous recv path: one length read and one body read per message.
+auto read_frames_direct(TcpStream stream, std::size_t count, Report& report) -> ilias::IoTask<void> {
+    std::vector<std::byte> body;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        ILIAS_CO_TRY(auto size, co_await ilias::io::readU32Le(stream));
+        body.resize(size);
+        ILIAS_CO_TRY(auto read, co_await ilias::io::readAll(stream, std::span<std::byte>{body}));
+        if (read != body.size()) {
+            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+        }
+    }
+    report.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.messages = count;
+    report.reads    = count * 2; // lower bound, short reads only add to it
+    co_return {};
+}
+
+auto read_frames_buffered(TcpStream stream, std::size_t count, Report& report) -> ilias::IoTask<void> {
+    detail::LengthPrefixedStreamMessageEndpoint<TcpStream> endpoint(std::move(stream));
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        ILIAS_CO_TRY(auto body, co_await endpoint.recvView());
+        if (body.size() != KMessageBytes) {
+            co_return ilias::Err(ilias::IoError::UnexpectedEOF);
+        }
+    }
+    report.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.messages = count;
+    report.reads    = endpoint.readCount();
+    co_return {};
+}
+
+template <typename ReadFunc>
+auto run_case(std::size_t count, Report& report, ReadFunc readFrames) -> ilias::IoTask<void> {
+    const IPEndpoint local("127.0.0.1", 10346);
+    ILIAS_CO_TRY(auto listener, co_await TcpListener::bind(local));
+    auto accept = [&]() -> ilias::IoTask<void> {
+        ILIAS_CO_TRY(auto peer, co_await listener.accept());
+        co_return co_await readFrames(std::move(peer.first), count, report);
+    };
+    auto connect = [&]() -> ilias::IoTask<void> {
+        ILIAS_CO_TRY(auto stream, co_await TcpStream::connect(local));
+        co_return co_await write_frames(std::move(stream), count);
+    };
+    auto [ret1, ret2] = co_await ilias::whenAll(accept(), connect());
+    if (!ret1) {
+        co_return ilias::Err(ret1.error());
+    }
+    if (!ret2) {
+        co_return ilias::Err(ret2.error());
+    }
+    co_return {};
+}
+
+void print_row(const char* name, const Report& report) {
+    std::cout << std::setw(12) << name << std::setw(12) << report.reads << std::fixed << std::setprecision(3)
+              << std::setw(16) << static_cast<double>(report.reads) / static_cast<double>(report.messages)
+              << std::setprecision(1) << std::setw(14)
+              << static_cast<double>(report.messages) / report.seconds / 1000.0 << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t count = 200000;
+    if (argc > 1) {
+        count = static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    count = (count + KBatch - 1) / KBatch * KBatch;
+
+    ilias::PlatformContext context;
+    context.install();
+
+    Report direct;
+    Report buffered;
+    if (!run_case(count, direct, read_frames_direct).wait() ||
+        !run_case(count, buffered, read_frames_buffered).wait()) {
+        std::cerr << "loopback transfer failed\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << count << " messages of " << KMessageBytes << " bytes over loopback tcp\n";
+    std::cout << std::setw(12) << "path" << std::setw(12) << "reads" << std::setw(16) << "reads/message"
+              << std::setw(14) << "kmsg/s" << "\n";
+    print_row("direct", direct);
+    print_row("read-ahead", buffered);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+if has_config("enable_communication") then
+    target("test_stream_readahead_bench")
+        set_kind("binary")
+        set_default(false)
+        add_includedirs("$(projectdir)/include")
+        add_deps("NekoCommunication")
+        add_files("test_stream_readahead_bench.cpp")
+        add_defines("NEKO_PROTO_STATIC")
+        on_load(function (target)
+            import("lua.auto", {rootdir = os.projectdir()})
+            auto().auto_add_packages(target)
+        end)
+    target_end()
+end
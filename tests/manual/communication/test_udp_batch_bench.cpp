@@ -0,0 +1,177 @@
+#include "nekoproto/transport/endpoint.hpp"
+#include "nekoproto/transport/udp_batch_endpoint.hpp"
+
+#include <ilias/net.hpp>
+#include <ilias/platform.hpp>
+#include <ilias/task.hpp>
+#include <ilias/task/when_all.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+using ilias::IPEndpoint;
+using ChunkedEndpoint = detail::ChunkedDatagramMessageEndpoint<ilias::UdpSocket, IPEndpoint>;
+using BatchEndpoint   = detail::UdpBatchMessageEndpoint;
+
+namespace {
+
+struct Report {
+    double seconds      = 0;
+    std::size_t packets = 0;
+};
+
+constexpr std::size_t KWindow = 32; // datagrams in flight before the receiver acknowledges
+
+auto make_chunked(const char* bind, const char* remote) -> ilias::IoTask<ChunkedEndpoint> {
+    auto local = IPEndpoint::fromString(bind);
+    auto peer  = IPEndpoint::fromString(remote);
+    if (!local || !peer) {
+        co_return ilias::Err(ilias::IoError::InvalidArgument);
+    }
+    ILIAS_CO_TRY(auto socket, ilias::Socket::make(local->family(), SOCK_DGRAM, 0));
+    socket.setOption(ilias::sockopt::ReuseAddress(1));
+    ILIAS_CO_TRYV(socket.bind(*local));
+    ILIAS_CO_TRY(auto udp, ilias::UdpSocket::from(std::move(socket)));
+    co_return ChunkedEndpoint(std::move(udp), *peer);
+}
+
+// The sender waits for an acknowledgement every window so that no datagram is dropped on a full socket buffer.
+auto send_one_by_one(ChunkedEndpoint& endpoint, std::size_t count, std::size_t bytes) -> ilias::IoTask<void> {
+    const std::vector<std::byte> message(bytes, std::byte{0x5A});
+    std::vector<std::byte> ack;
+    for (std::size_t sent = 0; sent < count; sent += KWindow) {
+        for (std::size_t idx = 0; idx < KWindow; ++idx) {
+            ILIAS_CO_TRYV(co_await endpoint.send(message));
+        }
+        ack.clear();
+        ILIAS_CO_TRYV(co_await endpoint.recv(ack));
+    }
+    co_return {};
+}
+
+auto recv_one_by_one(ChunkedEndpoint& endpoint, std::size_t count) -> ilias::IoTask<void> {
+    const std::array<std::byte, 1> ack{};
+    std::vector<std::byte> message;
+    for (std::size_t received = 0; received < count; received += KWindow) {
+        for (std::size_t idx = 0; idx < KWindow; ++idx) {
+            message.clear();
+            ILIAS_CO_TRYV(co_await endpoint.recv(message));
+        }
+        ILIAS_CO_TRYV(co_await endpoint.send(ack));
+    }
+    co_return {};
+}
+
+auto send_batched(BatchEndpoint& endpoint, std::size_t count, std::size_t bytes) -> ilias::IoTask<void> {
+    const std::vector<std::byte> message(bytes, std::byte{0x5A});
+    const std::vector<std::span<const std::byte>> window(KWindow, message);
+    std::vector<std::byte> ack;
+    for (std::size_t sent = 0; sent < count; sent += KWindow) {
+        ILIAS_CO_TRYV(co_await endpoint.sendBatch(window));
+        ILIAS_CO_TRYV(co_await endpoint.recv(ack));
+    }
+    co_return {};
+}
+
+auto recv_batched(BatchEndpoint& endpoint, std::size_t count) -> ilias::IoTask<void> {
+    const std::array<std::byte, 1> ack{};
+    for (std::size_t received = 0; received < count; received += KWindow) {
+        for (std::size_t window = 0; window < KWindow;) {
+            ILIAS_CO_TRY(auto datagrams, co_await endpoint.recvBatch());
+            window += datagrams.size();
+        }
+        ILIAS_CO_TRYV(co_await endpoint.send(ack));
+    }
+    co_return {};
+}
+
+template <typename Sender, typename Receiver>
+auto measure(Sender sender, Receiver receiver, std::size_t count, Report& report) -> ilias::IoTask<void> {
+    const auto start  = std::chrono::steady_clock::now();
+    auto [ret1, ret2] = co_await ilias::whenAll(std::move(receiver), std::move(sender));
+    report.seconds    = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.packets    = count;
+    if (!ret1) {
+        co_return ilias::Err(ret1.error());
+    }
+    if (!ret2) {
+        co_return ilias::Err(ret2.error());
+    }
+    co_return {};
+}
+
+auto run_chunked(std::size_t count, std::size_t bytes, Report& report) -> ilias::IoTask<void> {
+    ILIAS_CO_TRY(auto client, co_await make_chunked("127.0.0.1:10350", "127.0.0.1:10351"));
+    ILIAS_CO_TRY(auto server, co_await make_chunked("127.0.0.1:10351", "127.0.0.1:10350"));
+    co_return co_await measure(send_one_by_one(client, count, bytes), recv_one_by_one(server, count), count, report);
+}
+
+auto run_batched(std::size_t count, std::size_t bytes, bool offload, Report& report) -> ilias::IoTask<void> {
+    BatchEndpoint::Options options;
+    options.batch_size = KWindow;
+    options.gso        = offload;
+    options.gro        = offload;
+    auto client        = BatchEndpoint::open("127.0.0.1:10352", "127.0.0.1:10353", options);
+    auto server        = BatchEndpoint::open("127.0.0.1:10353", "127.0.0.1:10352", options);
+    if (!client) {
+        co_return ilias::Err(client.error());
+    }
+    if (!server) {
+        co_return ilias::Err(server.error());
+    }
+    ILIAS_CO_TRYV(
+        co_await measure(send_batched(*client, count, bytes), recv_batched(*server, count), count, report));
+    const auto sent     = client->metrics();
+    const auto received = server->metrics();
+    std::cout << "  " << (offload ? "gso/gro" : "batched") << ": " << sent.send_calls << " sendmmsg, "
+              << received.recv_calls << " recvmmsg, " << received.truncated << " truncated\n";
+    co_return {};
+}
+
+void print_row(const char* name, const Report& report) {
+    std::cout << std::setw(10) << name << std::fixed << std::setprecision(0) << std::setw(14)
+              << static_cast<double>(report.packets) / report.seconds << std::setprecision(2) << std::setw(12)
+              << report.seconds * 1e3 << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t count = 200000;
+    std::size_t bytes = 512;
+    if (argc > 1) {
+        count = static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    if (argc > 2) {
+        bytes = std::min<std::size_t>(static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10)), 1472U);
+    }
+    count = std::max(count / KWindow, std::size_t{1}) * KWindow;
+
+    ilias::PlatformContext context;
+    context.install();
+
+    Report chunked;
+    Report batched;
+    Report offload;
+    if (!run_chunked(count, bytes, chunked).wait() || !run_batched(count, bytes, false, batched).wait() ||
+        !run_batched(count, bytes, true, offload).wait()) {
+        std::cerr << "transfer failed\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << count << " datagrams of " << bytes << " bytes over loopback\n";
+    std::cout << std::setw(10) << "transport" << std::setw(14) << "packets/s" << std::setw(12) << "total ms" << "\n";
+    print_row("chunked", chunked);
+    print_row("batched", batched);
+    print_row("gso/gro", offload);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include "nekoproto/rpc/private/backend_base.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <span>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+using rpc::NekoRpcExtensionType;
+using rpc::NekoRpcFrameCodec;
+
+namespace {
+
+// Keeps the compiler from dropping the header round trips as dead code.
+volatile std::uint64_t gSink = 0;
+
+// Counts every allocation in the process, so a parse that allocates shows up as a non-zero column.
+std::size_t gAllocations = 0;
+
+} // namespace
+
+auto operator new(std::size_t size) -> void* {
+    ++gAllocations;
+    if (void* ptr = std::malloc(size == 0U ? 1U : size); ptr != nullptr) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+auto operator delete(void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void* ptr, std::size_t /*size*/) noexcept -> void { std::free(ptr); }
+
+namespace {
+
+struct Report {
+    double nsPerOp          = 0;
+    double allocationsPerOp = 0;
+};
+
+template <typename Func>
+auto measure(Func&& func) -> Report {
+    // Repeat until at least a quarter second has passed so the per-op time is not timer noise.
+    using Clock            = std::chrono::steady_clock;
+    std::size_t rounds     = 0;
+    const auto allocations = gAllocations;
+    const auto start       = Clock::now();
+    auto elapsed           = Clock::duration{};
+    do {
+        for (std::size_t idx = 0; idx < 1024U; ++idx) {
+            if (!func()) {
+                return {};
+            }
+        }
+        rounds += 1024U;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(250));
+    return {.nsPerOp          = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(rounds),
+            .allocationsPerOp = static_cast<double>(gAllocations - allocations) / static_cast<double>(rounds)};
+}
+
+auto make_frame(NekoRpcFrameCodec::ExtensionMapType extensions, std::size_t payloadBytes)
+    -> NekoRpcFrameCodec::MessageType {
+    static const std::vector<std::byte> method(8, std::byte{0x11});
+    const std::vector<std::byte> payload(payloadBytes, std::byte{0x22});
+    NekoRpcFrameCodec::Header header;
+    header.id = 42;
+    return NekoRpcFrameCodec::encodeFrame(
+        {.header = header, .method = method, .extensions = std::move(extensions), .payload = payload});
+}
+
+void print_row(const char* name, const Report& report) {
+    std::cout << std::setw(22) << name << std::fixed << std::setprecision(1) << std::setw(12) << report.nsPerOp
+              << std::setprecision(2) << std::setw(14) << report.allocationsPerOp << "\n";
+}
+
+} // namespace
+
+int main() {
+    const std::vector<std::byte> value(8, std::byte{0x33});
+    NekoRpcFrameCodec::ExtensionMapType methodId;
+    methodId[NekoRpcExtensionType::MethodTableVersion]  = value;
+    methodId[NekoRpcExtensionType::MethodSignatureHash] = value;
+    NekoRpcFrameCodec::ExtensionMapType hello = methodId;
+    hello[NekoRpcExtensionType::MethodId]                       = {};
+    hello[NekoRpcExtensionType::MethodMinimumCompatibleVersion] = value;
+    hello[NekoRpcExtensionType::Compression]                    = {};
+    hello[NekoRpcExtensionType::CompressionAlgorithm]           = value;
+    hello[NekoRpcExtensionType::CompressionMinPayloadSize]      = value;
+
+    const auto plain      = make_frame({}, 64U);
+    const auto withMethod = make_frame(methodId, 64U);
+    const auto withSeven  = make_frame(hello, 64U);
+    const auto header     = std::span<const std::byte>(plain).first<NekoRpcFrameCodec::HeaderBytes>();
+    NekoRpcFrameCodec::FrameParts parts;
+    if (!NekoRpcFrameCodec::parseFrame(withSeven, 0, parts) || parts.extensions.size() != 7U) {
+        std::cerr << "frame does not parse back\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::setw(22) << "case" << std::setw(12) << "ns/op" << std::setw(14) << "allocs/op" << "\n";
+    print_row("unpack header", measure([&] {
+                  gSink = NekoRpcFrameCodec::unpackHeader(header).id;
+                  return true;
+              }));
+    print_row("pack header", measure([&] {
+                  NekoRpcFrameCodec::Header value;
+                  value.id = gSink;
+                  gSink    = std::to_integer<std::uint64_t>(NekoRpcFrameCodec::packHeader(value)[15]);
+                  return true;
+              }));
+    print_row("parse, no extensions", measure([&] { return NekoRpcFrameCodec::parseFrame(plain, 0, parts); }));
+    print_row("parse, 2 extensions", measure([&] { return NekoRpcFrameCodec::parseFrame(withMethod, 0, parts); }));
+    print_row("parse, 7 extensions", measure([&] { return NekoRpcFrameCodec::parseFrame(withSeven, 0, parts); }));
+    return EXIT_SUCCESS;
+}
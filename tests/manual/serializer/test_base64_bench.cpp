@@ -0,0 +1,83 @@
+#include "nekoproto/serialization/types/binary_data.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+namespace {
+
+constexpr std::size_t KMiB = std::size_t{1} << 20U;
+
+const char* simd_path() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE4_1__)
+    return "sse4.1";
+#else
+    return "scalar";
+#endif
+}
+
+template <typename Func>
+double measure_mib_per_second(std::size_t bytes, Func&& func) {
+    // Repeat until at least a quarter second has passed so small inputs are not timer noise.
+    using Clock         = std::chrono::steady_clock;
+    std::size_t rounds  = 0;
+    const auto start    = Clock::now();
+    auto elapsed        = Clock::duration{};
+    do {
+        func();
+        ++rounds;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(250));
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return static_cast<double>(bytes * rounds) / static_cast<double>(KMiB) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::size_t> sizes = {1 * KMiB, 4 * KMiB, 16 * KMiB, 64 * KMiB};
+    if (argc > 1) {
+        sizes = {static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) * KMiB};
+    }
+
+    std::cout << "base64 codec: " << simd_path() << "\n";
+    std::cout << std::setw(10) << "size" << std::setw(16) << "encode MiB/s" << std::setw(16) << "decode MiB/s"
+              << "\n";
+
+    std::mt19937_64 random(42);
+    for (const auto size : sizes) {
+        std::vector<std::uint8_t> input(size);
+        for (auto& byte : input) {
+            byte = static_cast<std::uint8_t>(random());
+        }
+        std::vector<char> encoded(Base64Covert::EncodedSize(size));
+        std::vector<std::uint8_t> decoded(size);
+
+        const double encode = measure_mib_per_second(size, [&] {
+            Base64Covert::Encode(input.data(), input.size(), encoded.data());
+        });
+        bool valid          = true;
+        const double decode = measure_mib_per_second(size, [&] {
+            valid = Base64Covert::Decode(reinterpret_cast<const std::uint8_t*>(encoded.data()), encoded.size(),
+                                         decoded.data()) &&
+                    valid;
+        });
+        if (!valid || decoded != input) {
+            std::cerr << "round trip mismatch at " << size / KMiB << " MiB\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << std::setw(7) << size / KMiB << " MiB" << std::fixed << std::setprecision(1) << std::setw(16)
+                  << encode << std::setw(16) << decode << "\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,12 @@
+target("test_base64_bench")
+    set_kind("binary")
+    set_default(false)
+    add_includedirs("$(projectdir)/include")
+    add_deps("NekoSerializer")
+    add_files("test_base64_bench.cpp")
+    add_defines("NEKO_PROTO_STATIC")
+    on_load(function (target)
+        import("lua.auto", {rootdir = os.projectdir()})
+        auto().auto_add_packages(target)
+    end)
+target_end()
@@ -0,0 +1,153 @@
+#include "nekoproto/serialization/binary_serializer.hpp"
+#include "nekoproto/serialization/json_serializer.hpp"
+#include "nekoproto/serialization/serializer_base.hpp"
+#include "nekoproto/serialization/transcode.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+NEKO_USE_NAMESPACE
+
+namespace {
+
+struct Item {
+    std::string sku;
+    std::uint32_t quantity = 0;
+    double price           = 0;
+
+    NEKO_SERIALIZER(sku, quantity, price)
+};
+
+struct Order {
+    std::uint64_t id = 0;
+    std::string customer;
+    std::vector<Item> items;
+    std::optional<std::string> note;
+    bool paid = false;
+
+    NEKO_SERIALIZER(id, customer, items, note, paid)
+};
+
+using Orders = std::vector<Order>;
+
+constexpr double KMiB = 1024.0 * 1024.0;
+
+Orders make_orders(std::size_t count) {
+    Orders orders(count);
+    for (std::size_t index = 0; index < count; ++index) {
+        auto& order    = orders[index];
+        order.id       = 100000 + index;
+        order.customer = "customer-" + std::to_string(index % 97);
+        order.paid     = index % 3 == 0;
+        if (index % 4 == 0) {
+            order.note = "leave at the door";
+        }
+        for (std::size_t item = 0; item < 4; ++item) {
+            order.items.push_back(
+                {"sku-" + std::to_string(index * 4 + item), static_cast<std::uint32_t>(item + 1), 9.5 + item});
+        }
+    }
+    return orders;
+}
+
+template <typename Func>
+double measure_mib_per_second(std::size_t bytes, Func&& func) {
+    // Repeat until at least a quarter second has passed so small inputs are not timer noise.
+    using Clock        = std::chrono::steady_clock;
+    std::size_t rounds = 0;
+    const auto start   = Clock::now();
+    auto elapsed       = Clock::duration{};
+    do {
+        if (!func()) {
+            return 0;
+        }
+        ++rounds;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(250));
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return static_cast<double>(bytes * rounds) / KMiB / seconds;
+}
+
+template <typename From, typename To>
+bool typed_round(const std::vector<char>& input, std::vector<char>& output) {
+    Orders orders;
+    {
+        typename From::InputSerializer in(input.data(), input.size());
+        if (!in(orders)) {
+            return false;
+        }
+    }
+    output.clear();
+    typename To::OutputSerializer out(output);
+    return out(orders) && out.end();
+}
+
+template <typename From, typename To, typename... Schema>
+bool transcode_round(const std::vector<char>& input, std::vector<char>& output) {
+    output.clear();
+    return static_cast<bool>(transcode<From, To, Schema...>(input.data(), input.size(), output));
+}
+
+void print_row(const char* name, double typed, std::optional<double> generic, double schema) {
+    std::cout << std::setw(14) << name << std::fixed << std::setprecision(1) << std::setw(14) << typed;
+    if (generic) {
+        std::cout << std::setw(14) << *generic;
+    } else {
+        std::cout << std::setw(14) << "n/a";
+    }
+    std::cout << std::setw(14) << schema << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t count = 2000;
+    if (argc > 1) {
+        count = static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+    }
+    const auto orders = make_orders(count);
+    std::vector<char> json;
+    std::vector<char> binary;
+    {
+        JsonSerializer::OutputSerializer out(json);
+        BinarySerializer::OutputSerializer bin(binary);
+        if (!out(orders) || !out.end() || !bin(orders) || !bin.end()) {
+            std::cerr << "failed to build the input documents\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<char> output;
+    if (!transcode_round<JsonSerializer, BinarySerializer, Orders>(json, output) || output != binary) {
+        std::cerr << "schema transcode does not match the typed binary output\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << count << " orders, json " << json.size() << " bytes, binary " << binary.size() << " bytes\n";
+    std::cout << std::setw(14) << "MiB/s" << std::setw(14) << "typed" << std::setw(14) << "transcode"
+              << std::setw(14) << "schema" << "\n";
+    print_row("json->binary",
+              measure_mib_per_second(json.size(),
+                                     [&] { return typed_round<JsonSerializer, BinarySerializer>(json, output); }),
+              measure_mib_per_second(json.size(),
+                                     [&] { return transcode_round<JsonSerializer, BinarySerializer>(json, output); }),
+              measure_mib_per_second(json.size(), [&] {
+                  return transcode_round<JsonSerializer, BinarySerializer, Orders>(json, output);
+              }));
+    // Reflected binary objects carry id keys, so only the schema variant can read them back.
+    print_row("binary->json",
+              measure_mib_per_second(binary.size(),
+                                     [&] { return typed_round<BinarySerializer, JsonSerializer>(binary, output); }),
+              std::nullopt,
+              measure_mib_per_second(binary.size(), [&] {
+                  return transcode_round<BinarySerializer, JsonSerializer, Orders>(binary, output);
+              }));
+    return EXIT_SUCCESS;
+}
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <atomic>
 #include <gtest/gtest.h>
+#include <limits>
 #include <random>
 #include <sstream>
+#include <thread>
 
 #include "ilias/defines.hpp"
 #include "ilias/net/sockfd.hpp"
@@ -190,6 +194,259 @@ ilias::IoTask<void> test(IoContext& ioContext, ProtoFactory& protoFactory, Strea
     co_return {};
 }
 
+ilias::IoTask<void> stream_server_loop(ProtoFactory& protoFactory, std::vector<std::string>& received) {
+    auto retl = co_await TcpListener::bind(IPEndpoint("127.0.0.1", 10349));
+    if (!retl) {
+        co_return Err(retl.error());
+    }
+    auto ret = co_await retl.value().accept();
+    if (!ret) {
+        co_return Err(ret.error());
+    }
+    ProtoStreamClient<TcpStream> client(protoFactory, std::move(ret.value().first));
+    while (received.size() < 3) {
+        auto ret1 = co_await client.recv();
+        if (!ret1) {
+            co_return Err(ret1.error());
+        }
+        auto* msg = ret1->cast<Message>();
+        EXPECT_NE(msg, nullptr);
+        if (msg != nullptr) {
+            received.push_back(msg->msg);
+        }
+    }
+    Message ack;
+    ack.msg = "ack";
+    if (auto ret2 = co_await client.send(ack.makeProto()); !ret2) {
+        co_return Err(ret2.error());
+    }
+    co_await client.recv(); // wait for the peer to close
+    co_return co_await client.close();
+}
+
+ilias::IoTask<void> stream_client_loop(ProtoFactory& protoFactory, const std::string& bulk) {
+    auto ret = co_await ilias::TcpStream::connect(IPEndpoint("127.0.0.1", 10349));
+    if (!ret) {
+        co_return Err(ret.error());
+    }
+    ProtoStreamClient<TcpStream> client(protoFactory, std::move(ret.value()));
+    Message large;
+    large.msg = bulk;
+    Message urgent;
+    urgent.msg = "urgent";
+    Message plain;
+    plain.msg = "plain";
+    // recv runs alongside the senders to pick up the window grants of the bulk stream.
+    auto [ret1, ret2, ret3, ret4] =
+        co_await whenAll(client.sendStream(large.makeProto()), client.sendStream(urgent.makeProto(), 1),
+                         client.send(plain.makeProto()), client.recv());
+    if (!ret1 || !ret2 || !ret3) {
+        co_return Err(!ret1 ? ret1.error() : (!ret2 ? ret2.error() : ret3.error()));
+    }
+    if (!ret4) {
+        co_return Err(ret4.error());
+    }
+    auto* ack = ret4->cast<Message>();
+    EXPECT_TRUE(ack != nullptr && ack->msg == "ack");
+    co_return co_await client.close();
+}
+
+ilias::IoTask<void> stream_test(ProtoFactory& protoFactory, std::vector<std::string>& received,
+                                const std::string& bulk) {
+    auto [ret1, ret2] =
+        co_await whenAll(stream_server_loop(protoFactory, received), stream_client_loop(protoFactory, bulk));
+    if (!ret1 && ret1.error() != ilias::IoError::ConnectionReset) {
+        co_return Err(ret1.error());
+    }
+    if (!ret2) {
+        co_return Err(ret2.error());
+    }
+    co_return {};
+}
+
+ilias::IoTask<std::string> bidirectional_peer(ProtoStreamClient<TcpStream>& client, const std::string& bulk) {
+    Message large;
+    large.msg = bulk;
+    auto [sent, got] = co_await whenAll(client.sendStream(large.makeProto()), client.recv());
+    if (!sent) {
+        co_return Err(sent.error());
+    }
+    if (!got) {
+        co_return Err(got.error());
+    }
+    auto* msg = got->cast<Message>();
+    co_return msg == nullptr ? std::string() : msg->msg;
+}
+
+ilias::IoTask<void> bidirectional_stream_test(ProtoFactory& protoFactory, const std::string& bulk,
+                                              std::vector<std::string>& received) {
+    auto listener = co_await TcpListener::bind(IPEndpoint("127.0.0.1", 10351));
+    if (!listener) {
+        co_return Err(listener.error());
+    }
+    auto [accepted, connected] =
+        co_await whenAll(listener.value().accept(), TcpStream::connect(IPEndpoint("127.0.0.1", 10351)));
+    if (!accepted) {
+        co_return Err(accepted.error());
+    }
+    if (!connected) {
+        co_return Err(connected.error());
+    }
+    ProtoStreamClient<TcpStream> server(protoFactory, std::move(accepted.value().first));
+    ProtoStreamClient<TcpStream> client(protoFactory, std::move(connected.value()));
+    // Each side blocks writing its own stream while its recv owes the other side window grants.
+    auto [fromClient, fromServer] =
+        co_await whenAll(bidirectional_peer(server, bulk), bidirectional_peer(client, bulk));
+    if (!fromClient) {
+        co_return Err(fromClient.error());
+    }
+    if (!fromServer) {
+        co_return Err(fromServer.error());
+    }
+    received.push_back(std::move(fromClient.value()));
+    received.push_back(std::move(fromServer.value()));
+    co_await client.close();
+    co_return co_await server.close();
+}
+
+// Forwards to a TcpStream but takes at most *limit bytes per write, so the test decides which writes come up
+// short. Each write still sends everything it takes, so the socket buffers never add short writes of their own.
+// writeVectored takes the pieces of a batch in one call, which is how sliced sends reach it.
+class ThrottledStream {
+public:
+    ThrottledStream() = default;
+    ThrottledStream(TcpStream&& stream, const std::size_t& limit) : mStream(std::move(stream)), mLimit(&limit) {}
+
+    explicit operator bool() const { return static_cast<bool>(mStream); }
+
+    auto read(std::span<std::byte> buffer) -> ilias::IoTask<std::size_t> { return mStream.read(buffer); }
+    auto write(std::span<const std::byte> buffer) -> ilias::IoTask<std::size_t> {
+        buffer              = buffer.first(std::min(buffer.size(), *mLimit));
+        std::size_t written = 0;
+        while (written < buffer.size()) {
+            auto ret = co_await mStream.write(buffer.subspan(written));
+            if (!ret) {
+                co_return Err(ret.error());
+            }
+            if (ret.value() == 0) {
+                break;
+            }
+            written += ret.value();
+        }
+        co_return written;
+    }
+    auto writeVectored(std::span<const std::span<const std::byte>> pieces) -> ilias::IoTask<std::size_t> {
+        std::size_t written = 0;
+        for (const auto& piece : pieces) {
+            const auto taken = std::min(piece.size(), *mLimit - written);
+            auto ret         = co_await write(piece.first(taken));
+            if (!ret) {
+                co_return Err(ret.error());
+            }
+            written += ret.value();
+            if (ret.value() != piece.size()) {
+                break;
+            }
+        }
+        co_return written;
+    }
+    auto shutdown() -> ilias::IoTask<void> { return mStream.shutdown(); }
+    auto flush() -> ilias::IoTask<void> { co_return {}; }
+    auto close() -> void { mStream.close(); }
+
+private:
+    TcpStream mStream;
+    const std::size_t* mLimit = nullptr;
+};
+
+ilias::IoTask<void> sliced_transfer(ProtoStreamClient<ThrottledStream>& sender, ProtoStreamClient<TcpStream>& receiver,
+                                    Message& message) {
+    auto [sent, got] = co_await whenAll(sender.send(message.makeProto(), StreamFlag::SliceData), receiver.recv());
+    if (!sent) {
+        co_return Err(sent.error());
+    }
+    if (!got) {
+        co_return Err(got.error());
+    }
+    auto* msg = got->cast<Message>();
+    if (msg == nullptr || msg->msg != message.msg) {
+        co_return Err(ilias::IoError::UnexpectedEOF);
+    }
+    co_return {};
+}
+
+// Sends @p bulk sliced twice, first with writes that take every batch at once and then with writes that take
+// less than any batch, and returns the slice size the sender settled on after each.
+ilias::IoTask<std::pair<uint32_t, uint32_t>> adaptive_slice_test(ProtoFactory& protoFactory, const std::string& bulk) {
+    auto listener = co_await TcpListener::bind(IPEndpoint("127.0.0.1", 10353));
+    if (!listener) {
+        co_return Err(listener.error());
+    }
+    auto [accepted, connected] =
+        co_await whenAll(listener.value().accept(), TcpStream::connect(IPEndpoint("127.0.0.1", 10353)));
+    if (!accepted) {
+        co_return Err(accepted.error());
+    }
+    if (!connected) {
+        co_return Err(connected.error());
+    }
+    std::size_t writeLimit = std::numeric_limits<std::size_t>::max();
+    ProtoStreamClient<TcpStream> server(protoFactory, std::move(accepted.value().first));
+    ProtoStreamClient<ThrottledStream> client(protoFactory, ThrottledStream(std::move(connected.value()), writeLimit));
+    Message large;
+    large.msg = bulk;
+    if (auto ret = co_await sliced_transfer(client, server, large); !ret) {
+        co_return Err(ret.error());
+    }
+    const auto grown = client.sliceSize();
+    writeLimit       = 4096;
+    if (auto ret = co_await sliced_transfer(client, server, large); !ret) {
+        co_return Err(ret.error());
+    }
+    const auto shrunk = client.sliceSize();
+    co_await client.close();
+    co_await server.close();
+    co_return std::pair{grown, shrunk};
+}
+
+// A raw peer opens a stream and announces a slice larger than the initial window without waiting for a grant.
+// Returns the error the receiving recv failed with.
+ilias::IoTask<std::error_code> window_overrun_test(ProtoFactory& protoFactory) {
+    // ProtoStreamClient's KStreamWindow.
+    constexpr uint32_t kStreamWindow = 256U * 1024U;
+    auto listener                    = co_await TcpListener::bind(IPEndpoint("127.0.0.1", 10355));
+    if (!listener) {
+        co_return Err(listener.error());
+    }
+    auto [accepted, connected] =
+        co_await whenAll(listener.value().accept(), TcpStream::connect(IPEndpoint("127.0.0.1", 10355)));
+    if (!accepted) {
+        co_return Err(accepted.error());
+    }
+    if (!connected) {
+        co_return Err(connected.error());
+    }
+    ProtoStreamClient<TcpStream> receiver(protoFactory, std::move(accepted.value().first));
+    std::array<std::byte, MessageHeader::KSize * 2 + 8> frames{};
+    MessageHeader(8, 1, MessageType::StreamHeader).pack(frames.data());
+    const auto opening = MessageHeader(kStreamWindow * 2, ProtoFactory::protoType<Message>()).pack();
+    std::copy_n(opening.begin(), 8, frames.begin() + MessageHeader::KSize);
+    // Only the slice header goes out, the receiver has to refuse it before reading any payload.
+    MessageHeader(kStreamWindow + 1, 1, MessageType::StreamSlice).pack(frames.data() + MessageHeader::KSize + 8);
+    std::span<const std::byte> pending(frames);
+    while (!pending.empty()) {
+        auto written = co_await connected.value().write(pending);
+        if (!written) {
+            co_return Err(written.error());
+        }
+        pending = pending.subspan(written.value());
+    }
+    auto got = co_await receiver.recv();
+    connected.value().close();
+    co_await receiver.close();
+    co_return got ? std::error_code() : got.error();
+}
+
 ilias::IoTask<void> udp_client([[maybe_unused]] IoContext& ioContext, ProtoFactory& protoFactory,
                                          StreamFlag sendFlags, StreamFlag recvFlags, const IPEndpoint& bindPoint,
                                          const IPEndpoint& endpoint) {
@@ -373,10 +630,113 @@ TEST_F(Communication, Thread) {
     EXPECT_TRUE(test(ioContext, protoFactory, StreamFlag::SerializerInThread, StreamFlag::None).wait());
 }
 
+TEST_F(Communication, SerializerPoolMetrics) {
+    const auto before = SerializerPool::instance().metrics();
+    EXPECT_TRUE(test(ioContext, protoFactory, StreamFlag::SerializerInThread, StreamFlag::SerializerInThread).wait());
+    const auto after = SerializerPool::instance().metrics();
+    EXPECT_GT(after.serialize.jobs, before.serialize.jobs);
+    EXPECT_GT(after.parse.jobs, before.parse.jobs);
+    EXPECT_GE(after.parse.run_time, before.parse.run_time);
+}
+
+TEST_F(Communication, SerializerPoolStopWithdrawsQueuedJob) {
+    using namespace std::chrono_literals;
+    SerializerPool pool(SerializerPool::Options{.threads = 1, .inline_bytes = 0});
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    std::atomic<bool> queuedRan{false};
+    auto block = [&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+        return true;
+    };
+    auto mark = [&]() {
+        queuedRan = true;
+        return true;
+    };
+
+    auto running =
+        ilias::spawn(pool.run(std::make_shared<SerializerPool::Strand>(), SerializerPool::Stage::Parse, 1, block));
+    while (!started) {
+        ilias::sleep(1ms).wait();
+    }
+    auto queued =
+        ilias::spawn(pool.run(std::make_shared<SerializerPool::Strand>(), SerializerPool::Stage::Parse, 1, mark));
+    ilias::sleep(10ms).wait();
+    queued.stop();
+    // The stopped job comes back while the worker is still busy with the first one.
+    auto queuedResult = queued.wait();
+    ASSERT_TRUE(queuedResult.has_value());
+    ASSERT_FALSE(queuedResult->has_value());
+    EXPECT_EQ(queuedResult->error(), make_error_code(ilias::IoError::Canceled));
+    EXPECT_FALSE(release);
+
+    release = true;
+    auto runningResult = running.wait();
+    ASSERT_TRUE(runningResult.has_value());
+    ASSERT_TRUE(runningResult->has_value());
+    EXPECT_TRUE(runningResult->value());
+    EXPECT_FALSE(queuedRan);
+}
+
 TEST_F(Communication, Slice) {
     EXPECT_TRUE(test(ioContext, protoFactory, StreamFlag::SliceData, StreamFlag::None).wait());
 }
 
+TEST_F(Communication, SliceSize) {
+    ProtoStreamClient<TcpStream> client;
+    const auto adaptive = client.sliceSize();
+    EXPECT_GT(adaptive, static_cast<uint32_t>(MessageHeader::KSize));
+    client.setSliceSize(4096);
+    EXPECT_EQ(client.sliceSize(), 4096U);
+    client.setSliceSize(1);
+    EXPECT_EQ(client.sliceSize(), MessageHeader::KSize + 1);
+    client.setSliceSize(0);
+    EXPECT_EQ(client.sliceSize(), adaptive);
+}
+
+TEST_F(Communication, AdaptiveSliceSize) {
+    // ProtoStreamClient's KMinSliceSize and KMaxSliceSize.
+    constexpr uint32_t kMinSliceSize = 1200;
+    constexpr uint32_t kMaxSliceSize = 1024U * 1024U;
+    // Enough full batches to double from the default up to the cap, and to halve from the cap down to the floor.
+    const auto bulk = generate_random_string(8 * 1024 * 1024);
+    auto sizes      = adaptive_slice_test(protoFactory, bulk).wait();
+    ASSERT_TRUE(sizes);
+    EXPECT_EQ(sizes->first, kMaxSliceSize);
+    EXPECT_EQ(sizes->second, kMinSliceSize);
+}
+
+TEST_F(Communication, MultiplexedStreams) {
+    // Large enough to need several window grants.
+    const auto bulk = generate_random_string(1024 * 1024);
+    std::vector<std::string> received;
+    EXPECT_TRUE(stream_test(protoFactory, received, bulk).wait());
+    ASSERT_EQ(received.size(), 3U);
+    // The bulk stream shares the connection, the small messages are not queued behind it.
+    EXPECT_EQ(received.back(), bulk);
+    EXPECT_NE(std::find(received.begin(), received.end(), "urgent"), received.end());
+    EXPECT_NE(std::find(received.begin(), received.end(), "plain"), received.end());
+}
+
+TEST_F(Communication, BidirectionalStreams) {
+    // Far larger than the window and the socket buffers, so both peers stall on writes at the same time.
+    const auto bulk = generate_random_string(4 * 1024 * 1024);
+    std::vector<std::string> received;
+    EXPECT_TRUE(bidirectional_stream_test(protoFactory, bulk, received).wait());
+    ASSERT_EQ(received.size(), 2U);
+    EXPECT_EQ(received[0], bulk);
+    EXPECT_EQ(received[1], bulk);
+}
+
+TEST_F(Communication, StreamWindowOverrunFailsRecv) {
+    auto error = window_overrun_test(protoFactory).wait();
+    ASSERT_TRUE(error);
+    EXPECT_EQ(error.value(), make_error_code(ErrorCode::StreamWindowExceeded));
+}
+
 TEST_F(Communication, None) {
     EXPECT_TRUE(test(ioContext, protoFactory, StreamFlag::None, StreamFlag::None).wait());
 }
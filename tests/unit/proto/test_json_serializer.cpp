@@ -388,6 +388,15 @@ TEST(JsonSerializerTest, AtomicBinaryAndBitsetRoundTrip) {
     BinaryData<char> decodedBinary(decodedData.data(), decodedData.size());
     ASSERT_TRUE(read_named(R"({"value":"aGVsbG8gd29ybGQ="})", "value", decodedBinary));
     EXPECT_EQ(std::string(decodedData.begin(), decodedData.end()), data);
+    EXPECT_EQ(decodedBinary.size, data.size());
+
+    std::vector<char> small(data.size() - 1, '#');
+    BinaryData<char> smallBinary(small.data(), small.size());
+    const std::string_view encodedJson = R"({"value":"aGVsbG8gd29ybGQ="})";
+    JsonSerializer::InputSerializer smallInput(encodedJson.data(), encodedJson.size());
+    auto smallField = make_name_value_pair("value", smallBinary);
+    EXPECT_FALSE(smallInput(smallField));
+    EXPECT_EQ(std::string(small.begin(), small.end()), std::string(small.size(), '#'));
 
     const std::bitset<5> bitset{0b10101};
     EXPECT_EQ(write_named("value", bitset), R"({"value":"10101"})");
@@ -396,6 +405,35 @@ TEST(JsonSerializerTest, AtomicBinaryAndBitsetRoundTrip) {
     EXPECT_EQ(decodedBitset, bitset);
 }
 
+TEST(JsonSerializerTest, BinaryDataRejectsInvalidBlocksWithoutWriting) {
+    std::string payload(64, '\0');
+    for (std::size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i * 7U);
+    }
+    const auto encoded = Base64Covert::Encode(payload.data(), payload.size());
+    const std::string text(encoded.begin(), encoded.end());
+
+    // Positions inside the first and second 32-character vector blocks.
+    for (const std::size_t position : {std::size_t{13}, std::size_t{45}}) {
+        auto invalid      = text;
+        invalid[position] = '*';
+        std::vector<char> decoded(payload.size(), '#');
+        BinaryData<char> binary(decoded.data(), decoded.size());
+        const auto json = R"({"value":")" + invalid + R"("})";
+        JsonSerializer::InputSerializer input(json.data(), json.size());
+        auto field = make_name_value_pair("value", binary);
+        EXPECT_FALSE(input(field)) << "position " << position;
+        EXPECT_EQ(std::string(decoded.begin(), decoded.end()), std::string(decoded.size(), '#'))
+            << "position " << position;
+    }
+
+    std::vector<char> decoded(payload.size());
+    BinaryData<char> binary(decoded.data());
+    ASSERT_TRUE(read_named(R"({"value":")" + text + R"("})", "value", binary));
+    EXPECT_EQ(binary.size, payload.size());
+    EXPECT_EQ(std::string(decoded.begin(), decoded.end()), payload);
+}
+
 TEST(JsonSerializerTest, PairAndPointersRoundTrip) {
     const std::pair<int, std::string> pair{1, "hello world"};
     EXPECT_EQ(write_named("value", pair), R"({"value":{"first":1,"second":"hello world"}})");
@@ -56,6 +56,51 @@ struct TestP {
     NEKO_DECLARE_PROTOCOL(TestP, JsonSerializer)
 };
 
+struct WideMessage {
+    int f00 = 0;
+    int f01 = 0;
+    int f02 = 0;
+    int f03 = 0;
+    int f04 = 0;
+    int f05 = 0;
+    int f06 = 0;
+    int f07 = 0;
+    int f08 = 0;
+    int f09 = 0;
+    int f10 = 0;
+    int f11 = 0;
+    int f12 = 0;
+    int f13 = 0;
+    int f14 = 0;
+    int f15 = 0;
+    int f16 = 0;
+    int f17 = 0;
+    int f18 = 0;
+    int f19 = 0;
+    int f20 = 0;
+    int f21 = 0;
+    int f22 = 0;
+    int f23 = 0;
+    int f24 = 0;
+    int f25 = 0;
+    int f26 = 0;
+    int f27 = 0;
+    int f28 = 0;
+    int f29 = 0;
+    int f30 = 0;
+    int f31 = 0;
+    int f32 = 0;
+    int f33 = 0;
+    int f34 = 0;
+    int f35 = 0;
+    int f36 = 0;
+    int f37 = 0;
+    int f38 = 0;
+    int f39 = 0;
+    NEKO_SERIALIZER(f00, f01, f02, f03, f04, f05, f06, f07, f08, f09, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19,
+                    f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31, f32, f33, f34, f35, f36, f37, f38, f39)
+};
+
 struct UnusedProto {
     int a;
     NEKO_SERIALIZER(a)
@@ -248,6 +293,44 @@ TEST_F(ProtoTest, Base64Covert) {
     EXPECT_STREQ(str10.data(), "");
 }
 
+TEST_F(ProtoTest, Base64CovertLongInputsAndValidation) {
+    // Lengths around the 12/24-byte vector blocks and their scalar tails.
+    for (std::size_t size = 0; size < 160; ++size) {
+        std::vector<char> data(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>((i * 131U + size) & 0xFFU);
+        }
+        const auto encoded = Base64Covert::Encode(data);
+        ASSERT_EQ(encoded.size(), Base64Covert::EncodedSize(size));
+        EXPECT_EQ(Base64Covert::Decode(encoded), data) << "size " << size;
+
+        std::vector<uint8_t> decoded(size);
+        ASSERT_TRUE(Base64Covert::Decode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(),
+                                         decoded.data()));
+        EXPECT_EQ(decoded, std::vector<uint8_t>(data.begin(), data.end()));
+    }
+
+    const std::string valid(96, 'Q');
+    std::vector<uint8_t> out(Base64Covert::DecodedSize(reinterpret_cast<const uint8_t*>(valid.data()), valid.size()));
+    for (std::size_t position = 0; position < valid.size(); ++position) {
+        for (const char bad : {'*', '=', '\0', '\x80'}) {
+            auto invalid      = valid;
+            invalid[position] = bad;
+            const bool ok = Base64Covert::Decode(reinterpret_cast<const uint8_t*>(invalid.data()), invalid.size(),
+                                                 out.data());
+            const bool trailingPad = bad == '=' && position == valid.size() - 1;
+            EXPECT_EQ(ok, trailingPad) << "position " << position << " byte " << static_cast<int>(bad);
+        }
+    }
+
+    std::vector<uint8_t> buf;
+    EXPECT_FALSE(Base64Covert::Decode(reinterpret_cast<const uint8_t*>("QUJD="), 5, buf));
+    EXPECT_FALSE(Base64Covert::Decode(reinterpret_cast<const uint8_t*>("Q==="), 4, buf));
+    EXPECT_FALSE(Base64Covert::Decode(reinterpret_cast<const uint8_t*>("QU=D"), 4, buf));
+    EXPECT_TRUE(Base64Covert::Decode(reinterpret_cast<const uint8_t*>("QUI="), 4, buf));
+    EXPECT_EQ(std::string(buf.begin(), buf.end()), "AB");
+}
+
 TEST_F(ProtoTest, JsonProtoRef) {
     std::string str = "{\"a\":3,\"b\":\"Struct "
                       "test\",\"c\":true,\"d\":3.141592654,\"e\":[1,2,3],\"f\":{\"a\":1,\"b\":2},\"g\":[1,2,3,0,0],"
@@ -336,6 +419,143 @@ TEST_F(ProtoTest, InvalidParams) {
     EXPECT_FALSE(TestP::ProtoType::Deserialize(str.data(), str.length(), proto));
 }
 
+TEST_F(ProtoTest, ToDataWithHeadroom) {
+    BinaryProto proto;
+    proto.b       = "headroom";
+    auto expected = proto.makeProto().toData();
+
+    std::vector<char> buffer = {'x', 'y', 'z'};
+    buffer.reserve(256);
+    const auto* storage = buffer.data();
+    auto payload        = proto.makeProto().toData(buffer, 10);
+    ASSERT_EQ(payload.size(), expected.size());
+    EXPECT_EQ(buffer.size(), expected.size() + 10);
+    EXPECT_EQ(payload.data(), buffer.data() + 10);
+    EXPECT_EQ(buffer.data(), storage); // the buffer is reused, not reallocated
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(), expected.begin()));
+
+    TestP json;
+    auto jsonPayload = json.makeProto().toData(buffer, 0);
+    EXPECT_EQ(jsonPayload.size(), buffer.size());
+    EXPECT_EQ(std::vector<char>(jsonPayload.begin(), jsonPayload.end()), json.makeProto().toData());
+    EXPECT_TRUE(IProto{}.toData(buffer, 10).empty());
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST_F(ProtoTest, FieldHandle) {
+    auto proto        = mFactory->create("TestP");
+    auto* rawp        = proto.cast<TestP>();
+    const auto& table = detail::field_table_v<TestP>;
+    ASSERT_EQ(table.size(), Reflect<TestP>::size());
+    for (std::size_t idx = 0; idx < table.size(); ++idx) {
+        EXPECT_EQ(table.find(Reflect<TestP>::name(static_cast<int>(idx))), &table[idx]);
+    }
+    EXPECT_EQ(table.find("unexist field"), nullptr);
+
+    auto handleA = proto.fieldHandle<int>("a");
+    auto handleB = proto.fieldHandle<std::string>("b");
+    ASSERT_TRUE(handleA);
+    ASSERT_TRUE(handleB);
+    EXPECT_EQ(handleA.name(), "a");
+    EXPECT_FALSE(proto.fieldHandle<double>("a"));         // wrong type
+    EXPECT_FALSE(proto.fieldHandle<int>("unexist field")); // unexist field
+    EXPECT_EQ(proto.field(handleA), &rawp->a);
+    *proto.field(handleB) = "handle set";
+    EXPECT_EQ(rawp->b, "handle set");
+
+    // a handle is bound to the type it was resolved against
+    auto other = mFactory->create("BinaryProto");
+    EXPECT_EQ(other.field(handleA), nullptr);
+    EXPECT_EQ(IProto{}.field(handleA), nullptr);
+    EXPECT_EQ(proto.field(FieldHandle<int>{}), nullptr);
+
+    auto again = mFactory->create("TestP");
+    EXPECT_EQ(again.field(handleA), &again.cast<TestP>()->a);
+}
+
+TEST_F(ProtoTest, FieldTableStaysLinearInFieldCount) {
+    constexpr auto& layout = detail::field_layout_v<WideMessage>;
+    static_assert(layout.slots.size() <= 4 * Reflect<WideMessage>::size());
+    static_assert(layout.displacements.size() <= Reflect<WideMessage>::size());
+
+    const auto& table = detail::field_table_v<WideMessage>;
+    ASSERT_EQ(table.size(), Reflect<WideMessage>::size());
+    for (std::size_t idx = 0; idx < table.size(); ++idx) {
+        EXPECT_EQ(table.find(Reflect<WideMessage>::name(static_cast<int>(idx))), &table[idx]);
+    }
+    EXPECT_EQ(table.find("f40"), nullptr);
+    EXPECT_EQ(table.find(""), nullptr);
+
+    WideMessage message;
+    *static_cast<int*>(table.find("f27")->address(&message)) = 27;
+    EXPECT_EQ(message.f27, 27);
+}
+
+TEST_F(ProtoTest, ProtoTypeLookup) {
+    static_assert(ProtoFactory::protoHash<TestP>() == detail::proto_name_hash("TestP"));
+    EXPECT_EQ(ProtoFactory::protoType("TestP"), mFactory->protoType<TestP>());
+    EXPECT_EQ(ProtoFactory::protoType("BinaryProto"), mFactory->protoType<BinaryProto>());
+    EXPECT_EQ(ProtoFactory::protoType("InvalidP"), -1);
+
+    const int remoteTestP  = NEKO_RESERVED_PROTO_TYPE_SIZE + 7;
+    const int remoteBinary = NEKO_RESERVED_PROTO_TYPE_SIZE + 1;
+    auto table = ProtoFactory::translateProtoTypes(
+        {{remoteBinary, "BinaryProto"}, {remoteTestP, "TestP"}, {remoteTestP + 1, "InvalidP"}});
+    ASSERT_EQ(table.size(), static_cast<std::size_t>(remoteTestP + 2));
+    EXPECT_EQ(table[1], 1);
+    EXPECT_EQ(table[remoteBinary], mFactory->protoType<BinaryProto>());
+    EXPECT_EQ(table[remoteTestP], mFactory->protoType<TestP>());
+    EXPECT_EQ(table[remoteTestP - 1], -1);
+    EXPECT_EQ(table[remoteTestP + 1], -1);
+    EXPECT_TRUE(mFactory->create(table[remoteTestP]).cast<TestP>() != nullptr);
+    EXPECT_TRUE(mFactory->create(table[remoteTestP + 1]) == nullptr);
+    EXPECT_TRUE(ProtoFactory::translateProtoTypes({}).empty());
+}
+
+TEST_F(ProtoTest, FactoryPoolRecyclesInstances) {
+    using Pool = detail::ProtoPool<BinaryProto::ProtoType>;
+    const auto capacity = Pool::capacity();
+    // Earlier tests may have left instances in the pool; start from an empty one.
+    Pool::setCapacity(0);
+    Pool::setCapacity(capacity);
+    ASSERT_EQ(Pool::size(), 0U);
+
+    const BinaryProto* first = nullptr;
+    {
+        auto proto = mFactory->create(mFactory->protoType<BinaryProto>());
+        ASSERT_TRUE(proto != nullptr);
+        auto* raw = proto.cast<BinaryProto>();
+        first     = raw;
+        raw->a    = 42;
+        raw->b    = "recycled";
+        raw->d    = 7;
+    }
+    EXPECT_EQ(Pool::size(), 1U);
+
+    {
+        auto proto = mFactory->create("BinaryProto");
+        ASSERT_TRUE(proto != nullptr);
+        auto* raw = proto.cast<BinaryProto>();
+        EXPECT_EQ(raw, first);
+        EXPECT_EQ(raw->a, 1);
+        EXPECT_EQ(raw->b, "hello");
+        EXPECT_FALSE(raw->d.has_value());
+        EXPECT_EQ(Pool::size(), 0U);
+
+        BinaryProto source;
+        source.a  = 24;
+        auto data = source.makeProto().toData();
+        EXPECT_TRUE(proto.fromData(data.data(), data.size()));
+        EXPECT_EQ(raw->a, 24);
+    }
+
+    Pool::setCapacity(0);
+    EXPECT_EQ(Pool::size(), 0U);
+    { auto proto = mFactory->create("BinaryProto"); }
+    EXPECT_EQ(Pool::size(), 0U);
+    Pool::setCapacity(capacity);
+}
+
 TEST_F(ProtoTest, BinaryProto) {
     BinaryProto proto;
     proto.a   = 24;
@@ -6,6 +6,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <map>
 #include <memory>
 #include <limits>
@@ -24,6 +26,18 @@
 #include "nekoproto/jsonrpc/message_stream_wrapper.hpp"
 #include "nekoproto/rpc/rpc.hpp"
 #include "nekoproto/serialization/json_serializer.hpp"
+#include "nekoproto/transport/fragmented_datagram_endpoint.hpp"
+#include "nekoproto/transport/io_uring_stream.hpp"
+#include "nekoproto/transport/shm_endpoint.hpp"
+#include "nekoproto/transport/udp_batch_endpoint.hpp"
+#include "nekoproto/transport/unix_memfd_endpoint.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 NEKO_USE_NAMESPACE
 
@@ -111,6 +125,45 @@ void connect_endpoint(Server& server, Client& client) {
     client.setEndpoint(std::move(clientStream));
 }
 
+/// Datagram socket that hands out scripted datagrams, fails once they run out, and records what is sent.
+struct ScriptedDatagram {
+    struct Script {
+        std::deque<std::pair<std::vector<std::byte>, int>> inbox;
+        std::vector<std::pair<std::vector<std::byte>, int>> sent;
+    };
+    std::shared_ptr<Script> script = std::make_shared<Script>();
+
+    auto recvfrom(std::span<std::byte> out) -> ilias::IoTask<std::pair<std::size_t, int>> {
+        if (script->inbox.empty()) {
+            co_return ilias::Err(ilias::IoError::ConnectionReset);
+        }
+        auto [datagram, from] = std::move(script->inbox.front());
+        script->inbox.pop_front();
+        const auto size = std::min(datagram.size(), out.size());
+        std::memcpy(out.data(), datagram.data(), size);
+        co_return std::pair<std::size_t, int>{size, from};
+    }
+    auto sendto(std::span<const std::byte> in, int to) -> ilias::IoTask<std::size_t> {
+        script->sent.emplace_back(std::vector<std::byte>(in.begin(), in.end()), to);
+        co_return in.size();
+    }
+    auto close() -> void {}
+};
+
+/// A fragmented-endpoint datagram: @p payload followed by the 16-byte little-endian trailer.
+auto fragment_datagram(std::uint8_t kind, std::uint32_t id, std::uint32_t total, std::uint32_t index,
+                       std::vector<std::byte> payload) -> std::vector<std::byte> {
+    const auto start = payload.size();
+    payload.resize(start + 16U);
+    payload[start] = static_cast<std::byte>(kind);
+    for (std::size_t idx = 0; idx < 4U; ++idx) {
+        payload[start + 4U + idx]  = static_cast<std::byte>(id >> (idx * 8U));
+        payload[start + 8U + idx]  = static_cast<std::byte>(total >> (idx * 8U));
+        payload[start + 12U + idx] = static_cast<std::byte>(index >> (idx * 8U));
+    }
+    return payload;
+}
+
 template <typename Predicate>
 auto wait_until(Predicate predicate, std::chrono::milliseconds budget = std::chrono::milliseconds(250)) -> bool {
     using namespace std::chrono_literals;
@@ -186,7 +239,7 @@ TEST(NekoRpcBackend, JsonSerializedBackendCallsRegisteredMethodThroughFrame) {
     EXPECT_EQ(decoded.value(), 42);
 }
 
-TEST(NekoRpcBackend, CallsThroughIliasDuplexStreamEndpoint) {
+TEST(NekoRpcBackend, ServerReusesPooledReceiveBuffers) {
     ilias::PlatformContext context;
     context.install();
     RpcServer<BinaryRpcBackend, BinaryRpcTestApi> server{context};
@@ -195,19 +248,542 @@ TEST(NekoRpcBackend, CallsThroughIliasDuplexStreamEndpoint) {
 
     server->add = [](int lhs, int rhs) -> ilias::IoTask<int> { co_return lhs + rhs; };
 
-    auto result = client->add(20, 22).wait();
+    for (int idx = 0; idx < 100; ++idx) {
+        auto result = client->add(idx, 1).wait();
+        ASSERT_TRUE(result.has_value()) << result.error().message();
+    }
+    // The recv of the next frame may start before the previous request has
+    // handed its buffer back, so a couple of buffers circulate.
+    const auto metrics = server.bufferPoolMetrics();
+    EXPECT_GE(metrics.hits, 90U);
+    EXPECT_LE(metrics.misses, 10U);
+    EXPECT_GT(metrics.pooled_bytes_high_water, 0U);
+    EXPECT_GT(metrics.leased_bytes_high_water, 0U);
+
+    client.close();
+    server.close();
+}
+
+TEST(NekoRpcBackend, RecvBufferPoolKeepsBoundedSizeClasses) {
+    auto stats = std::make_shared<detail::RpcRecvBufferPoolStats>();
+    auto pool  = std::make_shared<detail::RpcRecvBufferPool>(stats, 1, 4096);
+    {
+        auto first  = pool->acquire(100);
+        auto second = pool->acquire(0);
+        EXPECT_GE(first.buffer().capacity(), 256U);
+        EXPECT_GE(second.buffer().capacity(), 256U);
+    }
+    // One buffer per class is kept, the other is freed.
+    auto metrics = stats->snapshot();
+    EXPECT_EQ(metrics.misses, 2U);
+    EXPECT_EQ(metrics.dropped, 1U);
+    EXPECT_EQ(metrics.leased_bytes, 0U);
+    EXPECT_GT(metrics.pooled_bytes, 0U);
+    {
+        auto reused = pool->acquire(200);
+        EXPECT_TRUE(reused.buffer().empty());
+        auto large = pool->acquire(3000);
+        EXPECT_GE(large.buffer().capacity(), 3000U);
+        large.buffer().resize(10000); // grown past the largest class, so not kept
+    }
+    metrics = stats->snapshot();
+    EXPECT_EQ(metrics.hits, 1U);
+    EXPECT_EQ(metrics.dropped, 2U);
+    pool.reset();
+    EXPECT_EQ(stats->snapshot().pooled_bytes, 0U);
+}
+
+namespace {
+
+/// @p size bytes of a repeating alphabet, so a chunk that lands in the wrong place fails the comparison.
+auto make_payload(std::size_t size) -> std::string {
+    std::string payload(size, 'x');
+    for (std::size_t idx = 0; idx < payload.size(); ++idx) {
+        payload[idx] = static_cast<char>('a' + (idx % 26));
+    }
+    return payload;
+}
+
+// Each transport connects a server to a client and picks how hard the shared test pushes it: KCalls small calls,
+// then one echo of KEchoBytes sized to reach the transport's large-message path.
+
+/// In-process duplex stream.
+struct DuplexTransport {
+    static constexpr int KCalls             = 20;
+    static constexpr std::size_t KEchoBytes = 16U * 1024U;
+
+    template <typename Server, typename Client>
+    auto connect(Server& server, Client& client) -> ::testing::AssertionResult {
+        connect_endpoint(server, client);
+        return ::testing::AssertionSuccess();
+    }
+};
+
+#if defined(__linux__)
+/// The calls go round a 4 KiB ring several times, so some frames wrap around its end. The echo is many times the
+/// ring size, so both frames are streamed through as several records.
+struct ShmTransport {
+    static constexpr int KCalls             = 200;
+    static constexpr std::size_t KEchoBytes = 64U * 1024U;
+
+    template <typename Server, typename Client>
+    auto connect(Server& server, Client& client) -> ::testing::AssertionResult {
+        auto pair = detail::ShmMessageEndpoint::createPair(4096);
+        if (!pair) {
+            return ::testing::AssertionFailure() << pair.error().message();
+        }
+        server.addEndpoint(std::move(pair.value().first));
+        client.setEndpoint(std::move(pair.value().second));
+        return ::testing::AssertionSuccess();
+    }
+};
+
+/// Batched UDP, the echo still fits one datagram.
+struct UdpBatchTransport {
+    static constexpr int KCalls             = 50;
+    static constexpr std::size_t KEchoBytes = 1024U;
+
+    template <typename Server, typename Client>
+    auto connect(Server& server, Client& client) -> ::testing::AssertionResult {
+        detail::UdpBatchMessageEndpoint::Options options;
+        options.batch_size = 8;
+        // Port bases sit 10 apart: NEKO_CPP_PLUS steps by 3 between the standards
+        // a test run may build side by side, so closer bases would collide.
+        const auto serverAddress = "127.0.0.1:" + std::to_string(12380 + NEKO_CPP_PLUS);
+        const auto clientAddress = "127.0.0.1:" + std::to_string(12381 + NEKO_CPP_PLUS);
+        auto serverEndpoint      = detail::UdpBatchMessageEndpoint::open(serverAddress, clientAddress, options);
+        if (!serverEndpoint) {
+            return ::testing::AssertionFailure() << serverEndpoint.error().message();
+        }
+        auto clientEndpoint = detail::UdpBatchMessageEndpoint::open(clientAddress, serverAddress, options);
+        if (!clientEndpoint) {
+            return ::testing::AssertionFailure() << clientEndpoint.error().message();
+        }
+        server.addEndpoint(std::move(serverEndpoint.value()));
+        client.setEndpoint(std::move(clientEndpoint.value()));
+        return ::testing::AssertionSuccess();
+    }
+};
+
+/// Unix socket through the listener. The echo is above the default memfd threshold both ways, the calls go inline.
+struct UnixMemfdTransport {
+    static constexpr int KCalls             = 50;
+    static constexpr std::size_t KEchoBytes = 2U * 1024U * 1024U;
+
+    template <typename Server, typename Client>
+    auto connect(Server& server, Client& client) -> ::testing::AssertionResult {
+        const auto path = "@nekoproto-rpc-test-" + std::to_string(NEKO_CPP_PLUS);
+        auto listener   = detail::UnixMemfdListener::bind(path);
+        if (!listener) {
+            return ::testing::AssertionFailure() << listener.error().message();
+        }
+        auto clientEndpoint = detail::make_unix_stream_client("unix://" + path).wait();
+        if (!clientEndpoint) {
+            return ::testing::AssertionFailure() << clientEndpoint.error().message();
+        }
+        auto serverEndpoint = listener.value().accept().wait();
+        if (!serverEndpoint) {
+            return ::testing::AssertionFailure() << serverEndpoint.error().message();
+        }
+        server.addEndpoint(std::move(serverEndpoint.value()));
+        client.setEndpoint(std::move(clientEndpoint.value()));
+        return ::testing::AssertionSuccess();
+    }
+};
+#endif
+
+#if defined(NEKO_IO_URING_STREAM)
+/// A small buffer ring, so the echo spans many buffers and runs the ring dry.
+struct IoUringTransport {
+    static constexpr int KCalls             = 50;
+    static constexpr std::size_t KEchoBytes = 128U * 1024U;
+
+    static auto available() -> bool { return detail::IoUringContext::instance() != nullptr; }
+
+    template <typename Server, typename Client>
+    auto connect(Server& server, Client& client) -> ::testing::AssertionResult {
+        detail::IoUringStream::Options options;
+        options.buffer_count = 8;
+        options.buffer_bytes = 4096;
+        const auto address   = "127.0.0.1:" + std::to_string(12400 + NEKO_CPP_PLUS);
+        auto listener        = detail::IoUringListener::bind(address);
+        if (!listener) {
+            return ::testing::AssertionFailure() << listener.error().message();
+        }
+        auto clientStream = detail::IoUringStream::connect(address, options).wait();
+        if (!clientStream) {
+            return ::testing::AssertionFailure() << clientStream.error().message();
+        }
+        auto serverStream = listener.value().accept(options).wait();
+        if (!serverStream) {
+            return ::testing::AssertionFailure() << serverStream.error().message();
+        }
+        server.addEndpoint(std::move(serverStream.value()));
+        client.setEndpoint(std::move(clientStream.value()));
+        return ::testing::AssertionSuccess();
+    }
+};
+#endif
+
+/// Fragmented UDP with selective acks, the echo is far beyond one datagram in both directions.
+struct FragmentedUdpTransport {
+    static constexpr int KCalls             = 20;
+    static constexpr std::size_t KEchoBytes = 256U * 1024U;
+
+    template <typename Server, typename Client>
+    auto connect(Server& server, Client& client) -> ::testing::AssertionResult {
+        detail::DatagramFragmentOptions options;
+        options.selective_ack    = true;
+        const auto serverAddress = "127.0.0.1:" + std::to_string(12390 + NEKO_CPP_PLUS);
+        const auto clientAddress = "127.0.0.1:" + std::to_string(12391 + NEKO_CPP_PLUS);
+        auto serverEndpoint =
+            detail::make_fragmented_udp_stream_client("udp://" + serverAddress + "-" + clientAddress, options).wait();
+        if (!serverEndpoint) {
+            return ::testing::AssertionFailure() << serverEndpoint.error().message();
+        }
+        auto clientEndpoint =
+            detail::make_fragmented_udp_stream_client("udp://" + clientAddress + "-" + serverAddress, options).wait();
+        if (!clientEndpoint) {
+            return ::testing::AssertionFailure() << clientEndpoint.error().message();
+        }
+        server.addEndpoint(std::move(serverEndpoint.value()));
+        client.setEndpoint(std::move(clientEndpoint.value()));
+        return ::testing::AssertionSuccess();
+    }
+};
+
+template <typename Transport>
+class NekoRpcTransport : public ::testing::Test {
+protected:
+    Transport transport;
+};
+
+using RpcTransports = ::testing::Types<DuplexTransport,
+#if defined(__linux__)
+                                       ShmTransport, UdpBatchTransport, UnixMemfdTransport,
+#endif
+#if defined(NEKO_IO_URING_STREAM)
+                                       IoUringTransport,
+#endif
+                                       FragmentedUdpTransport>;
+
+#if defined(__linux__)
+/// Write one raw unix memfd endpoint header, with @p memfd attached when it is set.
+auto send_unix_header(int socket, std::uint64_t header, int memfd = -1) -> bool {
+    std::array<std::byte, 8> bytes{};
+    for (std::size_t idx = 0; idx < bytes.size(); ++idx) {
+        bytes[idx] = static_cast<std::byte>((header >> (8U * idx)) & 0xFFU);
+    }
+    iovec iov{bytes.data(), bytes.size()};
+    alignas(cmsghdr) std::array<unsigned char, CMSG_SPACE(sizeof(int))> control{};
+    msghdr message{};
+    message.msg_iov    = &iov;
+    message.msg_iovlen = 1;
+    if (memfd >= 0) {
+        message.msg_control    = control.data();
+        message.msg_controllen = control.size();
+        auto* cmsg             = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level       = SOL_SOCKET;
+        cmsg->cmsg_type        = SCM_RIGHTS;
+        cmsg->cmsg_len         = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+    }
+    return ::sendmsg(socket, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(bytes.size());
+}
+#endif
+
+} // namespace
+
+TYPED_TEST_SUITE(NekoRpcTransport, RpcTransports);
+
+TYPED_TEST(NekoRpcTransport, CarriesCallsAndLargeMessages) {
+    if constexpr (requires { TypeParam::available(); }) {
+        if (!TypeParam::available()) {
+            GTEST_SKIP() << "transport is not available";
+        }
+    }
+    ilias::PlatformContext context;
+    context.install();
+    RpcServer<BinaryRpcBackend, BinaryRpcTestApi> server{context};
+    RpcClient<BinaryRpcBackend, BinaryRpcTestApi> client{context};
+    ASSERT_TRUE(this->transport.connect(server, client));
+
+    server->add = [](int lhs, int rhs) -> ilias::IoTask<int> { co_return lhs + rhs; };
+    server.bindMethod("echo", traits::FunctionT<ilias::IoTask<std::string>(std::string)>(
+                                  [](std::string value) -> ilias::IoTask<std::string> { co_return value; }));
+
+    for (int idx = 0; idx < TypeParam::KCalls; ++idx) {
+        auto result = client->add(idx, 22).wait();
+        ASSERT_TRUE(result.has_value()) << result.error().message();
+        EXPECT_EQ(result.value(), idx + 22);
+    }
+    const auto payload = make_payload(TypeParam::KEchoBytes);
+    auto echoed        = client.callRemote<std::string>("echo", payload).wait();
+    ASSERT_TRUE(echoed.has_value()) << echoed.error().message();
+    EXPECT_EQ(echoed.value(), payload);
+    auto result = client->add(1, 2).wait();
     ASSERT_TRUE(result.has_value()) << result.error().message();
-    EXPECT_EQ(result.value(), 42);
+    EXPECT_EQ(result.value(), 3);
+
+    // The server closes first, while its receive loop is asleep on a live peer; it must not wait for the client.
+    server.close();
+    client.close();
+}
+
+#if defined(__linux__)
+TEST(NekoRpcBackend, SharedMemoryRingRejectsCorruptControlAndLengthPrefix) {
+    alignas(64) std::array<std::byte, detail::ShmRing::regionBytes(detail::ShmRing::KMinCapacity)> memory{};
+    detail::ShmRing ring(memory.data(), detail::ShmRing::KMinCapacity, true);
+    detail::ShmRing::Record record;
+    // head runs further ahead of tail than the ring holds, or not even a length prefix ahead.
+    ring.control().head.store(ring.capacity() + 1U);
+    EXPECT_EQ(ring.peek(record), detail::ShmRing::PeekStatus::Corrupt);
+    ring.control().head.store(detail::ShmRing::KLengthBytes - 1U);
+    EXPECT_EQ(ring.peek(record), detail::ShmRing::PeekStatus::Corrupt);
+    // A length prefix larger than one record may be.
+    ring.control().head.store(0);
+    const std::vector<std::byte> body(ring.maxRecordBytes());
+    ASSERT_TRUE(ring.tryWrite(body, false));
+    memory[sizeof(detail::ShmRing::Control)] = std::byte{0xFF};
+    EXPECT_EQ(ring.peek(record), detail::ShmRing::PeekStatus::Corrupt);
+
+    // Through the endpoint: a prefix that claims more than the producer wrote fails the recv.
+    ilias::PlatformContext context;
+    context.install();
+    auto pair = detail::ShmMessageEndpoint::createPair(4096);
+    ASSERT_TRUE(pair.has_value()) << pair.error().message();
+    auto& [sender, receiver] = pair.value();
+    const auto handles       = sender.handles();
+    const auto regionBytes   = 2U * detail::ShmRing::regionBytes(handles.capacity);
+    // A second mapping stands in for a peer that scribbles over the shared memory.
+    void* region = ::mmap(nullptr, regionBytes, PROT_READ | PROT_WRITE, MAP_SHARED, handles.memory, 0);
+    ASSERT_NE(region, MAP_FAILED);
+    const std::array<std::byte, 3> message{std::byte{1}, std::byte{2}, std::byte{3}};
+    ASSERT_TRUE(sender.send(message).wait().has_value());
+    static_cast<std::byte*>(region)[sizeof(detail::ShmRing::Control)] = std::byte{0x40};
+    std::vector<std::byte> buffer;
+    auto received = receiver.recv(buffer).wait();
+    ASSERT_FALSE(received.has_value());
+    EXPECT_EQ(received.error(), std::make_error_code(std::errc::bad_message));
+    ::munmap(region, regionBytes);
+}
 
-    auto result2 = client->rpc.getMethodInfoList().wait();
-    ASSERT_TRUE(result2.has_value()) << result2.error().message();
-    EXPECT_EQ(result2.value().size(), 2 + (RpcServer<BinaryRpcBackend>::BuiltinMethodsCount));
-    for (auto& method : result2.value()) {
-        std::cout << "method: " << method << std::endl;
+TEST(NekoRpcBackend, UnixMemfdEndpointKeepsLargeMessagesMappedPastTheNextRecv) {
+    ilias::PlatformContext context;
+    context.install();
+    auto pair = detail::UnixMemfdMessageEndpoint::createPair();
+    ASSERT_TRUE(pair.has_value()) << pair.error().message();
+    auto& [sender, receiver] = pair.value();
+
+    // Above the default memfd threshold, then a message small enough to go inline.
+    const auto payload = make_payload(2 * 1024 * 1024);
+    const auto bytes   = std::as_bytes(std::span(payload));
+    auto sent          = sender.send(bytes).wait();
+    ASSERT_TRUE(sent.has_value()) << sent.error().message();
+    std::vector<std::byte> scratch;
+    auto held = receiver.recvHeld(scratch).wait();
+    ASSERT_TRUE(held.has_value()) << held.error().message();
+    EXPECT_NE(held.value().holder, nullptr);
+    EXPECT_TRUE(scratch.empty());
+    EXPECT_EQ(sender.metrics().memfd_sent, 1U);
+    EXPECT_EQ(receiver.metrics().memfd_received, 1U);
+    const std::array<std::byte, 3> small{std::byte{1}, std::byte{2}, std::byte{3}};
+    ASSERT_TRUE(sender.send(small).wait().has_value());
+    auto inlined = receiver.recvHeld(scratch).wait();
+    ASSERT_TRUE(inlined.has_value()) << inlined.error().message();
+    EXPECT_EQ(inlined.value().holder, nullptr);
+    EXPECT_EQ(receiver.metrics().memfd_received, 1U);
+    EXPECT_TRUE(std::ranges::equal(held.value().bytes, bytes));
+    held.value().holder.reset();
+}
+
+TEST(NekoRpcBackend, UnixMemfdEndpointRejectsOversizedInlineFrames) {
+    ilias::PlatformContext context;
+    context.install();
+    std::array<int, 2> fds{-1, -1};
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds.data()), 0);
+    detail::UnixMemfdOptions options;
+    options.memfd_threshold = 4096;
+    auto receiver           = detail::UnixMemfdMessageEndpoint::adopt(fds[0], options);
+    ASSERT_TRUE(receiver.has_value()) << receiver.error().message();
+    // The header alone fails the recv, before any of the announced body is buffered.
+    ASSERT_TRUE(send_unix_header(fds[1], options.memfd_threshold));
+    std::vector<std::byte> buffer;
+    auto received = receiver.value().recv(buffer).wait();
+    ASSERT_FALSE(received.has_value());
+    EXPECT_EQ(received.error(), make_error_code(ilias::IoError::MessageTooLarge));
+    ::close(fds[1]);
+}
+
+TEST(NekoRpcBackend, UnixMemfdEndpointRejectsMemfdsWithoutWriteAndShrinkSeals) {
+    ilias::PlatformContext context;
+    context.install();
+    std::array<int, 2> fds{-1, -1};
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds.data()), 0);
+    auto receiver = detail::UnixMemfdMessageEndpoint::adopt(fds[0]);
+    ASSERT_TRUE(receiver.has_value()) << receiver.error().message();
+    constexpr std::uint64_t kMemfdFlag = std::uint64_t{1} << 63U;
+    constexpr std::size_t kSize        = 4096;
+    // No seals at all, then a shrink seal without the write seal: the sender could still change the message.
+    const int unsealed = ::memfd_create("nekoproto-test", MFD_CLOEXEC);
+    const int shrinkOnly = ::memfd_create("nekoproto-test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    ASSERT_GE(unsealed, 0);
+    ASSERT_GE(shrinkOnly, 0);
+    ASSERT_EQ(::ftruncate(unsealed, kSize), 0);
+    ASSERT_EQ(::ftruncate(shrinkOnly, kSize), 0);
+    ASSERT_EQ(::fcntl(shrinkOnly, F_ADD_SEALS, F_SEAL_SHRINK), 0);
+    std::vector<std::byte> buffer;
+    for (const int memfd : {unsealed, shrinkOnly}) {
+        ASSERT_TRUE(send_unix_header(fds[1], kMemfdFlag | kSize, memfd));
+        ::close(memfd);
+        auto received = receiver.value().recv(buffer).wait();
+        ASSERT_FALSE(received.has_value());
+        EXPECT_EQ(received.error(), make_error_code(ilias::IoError::InvalidArgument));
+    }
+    EXPECT_EQ(receiver.value().metrics().memfd_received, 0U);
+    ::close(fds[1]);
+}
+#endif
+
+TEST(NekoRpcBackend, FragmentedEndpointDropsFragmentsWhoseTotalDiffers) {
+    ilias::PlatformContext context;
+    context.install();
+    // One payload byte per datagram, so a 3-byte message is three fragments.
+    detail::DatagramFragmentOptions options;
+    options.max_datagram_bytes = detail::FragmentedDatagramMessageEndpoint<ScriptedDatagram, int>::KTrailerBytes + 1U;
+    ScriptedDatagram datagram;
+    auto script = datagram.script;
+    detail::FragmentedDatagramMessageEndpoint<ScriptedDatagram, int> endpoint(std::move(datagram), 1, options);
+    const auto byte = [](char value) { return std::vector<std::byte>{static_cast<std::byte>(value)}; };
+    // The second datagram reuses the live id with a total whose index lies far past the first message's buffers.
+    script->inbox.emplace_back(fragment_datagram(0xD1, 7, 3, 0, byte('a')), 1);
+    script->inbox.emplace_back(fragment_datagram(0xD1, 7, 1000, 900, byte('x')), 1);
+    script->inbox.emplace_back(fragment_datagram(0xD1, 7, 3, 1, byte('b')), 1);
+    script->inbox.emplace_back(fragment_datagram(0xD1, 7, 3, 2, byte('c')), 1);
+
+    std::vector<std::byte> buffer;
+    auto received = endpoint.recv(buffer).wait();
+    ASSERT_TRUE(received.has_value()) << received.error().message();
+    EXPECT_EQ(received.value(), 3U);
+    EXPECT_EQ(buffer, (std::vector<std::byte>{std::byte{'a'}, std::byte{'b'}, std::byte{'c'}}));
+    EXPECT_EQ(endpoint.metrics().dropped_fragments, 1U);
+}
+
+TEST(NekoRpcBackend, FragmentedEndpointIgnoresAcksFromOtherPeers) {
+    ilias::PlatformContext context;
+    context.install();
+    detail::DatagramFragmentOptions options;
+    options.selective_ack      = true;
+    options.max_datagram_bytes = detail::FragmentedDatagramMessageEndpoint<ScriptedDatagram, int>::KTrailerBytes + 1U;
+    ScriptedDatagram datagram;
+    auto script = datagram.script;
+    detail::FragmentedDatagramMessageEndpoint<ScriptedDatagram, int> endpoint(std::move(datagram), 1, options);
+    const std::array<std::byte, 3> message{std::byte{1}, std::byte{2}, std::byte{3}};
+    ASSERT_TRUE(endpoint.send(message).wait().has_value());
+    ASSERT_EQ(script->sent.size(), 3U);
+    // Each sent datagram is one payload byte followed by the trailer, whose id starts at offset 4.
+    std::uint32_t id = 0;
+    for (std::size_t idx = 0; idx < 4U; ++idx) {
+        id |= static_cast<std::uint32_t>(script->sent.front().first[1U + 4U + idx]) << (idx * 8U);
     }
+    script->sent.clear();
+
+    // An empty bitmap reports every fragment missing. Peer 2 never received the message, only peer 1's ack counts.
+    script->inbox.emplace_back(fragment_datagram(0xA1, id, 3, 0, {std::byte{0}}), 2);
+    script->inbox.emplace_back(fragment_datagram(0xA1, id, 3, 0, {std::byte{0}}), 1);
+    std::vector<std::byte> buffer;
+    EXPECT_FALSE(endpoint.recv(buffer).wait().has_value());
+    EXPECT_EQ(endpoint.metrics().fragments_resent, 3U);
+    ASSERT_EQ(script->sent.size(), 3U);
+    for (const auto& [bytes, destination] : script->sent) {
+        EXPECT_EQ(destination, 1);
+    }
+}
 
+TEST(NekoRpcBackend, LocalEndpointSkipsFramesButKeepsTimeoutAndCancellation) {
+    using namespace std::chrono_literals;
+    ilias::PlatformContext context;
+    context.install();
+    BinaryRpcBackend::Options options;
+    options.request_timeout = 100ms;
+    RpcServer<BinaryRpcBackend, BinaryRpcTestApi> server{context, options};
+    RpcClient<BinaryRpcBackend, BinaryRpcTestApi> client{context, options};
+    client.setEndpoint(server.connectLocal(RpcPeerInfo{.id = "in-process", .attributes = {}}));
+    ASSERT_TRUE(client.isConnected());
+
+    server->add = [](int delayMs, int value) -> ilias::IoTask<int> {
+        co_await ilias::sleep(std::chrono::milliseconds(delayMs));
+        co_return value;
+    };
+    std::string peerId;
+    server.bindMethodWithContext<"value">(
+        "context.echo", traits::FunctionT<ilias::IoTask<std::string>(const RpcRequestContext&, std::string)>(
+                            [&peerId](const RpcRequestContext& requestContext,
+                                      std::string value) -> ilias::IoTask<std::string> {
+                                peerId = requestContext.peer().id;
+                                co_return value;
+                            }));
+
+    auto result = client->add(0, 42).wait();
+    ASSERT_TRUE(result.has_value()) << result.error().message();
+    EXPECT_EQ(result.value(), 42);
+
+    auto echoed = client.callRemote<std::string>("context.echo", std::string(4096, 'x')).wait();
+    ASSERT_TRUE(echoed.has_value()) << echoed.error().message();
+    EXPECT_EQ(echoed.value().size(), 4096U);
+    EXPECT_EQ(peerId, "in-process");
+
+    auto timedOut = client->add(300, 1).wait();
+    ASSERT_FALSE(timedOut.has_value());
+    EXPECT_EQ(timedOut.error(), make_error_code(RpcError::DeadlineExceeded));
+    EXPECT_EQ(server.metrics().timed_out, 1U);
+
+    RpcCallOptions timeoutOptions;
+    timeoutOptions.timeout = 10ms;
+    auto abandoned = client.callRemoteWithOptions(client->add, timeoutOptions, 60, 1).wait();
+    ASSERT_FALSE(abandoned.has_value());
+    EXPECT_EQ(abandoned.error(), make_error_code(RpcError::DeadlineExceeded));
+    EXPECT_TRUE(wait_until([&] { return server.metrics().canceled == 1U && server.metrics().active == 0U; }));
+
+    server.close();
+    EXPECT_FALSE(client.isConnected());
+    auto closed = client->add(0, 1).wait();
+    ASSERT_FALSE(closed.has_value());
     client.close();
+}
+
+TEST(NekoRpcBackend, LocalEndpointEncodesCallsWhoseDeclarationDiffers) {
+    ilias::PlatformContext context;
+    context.install();
+    RpcServer<JsonSerializedRpcBackend> server{context};
+    RpcClient<JsonSerializedRpcBackend> client{context};
+    client.setEndpoint(server.connectLocal());
+
+    server.bindMethod("scale", traits::FunctionT<ilias::IoTask<std::int64_t>(std::int64_t, double)>(
+                                   [](std::int64_t value, double factor) -> ilias::IoTask<std::int64_t> {
+                                       co_return static_cast<std::int64_t>(static_cast<double>(value) * factor);
+                                   }));
+
+    // int and float are not the declared int64_t and double, so the call is
+    // encoded and the codec converts the values instead of the call failing.
+    auto widened = client.callRemote<std::int64_t>("scale", 21, 2.0F).wait();
+    ASSERT_TRUE(widened.has_value()) << widened.error().message();
+    EXPECT_EQ(widened.value(), 42);
+
+    auto narrowed = client.callRemote<int>("scale", std::int64_t{5}, 3.0).wait();
+    ASSERT_TRUE(narrowed.has_value()) << narrowed.error().message();
+    EXPECT_EQ(narrowed.value(), 15);
+
+    auto exact = client.callRemote<std::int64_t>("scale", std::int64_t{4}, 0.5).wait();
+    ASSERT_TRUE(exact.has_value()) << exact.error().message();
+    EXPECT_EQ(exact.value(), 2);
+
+    // Values the codec cannot convert still fail like they would on the wire.
+    auto invalid = client.callRemote<std::int64_t>("scale", std::string("x"), 1.0).wait();
+    EXPECT_FALSE(invalid.has_value());
+
     server.close();
+    client.close();
 }
 
 TEST(NekoRpcBackend, ContextAwareBindingExposesCurrentInvocationAndProviderPeerInfo) {
@@ -1240,6 +1816,69 @@ TEST(NekoRpcBackend, CompressionExtensionsRoundTripNegotiationContext) {
     EXPECT_EQ(minSize, 256U);
 }
 
+TEST(NekoRpcBackend, FrameHeaderUsesFixedOffsetsAndExtensionsStaySorted) {
+    rpc::NekoRpcFrameCodec::Header header{.kind = rpc::NekoRpcKind::Notify, .codec = 2U, .id = 0x0102030405060708ULL};
+    header.payload_size = 0x0A0B0C0DU;
+    const auto wire     = rpc::NekoRpcFrameCodec::packHeader(header);
+    EXPECT_EQ(wire[0], std::byte{'N'});
+    EXPECT_EQ(wire[3], static_cast<std::byte>(rpc::NekoRpcKind::Notify));
+    EXPECT_EQ(wire[8], std::byte{0x01});
+    EXPECT_EQ(wire[23], std::byte{0x0D});
+    const auto parsed = rpc::NekoRpcFrameCodec::unpackHeader(wire);
+    EXPECT_EQ(parsed.id, header.id);
+    EXPECT_EQ(parsed.payload_size, header.payload_size);
+    EXPECT_EQ(rpc::NekoRpcFrameCodec::headerSize(), rpc::NekoRpcFrameCodec::HeaderBytes);
+
+    // More entries than fit inline, inserted out of order, still encode in type order and load back.
+    const auto value = rpc::NekoRpcExtensionCodec::integerValue<std::uint16_t>(7);
+    rpc::NekoRpcFrameCodec::ExtensionMapType extensions;
+    for (const int type : {12, 3, 9, 1, 11, 5, 7, 2, 10, 4}) {
+        EXPECT_TRUE(extensions.emplace(static_cast<rpc::NekoRpcExtensionType>(type),
+                                       rpc::NekoRpcExtensionCodec::asBytes(value))
+                        .second);
+    }
+    EXPECT_FALSE(extensions.emplace(rpc::NekoRpcExtensionType::MethodId, {}).second);
+    ASSERT_EQ(extensions.size(), 10U);
+
+    rpc::NekoRpcFrameCodec::MessageType bytes;
+    ASSERT_TRUE(rpc::NekoRpcExtensionCodec::appendTlvs(bytes, extensions));
+    rpc::NekoRpcFrameCodec::ExtensionMapType parsedExtensions;
+    ASSERT_TRUE(rpc::NekoRpcExtensionCodec::loadTlvs(rpc::NekoRpcExtensionCodec::asBytes(bytes), parsedExtensions));
+    ASSERT_EQ(parsedExtensions.size(), 10U);
+    std::uint16_t previous = 0;
+    for (const auto& [type, data] : parsedExtensions) {
+        EXPECT_GT(static_cast<std::uint16_t>(type), previous);
+        EXPECT_EQ(data.size(), sizeof(std::uint16_t));
+        previous = static_cast<std::uint16_t>(type);
+    }
+
+    const rpc::NekoRpcFrameCodec::MessageType firstTlv(bytes.begin(), bytes.begin() + 6);
+    bytes.insert(bytes.end(), firstTlv.begin(), firstTlv.end());
+    EXPECT_FALSE(rpc::NekoRpcExtensionCodec::loadTlvs(rpc::NekoRpcExtensionCodec::asBytes(bytes), parsedExtensions));
+}
+
+TEST(NekoRpcBackend, ExtensionDecodeScalesToFullExtensionBlock) {
+    // As many empty TLVs as the 16-bit extension size allows, in descending
+    // type order, which was the worst case for sorted insertion.
+    constexpr auto count = static_cast<std::uint16_t>(rpc::NekoRpcFrameCodec::MaxExtensionBytes / 4U);
+    rpc::NekoRpcFrameCodec::MessageType bytes;
+    for (std::uint16_t type = count; type > 0U; --type) {
+        rpc::NekoRpcExtensionCodec::appendInteger(bytes, type);
+        rpc::NekoRpcExtensionCodec::appendInteger(bytes, std::uint16_t{0});
+    }
+    rpc::NekoRpcFrameCodec::ExtensionMapType parsed;
+    ASSERT_TRUE(rpc::NekoRpcExtensionCodec::loadTlvs(rpc::NekoRpcExtensionCodec::asBytes(bytes), parsed));
+    ASSERT_EQ(parsed.size(), count);
+    EXPECT_TRUE(std::is_sorted(parsed.begin(), parsed.end(),
+                               [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; }));
+    EXPECT_TRUE(parsed.contains(static_cast<rpc::NekoRpcExtensionType>(count)));
+
+    // A repeat far from its first occurrence is still caught.
+    rpc::NekoRpcExtensionCodec::appendInteger(bytes, count);
+    rpc::NekoRpcExtensionCodec::appendInteger(bytes, std::uint16_t{0});
+    EXPECT_FALSE(rpc::NekoRpcExtensionCodec::loadTlvs(rpc::NekoRpcExtensionCodec::asBytes(bytes), parsed));
+}
+
 TEST(NekoRpcBackend, CompressionCodecRunLengthShrinksAndRestoresPayload) {
     rpc::NekoRpcFrameCodec::MessageType payload(512, static_cast<std::byte>('A'));
     auto compressed = rpc::NekoRpcCompressionCodec::compress(rpc::NekoRpcExtensionCodec::asBytes(payload),
@@ -1290,6 +1929,79 @@ TEST(NekoRpcBackend, FrameLimitsApplyToBackendOwnedEncodeAndDirectDecodePaths) {
     EXPECT_FALSE(BinaryRpcBackend::decodeIncoming(limitedServer, limitedServerSession, asBytes(request->message)).ok);
 }
 
+TEST(NekoRpcBackend, ResponseSegmentsMatchFlatFrameWithoutCopyingPayload) {
+    std::vector<detail::RpcMethodMetadata> methods{add_metadata("i32 add(i32 a, i32 b)")};
+    auto context = BinaryRpcBackend::makeServerContext(BinaryRpcBackend::Options{}, methods);
+    auto session = BinaryRpcBackend::makeServerPeerSession(context);
+
+    BinaryRpcBackend::DecodedRequest request;
+    request.header.kind = rpc::NekoRpcKind::Request;
+    request.header.id   = 7;
+    BinaryRpcBackend::ResponseValues responses;
+    BinaryRpcBackend::appendError(responses, request, RpcError::MethodNotFound);
+    ASSERT_EQ(responses.size(), 1U);
+
+    auto segments = BinaryRpcBackend::encodeResponseSegments(context, session, responses, false);
+    ASSERT_TRUE(segments.has_value());
+    const auto pieces = segments->segments();
+    EXPECT_EQ(pieces.front().size(), rpc::NekoRpcFrameCodec::headerSize());
+    EXPECT_EQ(pieces.back().data(), reinterpret_cast<const std::byte*>(responses.front().payload.data()));
+
+    const auto flat = BinaryRpcBackend::encodeResponses(context, session, responses, false);
+    EXPECT_EQ(segments->size(), flat.size());
+    EXPECT_EQ(segments->frame.flatten(), flat);
+    EXPECT_TRUE(BinaryRpcBackend::validateMessage(context, asBytes(flat)).has_value());
+
+    responses.clear();
+    EXPECT_FALSE(BinaryRpcBackend::encodeResponseSegments(context, session, responses, false).has_value());
+}
+
+TEST(NekoRpcBackend, DecodedRequestBorrowsReceivedFrame) {
+    BinaryRpcTestApi api;
+    api.add.setRemoteName("add");
+
+    std::vector<detail::RpcMethodMetadata> methods{add_metadata("i32 add(i32 a, i32 b)")};
+    auto serverContext = BinaryRpcBackend::makeServerContext(BinaryRpcBackend::Options{}, methods);
+    auto serverSession = BinaryRpcBackend::makeServerPeerSession(serverContext);
+    auto clientContext = BinaryRpcBackend::makeClientContext();
+    auto clientSession = BinaryRpcBackend::makeClientPeerSession(clientContext);
+    auto request = BinaryRpcBackend::encodeRequest(clientContext, clientSession, api.add, false, 20, 22);
+    ASSERT_TRUE(request.has_value()) << request.error().message();
+
+    const auto frame = asBytes(request->message);
+    const auto inFrame = [&frame](const void* data) {
+        const auto* byte = static_cast<const std::byte*>(data);
+        return byte >= frame.data() && byte < frame.data() + frame.size();
+    };
+    auto decoded = BinaryRpcBackend::decodeIncoming(serverContext, serverSession, frame);
+    ASSERT_TRUE(decoded.ok);
+    ASSERT_EQ(decoded.requests.size(), 1U);
+    const auto& named = decoded.requests.front();
+    EXPECT_EQ(BinaryRpcBackend::methodName(named), "add");
+    EXPECT_TRUE(inFrame(BinaryRpcBackend::methodName(named).data()));
+    EXPECT_TRUE(inFrame(BinaryRpcBackend::Codec::payload(named).data()));
+    EXPECT_FALSE(named.owned_method.has_value());
+    EXPECT_FALSE(named.owned_payload.has_value());
+    auto params = BinaryRpcBackend::decodeParams(named, api.add);
+    ASSERT_TRUE(params.has_value());
+    EXPECT_EQ(*params, std::make_tuple(20, 22));
+
+    // A name resolved from a method id is not in the frame, so the request owns it.
+    serverSession.method_id_enabled = true;
+    clientSession.method_id_enabled = true;
+    clientSession.remote_method_table.reset(method_entries(serverContext.method_table),
+                                            serverContext.method_table.version());
+    auto byId = BinaryRpcBackend::encodeRequest(clientContext, clientSession, api.add, false, 1, 2);
+    ASSERT_TRUE(byId.has_value()) << byId.error().message();
+    decoded = BinaryRpcBackend::decodeIncoming(serverContext, serverSession, asBytes(byId->message));
+    ASSERT_TRUE(decoded.ok);
+    ASSERT_EQ(decoded.requests.size(), 1U);
+    auto resolved = std::move(decoded.requests.front());
+    ASSERT_TRUE(resolved.owned_method.has_value());
+    EXPECT_EQ(BinaryRpcBackend::methodName(resolved), "add");
+    EXPECT_EQ(BinaryRpcBackend::Codec::payload(resolved).data(), resolved.payload.data());
+}
+
 TEST(NekoRpcBackend, RequireCompressionCallsThroughCompressedPayloads) {
     ilias::PlatformContext context;
     context.install();
@@ -1480,6 +2192,10 @@ TEST(NekoRpcBackend, BuiltinMethodsAvailableOnClientByDefault) {
     EXPECT_TRUE(contains(methods.value(), "rpc.get_connection_status"));
     EXPECT_TRUE(contains(methods.value(), "rpc.get_connection_tasks"));
 
+    auto infoList = client->rpc.getMethodInfoList().wait();
+    ASSERT_TRUE(infoList.has_value()) << infoList.error().message();
+    EXPECT_EQ(infoList.value().size(), static_cast<std::size_t>(RpcServer<BinaryRpcBackend>::BuiltinMethodsCount));
+
     auto method_info = client->rpc.getMethodInfo("rpc.get_method_list").wait();
     ASSERT_TRUE(method_info.has_value()) << method_info.error().message();
 
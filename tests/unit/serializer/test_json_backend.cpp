@@ -2,11 +2,13 @@
 #include <array>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
 #include <optional>
 #include <set>
+#include <sstream>
 #include <string>
 #include <tuple>
 #include <variant>
@@ -14,11 +16,13 @@
 
 #include <gtest/gtest.h>
 
+#include "nekoproto/serialization/binary_serializer.hpp"
 #include "nekoproto/serialization/json_serializer.hpp"
 #include "nekoproto/serialization/parsing/atomic.hpp"
 #include "nekoproto/serialization/parsing/optional.hpp"
 #include "nekoproto/serialization/reflection.hpp"
 #include "nekoproto/serialization/serializer_base.hpp"
+#include "nekoproto/serialization/transcode.hpp"
 
 NEKO_USE_NAMESPACE
 
@@ -539,4 +543,122 @@ TEST(RapidJsonBackendParser, InvalidRawStringReportsParseError) {
     EXPECT_NE(out.error()->msg.find("Invalid raw value"), std::string::npos);
 }
 
+TEST(RapidJsonBackendParser, JsonLinesRoundTripsRecordsThroughStream) {
+    std::vector<char> buffer;
+    {
+        JsonSerializer::LinesOutputSerializer out(buffer);
+        for (int index = 0; index < 4; ++index) {
+            ParserBackendSmoke record;
+            record.id = index;
+            if (index % 2 == 0) {
+                record.label = "even";
+            }
+            ASSERT_TRUE(out(record));
+        }
+        EXPECT_EQ(out.recordCount(), 4U);
+    }
+    EXPECT_EQ(as_string(buffer), "{\"id\":0,\"label\":\"even\",\"count\":0}\n"
+                                 "{\"id\":1,\"count\":0}\n"
+                                 "{\"id\":2,\"label\":\"even\",\"count\":0}\n"
+                                 "{\"id\":3,\"count\":0}\n");
+
+    std::istringstream stream(as_string(buffer));
+    JsonSerializer::LinesInputSerializer in(stream);
+    ParserBackendSmoke record;
+    int expected = 0;
+    while (in(record)) {
+        EXPECT_EQ(record.id, expected);
+        EXPECT_EQ(record.label.has_value(), expected % 2 == 0);
+        ++expected;
+    }
+    EXPECT_TRUE(in.eof()) << (in.error() == nullptr ? "" : in.error()->msg);
+    EXPECT_EQ(expected, 4);
+}
+
+TEST(RapidJsonBackendParser, JsonLinesStopsAtSyntaxError) {
+    const std::string lines = "[1,2]\n[3,\n[4]\n";
+    JsonSerializer::LinesInputSerializer in(lines.data(), lines.size());
+    std::vector<int> record;
+
+    ASSERT_TRUE(in(record));
+    EXPECT_EQ(record, (std::vector<int>{1, 2}));
+    EXPECT_FALSE(in(record));
+    ASSERT_NE(in.error(), nullptr);
+    EXPECT_EQ(in.error()->ec, sa::make_error_code(sa::ErrorCode::ParseError));
+    EXPECT_FALSE(in(record));
+    EXPECT_FALSE(in.eof());
+    EXPECT_EQ(in.recordCount(), 1U);
+}
+
+#if defined(NEKO_PROTO_ENABLE_RAPIDJSON)
+namespace {
+struct RapidTranscodeRow {
+    bool ok = false;
+    std::optional<int> count;
+
+    NEKO_SERIALIZER(ok, count)
+};
+
+struct RapidTranscodeMessage {
+    int id = 0;
+    std::string name;
+    std::vector<RapidTranscodeRow> rows;
+    std::uint64_t big = 0;
+
+    NEKO_SERIALIZER(id, name, rows, big)
+};
+} // namespace
+
+TEST(RapidJsonBackendParser, TranscodesJsonThroughBinaryWithoutTypes) {
+    const std::string json =
+        R"({"id":7,"name":"neko","tags":["a","b"],"ratio":0.5,"nested":{"ok":true,"none":null},)"
+        R"("big":18446744073709551615,"neg":-3})";
+    std::vector<char> binary;
+    auto result = transcode<RapidJsonSerializer, BinarySerializer>(json.data(), json.size(), binary);
+    ASSERT_TRUE(result) << result.error().msg;
+
+    std::vector<char> back;
+    result = transcode<BinarySerializer, RapidJsonSerializer>(binary.data(), binary.size(), back);
+    ASSERT_TRUE(result) << result.error().msg;
+    EXPECT_EQ(std::string(back.begin(), back.end()), json);
+}
+
+TEST(RapidJsonBackendParser, SchemaTranscodeMatchesTypedBinaryOutput) {
+    const std::string json =
+        R"({"id":3,"name":"row","rows":[{"ok":true,"count":null},{"ok":false,"count":2}],"big":9,"extra":1})";
+    std::vector<char> transcoded;
+    auto result = transcode<RapidJsonSerializer, BinarySerializer, RapidTranscodeMessage>(json.data(), json.size(),
+                                                                                           transcoded);
+    ASSERT_TRUE(result) << result.error().msg;
+
+    RapidTranscodeMessage message;
+    {
+        RapidJsonSerializer::InputSerializer input(json.data(), json.size());
+        ASSERT_TRUE(input(message)) << (input.error() == nullptr ? "" : input.error()->msg);
+    }
+    std::vector<char> typed;
+    {
+        BinarySerializer::OutputSerializer output(typed);
+        ASSERT_TRUE(output(message));
+    }
+    EXPECT_EQ(transcoded, typed);
+
+    std::vector<char> back;
+    result = transcode<BinarySerializer, RapidJsonSerializer, RapidTranscodeMessage>(transcoded.data(),
+                                                                                      transcoded.size(), back);
+    ASSERT_TRUE(result) << result.error().msg;
+    EXPECT_EQ(std::string(back.begin(), back.end()),
+              R"({"id":3,"name":"row","rows":[{"ok":true},{"ok":false,"count":2}],"big":9})");
+}
+
+TEST(RapidJsonBackendParser, TranscodeReportsInputErrors) {
+    const std::string json = R"({"id":)";
+    std::vector<char> binary;
+    const auto result = transcode<RapidJsonSerializer, BinarySerializer>(json.data(), json.size(), binary);
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().ec, sa::make_error_code(sa::ErrorCode::ParseError));
+    EXPECT_TRUE(binary.empty());
+}
+#endif
+
 #include "../common/common_main.cpp.in" // IWYU pragma: export
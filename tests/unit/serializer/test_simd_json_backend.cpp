@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <optional>
 #include <sstream>
@@ -8,8 +10,10 @@
 
 #ifdef NEKO_PROTO_ENABLE_SIMDJSON
 
+#include "nekoproto/serialization/binary_serializer.hpp"
 #include "nekoproto/serialization/json/simd_json_serializer.hpp"
 #include "nekoproto/serialization/serializer_base.hpp"
+#include "nekoproto/serialization/transcode.hpp"
 
 NEKO_USE_NAMESPACE
 
@@ -33,12 +37,36 @@ struct RawSimdField {
     };
 };
 
+struct SimdKeyFragments {
+    int plain = 0;
+    int quoted = 0;
+    std::map<std::string, int> dynamic;
+
+    NEKO_SERIALIZER(plain, (make_tags<rename_tag<"wire\"name">>(quoted)), dynamic)
+};
+
 struct SimdRequiredField {
     int value = 0;
 
     NEKO_SERIALIZER(value)
 };
 
+struct TranscodeRow {
+    bool ok = false;
+    std::optional<int> count;
+
+    NEKO_SERIALIZER(ok, count)
+};
+
+struct TranscodeMessage {
+    int id = 0;
+    std::string name;
+    std::vector<TranscodeRow> rows;
+    std::uint64_t big = 0;
+
+    NEKO_SERIALIZER(id, name, rows, big)
+};
+
 template <typename T>
 std::string write_json(const T& value) {
     std::vector<char> buffer;
@@ -108,6 +136,24 @@ TEST(SimdJsonBackend, StringKeyMapUsesJsonObject) {
     EXPECT_EQ(decoded, source);
 }
 
+TEST(SimdJsonBackend, ReflectedKeysUsePrecomputedFragments) {
+    static_assert(parsing::supports_key_fragments<detail::simd::Writer>);
+    using Fragments = detail::reflect_key_fragments<json::Key, SimdKeyFragments>;
+    static_assert(Fragments::at(0) == R"("plain":)");
+    static_assert(Fragments::at(1) == R"("wire\"name":)");
+    static_assert(Fragments::at(2) == R"("dynamic":)");
+
+    const SimdKeyFragments source{.plain = 1, .quoted = 2, .dynamic = {{"tab\tkey", 3}}};
+    const auto json = write_json(source);
+    EXPECT_EQ(json, R"({"plain":1,"wire\"name":2,"dynamic":{"tab\tkey":3}})");
+
+    SimdKeyFragments decoded;
+    ASSERT_TRUE(read_json(json, decoded));
+    EXPECT_EQ(decoded.plain, source.plain);
+    EXPECT_EQ(decoded.quoted, source.quoted);
+    EXPECT_EQ(decoded.dynamic, source.dynamic);
+}
+
 TEST(SimdJsonBackend, MissingRequiredFieldReportsContext) {
     const std::string json = R"({})";
     SimdRequiredField decoded;
@@ -156,6 +202,173 @@ TEST(SimdJsonBackend, InvalidJsonReturnsParseError) {
     EXPECT_NE(input.error()->msg.find("simdjson parse error"), std::string::npos);
 }
 
+TEST(SimdJsonBackend, JsonLinesWritesManyRecordsThroughOneSerializer) {
+    std::vector<char> buffer;
+    SimdJsonSerializer::LinesOutputSerializer output(buffer);
+    for (int index = 0; index < 3; ++index) {
+        ASSERT_TRUE(output(SimdSmoke{.id = index, .text = "r" + std::to_string(index), .values = {index}, .optional = {}}));
+    }
+    EXPECT_EQ(output.recordCount(), 3U);
+    EXPECT_EQ(std::string(buffer.begin(), buffer.end()), "{\"id\":0,\"text\":\"r0\",\"values\":[0]}\n"
+                                                         "{\"id\":1,\"text\":\"r1\",\"values\":[1]}\n"
+                                                         "{\"id\":2,\"text\":\"r2\",\"values\":[2]}\n");
+
+    RawSimdField invalid{.payload = R"({"broken":)"};
+    EXPECT_FALSE(output(invalid));
+    ASSERT_TRUE(output(SimdSmoke{.id = 3, .text = {}, .values = {}, .optional = {}}));
+    EXPECT_EQ(output.recordCount(), 4U);
+    EXPECT_EQ(std::count(buffer.begin(), buffer.end(), '\n'), 4);
+}
+
+TEST(SimdJsonBackend, JsonLinesReadsBufferLazily) {
+    const std::string lines = "{\"value\":1}\n\n{\"value\":2}\r\n  \n{\"value\":3}";
+    SimdJsonSerializer::LinesInputSerializer input(lines.data(), lines.size());
+    std::vector<int> decoded;
+    SimdRequiredField record;
+    while (input(record)) {
+        decoded.push_back(record.value);
+    }
+    EXPECT_TRUE(input.eof());
+    EXPECT_EQ(input.error(), nullptr);
+    EXPECT_EQ(decoded, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(input.recordCount(), 3U);
+    EXPECT_FALSE(input(record));
+}
+
+TEST(SimdJsonBackend, JsonLinesStreamsWithBoundedWindow) {
+    std::stringstream stream;
+    {
+        SimdJsonLinesOutputSerializer<std::stringstream> output(stream);
+        for (int index = 0; index < 200; ++index) {
+            const SimdSmoke record{
+                .id = index, .text = std::string(static_cast<std::size_t>(index), 'x'), .values = {}, .optional = {}};
+            ASSERT_TRUE(output(record));
+        }
+    }
+
+    // A chunk smaller than most records forces the window to carry partial
+    // lines forward and grow only up to the longest record.
+    SimdJsonSerializer::LinesInputSerializer input(stream, 16);
+    SimdSmoke record;
+    int expected = 0;
+    while (input(record)) {
+        ASSERT_EQ(record.id, expected);
+        ASSERT_EQ(record.text.size(), static_cast<std::size_t>(expected));
+        ++expected;
+    }
+    EXPECT_TRUE(input.eof()) << (input.error() == nullptr ? "" : input.error()->msg);
+    EXPECT_EQ(expected, 200);
+
+    const auto padded = simdjson::padded_string(std::string_view{"1\n2\n3\n"});
+    SimdJsonSerializer::LinesInputSerializer paddedInput(padded);
+    int sum = 0;
+    int value = 0;
+    while (paddedInput(value)) {
+        sum += value;
+    }
+    EXPECT_TRUE(paddedInput.eof());
+    EXPECT_EQ(sum, 6);
+}
+
+TEST(SimdJsonBackend, JsonLinesBatchesAroundOversizedRecord) {
+    // Small records are parsed in default-sized batches; only the record that
+    // exceeds the batch size widens it.
+    std::string lines;
+    for (int index = 0; index < 4096; ++index) {
+        lines += "{\"id\":" + std::to_string(index) + ",\"text\":\"\",\"values\":[]}\n";
+    }
+    const std::string longText(simdjson::dom::DEFAULT_BATCH_SIZE + 1024, 'x');
+    lines += "{\"id\":4096,\"text\":\"" + longText + "\",\"values\":[]}\n";
+    lines += "{\"id\":4097,\"text\":\"\",\"values\":[]}";
+
+    SimdJsonSerializer::LinesInputSerializer input(lines.data(), lines.size());
+    SimdSmoke record;
+    int expected = 0;
+    while (input(record)) {
+        ASSERT_EQ(record.id, expected);
+        ASSERT_EQ(record.text.size(), expected == 4096 ? longText.size() : 0U);
+        ++expected;
+    }
+    EXPECT_TRUE(input.eof()) << (input.error() == nullptr ? "" : input.error()->msg);
+    EXPECT_EQ(expected, 4098);
+}
+
+TEST(SimdJsonBackend, JsonLinesSeparatesRecordAndSyntaxErrors) {
+    const std::string lines = "{\"value\":1}\n{\"value\":\"text\"}\n{\"value\":3}\n{\"value\":\n";
+    SimdJsonSerializer::LinesInputSerializer input(lines.data(), lines.size());
+    SimdRequiredField record;
+
+    ASSERT_TRUE(input(record));
+    EXPECT_EQ(record.value, 1);
+
+    EXPECT_FALSE(input(record));
+    ASSERT_NE(input.error(), nullptr);
+    EXPECT_EQ(input.error()->ec, sa::make_error_code(sa::ErrorCode::InvalidType));
+    EXPECT_FALSE(input.eof());
+    EXPECT_EQ(record.value, 1);
+
+    ASSERT_TRUE(input(record));
+    EXPECT_EQ(record.value, 3);
+
+    EXPECT_FALSE(input(record));
+    ASSERT_NE(input.error(), nullptr);
+    EXPECT_EQ(input.error()->ec, sa::make_error_code(sa::ErrorCode::ParseError));
+    EXPECT_FALSE(input(record));
+    EXPECT_FALSE(input.eof());
+}
+
+TEST(SimdJsonBackend, TranscodesJsonThroughBinaryWithoutTypes) {
+    const std::string json =
+        R"({"id":7,"name":"neko","tags":["a","b"],"ratio":0.5,"nested":{"ok":true,"none":null},)"
+        R"("big":18446744073709551615,"neg":-3})";
+    std::vector<char> binary;
+    auto result = transcode<SimdJsonSerializer, BinarySerializer>(json.data(), json.size(), binary);
+    ASSERT_TRUE(result) << result.error().msg;
+
+    std::vector<char> back;
+    result = transcode<BinarySerializer, SimdJsonSerializer>(binary.data(), binary.size(), back);
+    ASSERT_TRUE(result) << result.error().msg;
+    EXPECT_EQ(std::string(back.begin(), back.end()), json);
+}
+
+TEST(SimdJsonBackend, SchemaTranscodeMatchesTypedBinaryOutput) {
+    const std::string json =
+        R"({"id":3,"name":"row","rows":[{"ok":true,"count":null},{"ok":false,"count":2}],"big":9,"extra":1})";
+    std::vector<char> transcoded;
+    auto result = transcode<SimdJsonSerializer, BinarySerializer, TranscodeMessage>(json.data(), json.size(),
+                                                                                     transcoded);
+    ASSERT_TRUE(result) << result.error().msg;
+
+    TranscodeMessage message;
+    ASSERT_TRUE(read_json(json, message));
+    std::vector<char> typed;
+    {
+        BinarySerializer::OutputSerializer output(typed);
+        ASSERT_TRUE(output(message));
+    }
+    EXPECT_EQ(transcoded, typed);
+
+    // Id objects may carry hashed keys, so reading them back needs the schema.
+    std::vector<char> back;
+    result = transcode<BinarySerializer, SimdJsonSerializer>(transcoded.data(), transcoded.size(), back);
+    EXPECT_FALSE(result);
+    back.clear();
+    result = transcode<BinarySerializer, SimdJsonSerializer, TranscodeMessage>(transcoded.data(), transcoded.size(),
+                                                                                back);
+    ASSERT_TRUE(result) << result.error().msg;
+    EXPECT_EQ(std::string(back.begin(), back.end()),
+              R"({"id":3,"name":"row","rows":[{"ok":true},{"ok":false,"count":2}],"big":9})");
+}
+
+TEST(SimdJsonBackend, TranscodeReportsInputErrors) {
+    const std::string json = R"({"id":)";
+    std::vector<char> binary;
+    const auto result = transcode<SimdJsonSerializer, BinarySerializer>(json.data(), json.size(), binary);
+    ASSERT_FALSE(result);
+    EXPECT_EQ(result.error().ec, sa::make_error_code(sa::ErrorCode::ParseError));
+    EXPECT_TRUE(binary.empty());
+}
+
 #endif
 
 #include "../common/common_main.cpp.in" // IWYU pragma: export
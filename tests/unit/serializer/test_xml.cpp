@@ -1,6 +1,7 @@
 #include <iterator>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -79,6 +80,64 @@ struct XmlPositionalComments {
     };
 };
 
+struct XmlViews {
+    std::string_view name;
+    std::string_view title;
+    int id = 0;
+
+    NEKO_SERIALIZER(name, title, id)
+};
+
+struct XmlLeaf {
+    std::string label;
+    std::vector<int> codes;
+
+    NEKO_SERIALIZER(label, codes)
+
+    bool operator==(const XmlLeaf&) const = default;
+};
+
+struct XmlBranch {
+    std::string name;
+    std::vector<XmlLeaf> leaves;
+    std::vector<std::vector<XmlChild>> groups;
+
+    NEKO_SERIALIZER(name, leaves, groups)
+
+    bool operator==(const XmlBranch&) const = default;
+};
+
+struct XmlTree {
+    int id = 0;
+    std::vector<XmlBranch> branches;
+    std::vector<std::vector<XmlLeaf>> grid;
+    std::string_view tag;
+
+    NEKO_SERIALIZER(id, branches, grid, tag)
+};
+
+XmlTree makeTree() {
+    XmlTree tree;
+    tree.id       = 11;
+    tree.branches = {
+        {.name = "first",
+         .leaves = {{.label = "a", .codes = {1, 2}}, {.label = "b & c", .codes = {}}},
+         .groups = {{{"Alice", 8}, {"Bob", 10}}, {}, {{"Carol", 12}}}},
+        {.name = "empty", .leaves = {}, .groups = {}},
+        {.name = "last", .leaves = {{.label = "<z>", .codes = {3}}}, .groups = {{}}},
+    };
+    tree.grid = {{{.label = "x", .codes = {4, 5}}}, {}, {{.label = "y", .codes = {}}, {.label = "w", .codes = {6}}}};
+    tree.tag  = "t&g";
+    return tree;
+}
+
+void expectSameTree(const XmlTree& decoded, const XmlTree& source) {
+    EXPECT_EQ(decoded.id, source.id);
+    EXPECT_EQ(decoded.branches, source.branches);
+    EXPECT_EQ(decoded.grid, source.grid);
+    EXPECT_EQ(decoded.tag, source.tag);
+}
+
 std::string asString(const std::vector<char>& buffer) { return {buffer.begin(), buffer.end()}; }
 
 std::size_t countOccurrences(std::string_view input, std::string_view needle) {
@@ -294,6 +353,106 @@ TEST(PugiXmlBackend, WriteModifierTagsCanBeLayered) {
     EXPECT_STREQ(outerRoot.child("value").previous_sibling().value(), "outer comment");
 }
 
+TEST(PugiXmlBackend, ReadsStringViewsFromInplaceBuffer) {
+    std::string input = R"(<views><name>Alice</name><title>a &amp; b</title><id>3</id></views>)";
+    XmlViews decoded;
+    PugiXmlInputSerializer in(std::span<char>{input});
+
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    EXPECT_EQ(decoded.name, "Alice");
+    EXPECT_EQ(decoded.title, "a & b");
+    EXPECT_EQ(decoded.id, 3);
+    EXPECT_GE(decoded.name.data(), input.data());
+    EXPECT_LT(decoded.name.data(), input.data() + input.size());
+    EXPECT_GE(decoded.title.data(), input.data());
+    EXPECT_LT(decoded.title.data(), input.data() + input.size());
+}
+
+TEST(PugiXmlBackend, RoundTripsNestedArraysOfObjects) {
+    const auto source = makeTree();
+    std::vector<char> buffer;
+    PugiXmlOutputSerializer out(buffer, "tree");
+    ASSERT_TRUE(out(source));
+    ASSERT_TRUE(out.end());
+
+    pugi::xml_document document;
+    ASSERT_TRUE(document.load_buffer(buffer.data(), buffer.size()));
+    const auto root = document.child("tree");
+    ASSERT_TRUE(root);
+    EXPECT_EQ(std::distance(root.children("branches").begin(), root.children("branches").end()), 3);
+    EXPECT_EQ(std::distance(root.children("grid").begin(), root.children("grid").end()), 3);
+
+    XmlTree decoded;
+    PugiXmlInputSerializer in(buffer.data(), buffer.size());
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    expectSameTree(decoded, source);
+
+    const std::vector<std::vector<XmlBranch>> nested{{source.branches[0]}, {}, source.branches};
+    std::vector<char> arrayBuffer;
+    PugiXmlOutputSerializer arrayOut(arrayBuffer, "forest");
+    ASSERT_TRUE(arrayOut(nested));
+    ASSERT_TRUE(arrayOut.end());
+
+    std::vector<std::vector<XmlBranch>> nestedDecoded;
+    PugiXmlInputSerializer arrayIn(arrayBuffer.data(), arrayBuffer.size());
+    ASSERT_TRUE(arrayIn(nestedDecoded)) << (arrayIn.error() == nullptr ? "" : arrayIn.error()->msg);
+    EXPECT_EQ(nestedDecoded, nested);
+}
+
+TEST(PugiXmlBackend, InplaceParseRoundTripsWriterOutput) {
+    const auto source = makeTree();
+    std::vector<char> buffer;
+    PugiXmlOutputSerializer out(buffer, "tree");
+    ASSERT_TRUE(out(source));
+    ASSERT_TRUE(out.end());
+
+    // Parsing in place rewrites the buffer, so decode from a copy and keep it alive with the views.
+    auto inplace = buffer;
+    XmlTree decoded;
+    PugiXmlInputSerializer in(std::span<char>{inplace});
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    expectSameTree(decoded, source);
+    EXPECT_GE(decoded.tag.data(), inplace.data());
+    EXPECT_LT(decoded.tag.data(), inplace.data() + inplace.size());
+
+    const std::vector<XmlLeaf> leaves{{.label = "only", .codes = {}}, {.label = "", .codes = {7, 8}}};
+    std::vector<char> arrayBuffer;
+    PugiXmlOutputSerializer arrayOut(arrayBuffer, "leaves");
+    ASSERT_TRUE(arrayOut(leaves));
+    ASSERT_TRUE(arrayOut.end());
+
+    std::vector<XmlLeaf> leavesDecoded;
+    PugiXmlInputSerializer arrayIn(std::span<char>{arrayBuffer});
+    ASSERT_TRUE(arrayIn(leavesDecoded)) << (arrayIn.error() == nullptr ? "" : arrayIn.error()->msg);
+    EXPECT_EQ(leavesDecoded, leaves);
+}
+
+TEST(PugiXmlBackend, StreamingWriterClosesElementsImplicitly) {
+    std::string output = "prefix";
+    xml::Writer writer(output);
+    writer.reset("person");
+    auto root  = writer.objectAsRoot(0);
+    auto child = writer.addObjectToObject("child", 0, &root);
+    writer.addValueToObject("name", std::string_view{"A&B"}, &child);
+    auto tags = writer.addArrayToObject("tags", 0, &child);
+    writer.addValueToArray(std::string_view{"x"}, &tags);
+    writer.addArrayToObject("none", 0, &child);
+    writer.addValueToObject("id", 7, &root, true);
+    writer.addValueToObject("quote", std::string_view{"\"<"}, &root, true);
+    writer.finish();
+
+    ASSERT_EQ(output.rfind("prefix", 0), 0U);
+    pugi::xml_document document;
+    ASSERT_TRUE(document.load_buffer(output.data() + 6, output.size() - 6));
+    const auto person = document.child("person");
+    ASSERT_TRUE(person);
+    EXPECT_EQ(person.attribute("id").as_int(), 7);
+    EXPECT_STREQ(person.attribute("quote").value(), "\"<");
+    EXPECT_STREQ(person.child("child").child("name").child_value(), "A&B");
+    EXPECT_STREQ(person.child("child").child("tags").child_value(), "x");
+    EXPECT_STREQ(person.child("child").child("none").attribute("neko-array").value(), "empty");
+}
+
 TEST(PugiXmlBackend, ReportsParseAndFieldErrors) {
     {
         const std::string malformed = "<document>";
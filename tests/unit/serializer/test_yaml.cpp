@@ -3,6 +3,7 @@
 #include <array>
 #include <limits>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -24,6 +25,22 @@ struct YamlNested {
     NEKO_SERIALIZER((make_tags<rename_tag<"wire_code">>(code)), label)
 };
 
+struct YamlAliases {
+    YamlNested base;
+    YamlNested copy;
+    std::vector<std::vector<int>> rows;
+
+    NEKO_SERIALIZER(base, copy, rows)
+};
+
+struct YamlTagged {
+    std::string name;
+    int value = 0;
+
+    NEKO_SERIALIZER((make_tags<yaml_tag<"!name">, yaml_scalar_style_tag<YamlScalarStyle::DoubleQuoted>>(name)),
+                    (make_tags<yaml_tag<"!value">>(value)))
+};
+
 struct Config {
     std::string key;
     std::variant<std::monostate, int, std::string, double> values;
@@ -128,6 +145,118 @@ TEST(YamlSerialization, WriterErrorsAreReportedAsSerializationErrors) {
     EXPECT_EQ(output.error()->ec, sa::make_error_code(sa::ErrorCode::InvalidType));
 }
 
+#if defined(NEKO_PROTO_ENABLE_LIBFYAML)
+TEST(YamlSerialization, LibfyamlEventReaderResolvesAliases) {
+    const std::string input = "base: &shared {wire_code: 3, label: three}\n"
+                              "copy: *shared\n"
+                              "rows: [[1, 2], [], [3]]\n";
+    YamlAliases decoded;
+    LibfyamlInputSerializer in(input.data(), input.size());
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    EXPECT_EQ(decoded.base.code, 3);
+    EXPECT_EQ(decoded.copy.code, 3);
+    EXPECT_EQ(decoded.copy.label, "three");
+    EXPECT_EQ(decoded.rows, (std::vector<std::vector<int>>{{1, 2}, {}, {3}}));
+
+    const std::string unknown = "base: *missing\n";
+    LibfyamlInputSerializer bad(unknown.data(), unknown.size());
+    EXPECT_FALSE(bad(decoded));
+}
+
+TEST(YamlSerialization, LibfyamlEventReaderExpandsMergeKeys) {
+    const std::string input = "base: &shared {wire_code: 3, label: three}\n"
+                              "copy:\n"
+                              "  <<: *shared\n"
+                              "  label: own\n"
+                              "rows: []\n";
+    YamlAliases decoded;
+    LibfyamlInputSerializer in(input.data(), input.size());
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    EXPECT_EQ(decoded.copy.code, 3);
+    EXPECT_EQ(decoded.copy.label, "own");
+
+    // Earlier sources of a merge list win over later ones.
+    const std::string list = "base: &first {wire_code: 1, label: one}\n"
+                             "copy: {<<: [{label: two}, *first]}\n"
+                             "rows: []\n";
+    LibfyamlInputSerializer listIn(list.data(), list.size());
+    ASSERT_TRUE(listIn(decoded)) << (listIn.error() == nullptr ? "" : listIn.error()->msg);
+    EXPECT_EQ(decoded.copy.code, 1);
+    EXPECT_EQ(decoded.copy.label, "two");
+
+    const std::string scalar = "base: {wire_code: 1, label: one}\n"
+                               "copy: {<<: 5}\n"
+                               "rows: []\n";
+    LibfyamlInputSerializer bad(scalar.data(), scalar.size());
+    EXPECT_FALSE(bad(decoded));
+}
+
+TEST(YamlSerialization, LibfyamlEventReaderRejectsDeepNestingAndMergeChains) {
+    std::vector<int> decoded;
+    const auto depth = yaml::Document::KMaxDepth + 1U;
+    const auto deep  = std::string(depth, '[') + std::string(depth, ']');
+    LibfyamlInputSerializer deepIn(deep.data(), deep.size());
+    ASSERT_FALSE(deepIn(decoded));
+    ASSERT_NE(deepIn.error(), nullptr);
+    EXPECT_EQ(deepIn.error()->ec, sa::make_error_code(sa::ErrorCode::ParseError));
+
+    // Every link merges the previous one, so the copied entries grow quadratically with the chain.
+    std::string chain = "l0: &l0 {k0: 0}\n";
+    for (std::size_t link = 1; link < 1600U; ++link) {
+        const auto id = std::to_string(link);
+        chain += "l" + id + ": &l" + id + " {<<: *l" + std::to_string(link - 1U) + ", k" + id + ": " + id + "}\n";
+    }
+    YamlAliases aliases;
+    LibfyamlInputSerializer chainIn(chain.data(), chain.size());
+    ASSERT_FALSE(chainIn(aliases));
+    ASSERT_NE(chainIn.error(), nullptr);
+    EXPECT_EQ(chainIn.error()->ec, sa::make_error_code(sa::ErrorCode::ParseError));
+    EXPECT_NE(chainIn.error()->msg.find("merge keys"), std::string::npos) << chainIn.error()->msg;
+}
+
+TEST(YamlSerialization, LibfyamlEventWriterKeepsTextOfQueuedEvents) {
+    std::vector<std::vector<YamlTagged>> source;
+    for (int row = 0; row < 20; ++row) {
+        source.push_back({{.name = "row" + std::to_string(row), .value = row}, {.name = "", .value = -row}});
+    }
+    std::ostringstream stream;
+    {
+        LibfyamlOutputSerializer out(stream);
+        ASSERT_TRUE(out(source)) << (out.error() == nullptr ? "" : out.error()->msg);
+    }
+    const auto output = stream.str();
+    EXPECT_EQ(countOccurrences(output, "!name"), 40U) << output;
+    EXPECT_NE(output.find("row19"), std::string::npos) << output;
+
+    std::vector<std::vector<YamlTagged>> decoded;
+    LibfyamlInputSerializer in(output.data(), output.size());
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    ASSERT_EQ(decoded.size(), source.size());
+    EXPECT_EQ(decoded[19][0].name, "row19");
+    EXPECT_EQ(decoded[19][1].value, -19);
+}
+
+TEST(YamlSerialization, LibfyamlEventWriterStreamsNestedCollections) {
+    const YamlAliases source{.base = {.code = 1, .label = "one"},
+                             .copy = {.code = 2, .label = "two"},
+                             .rows = {{1}, {}, {2, 3}}};
+    std::ostringstream stream;
+    {
+        LibfyamlOutputSerializer out(stream);
+        ASSERT_TRUE(out(source)) << (out.error() == nullptr ? "" : out.error()->msg);
+    }
+    const auto output = stream.str();
+    EXPECT_EQ(output, writeYaml(source));
+
+    YamlAliases decoded;
+    LibfyamlInputSerializer in(output.data(), output.size());
+    ASSERT_TRUE(in(decoded)) << (in.error() == nullptr ? "" : in.error()->msg);
+    EXPECT_EQ(decoded.base.label, "one");
+    EXPECT_EQ(decoded.copy.code, 2);
+    EXPECT_EQ(decoded.rows, source.rows);
+}
+#endif
+
 #if defined(NEKO_PROTO_ENABLE_YAMLCPP)
 TEST(YamlSerialization, YamlCppBackendRoundTripsObjects) {
     const YamlDocument source{.title   = "yaml-cpp",
@@ -410,7 +410,7 @@ if has_config("enable_communication") then
         add_headerfiles("include/(nekoproto/communication/**.hpp)")
         add_headerfiles("include/(nekoproto/transport/**.hpp)")
         add_includedirs("include")
-        add_files("src/communication_base.cpp")
+        add_files("src/communication_base.cpp", "src/serializer_pool.cpp")
 
         on_load(function (target)
             import("lua.auto", {rootdir = os.projectdir()})